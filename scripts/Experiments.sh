@@ -24,6 +24,14 @@ bin/main -t 2 -m 3 -a 25 -b 50 > data/rstartree.cali.50.c.out
 bin/main -t 2 -m 3 -a 25 -b 50 > data/rstartree.cali.50.d.out
 bin/main -t 2 -m 3 -a 25 -b 50 > data/rstartree.cali.50.e.out
 
+# Grid file and BKD-tree against the disk trees on UNIFORM and SKEW
+#for t in 0 1 2 3 6 7; do
+#	rm -f *diskbacked*.txt
+#	bin/main -t $t -m 0 -n 1000000 > data/disk.$t.uniform2.out
+#	rm -f *diskbacked*.txt
+#	bin/main -t $t -m 1 > data/disk.$t.skew2.out
+#done
+
 # NIR
 #bin/main -t 3 -m 0 -n 10000000 -b 1000 > data/nirtree.uniform2.1000.a.out
 #bin/main -t 3 -m 0 -n 10000000 -b 1000 > data/nirtree.uniform2.1000.b.out
@@ -0,0 +1,299 @@
+#include <bench/contention.h>
+#include <bench/randomPoints.h>
+#include <rtree/concurrentrtree.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+// Searches each reader thread makes per run
+#define CONTENTION_SEARCHES_PER_THREAD 200000
+
+// Operations each thread makes per run of the in-memory comparison
+#define CONCURRENT_OPERATIONS_PER_THREAD 200000
+
+enum ContentionMode {SHARED_LATCH, OPTIMISTIC, OPTIMISTIC_WITH_WRITER};
+
+static std::vector<Point> contentionPoints(unsigned count, unsigned seed)
+{
+	std::default_random_engine generator(seed);
+	std::uniform_real_distribution<double> pointDist(0.0, 1.0);
+	std::vector<Point> points;
+	points.reserve(count);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		Point p;
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			p[d] = pointDist(generator);
+		}
+		points.push_back(p);
+	}
+	return points;
+}
+
+// Returns searches per second
+static double runContention(Index *spatialIndex, const std::vector<Point> &points, unsigned threadCount, ContentionMode mode, unsigned &writes)
+{
+	std::shared_mutex latch;
+	std::atomic<bool> stop(false);
+	std::atomic<bool> missing(false);
+	std::vector<std::thread> readers;
+
+	std::thread writer;
+	writes = 0;
+	if (mode == OPTIMISTIC_WITH_WRITER)
+	{
+		writer = std::thread([&]() {
+			// Away from the points being searched for, so the results
+			// don't change
+			std::default_random_engine generator(threadCount);
+			std::uniform_real_distribution<double> pointDist(2.0, 3.0);
+			while (!stop.load(std::memory_order_relaxed))
+			{
+				Point p;
+				for (unsigned d = 0; d < dimensions; ++d)
+				{
+					p[d] = pointDist(generator);
+				}
+				spatialIndex->insert(p);
+				++writes;
+			}
+		});
+	}
+
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	for (unsigned t = 0; t < threadCount; ++t)
+	{
+		readers.emplace_back([&, t]() {
+			size_t next = t * 7919;
+			for (unsigned i = 0; i < CONTENTION_SEARCHES_PER_THREAD; ++i)
+			{
+				const Point &p = points[next % points.size()];
+				next += 104729;
+				std::vector<Point> v;
+				if (mode == SHARED_LATCH)
+				{
+					std::shared_lock<std::shared_mutex> guard(latch);
+					v = spatialIndex->search(p);
+				}
+				else
+				{
+					v = spatialIndex->search(p);
+				}
+				if (v.empty())
+				{
+					missing = true;
+				}
+			}
+		});
+	}
+	for (std::thread &reader : readers)
+	{
+		reader.join();
+	}
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	stop = true;
+	if (writer.joinable())
+	{
+		writer.join();
+	}
+	if (missing)
+	{
+		std::cout << "Search missed a point!" << std::endl;
+		exit(1);
+	}
+
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+	return (double) threadCount * CONTENTION_SEARCHES_PER_THREAD / seconds;
+}
+
+void contentionBenchmark(std::map<std::string, unsigned> &configU)
+{
+	if (configU["tree"] != R_TREE && configU["tree"] != R_STAR_TREE)
+	{
+		std::cout << "The contention benchmark needs the R-Tree or R*-Tree disk tree." << std::endl;
+		return;
+	}
+
+	Index *spatialIndex = createIndex(configU);
+	uint64_t pointCount;
+	std::atomic<uint64_t> *restarts;
+	if (configU["tree"] == R_TREE)
+	{
+		rtreedisk::RTreeDisk<3,6> *tree = (rtreedisk::RTreeDisk<3,6> *) spatialIndex;
+		tree->enableOptimisticReads();
+		pointCount = tree->point_count_;
+		restarts = &tree->optimistic_restarts_;
+	}
+	else
+	{
+		rstartreedisk::RStarTreeDisk<7,15> *tree = (rstartreedisk::RStarTreeDisk<7,15> *) spatialIndex;
+		tree->enableOptimisticReads();
+		pointCount = tree->point_count_;
+		restarts = &tree->optimistic_restarts_;
+	}
+
+	std::vector<Point> points = contentionPoints(configU["size"], configU["seed"]);
+	if (pointCount == 0)
+	{
+		for (const Point &p : points)
+		{
+			spatialIndex->insert(p);
+		}
+		std::cout << "Inserted " << points.size() << " points." << std::endl;
+	}
+	else if (pointCount < points.size())
+	{
+		std::cout << "Existing index holds " << pointCount << " points but the benchmark has " << points.size() << ". Remove the backing file to rebuild it." << std::endl;
+		return;
+	}
+
+	const char *modeNames[] = {"shared latch", "optimistic", "optimistic with a writer"};
+	for (ContentionMode mode : {SHARED_LATCH, OPTIMISTIC, OPTIMISTIC_WITH_WRITER})
+	{
+		std::cout << "Point searches, " << modeNames[mode] << ":" << std::endl;
+		for (unsigned threadCount = 1; ; threadCount *= 2)
+		{
+			threadCount = std::min(threadCount, configU["contention"]);
+			uint64_t restartsBefore = restarts->load();
+			unsigned writes;
+			double rate = runContention(spatialIndex, points, threadCount, mode, writes);
+			std::cout << "  " << threadCount << " threads: " << rate << " searches/s";
+			if (mode != SHARED_LATCH)
+			{
+				std::cout << ", " << restarts->load() - restartsBefore << " restarts";
+			}
+			if (mode == OPTIMISTIC_WITH_WRITER)
+			{
+				std::cout << ", " << writes << " inserts";
+			}
+			std::cout << std::endl;
+			if (threadCount == configU["contention"])
+			{
+				break;
+			}
+		}
+	}
+
+	spatialIndex->write_metadata();
+}
+
+// Returns operations per second. Every writePercent-th operation in a
+// hundred inserts a new point away from those being searched for; the
+// rest search for one of points. latch is null for trees that need none.
+static double runInMemory(Index *spatialIndex, std::shared_mutex *latch, const std::vector<Point> &points, unsigned threadCount, unsigned writePercent, unsigned run)
+{
+	std::atomic<bool> missing(false);
+	std::vector<std::thread> threads;
+
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	for (unsigned t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&, t]() {
+			std::default_random_engine generator(run * 1000 + t);
+			std::uniform_real_distribution<double> pointDist(2.0, 3.0);
+			size_t next = t * 7919;
+			for (unsigned i = 0; i < CONCURRENT_OPERATIONS_PER_THREAD; ++i)
+			{
+				if (i % 100 < writePercent)
+				{
+					Point p;
+					for (unsigned d = 0; d < dimensions; ++d)
+					{
+						p[d] = pointDist(generator);
+					}
+					if (latch != nullptr)
+					{
+						std::unique_lock<std::shared_mutex> guard(*latch);
+						spatialIndex->insert(p);
+					}
+					else
+					{
+						spatialIndex->insert(p);
+					}
+					continue;
+				}
+
+				const Point &p = points[next % points.size()];
+				next += 104729;
+				std::vector<Point> v;
+				if (latch != nullptr)
+				{
+					std::shared_lock<std::shared_mutex> guard(*latch);
+					v = spatialIndex->search(p);
+				}
+				else
+				{
+					v = spatialIndex->search(p);
+				}
+				if (v.empty())
+				{
+					missing = true;
+				}
+			}
+		});
+	}
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	if (missing)
+	{
+		std::cout << "Search missed a point!" << std::endl;
+		exit(1);
+	}
+
+	double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+	return (double) threadCount * CONCURRENT_OPERATIONS_PER_THREAD / seconds;
+}
+
+void concurrentRTreeBenchmark(std::map<std::string, unsigned> &configU)
+{
+	std::vector<Point> points = contentionPoints(configU["size"], configU["seed"]);
+	rtree::RTree latchedTree(configU["minfanout"], configU["maxfanout"]);
+	rtree::ConcurrentRTree concurrentTree(configU["minfanout"], configU["maxfanout"]);
+	std::shared_mutex latch;
+	for (const Point &p : points)
+	{
+		latchedTree.insert(p);
+		concurrentTree.insert(p);
+	}
+	std::cout << "Inserted " << points.size() << " points." << std::endl;
+
+	unsigned run = 0;
+	for (unsigned writePercent : {0u, 10u})
+	{
+		std::cout << "Point searches with " << writePercent << "% inserts:" << std::endl;
+		for (unsigned threadCount = 1; ; threadCount *= 2)
+		{
+			threadCount = std::min(threadCount, configU["concurrent"]);
+			double latchedRate = runInMemory(&latchedTree, &latch, points, threadCount, writePercent, run++);
+			uint64_t exclusiveBefore = concurrentTree.exclusiveWrites.load();
+			double concurrentRate = runInMemory(&concurrentTree, nullptr, points, threadCount, writePercent, run++);
+			std::cout << "  " << threadCount << " threads: latched " << latchedRate << " ops/s, concurrent " << concurrentRate << " ops/s (" << concurrentRate / latchedRate << "x)";
+			if (writePercent > 0)
+			{
+				std::cout << ", " << concurrentTree.exclusiveWrites.load() - exclusiveBefore << " writes held the whole tree";
+			}
+			std::cout << std::endl;
+			if (threadCount == configU["concurrent"])
+			{
+				break;
+			}
+		}
+	}
+
+	if (!concurrentTree.validate())
+	{
+		std::cout << "Concurrent tree failed validation!" << std::endl;
+		exit(1);
+	}
+	std::cout << "Concurrent tree validates." << std::endl;
+}
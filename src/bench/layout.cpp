@@ -0,0 +1,242 @@
+#include <bench/layout.h>
+#include <rstartree/rstartree.h>
+#include <nirtree/nirtree.h>
+#include <util/packedtree.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Point searches run through each layout
+#define LAYOUT_POINT_SEARCHES 100000
+
+// Range searches are sized to return about this many points
+#define LAYOUT_RANGE_RESULT_SIZE 1000
+
+// Counts one kind of cache miss on this thread, in user space only
+class CacheMissCounter
+{
+	public:
+		CacheMissCounter(uint32_t type, uint64_t config)
+		{
+			perf_event_attr attributes;
+			std::memset(&attributes, 0, sizeof(attributes));
+			attributes.size = sizeof(attributes);
+			attributes.type = type;
+			attributes.config = config;
+			attributes.disabled = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			fd = syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+		}
+
+		~CacheMissCounter()
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+
+		bool available() const
+		{
+			return fd >= 0;
+		}
+
+		void start()
+		{
+			if (fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+
+		uint64_t stop()
+		{
+			uint64_t count = 0;
+			if (fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+				if (read(fd, &count, sizeof(count)) != sizeof(count))
+				{
+					count = 0;
+				}
+			}
+			return count;
+		}
+
+	private:
+		int fd;
+};
+
+class LayoutMeasurement
+{
+	public:
+		double seconds;
+		uint64_t l1Misses;
+		uint64_t llcMisses;
+		uint64_t results;
+};
+
+template <typename Query, typename Search>
+static LayoutMeasurement measure(const std::vector<Query> &queries, Search search)
+{
+	CacheMissCounter l1(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	CacheMissCounter llc(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+	LayoutMeasurement measurement;
+	measurement.results = 0;
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	l1.start();
+	llc.start();
+	for (const Query &query : queries)
+	{
+		measurement.results += search(query).size();
+	}
+	measurement.llcMisses = llc.stop();
+	measurement.l1Misses = l1.stop();
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+	measurement.seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+
+	// Reported as a pair, so one missing counter hides both
+	if (not l1.available() or not llc.available())
+	{
+		measurement.l1Misses = UINT64_MAX;
+		measurement.llcMisses = UINT64_MAX;
+	}
+	return measurement;
+}
+
+static void report(const char *layout, const LayoutMeasurement &measurement, size_t queryCount)
+{
+	std::cout << "    " << layout << ": " << measurement.seconds / queryCount * 1e6 << "us";
+	if (measurement.l1Misses == UINT64_MAX)
+	{
+		std::cout << " per query, cache misses unavailable" << std::endl;
+	}
+	else
+	{
+		std::cout << ", " << (double) measurement.l1Misses / queryCount << " L1d misses, " << (double) measurement.llcMisses / queryCount << " LLC misses per query" << std::endl;
+	}
+}
+
+template <typename T>
+static void runLayout(const char *name, T &tree, const std::vector<Point> &points, const std::vector<Rectangle> &rectangles)
+{
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	for (const Point &p : points)
+	{
+		tree.insert(p);
+	}
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+	double insertTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+
+	begin = std::chrono::high_resolution_clock::now();
+	PackedTree packed = tree.pack();
+	end = std::chrono::high_resolution_clock::now();
+	double packTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+
+	std::cout << name << ": inserted in " << insertTime << "s, packed in " << packTime << "s" << std::endl;
+	std::cout << "  " << packed.nodeCount() << " nodes in " << packed.size() << " bytes, " << (double) packed.size() / CACHE_LINE_SIZE / packed.nodeCount() << " cache lines per node" << std::endl;
+	if (not packed.validate())
+	{
+		std::cout << "Packed tree failed validation!" << std::endl;
+		exit(1);
+	}
+
+	// Search in a different order than the points went in
+	std::vector<Point> searchPoints(points.begin(), points.begin() + std::min((size_t) LAYOUT_POINT_SEARCHES, points.size()));
+	std::shuffle(searchPoints.begin(), searchPoints.end(), std::default_random_engine(points.size()));
+
+	LayoutMeasurement pointer = measure(searchPoints, [&](const Point &p) { return tree.search(p); });
+	LayoutMeasurement packedPoint = measure(searchPoints, [&](const Point &p) { return packed.search(p); });
+	std::cout << "  " << searchPoints.size() << " point searches:" << std::endl;
+	report("pointer nodes", pointer, searchPoints.size());
+	report("packed nodes", packedPoint, searchPoints.size());
+
+	// Learned routing on more and more of the branch levels
+	for (unsigned depth = 1; depth < packed.height(); ++depth)
+	{
+		PackedTree routed = tree.pack();
+		begin = std::chrono::high_resolution_clock::now();
+		routed.learnRouting(depth);
+		end = std::chrono::high_resolution_clock::now();
+		double learnTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+		if (routed.routedNodeCount() == 0)
+		{
+			// No branch this high has children enough to be worth it
+			continue;
+		}
+
+		LayoutMeasurement routedPoint = measure(searchPoints, [&](const Point &p) { return routed.search(p); });
+		std::string layout = "learned routing, top " + std::to_string(depth) + " levels (" + std::to_string(routed.routedNodeCount()) + " models, " + std::to_string(learnTime) + "s to learn)";
+		report(layout.c_str(), routedPoint, searchPoints.size());
+		if (routedPoint.results != packedPoint.results)
+		{
+			std::cout << "Learned routing missed points!" << std::endl;
+			exit(1);
+		}
+	}
+
+	LayoutMeasurement pointerRange = measure(rectangles, [&](const Rectangle &r) { return tree.search(r); });
+	LayoutMeasurement packedRange = measure(rectangles, [&](const Rectangle &r) { return packed.search(r); });
+	std::cout << "  " << rectangles.size() << " range searches:" << std::endl;
+	report("pointer nodes", pointerRange, rectangles.size());
+	report("packed nodes", packedRange, rectangles.size());
+
+	if (pointer.results != packedPoint.results or pointerRange.results != packedRange.results)
+	{
+		std::cout << "Packed searches disagree with the tree!" << std::endl;
+		exit(1);
+	}
+}
+
+void layoutBenchmark(std::map<std::string, unsigned> &configU)
+{
+	std::default_random_engine generator(configU["seed"]);
+	std::uniform_real_distribution<double> pointDist(0.0, 1.0);
+	std::vector<Point> points;
+	points.reserve(configU["size"]);
+	for (unsigned i = 0; i < configU["size"]; ++i)
+	{
+		Point p;
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			p[d] = pointDist(generator);
+		}
+		points.push_back(p);
+	}
+
+	double side = std::pow(std::min(1.0, (double) LAYOUT_RANGE_RESULT_SIZE / configU["size"]), 1.0 / dimensions);
+	std::uniform_real_distribution<double> cornerDist(0.0, 1.0 - side);
+	std::vector<Rectangle> rectangles;
+	for (unsigned i = 0; i < configU["rectanglescount"]; ++i)
+	{
+		Point lower;
+		Point upper;
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			lower[d] = cornerDist(generator);
+			upper[d] = lower[d] + side;
+		}
+		rectangles.push_back(Rectangle(lower, upper));
+	}
+
+	{
+		rstartree::RStarTree tree(configU["minfanout"], configU["maxfanout"]);
+		runLayout("R*-Tree", tree, points, rectangles);
+	}
+	{
+		nirtree::NIRTree tree(configU["minfanout"], configU["maxfanout"]);
+		runLayout("NIR-Tree", tree, points, rectangles);
+	}
+}
@@ -1,9 +1,13 @@
 #include <bench/randomPoints.h>
+#include <bench/selectivity.h>
 #include <unistd.h>
 
 unsigned BenchTypeClasses::Uniform::size = 10000;
 unsigned BenchTypeClasses::Uniform::dimensions = dimensions;
 unsigned BenchTypeClasses::Uniform::seed = 3141;
+unsigned BenchTypeClasses::Synthetic::size = 10000;
+unsigned BenchTypeClasses::Synthetic::seed = 3141;
+unsigned BenchTypeClasses::Synthetic::threads = 0;
 
 static void fileGoodOrDie(std::fstream &file)
 {
@@ -32,6 +36,13 @@ PointGenerator<T>::PointGenerator(BenchTag::FileBackedReadChunksAtATime) :
 {
 }
 
+template <typename T>
+PointGenerator<T>::PointGenerator(BenchTag::SyntheticGenerated) :
+	benchmarkSize(T::size), offset(0),
+	syntheticStream(new SyntheticStream(T::distribution, T::size, T::seed, T::threads))
+{
+}
+
 
 template <typename T>
 void PointGenerator<T>::reset(BenchTag::DistributionGenerated)
@@ -52,6 +63,12 @@ void PointGenerator<T>::reset(BenchTag::FileBackedReadChunksAtATime)
 	backingFile.seekg(0);
 }
 
+template <typename T>
+void PointGenerator<T>::reset(BenchTag::SyntheticGenerated)
+{
+	syntheticStream->reset();
+}
+
 template <typename T>
 void PointGenerator<T>::reset()
 {
@@ -151,6 +168,14 @@ std::optional<Point> PointGenerator<T>::nextPoint(BenchTag::FileBackedReadChunks
 	return pointBuffer[offset++ % 10000];
 }
 
+template <typename T>
+std::optional<Point> PointGenerator<T>::nextPoint(BenchTag::SyntheticGenerated)
+{
+	// Never materialized, so billions of points stream straight into
+	// the index
+	return syntheticStream->nextPoint();
+}
+
 template <typename T>
 std::optional<Point> PointGenerator<T>::nextPoint()
 {
@@ -454,73 +479,129 @@ static Rectangle *generateGaiaRectangles()
 
 static bool is_already_loaded(
     std::map<std::string, unsigned> &configU,
-    Index *spatial_index
+    Index *spatial_index,
+    uint64_t expected_point_count
 ) {
+    // The constructors have already checked the superblock against the
+    // tree type and fanout, all that is left is the data itself.
+    uint64_t point_count = 0;
     if( configU["tree"] == NIR_TREE ) {
-        
         nirtreedisk::NIRTreeDisk<3,7,nirtreedisk::ExperimentalStrategy>
             *tree =
             (nirtreedisk::NIRTreeDisk<3,7,nirtreedisk::ExperimentalStrategy> *) spatial_index;
-
-        size_t existing_page_count = tree->node_allocator_.buffer_pool_.get_preexisting_page_count();
-        if( existing_page_count > 0 ) {
-            return true;
-        }
+        point_count = tree->point_count_;
+    } else if( configU["tree"] == R_TREE ) {
+        rtreedisk::RTreeDisk<3,6> *tree =
+            (rtreedisk::RTreeDisk<3,6> *) spatial_index;
+        point_count = tree->point_count_;
     } else if( configU["tree"] == R_PLUS_TREE ) {
         rplustreedisk::RPlusTreeDisk<3,7> *tree =
             (rplustreedisk::RPlusTreeDisk<3,7> *) spatial_index;
-        size_t existing_page_count = tree->node_allocator_.buffer_pool_.get_preexisting_page_count();
-        if( existing_page_count > 0 ) {
-            return true;
-        }
+        point_count = tree->point_count_;
     } else if( configU["tree"] == R_STAR_TREE ) {
         rstartreedisk::RStarTreeDisk<7,15> *tree =
             (rstartreedisk::RStarTreeDisk<7,15> *) spatial_index;
-        size_t existing_page_count = tree->node_allocator_.buffer_pool_.get_preexisting_page_count();
-        if( existing_page_count > 0 ) {
-            return true;
-        }
+        point_count = tree->point_count_;
+    } else if( configU["tree"] == GRID_FILE ) {
+        point_count = ((gridfile::GridFile *) spatial_index)->point_count_;
+    } else if( configU["tree"] == BKD_TREE ) {
+        point_count = ((bkdtree::BKDTree *) spatial_index)->point_count_;
+    }
+
+    if( point_count == 0 ) {
+        return false;
     }
 
-    return false;
+    if( point_count != expected_point_count ) {
+        std::cout << "Existing index holds " << point_count <<
+            " points but the benchmark has " << expected_point_count <<
+            ". Remove the backing file to rebuild it." << std::endl;
+        exit(1);
+    }
+
+    return true;
 }
-template <typename T>
-static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned> &configU, std::map<std::string, double> &configD)
-{
-	std::cout << "Running benchmark." << std::endl;
 
-	// Setup checksums
-	unsigned directSum = 0;
+static buffer_pool *disk_buffer_pool(
+    std::map<std::string, unsigned> &configU,
+    Index *spatial_index
+) {
+    if( configU["tree"] == NIR_TREE ) {
+        return &((nirtreedisk::NIRTreeDisk<3,7,nirtreedisk::ExperimentalStrategy> *)
+            spatial_index)->node_allocator_.buffer_pool_;
+    } else if( configU["tree"] == R_TREE ) {
+        return &((rtreedisk::RTreeDisk<3,6> *)
+            spatial_index)->node_allocator_.buffer_pool_;
+    } else if( configU["tree"] == R_PLUS_TREE ) {
+        return &((rplustreedisk::RPlusTreeDisk<3,7> *)
+            spatial_index)->node_allocator_.buffer_pool_;
+    } else if( configU["tree"] == R_STAR_TREE ) {
+        return &((rstartreedisk::RStarTreeDisk<7,15> *)
+            spatial_index)->node_allocator_.buffer_pool_;
+    } else if( configU["tree"] == GRID_FILE ) {
+        return &((gridfile::GridFile *)
+            spatial_index)->node_allocator_.buffer_pool_;
+    } else if( configU["tree"] == BKD_TREE ) {
+        return &((bkdtree::BKDTree *)
+            spatial_index)->node_allocator_.buffer_pool_;
+    }
+    return nullptr;
+}
 
-	// Setup statistics
-	double totalTimeInserts = 0.0;
-	double totalTimeSearches = 0.0;
-	double totalTimeRangeSearches = 0.0;
-	double totalTimeDeletes = 0.0;
-	unsigned totalInserts = 0;
-	double totalSearches = 0.0;
-	double totalRangeSearches = 0.0;
-	unsigned totalDeletes = 0.0;
+static void print_io_stats( buffer_pool *pool, const char *phase, size_t
+        pages_read_before, size_t bytes_read_before, size_t
+        read_calls_before ) {
+    if( pool == nullptr ) {
+        return;
+    }
+    std::cout << "Pages read during " << phase << ": " <<
+        pool->get_pages_read() - pages_read_before << " (" <<
+        pool->get_bytes_read() - bytes_read_before << " bytes in " <<
+        pool->get_read_calls() - read_calls_before << " reads)" <<
+        std::endl;
+    if( pool->get_partition_count() > 1 ) {
+        size_t hits = 0;
+        size_t local_hits = 0;
+        for( size_t i = 0; i < pool->get_partition_count(); i++ ) {
+            std::cout << "  Partition " << i << " (node " <<
+                pool->get_partition_node( i ) << "): " <<
+                pool->get_partition_hits( i ) << " hits (" <<
+                pool->get_partition_local_hits( i ) << " local), " <<
+                pool->get_partition_misses( i ) << " misses" << std::endl;
+            hits += pool->get_partition_hits( i );
+            local_hits += pool->get_partition_local_hits( i );
+        }
+        // Pages go in the partition of the subtree under the root they
+        // are in, so searches that keep to part of the tree stay local
+        std::cout << "  Local hits: " << local_hits << " of " << hits <<
+            std::endl;
+        std::cout << "  Remote node accesses: " <<
+            pool->get_remote_accesses() << std::endl;
+    }
+}
 
-	// Initialize the index
+Index *createIndex(std::map<std::string, unsigned> &configU)
+{
+	page_encoding encoding = configU["compression"] ? COMPRESSED_PAGES :
+		RAW_PAGES;
 	Index *spatialIndex;
 	if (configU["tree"] == R_TREE)
 	{
 		//spatialIndex = new rtree::RTree(configU["minfanout"], configU["maxfanout"]);
 		spatialIndex = new rtreedisk::RTreeDisk<3,6>( 4096 * 10 * 13000,
-                "rtreediskbacked_california.txt" );
+                "rtreediskbacked_california.txt", encoding, configU["filterbits"] );
 	}
 	else if (configU["tree"] == R_PLUS_TREE)
 	{
         spatialIndex = new
             rplustreedisk::RPlusTreeDisk<3,7>(4096*10*13000 /4,
-                "rplustreediskbacked_california.txt" );
+                "rplustreediskbacked_california.txt", encoding );
 		//spatialIndex = new rplustree::RPlusTree(configU["minfanout"], configU["maxfanout"]);
 	}
 	else if (configU["tree"] == R_STAR_TREE)
 	{
 		//spatialIndex = new rstartree::RStarTree(configU["minfanout"], configU["maxfanout"]);
-		spatialIndex = new rstartreedisk::RStarTreeDisk<7,15>( 4096 * 10 * 13000, "rstardiskbacked_california.txt" );
+		spatialIndex = new rstartreedisk::RStarTreeDisk<7,15>( 4096 * 10 * 13000, "rstardiskbacked_california.txt", encoding, configU["pointindex"], configU["filterbits"] );
 	}
 	else if (configU["tree"] == NIR_TREE)
 	{
@@ -528,7 +609,7 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
 		//spatialIndex = new nirtree::NIRTree(3,7);
 		spatialIndex = new
             nirtreedisk::NIRTreeDisk<3,7,nirtreedisk::ExperimentalStrategy>(
-                4096*10*13000, "nirdiskbacked_california.txt");
+                4096*10*13000, "nirdiskbacked_california.txt", encoding);
 	}
 	else if (configU["tree"] == QUAD_TREE)
 	{
@@ -538,7 +619,43 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
 	{
 		spatialIndex = new revisedrstartree::RevisedRStarTree(configU["minfanout"], configU["maxfanout"]);
 	}
+	else if (configU["tree"] == GRID_FILE)
+	{
+		spatialIndex = new gridfile::GridFile( 4096 * 10 * 13000, "gridfilediskbacked.txt", encoding );
+	}
+	else if (configU["tree"] == BKD_TREE)
+	{
+		spatialIndex = new bkdtree::BKDTree( 4096 * 10 * 13000, "bkdtreediskbacked.txt", encoding );
+	}
 	else
+	{
+		return nullptr;
+	}
+
+	return spatialIndex;
+}
+
+template <typename T>
+static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned> &configU, std::map<std::string, double> &configD)
+{
+	std::cout << "Running benchmark." << std::endl;
+
+	// Setup checksums
+	unsigned directSum = 0;
+
+	// Setup statistics
+	double totalTimeInserts = 0.0;
+	double totalTimeSearches = 0.0;
+	double totalTimeRangeSearches = 0.0;
+	double totalTimeDeletes = 0.0;
+	unsigned totalInserts = 0;
+	double totalSearches = 0.0;
+	double totalRangeSearches = 0.0;
+	unsigned totalDeletes = 0.0;
+
+	// Initialize the index
+	Index *spatialIndex = createIndex(configU);
+	if (spatialIndex == nullptr)
 	{
 		std::cout << "Unknown tree selected. Exiting." << std::endl;
 		return;
@@ -546,8 +663,9 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
 
 	// Initialize search rectangles
 	Rectangle *searchRectangles;
-	if (configU["distribution"] == UNIFORM)
+	if (configU["distribution"] == UNIFORM || configU["distribution"] >= GENERATED_UNIFORM)
 	{
+		// Sized for uniform data, see -Q for calibrated queries
 		searchRectangles = generateRectangles(configU["size"], configU["seed"], configU["rectanglescount"]);
 	}
 	else if (configU["distribution"] == SKEW)
@@ -592,7 +710,7 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
 
     std::optional<Point> nextPoint;
 
-    if( not is_already_loaded( configU, spatialIndex ) ) {
+    if( not is_already_loaded( configU, spatialIndex, T::size ) ) {
         // If we read stuff from disk and don't need to reinsert, skip this.
         // Insert points and time their insertion
         std::cout << "Inserting Points." << std::endl;
@@ -639,16 +757,60 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
 	//spatialIndex->validate();
 	//std::cout << "Validation OK." << std::endl;
 
+	// Read counts on a freshly reopened index are cold-cache I/O
+	buffer_pool *pool = disk_buffer_pool( configU, spatialIndex );
+	size_t pages_read_before = pool ? pool->get_pages_read() : 0;
+	size_t bytes_read_before = pool ? pool->get_bytes_read() : 0;
+	size_t read_calls_before = pool ? pool->get_read_calls() : 0;
+
 	// Search for points and time their retrieval
 	std::cout << "Beginning search." << std::endl;
 	pointGen.reset();
-	while((nextPoint = pointGen.nextPoint()) /* Intentional = not == */)
+	while(configU["interleave"] > 0 && totalSearches <= 100000)
+	{
+		// Same repeated searches, but a batch of points at a time so the
+		// index can interleave them
+		std::vector<Point> batch;
+		while(batch.size() < configU["interleave"] && (nextPoint = pointGen.nextPoint()))
+		{
+			batch.push_back(nextPoint.value());
+		}
+		if (batch.empty())
+		{
+			break;
+		}
+		for( int i = 0; i < 1000; i++ ) {
+			std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+			std::vector<std::vector<Point>> results = spatialIndex->batchSearch(batch);
+			std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+			for (unsigned j = 0; j < batch.size(); ++j)
+			{
+				if (results[j].empty() || results[j][0] != batch[j])
+				{
+					exit(1);
+				}
+			}
+			std::chrono::duration<double> delta = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin);
+			totalTimeSearches += delta.count();
+			totalSearches += batch.size();
+		}
+	}
+	// Queries through the coroutine API run on this, -A
+	std::unique_ptr<executor> queryExecutor;
+	if (configU["async"] > 0)
+	{
+		queryExecutor = std::make_unique<executor>();
+	}
+	while(configU["interleave"] == 0 && (nextPoint = pointGen.nextPoint()) /* Intentional = not == */)
 	{
 		// Search
 		Point &p = nextPoint.value();
         for( int i = 0; i < 1000; i++ ) {
             std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
-            if (spatialIndex->search(p)[0] != p)
+            std::vector<Point> v = queryExecutor ?
+                queryExecutor->run_sync(spatialIndex->searchAsync(*queryExecutor, p)) :
+                spatialIndex->search(p);
+            if (v[0] != p)
             {
                 exit(1);
             }
@@ -664,6 +826,8 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
 		// std::cout << "Point[" << i << "] queried. " << delta.count() << " s" << std::endl;
 	}
 	std::cout << "Search OK." << std::endl;
+	print_io_stats( pool, "search", pages_read_before, bytes_read_before,
+		read_calls_before );
 
 	// Validate checksum
     /*
@@ -678,11 +842,39 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
 	// Search for rectangles
 	unsigned rangeSearchChecksum = 0;
 	std::cout << "Beginning search for " << configU["rectanglescount"] << " rectangles..." << std::endl;
-	for (unsigned i = 0; i < configU["rectanglescount"]; ++i)
+	for (unsigned i = 0; queryExecutor && i < configU["rectanglescount"]; i += configU["async"])
+	{
+		// Up to -A queries in flight at once on one thread
+		unsigned end = std::min(configU["rectanglescount"], i + configU["async"]);
+		std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+		std::vector<task<std::vector<Point>>> queries;
+		for (unsigned j = i; j < end; ++j)
+		{
+			queries.push_back(spatialIndex->searchAsync(*queryExecutor, searchRectangles[j]));
+		}
+		std::vector<std::vector<Point>> results = queryExecutor->run_all(queries);
+		std::chrono::high_resolution_clock::time_point finish = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> delta = std::chrono::duration_cast<std::chrono::duration<double>>(finish - begin);
+		totalTimeRangeSearches += delta.count();
+		totalRangeSearches += end - i;
+		for (unsigned j = i; j < end; ++j)
+		{
+			rangeSearchChecksum += results[j - i].size();
+#ifndef NDEBUG
+			for (Point &p : results[j - i])
+			{
+				assert(searchRectangles[j].containsPoint(p));
+			}
+#endif
+		}
+	}
+	for (unsigned i = 0; !queryExecutor && i < configU["rectanglescount"]; ++i)
 	{
 		// Search
 		std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
-		std::vector<Point> v = spatialIndex->search(searchRectangles[i]);
+		std::vector<Point> v = configU["pageorder"] ?
+			spatialIndex->pageOrderSearch(searchRectangles[i]) :
+			spatialIndex->search(searchRectangles[i]);
 		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
 		std::chrono::duration<double> delta = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin);
 		totalTimeRangeSearches += delta.count();
@@ -701,6 +893,102 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
 #endif
 	}
 	std::cout << "Range search OK. Checksum = " << rangeSearchChecksum << std::endl;
+	print_io_stats( pool, "search and range search", pages_read_before,
+		bytes_read_before, read_calls_before );
+
+	// Estimate each range search's result size and compare, -e
+	if (configU["estimate"])
+	{
+		std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+		spatialIndex->estimate(searchRectangles[0]);
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		double firstEstimateTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+
+		double totalTimeEstimates = 0.0;
+		double totalQError = 0.0;
+		double maxQError = 0.0;
+		double totalBoundWidth = 0.0;
+		unsigned outOfBounds = 0;
+		for (unsigned i = 0; i < configU["rectanglescount"]; ++i)
+		{
+			begin = std::chrono::high_resolution_clock::now();
+			range_estimate e = spatialIndex->estimate(searchRectangles[i]);
+			end = std::chrono::high_resolution_clock::now();
+			totalTimeEstimates += std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+
+			// Ratio between estimate and truth, either way round, with
+			// empty results counted as one
+			double actual = spatialIndex->search(searchRectangles[i]).size();
+			double qError = std::max(e.count_, 1.0) / std::max(actual, 1.0);
+			qError = std::max(qError, 1.0 / qError);
+			totalQError += qError;
+			maxQError = std::max(maxQError, qError);
+			totalBoundWidth += e.upper_ - e.lower_;
+			if (actual < e.lower_ || actual > e.upper_)
+			{
+				outOfBounds++;
+			}
+		}
+		std::cout << "First estimate: " << firstEstimateTime << "s" << std::endl;
+		std::cout << "Average estimate time: " << totalTimeEstimates / configU["rectanglescount"] << "s" << std::endl;
+		std::cout << "Average q-error: " << totalQError / configU["rectanglescount"] << std::endl;
+		std::cout << "Max q-error: " << maxQError << std::endl;
+		std::cout << "Average bound width: " << totalBoundWidth / configU["rectanglescount"] << " points" << std::endl;
+		std::cout << "Results outside bounds: " << outOfBounds << std::endl;
+	}
+
+	// Range searches across the selectivity spectrum, -Q
+	if (configU["selectivity"])
+	{
+		// Reservoir sample of the data to calibrate the queries against
+		std::default_random_engine generator(configU["seed"]);
+		std::vector<Point> sample;
+		uint64_t datasetSize = 0;
+		pointGen.reset();
+		while ((nextPoint = pointGen.nextPoint()))
+		{
+			if (sample.size() < SelectivitySampleSize)
+			{
+				sample.push_back(nextPoint.value());
+			}
+			else
+			{
+				std::uniform_int_distribution<uint64_t> slotDist(0, datasetSize);
+				uint64_t slot = slotDist(generator);
+				if (slot < SelectivitySampleSize)
+				{
+					sample[slot] = nextPoint.value();
+				}
+			}
+			datasetSize++;
+		}
+		selectivitySweep(spatialIndex, sample, datasetSize, configU);
+	}
+
+	// Density tiles, -v
+	if (configU["visualization"])
+	{
+		std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+		spatialIndex->visualize();
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		std::cout << "Visualization: " << std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count() << "s" << std::endl;
+	}
+
+	// Export every point in storage order, -X
+	if (configU["export"])
+	{
+		pages_read_before = pool ? pool->get_pages_read() : 0;
+		bytes_read_before = pool ? pool->get_bytes_read() : 0;
+		read_calls_before = pool ? pool->get_read_calls() : 0;
+		std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+		uint64_t exported = spatialIndex->exportPoints("export.bin");
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		double exportTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+		std::cout << "Points exported: " << exported << std::endl;
+		std::cout << "Total time to export: " << exportTime << "s" << std::endl;
+		std::cout << "Export rate: " << exported * dimensions * sizeof(double) / exportTime / 1e6 << " MB/s" << std::endl;
+		print_io_stats(pool, "export", pages_read_before, bytes_read_before, read_calls_before);
+	}
 
 	// Gather statistics
 	spatialIndex->stat();
@@ -747,11 +1035,25 @@ static void runBench(PointGenerator<T> &pointGen, std::map<std::string, unsigned
     spatialIndex->write_metadata();
 
     std::cout << "Metadata written." << std::endl;
+    if( pool != nullptr ) {
+        std::cout << "Backing file size: " << pool->get_backing_file_size()
+            << " bytes" << std::endl;
+    }
 	// Cleanup
 	//delete spatialIndex;
 	delete [] searchRectangles;
 }
 
+template <typename T>
+static void runSynthetic(std::map<std::string, unsigned> &configU, std::map<std::string, double> &configD)
+{
+	BenchTypeClasses::Synthetic::size = configU["size"];
+	BenchTypeClasses::Synthetic::seed = configU["seed"];
+	BenchTypeClasses::Synthetic::threads = configU["generatorthreads"];
+	PointGenerator<T> pointGen;
+	runBench(pointGen, configU, configD);
+}
+
 void randomPoints(std::map<std::string, unsigned> &configU, std::map<std::string, double> &configD)
 {
 	switch (configU["distribution"])
@@ -807,5 +1109,30 @@ void randomPoints(std::map<std::string, unsigned> &configU, std::map<std::string
 			runBench(pointGen, configU, configD);
 			break;
 		}
+		case GENERATED_UNIFORM:
+		{
+			runSynthetic<BenchTypeClasses::GeneratedUniform>(configU, configD);
+			break;
+		}
+		case ZIPF:
+		{
+			runSynthetic<BenchTypeClasses::Zipf>(configU, configD);
+			break;
+		}
+		case GAUSSIAN_CLUSTERS:
+		{
+			runSynthetic<BenchTypeClasses::GaussianClusters>(configU, configD);
+			break;
+		}
+		case ROAD_NETWORK:
+		{
+			runSynthetic<BenchTypeClasses::RoadNetwork>(configU, configD);
+			break;
+		}
+		case DUPLICATES:
+		{
+			runSynthetic<BenchTypeClasses::Duplicates>(configU, configD);
+			break;
+		}
 	}
 }
@@ -0,0 +1,201 @@
+#include <bench/selectivity.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+// Range searches timed at each target and shape
+#define SELECTIVITY_QUERIES_PER_TARGET 100
+
+// Neighbours used to judge density near a centre when the target is
+// under this many sample points
+#define SELECTIVITY_DENSITY_NEIGHBOURS 8
+
+// Skinny boxes are this many times longer along one dimension
+#define SELECTIVITY_SKINNY_ASPECT 16.0
+
+// Hotspot boxes are centred on this many of the densest grid cells
+#define SELECTIVITY_HOTSPOTS 8
+
+// Centroids of the densest cells of a grid laid over the sample
+static std::vector<Point> hotspotCentres(const std::vector<Point> &sample, const Point &low, const Point &extent)
+{
+	// About a hundred sample points per cell if they were spread evenly
+	unsigned cellsPerDimension = std::max(2.0, std::floor(std::pow(sample.size() / 100.0, 1.0 / dimensions)));
+
+	std::map<std::vector<unsigned>, std::pair<unsigned, Point>> cells;
+	for (const Point &p : sample)
+	{
+		std::vector<unsigned> cell(dimensions);
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			cell[d] = std::min(cellsPerDimension - 1, (unsigned) ((p[d] - low[d]) / extent[d] * cellsPerDimension));
+		}
+		auto &entry = cells[cell];
+		if (entry.first == 0)
+		{
+			entry.second = p;
+		}
+		else
+		{
+			entry.second = entry.second + p;
+		}
+		entry.first++;
+	}
+
+	std::vector<std::pair<unsigned, Point>> densest;
+	for (auto &cell : cells)
+	{
+		densest.push_back(cell.second);
+	}
+	std::sort(densest.begin(), densest.end(), [](const std::pair<unsigned, Point> &a, const std::pair<unsigned, Point> &b) {
+		return a.first > b.first;
+	});
+	densest.resize(std::min<size_t>(densest.size(), SELECTIVITY_HOTSPOTS));
+
+	std::vector<Point> centres;
+	for (auto &cell : densest)
+	{
+		centres.push_back(cell.second / (double) cell.first);
+	}
+	return centres;
+}
+
+std::vector<Rectangle> generateSelectivityRectangles(const std::vector<Point> &sample, uint64_t datasetSize, double targetResults, QueryShape shape, unsigned rectangleCount, unsigned seed)
+{
+	assert(!sample.empty());
+	std::default_random_engine generator(seed);
+	std::uniform_int_distribution<size_t> sampleDist(0, sample.size() - 1);
+	std::uniform_int_distribution<unsigned> dimensionDist(0, dimensions - 1);
+
+	// Box sides are measured relative to the data's extent
+	Point low = sample[0];
+	Point high = sample[0];
+	for (const Point &p : sample)
+	{
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			low[d] = std::min(low[d], p[d]);
+			high[d] = std::max(high[d], p[d]);
+		}
+	}
+	Point extent;
+	for (unsigned d = 0; d < dimensions; ++d)
+	{
+		extent[d] = high[d] > low[d] ? high[d] - low[d] : 1.0;
+	}
+
+	std::vector<Point> hotspots;
+	if (shape == HOTSPOT_QUERIES)
+	{
+		hotspots = hotspotCentres(sample, low, extent);
+	}
+	std::uniform_int_distribution<size_t> hotspotDist(0, std::max<size_t>(hotspots.size(), 1) - 1);
+
+	// Sample points the box should hold. A centre taken from the sample
+	// is a result of its own, standing in for just itself rather than
+	// for its share of the dataset.
+	double own = shape == HOTSPOT_QUERIES ? 0.0 : 1.0;
+	double k = own + std::max(targetResults - own, 0.0) * sample.size() / datasetSize;
+	size_t neighbours = std::min<size_t>(SELECTIVITY_DENSITY_NEIGHBOURS, sample.size());
+
+	std::vector<Rectangle> rectangles;
+	rectangles.reserve(rectangleCount);
+	std::vector<double> distances(sample.size());
+	for (unsigned i = 0; i < rectangleCount; ++i)
+	{
+		Point centre = shape == HOTSPOT_QUERIES ? hotspots[hotspotDist(generator)] : sample[sampleDist(generator)];
+		Point scale = extent;
+		if (shape == SKINNY_QUERIES)
+		{
+			unsigned longDimension = dimensionDist(generator);
+			for (unsigned d = 0; d < dimensions; ++d)
+			{
+				if (d != longDimension)
+				{
+					scale[d] = extent[d] / SELECTIVITY_SKINNY_ASPECT;
+				}
+			}
+		}
+
+		// A box of half-width r holds every sample point within r
+		for (size_t j = 0; j < sample.size(); ++j)
+		{
+			double distance = 0.0;
+			for (unsigned d = 0; d < dimensions; ++d)
+			{
+				distance = std::max(distance, std::fabs(sample[j][d] - centre[d]) / scale[d]);
+			}
+			distances[j] = distance;
+		}
+
+		// Box volume grows with r^dimensions, so interpolate in that
+		double r;
+		if (k >= sample.size())
+		{
+			r = *std::max_element(distances.begin(), distances.end());
+		}
+		else if (k >= neighbours)
+		{
+			size_t below = (size_t) k;
+			std::nth_element(distances.begin(), distances.begin() + below - 1, distances.end());
+			double inner = std::pow(distances[below - 1], dimensions);
+			double outer = *std::min_element(distances.begin() + below, distances.end());
+			outer = std::pow(outer, dimensions);
+			r = std::pow(inner + (k - below) * (outer - inner), 1.0 / dimensions);
+		}
+		else
+		{
+			// Too few sample points this close, so assume the density
+			// around the centre is even out to the nearest few
+			std::nth_element(distances.begin(), distances.begin() + neighbours - 1, distances.end());
+			r = distances[neighbours - 1] * std::pow((k - own) / (neighbours - own), 1.0 / dimensions);
+		}
+
+		Point ll;
+		Point ur;
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			ll[d] = centre[d] - r * scale[d];
+			// Upper bounds are exclusive, so keep points on the edge
+			ur[d] = std::nextafter(centre[d] + r * scale[d], std::numeric_limits<double>::infinity());
+		}
+		rectangles.push_back(Rectangle(ll, ur));
+	}
+
+	return rectangles;
+}
+
+void selectivitySweep(Index *spatialIndex, const std::vector<Point> &sample, uint64_t datasetSize, std::map<std::string, unsigned> &configU)
+{
+	const double targets[] = {1.0, 10.0, 1e3, 1e5, 1e7};
+	const char *shapeNames[] = {"square", "skinny", "hotspot"};
+
+	std::cout << "Latency by selectivity (" << SELECTIVITY_QUERIES_PER_TARGET << " range searches each):" << std::endl;
+	for (QueryShape shape : {SQUARE_QUERIES, SKINNY_QUERIES, HOTSPOT_QUERIES})
+	{
+		for (double target : targets)
+		{
+			if (target > datasetSize)
+			{
+				continue;
+			}
+
+			std::vector<Rectangle> rectangles = generateSelectivityRectangles(sample, datasetSize, target, shape, SELECTIVITY_QUERIES_PER_TARGET, configU["seed"]);
+			double totalTime = 0.0;
+			uint64_t totalResults = 0;
+			for (const Rectangle &rectangle : rectangles)
+			{
+				std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+				std::vector<Point> v = spatialIndex->search(rectangle);
+				std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+				totalTime += std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+				totalResults += v.size();
+			}
+			std::cout << "  " << shapeNames[shape] << ", target " << target << ": average results " << (double) totalResults / rectangles.size() << ", average time " << totalTime / rectangles.size() << "s" << std::endl;
+		}
+	}
+}
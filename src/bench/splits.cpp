@@ -0,0 +1,99 @@
+#include <bench/splits.h>
+#include <rtreedisk/rtreedisk.h>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Small enough that searches over the larger benchmarks go to disk
+#define SPLIT_BENCHMARK_BUFFER_PAGES 256
+
+static std::vector<Point> splitPoints(unsigned count, unsigned seed)
+{
+	std::default_random_engine generator(seed);
+	std::uniform_real_distribution<double> pointDist(0.0, 1.0);
+	std::vector<Point> points;
+	points.reserve(count);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		Point p;
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			p[d] = pointDist(generator);
+		}
+		points.push_back(p);
+	}
+	return points;
+}
+
+static std::vector<Rectangle> splitRectangles(unsigned count, unsigned seed)
+{
+	std::default_random_engine generator(seed + 1);
+	std::uniform_real_distribution<double> pointDist(0.0, 0.99);
+	std::vector<Rectangle> rectangles;
+	rectangles.reserve(count);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		Point lower;
+		Point upper;
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			lower[d] = pointDist(generator);
+			upper[d] = lower[d] + 0.01;
+		}
+		rectangles.push_back(Rectangle(lower, upper));
+	}
+	return rectangles;
+}
+
+template <class Strategy>
+static void runSplit(const char *name, const std::vector<Point> &points, const std::vector<Rectangle> &rectangles)
+{
+	std::string backingFile = "splitbench.txt";
+	std::remove(backingFile.c_str());
+
+	{
+		rtreedisk::RTreeDisk<25,50,Strategy> tree(4096 * SPLIT_BENCHMARK_BUFFER_PAGES, backingFile);
+
+		std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+		for (const Point &p : points)
+		{
+			tree.insert(p);
+		}
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		double insertSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+
+		buffer_pool &pool = tree.node_allocator_.buffer_pool_;
+		size_t pagesBefore = pool.get_pages_read();
+		size_t results = 0;
+		begin = std::chrono::high_resolution_clock::now();
+		for (const Rectangle &r : rectangles)
+		{
+			results += tree.search(r).size();
+		}
+		end = std::chrono::high_resolution_clock::now();
+		double searchSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+		size_t pagesRead = pool.get_pages_read() - pagesBefore;
+
+		std::cout << name << ":" << std::endl;
+		std::cout << "  inserts/s = " << points.size() / insertSeconds << std::endl;
+		std::cout << "  range search time = " << searchSeconds << "s" << std::endl;
+		std::cout << "  pages read per range search = " << (double) pagesRead / rectangles.size() << std::endl;
+		std::cout << "  pages allocated = " << pool.get_highest_allocated_page_id() + 1 << std::endl;
+		std::cout << "  results = " << results << std::endl;
+	}
+
+	std::remove(backingFile.c_str());
+}
+
+void splitBenchmark(std::map<std::string, unsigned> &configU)
+{
+	std::vector<Point> points = splitPoints(configU["size"], configU["seed"]);
+	std::vector<Rectangle> rectangles = splitRectangles(configU["rectanglescount"], configU["seed"]);
+
+	runSplit<rtreedisk::QuadraticSplit>("Quadratic split", points, rectangles);
+	runSplit<rtreedisk::LinearSplit>("Linear split", points, rectangles);
+	runSplit<rtreedisk::AngTanSplit>("Ang-Tan split", points, rectangles);
+	runSplit<rtreedisk::SweepSplit>("Sweep split", points, rectangles);
+}
@@ -0,0 +1,268 @@
+#include <bench/synthetic.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Independent random streams for each part of a point
+enum SyntheticStreamId {COORDINATE_STREAM, CHOICE_STREAM, MODEL_STREAM, POOL_STREAM};
+
+#define ZIPF_CELL_BITS 20
+#define ZIPF_EXPONENT 1.1
+#define GAUSSIAN_CLUSTERS 64
+#define ROAD_SEGMENTS 4096
+#define DUPLICATES_PER_POINT 16
+
+// splitmix64 finaliser
+static uint64_t mix(uint64_t h)
+{
+	h += 0x9e3779b97f4a7c15ULL;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	return h ^ (h >> 31);
+}
+
+// The draw'th random number of stream for item index
+static uint64_t syntheticHash(unsigned seed, SyntheticStreamId stream, uint64_t index, unsigned draw)
+{
+	return mix(mix(mix(((uint64_t) seed << 8) ^ stream) ^ index) ^ draw);
+}
+
+// In [0, 1)
+static double syntheticUniform(unsigned seed, SyntheticStreamId stream, uint64_t index, unsigned draw)
+{
+	return (syntheticHash(seed, stream, index, draw) >> 11) * 0x1.0p-53;
+}
+
+// Standard normal by Box-Muller
+static double syntheticGaussian(unsigned seed, SyntheticStreamId stream, uint64_t index, unsigned draw)
+{
+	double u = 1.0 - syntheticUniform(seed, stream, index, 2 * draw);
+	double v = syntheticUniform(seed, stream, index, 2 * draw + 1);
+	return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * M_PI * v);
+}
+
+static Point uniformPoint(unsigned seed, SyntheticStreamId stream, uint64_t index)
+{
+	Point p;
+	for (unsigned d = 0; d < dimensions; ++d)
+	{
+		p[d] = syntheticUniform(seed, stream, index, d);
+	}
+	return p;
+}
+
+static Point zipfPoint(unsigned seed, uint64_t index)
+{
+	// Continuous approximation to the Zipf inverse CDF over the cells
+	const double cells = (double) (1ULL << ZIPF_CELL_BITS);
+	double u = syntheticUniform(seed, CHOICE_STREAM, index, 0);
+	double x = std::pow((std::pow(cells, 1.0 - ZIPF_EXPONENT) - 1.0) * u + 1.0, 1.0 / (1.0 - ZIPF_EXPONENT));
+	uint64_t rank = std::min<uint64_t>((uint64_t) x - 1, (1ULL << ZIPF_CELL_BITS) - 1);
+
+	// Scatter the ranks over the grid with an odd multiplier, a
+	// bijection mod 2^ZIPF_CELL_BITS, then deal the cell's bits out to
+	// the dimensions in turn
+	uint64_t mask = (1ULL << ZIPF_CELL_BITS) - 1;
+	uint64_t cell = ((rank * (syntheticHash(seed, MODEL_STREAM, 0, 0) | 1)) ^ syntheticHash(seed, MODEL_STREAM, 0, 1)) & mask;
+	uint64_t coordinates[dimensions] = {};
+	unsigned bits[dimensions] = {};
+	for (unsigned b = 0; b < ZIPF_CELL_BITS; ++b)
+	{
+		unsigned d = b % dimensions;
+		coordinates[d] |= ((cell >> b) & 1) << bits[d];
+		bits[d]++;
+	}
+
+	Point p;
+	for (unsigned d = 0; d < dimensions; ++d)
+	{
+		p[d] = (coordinates[d] + syntheticUniform(seed, COORDINATE_STREAM, index, d)) / (double) (1ULL << bits[d]);
+	}
+	return p;
+}
+
+static Point gaussianClusterPoint(unsigned seed, uint64_t index)
+{
+	uint64_t cluster = syntheticHash(seed, CHOICE_STREAM, index, 0) % GAUSSIAN_CLUSTERS;
+	// Spreads from 0.002 to 0.05
+	double sigma = 0.002 * std::pow(25.0, syntheticUniform(seed, MODEL_STREAM, cluster, dimensions));
+
+	Point p;
+	for (unsigned d = 0; d < dimensions; ++d)
+	{
+		double centre = syntheticUniform(seed, MODEL_STREAM, cluster, d);
+		p[d] = centre + sigma * syntheticGaussian(seed, COORDINATE_STREAM, index, d);
+	}
+	return p;
+}
+
+static Point roadNetworkPoint(unsigned seed, uint64_t index)
+{
+	uint64_t segment = syntheticHash(seed, CHOICE_STREAM, index, 0) % ROAD_SEGMENTS;
+
+	// One in ten segments is a highway
+	bool highway = syntheticUniform(seed, MODEL_STREAM, segment, dimensions) < 0.1;
+	double length = highway ? 0.2 + 0.4 * syntheticUniform(seed, MODEL_STREAM, segment, dimensions + 1) :
+		0.005 + 0.045 * syntheticUniform(seed, MODEL_STREAM, segment, dimensions + 1);
+	double angle = 2.0 * M_PI * syntheticUniform(seed, MODEL_STREAM, segment, dimensions + 2);
+	double t = syntheticUniform(seed, COORDINATE_STREAM, index, 0);
+
+	// Along the segment in the first two dimensions, close to its start
+	// in the rest
+	Point p;
+	for (unsigned d = 0; d < dimensions; ++d)
+	{
+		double start = syntheticUniform(seed, MODEL_STREAM, segment, d);
+		double along = d == 0 ? std::cos(angle) : d == 1 ? std::sin(angle) : 0.0;
+		double jitter = (d < 2 ? 0.0001 : 0.001) * syntheticGaussian(seed, COORDINATE_STREAM, index, d + 1);
+		p[d] = start + t * length * along + jitter;
+	}
+	return p;
+}
+
+static Point duplicatePoint(uint64_t count, unsigned seed, uint64_t index)
+{
+	uint64_t distinct = std::max<uint64_t>(count / DUPLICATES_PER_POINT, 1);
+	return uniformPoint(seed, POOL_STREAM, syntheticHash(seed, CHOICE_STREAM, index, 0) % distinct);
+}
+
+Point syntheticPoint(SyntheticDistribution distribution, uint64_t count, unsigned seed, uint64_t index)
+{
+	switch (distribution)
+	{
+		case SYNTHETIC_UNIFORM:
+			return uniformPoint(seed, COORDINATE_STREAM, index);
+		case SYNTHETIC_ZIPF:
+			return zipfPoint(seed, index);
+		case SYNTHETIC_GAUSSIAN_CLUSTERS:
+			return gaussianClusterPoint(seed, index);
+		case SYNTHETIC_ROAD_NETWORK:
+			return roadNetworkPoint(seed, index);
+		case SYNTHETIC_DUPLICATES:
+			return duplicatePoint(count, seed, index);
+	}
+	assert(false);
+	return Point();
+}
+
+SyntheticStream::SyntheticStream(SyntheticDistribution distribution, uint64_t count, unsigned seed, unsigned threadCount) :
+	distribution(distribution), count(count), seed(seed),
+	threadCount(threadCount > 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u)),
+	chunkCount((count + SyntheticChunkSize - 1) / SyntheticChunkSize)
+{
+	ring.resize(2 * this->threadCount);
+	startWorkers();
+}
+
+SyntheticStream::~SyntheticStream()
+{
+	stopWorkers();
+}
+
+void SyntheticStream::startWorkers()
+{
+	stopping = false;
+	claimChunk = 0;
+	readChunk = 0;
+	current.clear();
+	offset = 0;
+	for (Slot &slot : ring)
+	{
+		slot.ready = false;
+	}
+	for (unsigned t = 0; t < threadCount; ++t)
+	{
+		workers.emplace_back(&SyntheticStream::work, this);
+	}
+}
+
+void SyntheticStream::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> guard(latch);
+		stopping = true;
+	}
+	consumed.notify_all();
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+}
+
+void SyntheticStream::work()
+{
+	std::vector<Point> points;
+	for (;;)
+	{
+		uint64_t chunk;
+		{
+			// Wait for room in the ring
+			std::unique_lock<std::mutex> lock(latch);
+			consumed.wait(lock, [&]() {
+				return stopping || claimChunk >= chunkCount || claimChunk < readChunk + ring.size();
+			});
+			if (stopping || claimChunk >= chunkCount)
+			{
+				return;
+			}
+			chunk = claimChunk++;
+		}
+
+		uint64_t first = chunk * SyntheticChunkSize;
+		uint64_t last = std::min(count, first + SyntheticChunkSize);
+		points.clear();
+		points.reserve(last - first);
+		for (uint64_t i = first; i < last; ++i)
+		{
+			points.push_back(syntheticPoint(distribution, count, seed, i));
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(latch);
+			Slot &slot = ring[chunk % ring.size()];
+			slot.points.swap(points);
+			slot.chunk = chunk;
+			slot.ready = true;
+		}
+		produced.notify_all();
+	}
+}
+
+bool SyntheticStream::nextChunk(std::vector<Point> &chunk)
+{
+	std::unique_lock<std::mutex> lock(latch);
+	if (readChunk >= chunkCount)
+	{
+		return false;
+	}
+	Slot &slot = ring[readChunk % ring.size()];
+	produced.wait(lock, [&]() {
+		return slot.ready && slot.chunk == readChunk;
+	});
+	chunk.swap(slot.points);
+	slot.ready = false;
+	readChunk++;
+	lock.unlock();
+	consumed.notify_all();
+	return true;
+}
+
+std::optional<Point> SyntheticStream::nextPoint()
+{
+	if (offset >= current.size())
+	{
+		if (!nextChunk(current))
+		{
+			return std::nullopt;
+		}
+		offset = 0;
+	}
+	return current[offset++];
+}
+
+void SyntheticStream::reset()
+{
+	stopWorkers();
+	startWorkers();
+}
@@ -0,0 +1,754 @@
+#include <bkdtree/bkdtree.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace bkdtree
+{
+    // Full buffers queued behind the merge thread before inserts wait
+    // for it to catch up
+    constexpr size_t MAX_FROZEN_BUFFERS = 2;
+
+    Segment::~Segment()
+    {
+        if( retired_ ) {
+            tree_->freeSegment( *this );
+        }
+    }
+
+    void Segment::candidateLeaves( const Rectangle &requestedRectangle,
+            std::vector<tree_node_handle> &leaves ) const
+    {
+        if( leaves_.empty() or !bounding_box_.intersectsRectangle(
+                    requestedRectangle ) ) {
+            return;
+        }
+
+        // Points equal to a split value may sit on either side of it
+        struct Frame { size_t node, first_leaf, last_leaf; };
+        std::vector<Frame> stack = { { 0, 0, leaves_.size() } };
+        while( !stack.empty() ) {
+            Frame frame = stack.back();
+            stack.pop_back();
+            if( frame.last_leaf - frame.first_leaf == 1 ) {
+                leaves.push_back( leaves_[frame.first_leaf] );
+                continue;
+            }
+
+            size_t middle = (frame.first_leaf + frame.last_leaf) / 2;
+            unsigned d = split_dimensions_[frame.node];
+            double split = split_values_[frame.node];
+            if( requestedRectangle.upperRight[d] > split ) {
+                stack.push_back( { 2 * frame.node + 2, middle,
+                        frame.last_leaf } );
+            }
+            if( requestedRectangle.lowerLeft[d] <= split ) {
+                stack.push_back( { 2 * frame.node + 1, frame.first_leaf,
+                        middle } );
+            }
+        }
+    }
+
+    BKDTree::BKDTree( buffer_budget memory_budget, std::string backing_file,
+            page_encoding encoding, unsigned buffer_capacity, bool
+            background_merges ) :
+        node_allocator_( memory_budget, backing_file, encoding ),
+        backing_file_( backing_file ), buffer_capacity_( buffer_capacity ),
+        point_count_( 0 ), stopping_( false )
+    {
+        assert( buffer_capacity_ > 0 );
+        node_allocator_.initialize();
+
+        superblock sb;
+        superblock expected = superblock::describe( BKDTREE_DISK,
+                LEAF_CAPACITY, LEAF_CAPACITY );
+        if( node_allocator_.load_superblock( expected, sb ) ) {
+            point_count_ = sb.point_count_;
+            loadMetadata( sb.root_ );
+        } else {
+            node_allocator_.reserve_superblock();
+        }
+        buffer_.reserve( buffer_capacity_ );
+
+        if( background_merges ) {
+            merge_thread_ = std::thread( &BKDTree::mergeLoop, this );
+        }
+    }
+
+    BKDTree::~BKDTree()
+    {
+        {
+            std::lock_guard<std::mutex> guard( lock_ );
+            stopping_ = true;
+        }
+        merge_wanted_.notify_all();
+        if( merge_thread_.joinable() ) {
+            merge_thread_.join();
+        }
+    }
+
+    std::shared_ptr<Segment> BKDTree::buildSegment( std::vector<Point>
+            &points )
+    {
+        assert( !points.empty() );
+        auto segment = std::make_shared<Segment>( this );
+        segment->point_count_ = points.size();
+        segment->bounding_box_ = Rectangle( points[0],
+                Point::closest_larger_point( points[0] ) );
+        for( const Point &p : points ) {
+            segment->bounding_box_.expand( p );
+        }
+
+        size_t leaf_count = (points.size() + LEAF_CAPACITY - 1) /
+            LEAF_CAPACITY;
+        // A balanced split of leaf_count leaves never numbers a node
+        // past 4 * leaf_count
+        segment->split_dimensions_.assign( 4 * leaf_count, 0 );
+        segment->split_values_.assign( 4 * leaf_count, 0.0 );
+        buildSubtree( *segment, points, 0, 0, leaf_count );
+
+        std::lock_guard<std::mutex> guard( storage_lock_ );
+        for( size_t leaf = 0; leaf < leaf_count; leaf++ ) {
+            auto alloc_data = node_allocator_.create_new_tree_node<LeafBlock>(
+                    PAGE_DATA_SIZE, NodeHandleType(0) );
+            assert( alloc_data.second );
+            size_t first = leaf * LEAF_CAPACITY;
+            size_t count = std::min( (size_t) LEAF_CAPACITY, points.size() -
+                    first );
+            std::copy( points.begin() + first, points.begin() + first +
+                    count, alloc_data.first->points_ );
+            alloc_data.first->count_ = count;
+            segment->leaves_.push_back( alloc_data.second );
+        }
+        return segment;
+    }
+
+    void BKDTree::buildSubtree( Segment &segment, std::vector<Point> &points,
+            size_t node, size_t first_leaf, size_t last_leaf )
+    {
+        if( last_leaf - first_leaf <= 1 ) {
+            return;
+        }
+
+        // Every leaf left of the middle one ends up full
+        size_t middle = (first_leaf + last_leaf) / 2;
+        size_t first = first_leaf * LEAF_CAPACITY;
+        size_t last = std::min( last_leaf * LEAF_CAPACITY, points.size() );
+        size_t split = middle * LEAF_CAPACITY;
+        assert( first < split and split < last );
+
+        unsigned widest = 0;
+        double widestSpread = -1.0;
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            auto bounds = std::minmax_element( points.begin() + first,
+                    points.begin() + last, [d]( const Point &a, const
+                        Point &b ) { return a[d] < b[d]; } );
+            double spread = (*bounds.second)[d] - (*bounds.first)[d];
+            if( spread > widestSpread ) {
+                widest = d;
+                widestSpread = spread;
+            }
+        }
+
+        std::nth_element( points.begin() + first, points.begin() + split,
+                points.begin() + last, [widest]( const Point &a, const
+                    Point &b ) { return a[widest] < b[widest]; } );
+        segment.split_dimensions_[node] = widest;
+        segment.split_values_[node] = points[split][widest];
+
+        buildSubtree( segment, points, 2 * node + 1, first_leaf, middle );
+        buildSubtree( segment, points, 2 * node + 2, middle, last_leaf );
+    }
+
+    std::vector<Point> BKDTree::readSegment( const Segment &segment )
+    {
+        std::vector<Point> points;
+        points.reserve( segment.point_count_ );
+        for( tree_node_handle leaf_handle : segment.leaves_ ) {
+            std::lock_guard<std::mutex> guard( storage_lock_ );
+            pinned_node_ptr<LeafBlock> leaf =
+                node_allocator_.get_tree_node<LeafBlock>( leaf_handle );
+            points.insert( points.end(), leaf->points_, leaf->points_ +
+                    leaf->count_ );
+        }
+        return points;
+    }
+
+    void BKDTree::freeSegment( const Segment &segment )
+    {
+        std::lock_guard<std::mutex> guard( storage_lock_ );
+        for( tree_node_handle leaf_handle : segment.leaves_ ) {
+            tree_node_handle handle = leaf_handle;
+            node_allocator_.free( handle, PAGE_DATA_SIZE );
+        }
+    }
+
+    void BKDTree::freezeBuffer( std::unique_lock<std::mutex> &lock )
+    {
+        merge_done_.wait( lock, [this] { return frozen_.size() <
+                MAX_FROZEN_BUFFERS or !merge_thread_.joinable(); } );
+        frozen_.push_back( std::make_shared<std::vector<Point>>(
+                    std::move( buffer_ ) ) );
+        buffer_ = std::vector<Point>();
+        buffer_.reserve( buffer_capacity_ );
+    }
+
+    bool BKDTree::mergeOnce()
+    {
+        std::shared_ptr<std::vector<Point>> incoming;
+        std::vector<std::shared_ptr<Segment>> merged;
+        std::unordered_map<Point, unsigned, point_hash> tombstones;
+        {
+            std::lock_guard<std::mutex> guard( lock_ );
+            if( frozen_.empty() ) {
+                return false;
+            }
+            incoming = frozen_.front();
+            while( merged.size() < levels_.size() and
+                    levels_[merged.size()] ) {
+                merged.push_back( levels_[merged.size()] );
+            }
+            tombstones = tombstones_;
+        }
+        size_t level = merged.size();
+
+        // Everything read here is immutable, so queries keep running
+        // against the old segments until the new one is swapped in
+        std::vector<Point> points = *incoming;
+        for( const std::shared_ptr<Segment> &segment : merged ) {
+            std::vector<Point> segmentPoints = readSegment( *segment );
+            points.insert( points.end(), segmentPoints.begin(),
+                    segmentPoints.end() );
+        }
+
+        std::unordered_map<Point, unsigned, point_hash> consumed;
+        if( !tombstones.empty() ) {
+            points.erase( std::remove_if( points.begin(), points.end(),
+                        [&]( const Point &p ) {
+                auto iter = tombstones.find( p );
+                if( iter == tombstones.end() or iter->second == 0 ) {
+                    return false;
+                }
+                iter->second--;
+                consumed[p]++;
+                return true;
+            } ), points.end() );
+        }
+
+        std::shared_ptr<Segment> segment;
+        if( !points.empty() ) {
+            segment = buildSegment( points );
+        }
+
+        {
+            std::lock_guard<std::mutex> guard( lock_ );
+            for( size_t i = 0; i < level; i++ ) {
+                levels_[i]->retired_ = true;
+                levels_[i].reset();
+            }
+            if( level == levels_.size() ) {
+                levels_.emplace_back();
+            }
+            levels_[level] = segment;
+            frozen_.pop_front();
+
+            for( const auto &entry : consumed ) {
+                auto iter = tombstones_.find( entry.first );
+                assert( iter != tombstones_.end() and iter->second >=
+                        entry.second );
+                iter->second -= entry.second;
+                if( iter->second == 0 ) {
+                    tombstones_.erase( iter );
+                }
+            }
+        }
+        merge_done_.notify_all();
+
+        // The retired segments give their pages back here, or once the
+        // last query still reading them is done
+        return true;
+    }
+
+    void BKDTree::mergeLoop()
+    {
+        for( ;; ) {
+            {
+                std::unique_lock<std::mutex> lock( lock_ );
+                merge_wanted_.wait( lock, [this] { return stopping_ or
+                        !frozen_.empty(); } );
+                if( stopping_ ) {
+                    return;
+                }
+            }
+            mergeOnce();
+        }
+    }
+
+    void BKDTree::waitForMerges()
+    {
+        if( !merge_thread_.joinable() ) {
+            while( mergeOnce() ) {}
+            return;
+        }
+        std::unique_lock<std::mutex> lock( lock_ );
+        merge_done_.wait( lock, [this] { return frozen_.empty(); } );
+    }
+
+    void BKDTree::snapshot( const Rectangle &requestedRectangle,
+            std::vector<Point> &in_memory,
+            std::vector<std::shared_ptr<Segment>> &segments,
+            std::unordered_map<Point, unsigned, point_hash> &tombstones )
+    {
+        std::lock_guard<std::mutex> guard( lock_ );
+        for( const Point &p : buffer_ ) {
+            if( requestedRectangle.containsPoint( p ) ) {
+                in_memory.push_back( p );
+            }
+        }
+        for( const std::shared_ptr<std::vector<Point>> &frozen : frozen_ ) {
+            for( const Point &p : *frozen ) {
+                if( requestedRectangle.containsPoint( p ) ) {
+                    in_memory.push_back( p );
+                }
+            }
+        }
+        for( const std::shared_ptr<Segment> &segment : levels_ ) {
+            if( segment ) {
+                segments.push_back( segment );
+            }
+        }
+        for( const auto &entry : tombstones_ ) {
+            if( requestedRectangle.containsPoint( entry.first ) ) {
+                tombstones.insert( entry );
+            }
+        }
+    }
+
+    void BKDTree::searchSegments( const Rectangle &requestedRectangle,
+            const std::vector<std::shared_ptr<Segment>> &segments,
+            std::vector<Point> &matchingPoints )
+    {
+        std::vector<tree_node_handle> leaves;
+        for( const std::shared_ptr<Segment> &segment : segments ) {
+            segment->candidateLeaves( requestedRectangle, leaves );
+        }
+
+        std::lock_guard<std::mutex> guard( storage_lock_ );
+        node_allocator_.visit_in_page_order( leaves,
+                [&]( tree_node_handle leaf_handle ) {
+            pinned_node_ptr<LeafBlock> leaf =
+                node_allocator_.get_tree_node<LeafBlock>( leaf_handle );
+#ifdef STAT
+            stats.markLeafSearched();
+#endif
+            for( unsigned i = 0; i < leaf->count_; i++ ) {
+                if( requestedRectangle.containsPoint( leaf->points_[i] ) ) {
+                    matchingPoints.push_back( leaf->points_[i] );
+                }
+            }
+        } );
+    }
+
+    void BKDTree::applyTombstones( std::vector<Point> &points,
+            std::unordered_map<Point, unsigned, point_hash> tombstones )
+    {
+        if( tombstones.empty() ) {
+            return;
+        }
+        points.erase( std::remove_if( points.begin(), points.end(),
+                    [&tombstones]( const Point &p ) {
+            auto iter = tombstones.find( p );
+            if( iter == tombstones.end() or iter->second == 0 ) {
+                return false;
+            }
+            iter->second--;
+            return true;
+        } ), points.end() );
+    }
+
+    std::vector<Point> BKDTree::exhaustiveSearch( Point requestedPoint )
+    {
+        std::vector<Point> matchingPoints;
+        std::vector<std::shared_ptr<Segment>> segments;
+        std::unordered_map<Point, unsigned, point_hash> tombstones;
+        snapshot( Rectangle( requestedPoint, Point::closest_larger_point(
+                        requestedPoint ) ), matchingPoints, segments,
+                tombstones );
+
+        for( const std::shared_ptr<Segment> &segment : segments ) {
+            for( const Point &p : readSegment( *segment ) ) {
+                if( p == requestedPoint ) {
+                    matchingPoints.push_back( p );
+                }
+            }
+        }
+        applyTombstones( matchingPoints, tombstones );
+        return matchingPoints;
+    }
+
+    std::vector<Point> BKDTree::searchRange( const Rectangle
+            &requestedRectangle )
+    {
+        std::vector<Point> matchingPoints;
+        std::vector<std::shared_ptr<Segment>> segments;
+        std::unordered_map<Point, unsigned, point_hash> tombstones;
+        snapshot( requestedRectangle, matchingPoints, segments, tombstones );
+        searchSegments( requestedRectangle, segments, matchingPoints );
+        applyTombstones( matchingPoints, tombstones );
+        return matchingPoints;
+    }
+
+    std::vector<Point> BKDTree::search( Point requestedPoint )
+    {
+        std::vector<Point> matchingPoints = searchRange( Rectangle(
+                    requestedPoint, Point::closest_larger_point(
+                        requestedPoint ) ) );
+#ifdef STAT
+        stats.resetSearchTracker( false );
+#endif
+        return matchingPoints;
+    }
+
+    std::vector<Point> BKDTree::search( Rectangle requestedRectangle )
+    {
+        std::vector<Point> matchingPoints = searchRange( requestedRectangle );
+#ifdef STAT
+        stats.resetSearchTracker( true );
+#endif
+        return matchingPoints;
+    }
+
+    void BKDTree::insert( Point givenPoint )
+    {
+        {
+            std::unique_lock<std::mutex> lock( lock_ );
+            buffer_.push_back( givenPoint );
+            point_count_++;
+            if( buffer_.size() < buffer_capacity_ ) {
+                return;
+            }
+            freezeBuffer( lock );
+        }
+
+        if( merge_thread_.joinable() ) {
+            merge_wanted_.notify_one();
+        } else {
+            mergeOnce();
+        }
+    }
+
+    void BKDTree::remove( Point givenPoint )
+    {
+        {
+            std::lock_guard<std::mutex> guard( lock_ );
+            auto iter = std::find( buffer_.begin(), buffer_.end(),
+                    givenPoint );
+            if( iter != buffer_.end() ) {
+                *iter = buffer_.back();
+                buffer_.pop_back();
+                point_count_--;
+                return;
+            }
+        }
+
+        // Frozen buffers and segments are immutable, so hide a copy that
+        // is still visible behind a tombstone
+        if( searchRange( Rectangle( givenPoint,
+                        Point::closest_larger_point( givenPoint ) ) ).empty() ) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard( lock_ );
+        tombstones_[givenPoint]++;
+        point_count_--;
+    }
+
+    unsigned BKDTree::checksum()
+    {
+        Rectangle everything( Point::atNegInfinity, Point::atInfinity );
+        unsigned sum = 0;
+        for( const Point &p : searchRange( everything ) ) {
+            for( unsigned d = 0; d < dimensions; d++ ) {
+                sum += (unsigned) p[d];
+            }
+        }
+        return sum;
+    }
+
+    bool BKDTree::validate()
+    {
+        std::vector<Point> in_memory;
+        std::vector<std::shared_ptr<Segment>> segments;
+        std::unordered_map<Point, unsigned, point_hash> tombstones;
+        snapshot( Rectangle( Point::atNegInfinity, Point::atInfinity ),
+                in_memory, segments, tombstones );
+
+        uint64_t points = in_memory.size();
+        for( const std::shared_ptr<Segment> &segment : segments ) {
+            // Walk the splits down to every leaf, checking the leaf's
+            // points fall on the right side of each of them
+            struct Frame {
+                size_t node, first_leaf, last_leaf;
+                Point low, high;
+            };
+            std::vector<Frame> stack = { { 0, 0, segment->leaves_.size(),
+                Point::atNegInfinity, Point::atInfinity } };
+            uint64_t segmentPoints = 0;
+            while( !stack.empty() ) {
+                Frame frame = stack.back();
+                stack.pop_back();
+                if( frame.last_leaf - frame.first_leaf > 1 ) {
+                    size_t middle = (frame.first_leaf + frame.last_leaf) / 2;
+                    unsigned d = segment->split_dimensions_[frame.node];
+                    double split = segment->split_values_[frame.node];
+                    Frame left = { 2 * frame.node + 1, frame.first_leaf,
+                        middle, frame.low, frame.high };
+                    left.high[d] = split;
+                    Frame right = { 2 * frame.node + 2, middle,
+                        frame.last_leaf, frame.low, frame.high };
+                    right.low[d] = split;
+                    stack.push_back( left );
+                    stack.push_back( right );
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> guard( storage_lock_ );
+                pinned_node_ptr<LeafBlock> leaf =
+                    node_allocator_.get_tree_node<LeafBlock>(
+                            segment->leaves_[frame.first_leaf] );
+                if( leaf->count_ == 0 or leaf->count_ > LEAF_CAPACITY or
+                        (frame.first_leaf + 1 < segment->leaves_.size() and
+                         leaf->count_ != LEAF_CAPACITY) ) {
+                    std::cout << "Leaf " << frame.first_leaf << " holds " <<
+                        leaf->count_ << " points" << std::endl;
+                    return false;
+                }
+                for( unsigned i = 0; i < leaf->count_; i++ ) {
+                    const Point &p = leaf->points_[i];
+                    for( unsigned d = 0; d < dimensions; d++ ) {
+                        if( p[d] < frame.low[d] or p[d] > frame.high[d] ) {
+                            std::cout << p << " is on the wrong side of a "
+                                "split" << std::endl;
+                            return false;
+                        }
+                    }
+                    if( !segment->bounding_box_.containsPoint( p ) ) {
+                        std::cout << p << " is outside its segment's "
+                            "bounding box" << std::endl;
+                        return false;
+                    }
+                }
+                segmentPoints += leaf->count_;
+            }
+            if( segmentPoints != segment->point_count_ ) {
+                std::cout << "Segment holds " << segmentPoints <<
+                    " points but expected " << segment->point_count_ <<
+                    std::endl;
+                return false;
+            }
+            points += segmentPoints;
+        }
+
+        uint64_t hidden = 0;
+        for( const auto &entry : tombstones ) {
+            hidden += entry.second;
+        }
+        if( points - hidden != point_count_ ) {
+            std::cout << "Found " << points - hidden <<
+                " live points but expected " << point_count_ << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<uint64_t> BKDTree::segmentSizes()
+    {
+        std::lock_guard<std::mutex> guard( lock_ );
+        std::vector<uint64_t> sizes;
+        for( const std::shared_ptr<Segment> &segment : levels_ ) {
+            if( segment ) {
+                sizes.push_back( segment->point_count_ );
+            }
+        }
+        return sizes;
+    }
+
+    uint64_t BKDTree::tombstoneCount()
+    {
+        std::lock_guard<std::mutex> guard( lock_ );
+        uint64_t count = 0;
+        for( const auto &entry : tombstones_ ) {
+            count += entry.second;
+        }
+        return count;
+    }
+
+    void BKDTree::stat()
+    {
+        std::lock_guard<std::mutex> guard( lock_ );
+        size_t leaves = 0;
+        size_t splits = 0;
+        std::cout << "Buffered points: " << buffer_.size() << " / " <<
+            buffer_capacity_ << std::endl;
+        std::cout << "Buffers awaiting merge: " << frozen_.size() <<
+            std::endl;
+        for( size_t level = 0; level < levels_.size(); level++ ) {
+            if( !levels_[level] ) {
+                continue;
+            }
+            std::cout << "Level " << level << ": " <<
+                levels_[level]->point_count_ << " points in " <<
+                levels_[level]->leaves_.size() << " leaves" << std::endl;
+            leaves += levels_[level]->leaves_.size();
+            splits += levels_[level]->split_values_.size();
+        }
+        std::cout << "Leaf blocks: " << leaves << std::endl;
+        std::cout << "Avg leaf occupancy: " << (leaves ? (double)
+                (point_count_ - buffer_.size()) / (leaves * LEAF_CAPACITY) :
+                0.0) << std::endl;
+        std::cout << "Tombstones: " << tombstones_.size() << std::endl;
+        std::cout << "Split table size: " << splits * (sizeof(uint8_t) +
+                sizeof(double)) << " bytes" << std::endl;
+    }
+
+    void BKDTree::print()
+    {
+        std::lock_guard<std::mutex> guard( lock_ );
+        for( size_t level = 0; level < levels_.size(); level++ ) {
+            if( !levels_[level] ) {
+                std::cout << "Level " << level << ": empty" << std::endl;
+                continue;
+            }
+            std::cout << "Level " << level << ": " <<
+                levels_[level]->point_count_ << " points in " <<
+                levels_[level]->bounding_box_ << std::endl;
+        }
+        for( const Point &p : buffer_ ) {
+            std::cout << "Buffered " << p << std::endl;
+        }
+    }
+
+    void BKDTree::visualize()
+    {
+    }
+
+    void BKDTree::loadMetadata( tree_node_handle head )
+    {
+        std::vector<char> bytes = node_allocator_.read_blob( head,
+                metadata_chunks_ );
+
+        size_t offset = 0;
+        auto read = [&]( void *dst, size_t len ) {
+            if( offset + len > bytes.size() ) {
+                throw std::runtime_error( "Backing file " + backing_file_ +
+                        " has truncated segment metadata" );
+            }
+            memcpy( dst, bytes.data() + offset, len );
+            offset += len;
+        };
+
+        uint64_t levels;
+        read( &levels, sizeof(levels) );
+        levels_.resize( levels );
+        for( uint64_t level = 0; level < levels; level++ ) {
+            uint64_t point_count;
+            read( &point_count, sizeof(point_count) );
+            if( point_count == 0 ) {
+                continue;
+            }
+
+            auto segment = std::make_shared<Segment>( this );
+            segment->point_count_ = point_count;
+            read( &segment->bounding_box_.lowerLeft, sizeof(Point) );
+            read( &segment->bounding_box_.upperRight, sizeof(Point) );
+            uint64_t splits;
+            read( &splits, sizeof(splits) );
+            segment->split_dimensions_.resize( splits );
+            segment->split_values_.resize( splits );
+            read( segment->split_dimensions_.data(), splits *
+                    sizeof(uint8_t) );
+            read( segment->split_values_.data(), splits * sizeof(double) );
+            uint64_t leaves;
+            read( &leaves, sizeof(leaves) );
+            segment->leaves_.resize( leaves );
+            read( segment->leaves_.data(), leaves *
+                    sizeof(tree_node_handle) );
+            levels_[level] = segment;
+        }
+
+        uint64_t buffered;
+        read( &buffered, sizeof(buffered) );
+        buffer_.resize( buffered );
+        read( buffer_.data(), buffered * sizeof(Point) );
+
+        uint64_t tombstones;
+        read( &tombstones, sizeof(tombstones) );
+        for( uint64_t i = 0; i < tombstones; i++ ) {
+            Point p;
+            uint32_t count;
+            read( &p, sizeof(p) );
+            read( &count, sizeof(count) );
+            tombstones_[p] = count;
+        }
+    }
+
+    tree_node_handle BKDTree::persistMetadata()
+    {
+        std::vector<char> bytes;
+        auto write = [&bytes]( const void *src, size_t len ) {
+            bytes.insert( bytes.end(), (const char *) src, (const char *)
+                    src + len );
+        };
+
+        uint64_t levels = levels_.size();
+        write( &levels, sizeof(levels) );
+        for( const std::shared_ptr<Segment> &segment : levels_ ) {
+            uint64_t point_count = segment ? segment->point_count_ : 0;
+            write( &point_count, sizeof(point_count) );
+            if( !segment ) {
+                continue;
+            }
+            write( &segment->bounding_box_.lowerLeft, sizeof(Point) );
+            write( &segment->bounding_box_.upperRight, sizeof(Point) );
+            uint64_t splits = segment->split_values_.size();
+            write( &splits, sizeof(splits) );
+            write( segment->split_dimensions_.data(), splits *
+                    sizeof(uint8_t) );
+            write( segment->split_values_.data(), splits * sizeof(double) );
+            uint64_t leaves = segment->leaves_.size();
+            write( &leaves, sizeof(leaves) );
+            write( segment->leaves_.data(), leaves *
+                    sizeof(tree_node_handle) );
+        }
+
+        uint64_t buffered = buffer_.size();
+        write( &buffered, sizeof(buffered) );
+        write( buffer_.data(), buffered * sizeof(Point) );
+
+        uint64_t tombstones = tombstones_.size();
+        write( &tombstones, sizeof(tombstones) );
+        for( const auto &entry : tombstones_ ) {
+            uint32_t count = entry.second;
+            write( &entry.first, sizeof(Point) );
+            write( &count, sizeof(count) );
+        }
+
+        return node_allocator_.write_blob( bytes, metadata_chunks_ );
+    }
+
+    void BKDTree::write_metadata()
+    {
+        waitForMerges();
+
+        std::lock_guard<std::mutex> guard( lock_ );
+        std::lock_guard<std::mutex> storage_guard( storage_lock_ );
+        superblock sb = superblock::describe( BKDTREE_DISK, LEAF_CAPACITY,
+                LEAF_CAPACITY );
+        sb.root_ = persistMetadata();
+        sb.point_count_ = point_count_;
+        sb.tree_height_ = levels_.size();
+
+        // Writes back everything to disk along with the superblock
+        node_allocator_.write_superblock( sb );
+    }
+}
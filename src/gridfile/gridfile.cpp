@@ -0,0 +1,664 @@
+#include <gridfile/gridfile.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace gridfile
+{
+    static uint64_t handleKey( tree_node_handle handle )
+    {
+        return ((uint64_t) handle.get_page_id() << 16) | handle.get_offset();
+    }
+
+    GridFile::GridFile( buffer_budget memory_budget, std::string backing_file,
+            page_encoding encoding, unsigned bucket_capacity ) :
+        node_allocator_( memory_budget, backing_file, encoding ),
+        backing_file_( backing_file ), bucket_capacity_( bucket_capacity ),
+        point_count_( 0 ), scales_( dimensions )
+    {
+        assert( bucket_capacity_ > 0 and bucket_capacity_ <=
+                MAX_BUCKET_CAPACITY );
+        node_allocator_.initialize();
+
+        superblock sb;
+        superblock expected = superblock::describe( GRIDFILE_DISK,
+                bucket_capacity_, bucket_capacity_ );
+        if( node_allocator_.load_superblock( expected, sb ) ) {
+            point_count_ = sb.point_count_;
+            loadDirectory( sb.root_ );
+            return;
+        }
+
+        // A fresh grid is one cell covering everything
+        node_allocator_.reserve_superblock();
+        directory_.push_back( createBucket() );
+    }
+
+    uint16_t GridFile::bucketAllocationSize() const
+    {
+        return BUCKET_HEADER_SIZE + bucket_capacity_ * sizeof(Point);
+    }
+
+    tree_node_handle GridFile::createBucket()
+    {
+        auto alloc_data = node_allocator_.create_new_tree_node<Bucket>(
+                bucketAllocationSize(), NodeHandleType(0) );
+        assert( alloc_data.second );
+        alloc_data.first->next_ = tree_node_handle( nullptr );
+        alloc_data.first->count_ = 0;
+        return alloc_data.second;
+    }
+
+    size_t GridFile::cellCount() const
+    {
+        size_t count = 1;
+        for( const std::vector<double> &scale : scales_ ) {
+            count *= scale.size() + 1;
+        }
+        return count;
+    }
+
+    size_t GridFile::bucketCount() const
+    {
+        std::unordered_set<uint64_t> buckets;
+        for( tree_node_handle bucket_handle : directory_ ) {
+            buckets.insert( handleKey( bucket_handle ) );
+        }
+        return buckets.size();
+    }
+
+    size_t GridFile::intervalFor( unsigned dimension, double value ) const
+    {
+        const std::vector<double> &scale = scales_[dimension];
+        return std::upper_bound( scale.begin(), scale.end(), value ) -
+            scale.begin();
+    }
+
+    size_t GridFile::cellIndex( const std::vector<size_t> &coordinates )
+        const
+    {
+        size_t cell = 0;
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            cell = cell * (scales_[d].size() + 1) + coordinates[d];
+        }
+        return cell;
+    }
+
+    std::vector<size_t> GridFile::cellCoordinates( size_t cell ) const
+    {
+        std::vector<size_t> coordinates( dimensions );
+        for( unsigned d = dimensions; d-- > 0; ) {
+            size_t intervals = scales_[d].size() + 1;
+            coordinates[d] = cell % intervals;
+            cell /= intervals;
+        }
+        return coordinates;
+    }
+
+    size_t GridFile::cellStride( unsigned dimension ) const
+    {
+        size_t stride = 1;
+        for( unsigned d = dimension + 1; d < dimensions; d++ ) {
+            stride *= scales_[d].size() + 1;
+        }
+        return stride;
+    }
+
+    size_t GridFile::cellFor( const Point &p ) const
+    {
+        size_t cell = 0;
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            cell = cell * (scales_[d].size() + 1) + intervalFor( d, p[d] );
+        }
+        return cell;
+    }
+
+    std::vector<Point> GridFile::readBucket( tree_node_handle bucket_handle )
+    {
+        std::vector<Point> points;
+        while( bucket_handle ) {
+            pinned_node_ptr<Bucket> bucket = get_bucket( bucket_handle );
+            points.insert( points.end(), bucket->points_, bucket->points_ +
+                    bucket->count_ );
+            bucket_handle = bucket->next_;
+        }
+        return points;
+    }
+
+    void GridFile::writeBucket( tree_node_handle bucket_handle, const
+            std::vector<Point> &points )
+    {
+        size_t written = 0;
+        pinned_node_ptr<Bucket> bucket = get_bucket( bucket_handle );
+        for( ;; ) {
+            size_t count = std::min( (size_t) bucket_capacity_,
+                    points.size() - written );
+            std::copy( points.begin() + written, points.begin() + written +
+                    count, bucket->points_ );
+            bucket->count_ = count;
+            written += count;
+
+            if( written == points.size() ) {
+                break;
+            }
+            if( !bucket->next_ ) {
+                bucket->next_ = createBucket();
+            }
+            bucket = get_bucket( bucket->next_ );
+        }
+
+        // Give back whatever is left of the chain
+        tree_node_handle spare = bucket->next_;
+        bucket->next_ = tree_node_handle( nullptr );
+        while( spare ) {
+            tree_node_handle next = get_bucket( spare )->next_;
+            node_allocator_.free( spare, bucketAllocationSize() );
+            spare = next;
+        }
+    }
+
+    void GridFile::bucketRegion( size_t cell, std::vector<size_t> &low,
+            std::vector<size_t> &high ) const
+    {
+        tree_node_handle bucket_handle = directory_[cell];
+        low.resize( dimensions );
+        high.resize( dimensions );
+        size_t rest = cell;
+        for( unsigned d = dimensions; d-- > 0; ) {
+            size_t intervals = scales_[d].size() + 1;
+            low[d] = high[d] = rest % intervals;
+            rest /= intervals;
+        }
+
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            size_t stride = cellStride( d );
+            size_t start = low[d];
+            while( low[d] > 0 and directory_[cell - (start - low[d] + 1) *
+                    stride] == bucket_handle ) {
+                low[d]--;
+            }
+            while( high[d] < scales_[d].size() and directory_[cell + (high[d]
+                    - start + 1) * stride] == bucket_handle ) {
+                high[d]++;
+            }
+        }
+    }
+
+    void GridFile::splitRegion( tree_node_handle bucket_handle, unsigned
+            dimension, const std::vector<size_t> &low, const
+            std::vector<size_t> &high )
+    {
+        assert( high[dimension] > low[dimension] );
+
+        // Cells from the middle interval up move to a new bucket
+        size_t middle = low[dimension] + (high[dimension] - low[dimension]
+                + 1) / 2;
+        double boundary = scales_[dimension][middle - 1];
+
+        // Odometer step through the upper part of the region
+        tree_node_handle sibling_handle = createBucket();
+        std::vector<size_t> coordinates = low;
+        coordinates[dimension] = middle;
+        for( ;; ) {
+            size_t cell = cellIndex( coordinates );
+            assert( directory_[cell] == bucket_handle );
+            directory_[cell] = sibling_handle;
+
+            unsigned d = dimensions;
+            while( d-- > 0 ) {
+                if( coordinates[d] < high[d] ) {
+                    coordinates[d]++;
+                    break;
+                }
+                coordinates[d] = d == dimension ? middle : low[d];
+            }
+            if( d == std::numeric_limits<unsigned>::max() ) {
+                break;
+            }
+        }
+
+        std::vector<Point> stay;
+        std::vector<Point> move;
+        for( const Point &p : readBucket( bucket_handle ) ) {
+            if( p[dimension] >= boundary ) {
+                move.push_back( p );
+            } else {
+                stay.push_back( p );
+            }
+        }
+        writeBucket( bucket_handle, stay );
+        writeBucket( sibling_handle, move );
+    }
+
+    void GridFile::refineScale( unsigned dimension, size_t interval, double
+            boundary )
+    {
+        std::vector<size_t> oldIntervals( dimensions );
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            oldIntervals[d] = scales_[d].size() + 1;
+        }
+
+        std::vector<double> &scale = scales_[dimension];
+        scale.insert( scale.begin() + interval, boundary );
+
+        // Both halves of the split interval start out sharing the old
+        // cell's bucket
+        std::vector<tree_node_handle> directory( cellCount() );
+        std::vector<size_t> coordinates( dimensions, 0 );
+        for( size_t cell = 0; cell < directory.size(); cell++ ) {
+            size_t oldCell = 0;
+            for( unsigned d = 0; d < dimensions; d++ ) {
+                size_t coordinate = coordinates[d];
+                if( d == dimension and coordinate > interval ) {
+                    coordinate--;
+                }
+                oldCell = oldCell * oldIntervals[d] + coordinate;
+            }
+            directory[cell] = directory_[oldCell];
+
+            // Next cell in row-major order
+            for( unsigned d = dimensions; d-- > 0; ) {
+                if( ++coordinates[d] <= scales_[d].size() ) {
+                    break;
+                }
+                coordinates[d] = 0;
+            }
+        }
+        directory_.swap( directory );
+    }
+
+    bool GridFile::splitBucket( tree_node_handle bucket_handle, const Point
+            &incoming )
+    {
+        std::vector<size_t> low;
+        std::vector<size_t> high;
+        bucketRegion( cellFor( incoming ), low, high );
+        assert( directory_[cellFor( incoming )] == bucket_handle );
+
+        // Shared buckets split between their cells along the dimension
+        // they span the most intervals of
+        unsigned widest = 0;
+        for( unsigned d = 1; d < dimensions; d++ ) {
+            if( high[d] - low[d] > high[widest] - low[widest] ) {
+                widest = d;
+            }
+        }
+        if( high[widest] > low[widest] ) {
+            splitRegion( bucket_handle, widest, low, high );
+            return true;
+        }
+
+        // The bucket has a cell of its own, so cut that cell in two at
+        // the median of its points in the dimension they spread widest
+        std::vector<Point> points = readBucket( bucket_handle );
+        points.push_back( incoming );
+
+        std::vector<unsigned> order( dimensions );
+        std::vector<double> spread( dimensions );
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            order[d] = d;
+            auto bounds = std::minmax_element( points.begin(), points.end(),
+                    [d]( const Point &a, const Point &b ) { return a[d] <
+                    b[d]; } );
+            spread[d] = (*bounds.second)[d] - (*bounds.first)[d];
+        }
+        std::stable_sort( order.begin(), order.end(), [&spread]( unsigned a,
+                    unsigned b ) { return spread[a] > spread[b]; } );
+
+        std::vector<double> values( points.size() );
+        for( unsigned d : order ) {
+            if( spread[d] == 0.0 ) {
+                break;
+            }
+            for( size_t i = 0; i < points.size(); i++ ) {
+                values[i] = points[i][d];
+            }
+            std::sort( values.begin(), values.end() );
+
+            // Points below the boundary stay, so it must leave at least
+            // one point on either side
+            double boundary = values[values.size() / 2];
+            if( boundary == values.front() ) {
+                boundary = *std::upper_bound( values.begin(), values.end(),
+                        values.front() );
+            }
+
+            refineScale( d, low[d], boundary );
+            high[d] = low[d] + 1;
+            splitRegion( bucket_handle, d, low, high );
+            return true;
+        }
+
+        return false;
+    }
+
+    std::vector<Point> GridFile::exhaustiveSearch( Point requestedPoint )
+    {
+        std::vector<Point> matchingPoints;
+        std::unordered_set<uint64_t> visited;
+        for( tree_node_handle bucket_handle : directory_ ) {
+            if( !visited.insert( handleKey( bucket_handle ) ).second ) {
+                continue;
+            }
+            for( const Point &p : readBucket( bucket_handle ) ) {
+                if( p == requestedPoint ) {
+                    matchingPoints.push_back( p );
+                }
+            }
+        }
+        return matchingPoints;
+    }
+
+    std::vector<Point> GridFile::search( Point requestedPoint )
+    {
+        std::vector<Point> matchingPoints;
+        tree_node_handle bucket_handle = directory_[cellFor( requestedPoint )];
+        while( bucket_handle ) {
+            pinned_node_ptr<Bucket> bucket = get_bucket( bucket_handle );
+#ifdef STAT
+            stats.markLeafSearched();
+#endif
+            for( unsigned i = 0; i < bucket->count_; i++ ) {
+                if( bucket->points_[i] == requestedPoint ) {
+                    matchingPoints.push_back( bucket->points_[i] );
+                }
+            }
+            bucket_handle = bucket->next_;
+        }
+#ifdef STAT
+        stats.resetSearchTracker( false );
+#endif
+        return matchingPoints;
+    }
+
+    std::vector<Point> GridFile::search( Rectangle requestedRectangle )
+    {
+        // Enumerate the cells the query overlaps, then read each of
+        // their buckets once, in page order
+        std::vector<size_t> low( dimensions );
+        std::vector<size_t> high( dimensions );
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            low[d] = intervalFor( d, requestedRectangle.lowerLeft[d] );
+            high[d] = intervalFor( d, requestedRectangle.upperRight[d] );
+        }
+
+        std::vector<tree_node_handle> buckets;
+        std::unordered_set<uint64_t> visited;
+        std::vector<size_t> coordinates = low;
+        for( ;; ) {
+            tree_node_handle bucket_handle = directory_[cellIndex(
+                    coordinates )];
+            if( visited.insert( handleKey( bucket_handle ) ).second ) {
+                buckets.push_back( bucket_handle );
+            }
+
+            // Odometer step through the box of cells
+            unsigned d = dimensions;
+            while( d-- > 0 ) {
+                if( coordinates[d] < high[d] ) {
+                    coordinates[d]++;
+                    break;
+                }
+                coordinates[d] = low[d];
+            }
+            if( d == std::numeric_limits<unsigned>::max() ) {
+                break;
+            }
+        }
+
+        std::vector<Point> matchingPoints;
+        node_allocator_.visit_in_page_order( buckets,
+                [&]( tree_node_handle bucket_handle ) {
+            while( bucket_handle ) {
+                pinned_node_ptr<Bucket> bucket = get_bucket( bucket_handle );
+#ifdef STAT
+                stats.markLeafSearched();
+#endif
+                for( unsigned i = 0; i < bucket->count_; i++ ) {
+                    if( requestedRectangle.containsPoint( bucket->points_[i] ) ) {
+                        matchingPoints.push_back( bucket->points_[i] );
+                    }
+                }
+                bucket_handle = bucket->next_;
+            }
+        } );
+#ifdef STAT
+        stats.resetSearchTracker( true );
+#endif
+        return matchingPoints;
+    }
+
+    void GridFile::insert( Point givenPoint )
+    {
+        for( ;; ) {
+            tree_node_handle bucket_handle = directory_[cellFor( givenPoint )];
+            pinned_node_ptr<Bucket> bucket = get_bucket( bucket_handle );
+            if( !bucket->next_ and bucket->count_ < bucket_capacity_ ) {
+                bucket->points_[bucket->count_] = givenPoint;
+                bucket->count_++;
+                break;
+            }
+
+            if( !splitBucket( bucket_handle, givenPoint ) ) {
+                // Nothing but duplicates of givenPoint, chain them
+                std::vector<Point> points = readBucket( bucket_handle );
+                points.push_back( givenPoint );
+                writeBucket( bucket_handle, points );
+                break;
+            }
+        }
+        point_count_++;
+    }
+
+    void GridFile::remove( Point givenPoint )
+    {
+        tree_node_handle bucket_handle = directory_[cellFor( givenPoint )];
+        std::vector<Point> points = readBucket( bucket_handle );
+        auto iter = std::find( points.begin(), points.end(), givenPoint );
+        if( iter == points.end() ) {
+            return;
+        }
+
+        // Buckets are not merged back when they empty out, the cells
+        // keep them for the next insert
+        *iter = points.back();
+        points.pop_back();
+        writeBucket( bucket_handle, points );
+        point_count_--;
+    }
+
+    unsigned GridFile::checksum()
+    {
+        unsigned sum = 0;
+        std::unordered_set<uint64_t> visited;
+        for( tree_node_handle bucket_handle : directory_ ) {
+            if( !visited.insert( handleKey( bucket_handle ) ).second ) {
+                continue;
+            }
+            for( const Point &p : readBucket( bucket_handle ) ) {
+                for( unsigned d = 0; d < dimensions; d++ ) {
+                    sum += (unsigned) p[d];
+                }
+            }
+        }
+        return sum;
+    }
+
+    bool GridFile::validate()
+    {
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            if( !std::is_sorted( scales_[d].begin(), scales_[d].end() ) ) {
+                std::cout << "Scale " << d << " is out of order" << std::endl;
+                return false;
+            }
+        }
+        if( directory_.size() != cellCount() ) {
+            std::cout << "Directory has " << directory_.size() <<
+                " cells but the scales make " << cellCount() << std::endl;
+            return false;
+        }
+
+        // Every bucket's cells must form a box, as bucketRegion relies on
+        std::unordered_map<uint64_t, size_t> cellsPerBucket;
+        for( tree_node_handle bucket_handle : directory_ ) {
+            cellsPerBucket[handleKey( bucket_handle )]++;
+        }
+        std::vector<size_t> low;
+        std::vector<size_t> high;
+        for( size_t cell = 0; cell < directory_.size(); cell++ ) {
+            size_t &cells = cellsPerBucket[handleKey( directory_[cell] )];
+            if( cells == 0 ) {
+                // Already checked from an earlier cell
+                continue;
+            }
+            bucketRegion( cell, low, high );
+            size_t boxCells = 0;
+            std::vector<size_t> coordinates = low;
+            for( ;; ) {
+                if( directory_[cellIndex( coordinates )] != directory_[cell] ) {
+                    boxCells = 0;
+                    break;
+                }
+                boxCells++;
+
+                unsigned d = dimensions;
+                while( d-- > 0 ) {
+                    if( coordinates[d] < high[d] ) {
+                        coordinates[d]++;
+                        break;
+                    }
+                    coordinates[d] = low[d];
+                }
+                if( d == std::numeric_limits<unsigned>::max() ) {
+                    break;
+                }
+            }
+            if( boxCells != cells ) {
+                std::cout << "Bucket of cell " << cell << " spans " << cells
+                    << " cells that don't form a box" << std::endl;
+                return false;
+            }
+            cells = 0;
+        }
+
+        // Every point must be found through the cell it falls in
+        uint64_t points = 0;
+        std::unordered_set<uint64_t> visited;
+        for( tree_node_handle bucket_handle : directory_ ) {
+            if( !visited.insert( handleKey( bucket_handle ) ).second ) {
+                continue;
+            }
+            for( const Point &p : readBucket( bucket_handle ) ) {
+                if( directory_[cellFor( p )] != bucket_handle ) {
+                    std::cout << p << " is stored in the wrong bucket" <<
+                        std::endl;
+                    return false;
+                }
+                points++;
+            }
+        }
+        if( points != point_count_ ) {
+            std::cout << "Found " << points << " points but expected " <<
+                point_count_ << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void GridFile::stat()
+    {
+        size_t buckets = bucketCount();
+        std::cout << "Grid cells: " << cellCount() << std::endl;
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            std::cout << "Intervals in dimension " << d << ": " <<
+                scales_[d].size() + 1 << std::endl;
+        }
+        std::cout << "Buckets: " << buckets << std::endl;
+        std::cout << "Avg bucket occupancy: " << (double) point_count_ /
+            (buckets * bucket_capacity_) << std::endl;
+        std::cout << "Directory size: " << directory_.size() *
+            sizeof(tree_node_handle) << " bytes" << std::endl;
+    }
+
+    void GridFile::print()
+    {
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            std::cout << "Scale " << d << ":";
+            for( double boundary : scales_[d] ) {
+                std::cout << " " << boundary;
+            }
+            std::cout << std::endl;
+        }
+        for( size_t cell = 0; cell < directory_.size(); cell++ ) {
+            std::cout << "Cell " << cell << " -> " << directory_[cell] <<
+                std::endl;
+        }
+    }
+
+    void GridFile::visualize()
+    {
+    }
+
+    void GridFile::loadDirectory( tree_node_handle head )
+    {
+        std::vector<char> bytes = node_allocator_.read_blob( head,
+                directory_chunks_ );
+
+        size_t offset = 0;
+        auto read = [&]( void *dst, size_t len ) {
+            if( offset + len > bytes.size() ) {
+                throw std::runtime_error( "Backing file " + backing_file_ +
+                        " has a truncated grid directory" );
+            }
+            memcpy( dst, bytes.data() + offset, len );
+            offset += len;
+        };
+
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            uint64_t boundaries;
+            read( &boundaries, sizeof(boundaries) );
+            scales_[d].resize( boundaries );
+            read( scales_[d].data(), boundaries * sizeof(double) );
+        }
+        uint64_t cells;
+        read( &cells, sizeof(cells) );
+        directory_.resize( cells );
+        read( directory_.data(), cells * sizeof(tree_node_handle) );
+        assert( directory_.size() == cellCount() );
+    }
+
+    tree_node_handle GridFile::persistDirectory()
+    {
+        std::vector<char> bytes;
+        auto write = [&bytes]( const void *src, size_t len ) {
+            bytes.insert( bytes.end(), (const char *) src, (const char *)
+                    src + len );
+        };
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            uint64_t boundaries = scales_[d].size();
+            write( &boundaries, sizeof(boundaries) );
+            write( scales_[d].data(), boundaries * sizeof(double) );
+        }
+        uint64_t cells = directory_.size();
+        write( &cells, sizeof(cells) );
+        write( directory_.data(), cells * sizeof(tree_node_handle) );
+
+        return node_allocator_.write_blob( bytes, directory_chunks_ );
+    }
+
+    void GridFile::write_metadata()
+    {
+        superblock sb = superblock::describe( GRIDFILE_DISK,
+                bucket_capacity_, bucket_capacity_ );
+        sb.root_ = persistDirectory();
+        sb.point_count_ = point_count_;
+        sb.tree_height_ = 1;
+
+        // Writes back everything to disk along with the superblock
+        node_allocator_.write_superblock( sb );
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef __CONTENTION__
+#define __CONTENTION__
+
+#include <map>
+#include <string>
+
+// Hammers the root of the R-Tree or R*-Tree disk tree with point
+// searches from 1 up to configU["contention"] threads, first with every
+// search taking a shared latch and then optimistically, and finally
+// optimistically alongside a thread inserting as fast as it can.
+// Reports searches per second for each.
+void contentionBenchmark(std::map<std::string, unsigned> &configU);
+
+// Runs point searches, alone and then mixed with inserts, from 1 up to
+// configU["concurrent"] threads against an in-memory R-Tree behind a
+// reader-writer latch and against the concurrent R-Tree, which takes no
+// latch to search. Reports operations per second for each and checks
+// that the concurrent tree still validates afterwards.
+void concurrentRTreeBenchmark(std::map<std::string, unsigned> &configU);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __LAYOUT__
+#define __LAYOUT__
+
+#include <map>
+#include <string>
+
+// Builds an in-memory R*-Tree and NIR-Tree from configU["size"] uniform
+// points and packs each into the cache-line-aligned layout of
+// util/packedtree.h. Then runs the same point searches and
+// configU["rectanglescount"] range searches through both layouts,
+// reporting the time and cache misses per query. Point searches are
+// also run with learned routing on the upper levels of the packed copy,
+// one level deeper at a time. Cache misses are read from the hardware
+// counters and are reported unavailable where the kernel doesn't offer
+// them.
+void layoutBenchmark(std::map<std::string, unsigned> &configU);
+
+#endif
@@ -19,6 +19,10 @@
 #include <nirtreedisk/nirtreedisk.h>
 #include <quadtree/quadtree.h>
 #include <revisedrstartree/revisedrstartree.h>
+#include <gridfile/gridfile.h>
+#include <bkdtree/bkdtree.h>
+#include <bench/synthetic.h>
+#include <memory>
 #include <optional>
 
 const unsigned BitDataSize = 60000;
@@ -37,17 +41,22 @@ const unsigned GaiaDataSize = 18084053;
 const unsigned GaiaQuerySize = 5000;
 const unsigned MicrosoftBuildingsDataSize = 752704741;
 
-enum BenchType {UNIFORM, SKEW, CLUSTER, CALIFORNIA, BIOLOGICAL, FOREST, CANADA, GAIA, MICROSOFTBUILDINGS};
-enum TreeType {R_TREE, R_PLUS_TREE, R_STAR_TREE, NIR_TREE, QUAD_TREE, REVISED_R_STAR_TREE};
+enum BenchType {UNIFORM, SKEW, CLUSTER, CALIFORNIA, BIOLOGICAL, FOREST, CANADA, GAIA, MICROSOFTBUILDINGS, GENERATED_UNIFORM, ZIPF, GAUSSIAN_CLUSTERS, ROAD_NETWORK, DUPLICATES};
+enum TreeType {R_TREE, R_PLUS_TREE, R_STAR_TREE, NIR_TREE, QUAD_TREE, REVISED_R_STAR_TREE, GRID_FILE, BKD_TREE};
 
 void randomPoints(std::map<std::string, unsigned> &configU, std::map<std::string, double> &configD);
 
+// Builds the index selected by configU, opening the backing file for disk
+// trees. Returns nullptr for an unknown tree type.
+Index *createIndex(std::map<std::string, unsigned> &configU);
+
 // Tags defining how the benchmark is generated
 namespace BenchTag
 {
 	struct DistributionGenerated {};
 	struct FileBackedReadAll {};
 	struct FileBackedReadChunksAtATime {};
+	struct SyntheticGenerated {};
 	struct Error {};
 };
 
@@ -128,6 +137,48 @@ namespace BenchTypeClasses
 			static constexpr unsigned dimensions = 2;
 			static constexpr char fileName[] = "/home/bjglasbe/Documents/code/nir-tree/data/microsoftbuildings";
 	};
+
+	// Streamed from a SyntheticStream in any number of dimensions
+	class Synthetic : public Benchmark
+	{
+		public:
+			static unsigned size;
+			static unsigned seed;
+			// Generator threads, 0 for one per hardware thread
+			static unsigned threads;
+			static constexpr unsigned dimensions = 0;
+			static constexpr char fileName[] = "";
+	};
+
+	class GeneratedUniform : public Synthetic
+	{
+		public:
+			static constexpr SyntheticDistribution distribution = SYNTHETIC_UNIFORM;
+	};
+
+	class Zipf : public Synthetic
+	{
+		public:
+			static constexpr SyntheticDistribution distribution = SYNTHETIC_ZIPF;
+	};
+
+	class GaussianClusters : public Synthetic
+	{
+		public:
+			static constexpr SyntheticDistribution distribution = SYNTHETIC_GAUSSIAN_CLUSTERS;
+	};
+
+	class RoadNetwork : public Synthetic
+	{
+		public:
+			static constexpr SyntheticDistribution distribution = SYNTHETIC_ROAD_NETWORK;
+	};
+
+	class Duplicates : public Synthetic
+	{
+		public:
+			static constexpr SyntheticDistribution distribution = SYNTHETIC_DUPLICATES;
+	};
 };
 
 
@@ -161,6 +212,21 @@ namespace BenchDetail
 	template <>
 	struct getBenchTag<BenchTypeClasses::MicrosoftBuildings> : BenchTag::FileBackedReadChunksAtATime {};
 
+	template <>
+	struct getBenchTag<BenchTypeClasses::GeneratedUniform> : BenchTag::SyntheticGenerated {};
+
+	template <>
+	struct getBenchTag<BenchTypeClasses::Zipf> : BenchTag::SyntheticGenerated {};
+
+	template <>
+	struct getBenchTag<BenchTypeClasses::GaussianClusters> : BenchTag::SyntheticGenerated {};
+
+	template <>
+	struct getBenchTag<BenchTypeClasses::RoadNetwork> : BenchTag::SyntheticGenerated {};
+
+	template <>
+	struct getBenchTag<BenchTypeClasses::Duplicates> : BenchTag::SyntheticGenerated {};
+
 }
 
 template <typename T>
@@ -170,13 +236,16 @@ class PointGenerator
 		PointGenerator(BenchTag::DistributionGenerated);
 		PointGenerator(BenchTag::FileBackedReadAll);
 		PointGenerator(BenchTag::FileBackedReadChunksAtATime);
+		PointGenerator(BenchTag::SyntheticGenerated);
 
 		void reset(BenchTag::DistributionGenerated);
 		void reset(BenchTag::FileBackedReadAll);
 		void reset(BenchTag::FileBackedReadChunksAtATime);
+		void reset(BenchTag::SyntheticGenerated);
 		std::optional<Point> nextPoint(BenchTag::DistributionGenerated);
 		std::optional<Point> nextPoint(BenchTag::FileBackedReadAll);
 		std::optional<Point> nextPoint(BenchTag::FileBackedReadChunksAtATime);
+		std::optional<Point> nextPoint(BenchTag::SyntheticGenerated);
 
 		// Class members
 		unsigned benchmarkSize;
@@ -185,6 +254,7 @@ class PointGenerator
 		unsigned offset;
 
 		std::vector<Point> pointBuffer;
+		std::unique_ptr<SyntheticStream> syntheticStream;
 
 	public:
 		static_assert(std::is_base_of<BenchTypeClasses::Benchmark, T>::value && 
@@ -0,0 +1,30 @@
+#ifndef __SELECTIVITY__
+#define __SELECTIVITY__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <index/index.h>
+
+enum QueryShape {SQUARE_QUERIES, SKINNY_QUERIES, HOTSPOT_QUERIES};
+
+// Up to this many points of a dataset are kept to calibrate queries
+const unsigned SelectivitySampleSize = 100000;
+
+// Generates rectangleCount rectangles expected to each hold
+// targetResults of datasetSize points, calibrated against sample, a
+// uniform sample of the data. Each is grown around its centre until it
+// holds the right share of the sample; when that share is under one
+// point the box is shrunk further assuming the density near the centre
+// is even. Square boxes are square relative to the data's extent in
+// each dimension and centred on random sample points; skinny boxes are
+// 16 times longer along a random dimension; hotspot boxes are square
+// and centred on the densest parts of the data.
+std::vector<Rectangle> generateSelectivityRectangles(const std::vector<Point> &sample, uint64_t datasetSize, double targetResults, QueryShape shape, unsigned rectangleCount, unsigned seed);
+
+// Range searches spatialIndex at 1, 10, 1e3, 1e5 and 1e7 results for
+// each shape, skipping targets beyond the dataset, and reports the
+// average results and latency of each
+void selectivitySweep(Index *spatialIndex, const std::vector<Point> &sample, uint64_t datasetSize, std::map<std::string, unsigned> &configU);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef __SPLITS__
+#define __SPLITS__
+
+#include <map>
+#include <string>
+
+// Builds an R-Tree disk tree from configU["size"] uniform points once
+// with each split strategy, timing the inserts, then times
+// configU["rectanglescount"] range searches against each tree and
+// counts the pages they had to read through a small buffer pool.
+void splitBenchmark(std::map<std::string, unsigned> &configU);
+
+#endif
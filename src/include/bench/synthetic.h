@@ -0,0 +1,81 @@
+#ifndef __SYNTHETIC__
+#define __SYNTHETIC__
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <util/geometry.h>
+
+enum SyntheticDistribution {SYNTHETIC_UNIFORM, SYNTHETIC_ZIPF, SYNTHETIC_GAUSSIAN_CLUSTERS, SYNTHETIC_ROAD_NETWORK, SYNTHETIC_DUPLICATES};
+
+// Points generated a chunk at a time
+const unsigned SyntheticChunkSize = 65536;
+
+// Point index of a count-point dataset drawn from distribution. Every
+// point is a function of just the seed and its index, so a dataset is
+// the same however it is generated and points can be made in any order.
+// All distributions lie roughly within the unit cube:
+//   uniform           - uniform over the unit cube
+//   Zipf              - uniform within cells of a 2^20 cell grid, the
+//                       cells picked with Zipf frequencies, exponent 1.1
+//   Gaussian clusters - a mixture of 64 Gaussians of varying spread
+//   road network      - 4096 line segments, mostly short with some long
+//                       highways, points scattered tightly along them
+//   duplicates        - count / 16 distinct uniform points, each
+//                       repeated 16 times on average
+Point syntheticPoint(SyntheticDistribution distribution, uint64_t count, unsigned seed, uint64_t index);
+
+// Streams a synthetic dataset without ever holding more than a few
+// chunks of it. Worker threads generate chunks ahead of the reader into
+// a ring twice as long as there are threads, blocking while it is full.
+class SyntheticStream
+{
+	public:
+		// threadCount of 0 uses every hardware thread
+		SyntheticStream(SyntheticDistribution distribution, uint64_t count, unsigned seed, unsigned threadCount);
+		~SyntheticStream();
+
+		std::optional<Point> nextPoint();
+		// Swaps the next chunk into chunk, for loaders that take points
+		// in batches. False once the dataset is exhausted.
+		bool nextChunk(std::vector<Point> &chunk);
+		// Starts the dataset over from its first point
+		void reset();
+
+	private:
+		struct Slot
+		{
+			std::vector<Point> points;
+			uint64_t chunk;
+			bool ready;
+		};
+
+		void startWorkers();
+		void stopWorkers();
+		void work();
+
+		SyntheticDistribution distribution;
+		uint64_t count;
+		unsigned seed;
+		unsigned threadCount;
+		uint64_t chunkCount;
+
+		std::mutex latch;
+		std::condition_variable produced;
+		std::condition_variable consumed;
+		std::vector<Slot> ring;
+		std::vector<std::thread> workers;
+		bool stopping;
+		// Next chunk for a worker to generate and for the reader to take
+		uint64_t claimChunk;
+		uint64_t readChunk;
+
+		// The chunk nextPoint() is reading from
+		std::vector<Point> current;
+		size_t offset;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <index/index.h>
+#include <util/geometry.h>
+#include <util/statistics.h>
+#include <storage/tree_node_allocator.h>
+#include <storage/point_location_index.h>
+#include <storage/superblock.h>
+
+namespace bkdtree
+{
+    // A leaf block fills a whole page so that the blocks of a segment
+    // are laid out back to back in the backing file.
+    struct LeafBlock
+    {
+        uint32_t count_;
+        Point points_[(PAGE_DATA_SIZE - sizeof(uint64_t)) / sizeof(Point)];
+    };
+
+    constexpr unsigned LEAF_CAPACITY = (PAGE_DATA_SIZE - sizeof(uint64_t)) /
+        sizeof(Point);
+    static_assert( sizeof(LeafBlock) <= PAGE_DATA_SIZE );
+
+    constexpr unsigned DEFAULT_BUFFER_CAPACITY = 16 * LEAF_CAPACITY;
+
+    class BKDTree;
+
+    // An immutable kd-tree bulk loaded from a known set of points. The
+    // points are split at the median of their widest dimension until
+    // every part fits in a leaf block, so every leaf but the last is
+    // full and the tree is perfectly balanced. Internal nodes only hold
+    // a split and live in memory, implicitly numbered (children of node
+    // i are 2i + 1 and 2i + 2); leaf blocks are written in key order.
+    //
+    // A segment frees its leaf blocks when the last reference to it
+    // goes away after it has been retired by a merge, so that queries
+    // still reading it are never handed recycled pages.
+    struct Segment
+    {
+        BKDTree *tree_;
+        uint64_t point_count_;
+        Rectangle bounding_box_;
+        std::vector<uint8_t> split_dimensions_;
+        std::vector<double> split_values_;
+        std::vector<tree_node_handle> leaves_;
+        bool retired_;
+
+        Segment( BKDTree *tree ) : tree_( tree ), point_count_( 0 ),
+            retired_( false ) {}
+        ~Segment();
+
+        // Leaf blocks whose region may hold points of requestedRectangle
+        void candidateLeaves( const Rectangle &requestedRectangle,
+                std::vector<tree_node_handle> &leaves ) const;
+    };
+
+    // Bkd-tree (Procopiuc et al.): inserts go to an in-memory buffer,
+    // and a full buffer becomes an immutable segment on disk. Segments
+    // follow the logarithmic method, level i holding at most one segment
+    // of up to buffer_capacity * 2^i points: a new segment is merged
+    // with every occupied level below the first free one into a single
+    // segment on that level. The merges run on a background thread, so
+    // an insert only ever appends to the buffer, and every segment is
+    // written once, sequentially, fully packed.
+    //
+    // Queries search the buffer, any buffers still waiting to be merged
+    // and every live segment. Segments never change, so a removal of a
+    // point that is already on disk records a tombstone that hides one
+    // copy of it from queries until the next merge drops that copy.
+    //
+    // Only the background thread and one caller may use the tree at a
+    // time; concurrent callers need their own locking.
+    class BKDTree : public Index
+    {
+        public:
+            tree_node_allocator node_allocator_;
+            std::string backing_file_;
+            unsigned buffer_capacity_;
+            uint64_t point_count_;
+            Statistics stats;
+
+            // Constructors and destructors
+            BKDTree( buffer_budget memory_budget, std::string backing_file,
+                    page_encoding encoding = RAW_PAGES,
+                    unsigned buffer_capacity = DEFAULT_BUFFER_CAPACITY,
+                    bool background_merges = true );
+            ~BKDTree();
+
+            // Datastructure interface
+            std::vector<Point> exhaustiveSearch( Point requestedPoint );
+            std::vector<Point> search( Point requestedPoint );
+            std::vector<Point> search( Rectangle requestedRectangle );
+            void insert( Point givenPoint );
+            void remove( Point givenPoint );
+
+            // Miscellaneous
+            unsigned checksum();
+            bool validate();
+            void stat();
+            void print();
+            void visualize();
+
+            // Waits for pending merges, then persists every segment along
+            // with the buffer and the tombstones.
+            void write_metadata();
+
+            // Blocks until every full buffer has been merged into a
+            // segment.
+            void waitForMerges();
+
+            // Points of every live segment, in level order. Empty levels
+            // are left out.
+            std::vector<uint64_t> segmentSizes();
+
+            uint64_t tombstoneCount();
+
+        protected:
+            friend struct Segment;
+
+            std::shared_ptr<Segment> buildSegment( std::vector<Point>
+                    &points );
+            void buildSubtree( Segment &segment, std::vector<Point> &points,
+                    size_t node, size_t first_leaf, size_t last_leaf );
+            std::vector<Point> readSegment( const Segment &segment );
+            void freeSegment( const Segment &segment );
+
+            // Turns the oldest frozen buffer into a segment and merges it
+            // down the levels. Returns false if there was nothing to do.
+            bool mergeOnce();
+            void mergeLoop();
+            void freezeBuffer( std::unique_lock<std::mutex> &lock );
+
+            // Everything a query needs, taken under lock_ so that it can
+            // run against a consistent set of sources without holding it
+            void snapshot( const Rectangle &requestedRectangle,
+                    std::vector<Point> &in_memory,
+                    std::vector<std::shared_ptr<Segment>> &segments,
+                    std::unordered_map<Point, unsigned, point_hash>
+                    &tombstones );
+            std::vector<Point> searchRange( const Rectangle
+                    &requestedRectangle );
+            void searchSegments( const Rectangle &requestedRectangle,
+                    const std::vector<std::shared_ptr<Segment>> &segments,
+                    std::vector<Point> &matchingPoints );
+            static void applyTombstones( std::vector<Point> &points,
+                    std::unordered_map<Point, unsigned, point_hash>
+                    tombstones );
+
+            void loadMetadata( tree_node_handle head );
+            tree_node_handle persistMetadata();
+
+            // lock_ guards the in-memory state below, storage_lock_ the
+            // allocator, since segments are built and read without
+            // holding lock_.
+            std::mutex lock_;
+            std::mutex storage_lock_;
+            std::condition_variable merge_wanted_;
+            std::condition_variable merge_done_;
+
+            std::vector<Point> buffer_;
+            std::deque<std::shared_ptr<std::vector<Point>>> frozen_;
+            std::vector<std::shared_ptr<Segment>> levels_;
+            std::unordered_map<Point, unsigned, point_hash> tombstones_;
+            bool stopping_;
+
+            std::thread merge_thread_;
+
+            // Pages holding the last persisted copy of the metadata
+            std::vector<tree_node_handle> metadata_chunks_;
+    };
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <index/index.h>
+#include <util/geometry.h>
+#include <util/statistics.h>
+#include <storage/tree_node_allocator.h>
+#include <storage/superblock.h>
+
+namespace gridfile
+{
+    // A bucket holds the points of one or more neighbouring grid cells.
+    // Buckets only chain through next_ when every point in them is the
+    // same and there is nothing left to split on.
+    struct Bucket
+    {
+        tree_node_handle next_;
+        uint32_t count_;
+        Point points_[1];
+    };
+
+    constexpr size_t BUCKET_HEADER_SIZE = sizeof(Bucket) - sizeof(Point);
+    constexpr unsigned MAX_BUCKET_CAPACITY = (PAGE_DATA_SIZE -
+            BUCKET_HEADER_SIZE) / sizeof(Point);
+
+    // Grid file (Nievergelt et al.): one linear scale per dimension cuts
+    // the space into a grid of cells, and a directory maps every cell to
+    // a bucket stored through the tree_node_allocator. A bucket that
+    // overflows is split between the cells sharing it, and a bucket that
+    // already has a cell to itself gets a new boundary in the scale of
+    // its widest dimension first. Point queries are one directory lookup
+    // and one bucket read, range queries read exactly the buckets of the
+    // cells they overlap.
+    //
+    // Suited to roughly uniform data. Skewed data grows the directory
+    // quickly since every new boundary splits a whole slice of cells.
+    class GridFile : public Index
+    {
+        public:
+            tree_node_allocator node_allocator_;
+            std::string backing_file_;
+            unsigned bucket_capacity_;
+            uint64_t point_count_;
+            Statistics stats;
+
+            // scales_[d] holds the interior boundaries in dimension d in
+            // increasing order, cutting it into scales_[d].size() + 1
+            // intervals. A boundary belongs to the interval above it.
+            std::vector<std::vector<double>> scales_;
+
+            // One bucket per cell, row-major over the intervals.
+            // Neighbouring cells may share a bucket.
+            std::vector<tree_node_handle> directory_;
+
+            // Constructors and destructors
+            GridFile( buffer_budget memory_budget, std::string backing_file,
+                    page_encoding encoding = RAW_PAGES,
+                    unsigned bucket_capacity = MAX_BUCKET_CAPACITY );
+            ~GridFile() {}
+
+            // Datastructure interface
+            std::vector<Point> exhaustiveSearch( Point requestedPoint );
+            std::vector<Point> search( Point requestedPoint );
+            std::vector<Point> search( Rectangle requestedRectangle );
+            void insert( Point givenPoint );
+            void remove( Point givenPoint );
+
+            // Miscellaneous
+            unsigned checksum();
+            bool validate();
+            void stat();
+            void print();
+            void visualize();
+
+            void write_metadata();
+
+            // Directory layout
+            size_t cellCount() const;
+            size_t bucketCount() const;
+            size_t intervalFor( unsigned dimension, double value ) const;
+            size_t cellFor( const Point &p ) const;
+            size_t cellIndex( const std::vector<size_t> &coordinates ) const;
+            std::vector<size_t> cellCoordinates( size_t cell ) const;
+            // How far apart in the directory two cells one interval apart
+            // in dimension are
+            size_t cellStride( unsigned dimension ) const;
+
+        protected:
+            inline pinned_node_ptr<Bucket> get_bucket( tree_node_handle
+                    bucket_handle ) {
+                return node_allocator_.get_tree_node<Bucket>(
+                        bucket_handle );
+            }
+
+            uint16_t bucketAllocationSize() const;
+            tree_node_handle createBucket();
+
+            // Every point in a bucket chain
+            std::vector<Point> readBucket( tree_node_handle bucket_handle );
+            // Replaces the contents of a bucket chain, growing or
+            // shrinking the chain to fit
+            void writeBucket( tree_node_handle bucket_handle, const
+                    std::vector<Point> &points );
+
+            // The inclusive range of intervals, per dimension, of the
+            // cells sharing cell's bucket. Every bucket's cells form a box,
+            // so this walks out from cell along each dimension rather
+            // than looking through the whole directory.
+            void bucketRegion( size_t cell, std::vector<size_t> &low,
+                    std::vector<size_t> &high ) const;
+
+            // Makes room for incoming in its bucket by splitting the
+            // bucket, refining a scale first if the bucket has only one
+            // cell. Returns false if the bucket's points and incoming are
+            // all the same, so that there is nothing to split on.
+            bool splitBucket( tree_node_handle bucket_handle, const Point
+                    &incoming );
+            void splitRegion( tree_node_handle bucket_handle, unsigned
+                    dimension, const std::vector<size_t> &low, const
+                    std::vector<size_t> &high );
+            void refineScale( unsigned dimension, size_t interval, double
+                    boundary );
+
+            void loadDirectory( tree_node_handle head );
+            tree_node_handle persistDirectory();
+
+            // Pages holding the last persisted copy of the directory
+            std::vector<tree_node_handle> directory_chunks_;
+    };
+}
@@ -1,9 +1,13 @@
 #ifndef __INDEX__
 #define __INDEX__
 
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <util/geometry.h>
 #include <util/statistics.h>
+#include <storage/async.h>
+#include <storage/range_estimator.h>
 
 class Index
 {
@@ -13,6 +17,65 @@ class Index
 		virtual std::vector<Point> exhaustiveSearch(Point requestedPoint) = 0;
 		virtual std::vector<Point> search(Point requestedPoint) = 0;
 		virtual std::vector<Point> search(Rectangle requestedRectangle) = 0;
+		// Range search tuned for cold or large queries on disk-backed
+		// indexes. Defaults to an ordinary range search.
+		virtual std::vector<Point> pageOrderSearch(Rectangle requestedRectangle) { return search(requestedRectangle); }
+		// Point searches for every requested point, result i for point i.
+		// Indexes that can interleave the lookups to hide cache misses
+		// override this; by default they run one after another.
+		virtual std::vector<std::vector<Point>> batchSearch(const std::vector<Point> &requestedPoints)
+		{
+			std::vector<std::vector<Point>> results;
+			results.reserve(requestedPoints.size());
+			for (const Point &requestedPoint : requestedPoints)
+			{
+				results.push_back(search(requestedPoint));
+			}
+			return results;
+		}
+		// Searches that co_await their page reads instead of blocking on
+		// them, for running many at once on an executor. By default they
+		// run the ordinary search without ever suspending.
+		virtual task<std::vector<Point>> searchAsync(executor &ex, Point requestedPoint) { co_return search(requestedPoint); }
+		virtual task<std::vector<Point>> searchAsync(executor &ex, Rectangle requestedRectangle) { co_return search(requestedRectangle); }
+		// How many points search(requestedRectangle) would return, for
+		// choosing between an index scan and a full scan. Disk trees
+		// answer from a summary of their upper levels without reading
+		// any pages; by default this runs the search and is exact.
+		virtual range_estimate estimate(Rectangle requestedRectangle)
+		{
+			uint64_t count = search(requestedRectangle).size();
+			return range_estimate{(double) count, count, count};
+		}
+		// The box around every point and how many there are, for sizing
+		// searches such as nearest-neighbour queries. Disk trees answer
+		// from their root and point count, leaving boundingBox alone when
+		// they are empty. Returns false for indexes that don't keep these
+		// at hand.
+		virtual bool extent(Rectangle &boundingBox, uint64_t &pointCount) { return false; }
+		// Writes every point to path as dimensions doubles per point, the
+		// format the benchmarks read datasets from, and returns how many.
+		// Disk trees stream their leaves in storage order; by default
+		// this runs a range search over everything.
+		virtual uint64_t exportPoints(const std::string &path)
+		{
+			std::vector<Point> points = search(Rectangle(Point::atNegInfinity, Point::atInfinity));
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			for (const Point &p : points)
+			{
+				for (unsigned d = 0; d < dimensions; ++d)
+				{
+					double value = p[d];
+					file.write((const char *) &value, sizeof(double));
+				}
+			}
+			file.close();
+			if (file.fail())
+			{
+				throw std::runtime_error("Could not write " + path);
+			}
+			return points.size();
+		}
 		virtual void insert(Point givenPoint) = 0;
 		virtual void remove(Point givenPoint) = 0;
 		virtual unsigned checksum() = 0;
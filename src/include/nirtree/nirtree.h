@@ -26,6 +26,7 @@
 #include <nirtree/node.h>
 #include <index/index.h>
 #include <util/bmpPrinter.h>
+#include <util/packedtree.h>
 #include <util/statistics.h>
 
 namespace nirtree
@@ -54,6 +55,9 @@ namespace nirtree
 			void stat();
 			void print();
 			void visualize();
+
+			// A read-only copy laid out for searching, see util/packedtree.h
+			PackedTree pack();
 	};
 }
 
@@ -27,9 +27,10 @@
 #include <util/bmpPrinter.h>
 #include <util/statistics.h>
 #include <nirtreedisk/node.h>
-
-#include <unistd.h>
-#include <fcntl.h>
+#include <storage/superblock.h>
+#include <storage/range_estimator.h>
+#include <storage/point_scan.h>
+#include <util/densityRenderer.h>
 
 namespace nirtreedisk
 {
@@ -42,38 +43,49 @@ namespace nirtreedisk
             tree_node_handle root;
             tree_node_allocator node_allocator_;
             std::string backing_file_;
+            uint64_t point_count_;
+
+            // Entries tombstoned by lazy deletes and not yet compacted
+            uint64_t tombstone_count_;
+            bool lazy_deletes_;
+            unsigned compaction_percent_;
+
+            // Backs estimate(), kept current by every insert and remove
+            range_estimator range_estimator_;
 
 			Statistics stats;
 
 			// Constructors and destructors
-			NIRTreeDisk( size_t memory_budget, std::string backing_file  ) :
-                node_allocator_( memory_budget, backing_file ),
-                backing_file_( backing_file )
+			NIRTreeDisk( buffer_budget memory_budget, std::string backing_file,
+                    page_encoding encoding = RAW_PAGES ) :
+                node_allocator_( memory_budget, backing_file, encoding ),
+                backing_file_( backing_file ),
+                point_count_( 0 ), tombstone_count_( 0 ),
+                lazy_deletes_( false ), compaction_percent_( 0 )
             {
                 node_allocator_.initialize();
 
-                size_t existing_page_count =
-                    node_allocator_.buffer_pool_.get_preexisting_page_count();
-
-                // If this is a fresh tree, we need a root
-                if( existing_page_count == 0 ) { 
-                    auto alloc =
-                        node_allocator_.create_new_tree_node<LeafNode<min_branch_factor,max_branch_factor,strategy>>(
-                                NodeHandleType(LEAF_NODE) );
-                    root = alloc.second;
-                    new (&(*(alloc.first)))
-                        LeafNode<min_branch_factor,max_branch_factor,strategy>( this,
-                                tree_node_handle(nullptr), root );
-
+                superblock sb;
+                superblock expected = superblock::describe( NIRTREE_DISK,
+                        min_branch_factor, max_branch_factor );
+                if( node_allocator_.load_superblock( expected, sb ) ) {
+                    root = sb.root_;
+                    point_count_ = sb.point_count_;
+                    tombstone_count_ = sb.tombstone_count_;
+                    range_estimator_.load( node_allocator_,
+                            sb.range_estimator_head_ );
                     return;
                 }
 
-                std::string meta_file = backing_file_ + ".meta";
-                int fd = open( meta_file.c_str(), O_RDONLY );
-                assert( fd >= 0 );
-
-                int rc = read( fd, (char *) &root, sizeof( root ) );
-                assert( rc == sizeof( root ) );
+                // This is a fresh tree, we need a root
+                node_allocator_.reserve_superblock();
+                auto alloc =
+                    node_allocator_.create_new_tree_node<LeafNode<min_branch_factor,max_branch_factor,strategy>>(
+                            NodeHandleType(LEAF_NODE) );
+                root = alloc.second;
+                new (&(*(alloc.first)))
+                    LeafNode<min_branch_factor,max_branch_factor,strategy>( this,
+                            tree_node_handle(nullptr), root );
             }
 
 			~NIRTreeDisk() {
@@ -86,8 +98,34 @@ namespace nirtreedisk
 			std::vector<Point> exhaustiveSearch(Point requestedPoint);
 			std::vector<Point> search(Point requestedPoint);
 			std::vector<Point> search(Rectangle requestedRectangle);
+			// Same results as search(Rectangle), but walks the tree a
+			// level at a time reading each level's nodes in page order
+			std::vector<Point> pageOrderSearch(Rectangle requestedRectangle);
 			void insert(Point givenPoint);
 			void remove(Point givenPoint);
+			range_estimate estimate(Rectangle requestedRectangle);
+			bool extent(Rectangle &boundingBox, uint64_t &pointCount) override;
+			// Starts estimate()'s summary over, reading every node
+			void buildRangeEstimator();
+			// Appends a node's branches, each with its polygon's bounding
+			// box, or a leaf's live points
+			void expandNode(tree_node_handle node_handle, range_estimator::branch_list &branches, std::vector<Point> &points);
+			// Writes a density tile pyramid under directory, see
+			// DensityRenderer. Returns how many tiles were written.
+			unsigned renderDensity(const std::string &directory, unsigned maxZoom, unsigned threadCount = 0);
+			// Every live point, leaf by leaf in storage order, see point_scan
+			point_scan scan();
+			uint64_t exportPoints(const std::string &path) override;
+
+			// From here on remove() only tombstones the point in its
+			// leaf rather than condensing the tree. Once tombstones make
+			// up more than compaction_percent of the leaf entries,
+			// compactTombstones() runs.
+			void enableLazyDeletes(unsigned compaction_percent = 25);
+			// Drops tombstoned entries from every leaf, then
+			// reinserts the points of leaves left underfull and unlinks
+			// those leaves. Safe to call at any time.
+			void compactTombstones();
 
 			// Miscellaneous
 			unsigned checksum();
@@ -116,20 +154,21 @@ namespace nirtreedisk
 
 
             void write_metadata() override {
-                // Step 1:
-                // Writeback everything to disk
-                node_allocator_.buffer_pool_.writeback_all_pages();
-
-                // Step 2:
-                // Write metadata file
-                std::string meta_fname = backing_file_ + ".meta";
-                int fd = open( meta_fname.c_str(), O_WRONLY |
-                        O_TRUNC | O_CREAT, S_IRUSR | S_IWUSR );
-                assert( fd >= 0 );
-                // yes, yes, i should loop this whatever
-                int rc = write( fd, (char *) &root, sizeof(root) );
-                assert( rc == sizeof(root) );
-                close( fd );
+                superblock sb = superblock::describe( NIRTREE_DISK,
+                        min_branch_factor, max_branch_factor );
+                sb.root_ = root;
+                sb.point_count_ = point_count_;
+                sb.tombstone_count_ = tombstone_count_;
+                if( root.get_type() == LEAF_NODE ) {
+                    sb.tree_height_ = get_leaf_node( root )->height();
+                } else {
+                    sb.tree_height_ = get_branch_node( root )->height();
+                }
+                sb.range_estimator_head_ = range_estimator_.persist(
+                        node_allocator_ );
+
+                // Writes back everything to disk along with the superblock
+                node_allocator_.write_superblock( sb );
             }
 	};
 #include "nirtreedisk.tcc"
@@ -52,6 +52,69 @@ NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::search( Rectangle req
     }
 }
 
+template <int min_branch_factor, int max_branch_factor, class strategy>
+std::vector<Point>
+NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::pageOrderSearch( Rectangle requestedRectangle ) {
+    std::vector<Point> accumulator;
+    std::vector<tree_node_handle> frontier = { root };
+    std::vector<tree_node_handle> next_frontier;
+
+    while( !frontier.empty() ) {
+        node_allocator_.visit_in_page_order( frontier,
+                [&]( tree_node_handle node_handle ) {
+            if( node_handle.get_type() == LEAF_NODE ) {
+                auto current_node = get_leaf_node( node_handle );
+                for( size_t i = 0; i < current_node->cur_offset_; i++ ) {
+                    Point &p = current_node->entries.at(i);
+                    if( requestedRectangle.containsPoint(p) and
+                            not current_node->tombstones_.test(i) ) {
+                        accumulator.push_back( p );
+                    }
+                }
+                current_node->searchOverflow( requestedRectangle,
+                        accumulator );
+#ifdef STAT
+                stats.markLeafSearched();
+#endif
+                return;
+            }
+
+            auto current_node = get_branch_node( node_handle );
+            for( size_t i = 0; i < current_node->cur_offset_; i++ ) {
+                Branch &b = current_node->entries.at(i);
+                if( std::holds_alternative<InlineBoundedIsotheticPolygon>(
+                            b.boundingPoly ) ) {
+                    InlineBoundedIsotheticPolygon &loc_poly =
+                        std::get<InlineBoundedIsotheticPolygon>(
+                                b.boundingPoly );
+                    if( loc_poly.intersectsRectangle( requestedRectangle ) ) {
+                        next_frontier.push_back( b.child );
+                    }
+                } else {
+                    tree_node_handle poly_handle =
+                        std::get<tree_node_handle>( b.boundingPoly );
+                    auto poly_pin =
+                        InlineUnboundedIsotheticPolygon::read_polygon_from_disk(
+                                &node_allocator_, poly_handle );
+                    if( poly_pin->intersectsRectangle( requestedRectangle ) ) {
+                        next_frontier.push_back( b.child );
+                    }
+                }
+            }
+#ifdef STAT
+            stats.markNonLeafNodeSearched();
+#endif
+        } );
+        frontier.swap( next_frontier );
+        next_frontier.clear();
+    }
+
+#ifdef STAT
+    stats.resetSearchTracker( true );
+#endif
+    return accumulator;
+}
+
 template <int min_branch_factor, int max_branch_factor, class strategy>
 void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::insert( Point givenPoint ) {
     if( root.get_type() == LEAF_NODE ) {
@@ -61,16 +124,231 @@ void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::insert( Point gi
         auto root_node = get_branch_node( root );
         root = root_node->insert(givenPoint);
     }
+    point_count_++;
+    range_estimator_.note_insert( givenPoint );
 }
 
 template <int min_branch_factor, int max_branch_factor, class strategy>
 void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::remove( Point givenPoint ) {
+    if( lazy_deletes_ ) {
+        tree_node_handle leaf_handle;
+        if( root.get_type() == LEAF_NODE ) {
+            leaf_handle = get_leaf_node( root )->findLeaf( givenPoint );
+        } else {
+            leaf_handle = get_branch_node( root )->findLeaf( givenPoint );
+        }
+        // Record not in the tree
+        if( leaf_handle == nullptr ) {
+            return;
+        }
+
+        point_count_--;
+        range_estimator_.note_remove( givenPoint );
+        // Copies in an overflow chain come straight out
+        auto leaf_node = get_leaf_node( leaf_handle );
+        if( leaf_node->removeOverflowPoint( givenPoint ) ) {
+            return;
+        }
+        leaf_node->tombstonePoint( givenPoint );
+        tombstone_count_++;
+        if( tombstone_count_ * 100 > compaction_percent_ *
+                (point_count_ + tombstone_count_) ) {
+            compactTombstones();
+        }
+        return;
+    }
+
+    tree_node_handle new_root;
     if( root.get_type() == LEAF_NODE ) {
         auto root_node = get_leaf_node( root );
-        root = root_node->remove( givenPoint );
+        new_root = root_node->remove( givenPoint );
     } else {
         auto root_node = get_branch_node( root );
-        root = root_node->remove( givenPoint );
+        new_root = root_node->remove( givenPoint );
+    }
+    // Record not in the tree
+    if( not new_root ) {
+        return;
+    }
+    root = new_root;
+    point_count_--;
+    range_estimator_.note_remove( givenPoint );
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+range_estimate NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::estimate( Rectangle requestedRectangle ) {
+    return range_estimator_.estimate( requestedRectangle );
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+bool NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::extent( Rectangle &boundingBox, uint64_t &pointCount ) {
+    pointCount = point_count_;
+    if( point_count_ == 0 ) {
+        return true;
+    }
+    if( root.get_type() == LEAF_NODE ) {
+        boundingBox = get_leaf_node( root )->boundingBox();
+    } else {
+        boundingBox = get_branch_node( root )->boundingBox();
+    }
+    return true;
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::buildRangeEstimator() {
+    range_estimator_.rebuild( root, [&]( tree_node_handle node_handle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( node_handle, branches, points );
+    } );
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::expandNode( tree_node_handle node_handle,
+        range_estimator::branch_list &branches, std::vector<Point> &points ) {
+    if( node_handle.get_type() == LEAF_NODE ) {
+        auto current_node = get_leaf_node( node_handle );
+        for( size_t i = 0; i < current_node->cur_offset_; i++ ) {
+            if( not current_node->tombstones_.test(i) ) {
+                points.push_back( current_node->entries.at(i) );
+            }
+        }
+        overflow_scan( &node_allocator_, current_node->overflow_, points );
+        return;
+    }
+
+    // Each child's points lie within its polygon's bounding box
+    auto current_node = get_branch_node( node_handle );
+    for( size_t i = 0; i < current_node->cur_offset_; i++ ) {
+        Branch &b = current_node->entries.at(i);
+        if( std::holds_alternative<InlineBoundedIsotheticPolygon>(
+                    b.boundingPoly ) ) {
+            branches.push_back( std::make_pair(
+                        std::get<InlineBoundedIsotheticPolygon>(
+                            b.boundingPoly ).get_summary_rectangle(),
+                        b.child ) );
+        } else {
+            auto poly_pin =
+                InlineUnboundedIsotheticPolygon::read_polygon_from_disk(
+                        &node_allocator_, std::get<tree_node_handle>(
+                            b.boundingPoly ) );
+            branches.push_back( std::make_pair(
+                        poly_pin->get_summary_rectangle(), b.child ) );
+        }
+    }
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+unsigned NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::renderDensity( const std::string &directory,
+        unsigned maxZoom, unsigned threadCount ) {
+    DensityRenderer renderer( root, point_count_, [&]( tree_node_handle node_handle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( node_handle, branches, points );
+    } );
+    return renderer.render( directory, maxZoom, 256, threadCount );
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+point_scan NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::scan() {
+    return point_scan( &node_allocator_, root, [this]( tree_node_handle node_handle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( node_handle, branches, points );
+    } );
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+uint64_t NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::exportPoints( const std::string &path ) {
+    return scan().export_points( path );
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::enableLazyDeletes( unsigned compaction_percent ) {
+    lazy_deletes_ = true;
+    compaction_percent_ = compaction_percent;
+}
+
+template <int min_branch_factor, int max_branch_factor, class strategy>
+void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::compactTombstones() {
+    std::vector<Point> orphans;
+    std::vector<tree_node_handle> underfull_leaves;
+    std::stack<tree_node_handle> context;
+    context.push( root );
+
+    // Compact each leaf in place, setting aside the points of any that
+    // end up underfull
+    while( !context.empty() ) {
+        tree_node_handle current_handle = context.top();
+        context.pop();
+
+        if( current_handle.get_type() == BRANCH_NODE ) {
+            auto current_node = get_branch_node( current_handle );
+            for( size_t i = 0; i < current_node->cur_offset_; i++ ) {
+                context.push( current_node->entries.at(i).child );
+            }
+            continue;
+        }
+
+        auto current_node = get_leaf_node( current_handle );
+        if( current_node->tombstones_.none() ) {
+            continue;
+        }
+        current_node->purgeTombstones();
+        if( current_handle != root and
+                current_node->cur_offset_ < min_branch_factor ) {
+            orphans.insert( orphans.end(), current_node->entries.begin(),
+                    current_node->entries.begin() +
+                    current_node->cur_offset_ );
+            overflow_scan( &node_allocator_, current_node->overflow_,
+                    orphans );
+            overflow_free( &node_allocator_, current_node->overflow_ );
+            current_node->overflow_ = tree_node_handle( nullptr );
+            current_node->cur_offset_ = 0;
+            underfull_leaves.push_back( current_handle );
+        }
+    }
+    tombstone_count_ = 0;
+
+    for( tree_node_handle leaf_handle : underfull_leaves ) {
+        get_leaf_node( leaf_handle )->condenseTree();
+    }
+
+    // Shorten the tree, or start over from an empty leaf if every
+    // leaf went
+    while( root.get_type() == BRANCH_NODE ) {
+        auto root_node = get_branch_node( root );
+        if( root_node->cur_offset_ > 1 ) {
+            break;
+        }
+
+        tree_node_handle old_root = root;
+        if( root_node->cur_offset_ == 1 ) {
+            root = root_node->entries.at(0).child;
+            if( root.get_type() == LEAF_NODE ) {
+                get_leaf_node( root )->parent = tree_node_handle( nullptr );
+            } else {
+                get_branch_node( root )->parent = tree_node_handle( nullptr );
+            }
+        } else {
+            auto alloc =
+                node_allocator_.create_new_tree_node<LeafNode<min_branch_factor,max_branch_factor,strategy>>(
+                        NodeHandleType(LEAF_NODE) );
+            root = alloc.second;
+            new (&(*(alloc.first)))
+                LeafNode<min_branch_factor,max_branch_factor,strategy>( this,
+                        tree_node_handle(nullptr), root );
+        }
+        node_allocator_.free( old_root,
+                sizeof( BranchNode<min_branch_factor,max_branch_factor,strategy> ) );
+    }
+
+    for( const Point &orphan : orphans ) {
+        if( root.get_type() == LEAF_NODE ) {
+            root = get_leaf_node( root )->insert( orphan );
+        } else {
+            root = get_branch_node( root )->insert( orphan );
+        }
     }
 }
 
@@ -122,6 +400,5 @@ void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::print() {
 
 template <int min_branch_factor, int max_branch_factor, class strategy>
 void NIRTreeDisk<min_branch_factor,max_branch_factor,strategy>::visualize() {
-    //BMPPrinter p(1000, 1000);
-   // p.printToBMP(root);
+    renderDensity( "density", 6 );
 }
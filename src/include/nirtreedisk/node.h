@@ -27,12 +27,14 @@
 #include <iostream>
 #include <chrono>
 #include <algorithm>
+#include <bitset>
 #include <omp.h>
 #include <globals/globals.h>
 #include <util/geometry.h>
 #include <util/graph.h>
 #include <util/debug.h>
 #include <util/statistics.h>
+#include <storage/overflow_chain.h>
 #include <variant>
 
 namespace nirtreedisk
@@ -130,6 +132,10 @@ namespace nirtreedisk
             tree_node_handle self_handle_;
 
             std::array<Point, max_branch_factor+1> entries;
+            // Entries removed by a lazy delete, which searches skip
+            std::bitset<max_branch_factor+1> tombstones_;
+            // Further copies of one of the entries, see overflow_chain.h
+            tree_node_handle overflow_;
 
 			// Constructors and destructors
 			LeafNode(
@@ -138,7 +144,7 @@ namespace nirtreedisk
                 tree_node_handle self_handle
             ) :
                 treeRef( treeRef ), parent( parent ), cur_offset_( 0 ),
-                self_handle_( self_handle ) {
+                self_handle_( self_handle ), overflow_( nullptr ) {
                     static_assert( sizeof(
                                 LeafNode<min_branch_factor,max_branch_factor,strategy>)
                             <= PAGE_DATA_SIZE );
@@ -151,9 +157,26 @@ namespace nirtreedisk
             void removePoint( const Point &point );
             void removeEntry( const tree_node_handle &handle );
 
-            void addPoint( const Point &point ) {
-                entries.at( this->cur_offset_++ ) = point;
-            }
+            // Reuses the slot of a tombstoned entry if there is one.
+            // Copies of the overflow chain's point go to the chain.
+            void addPoint( const Point &point );
+            // Moves all but one copy of a point to the overflow chain
+            // if an overfull leaf is mostly copies of it
+            void spillDuplicates();
+            // Takes a copy of point out of the overflow chain, returning
+            // false if the chain has none
+            bool removeOverflowPoint( const Point &point );
+            // Appends the overflow chain to accumulator if its point
+            // matches
+            void searchOverflow( const Point &requestedPoint,
+                    std::vector<Point> &accumulator );
+            void searchOverflow( const Rectangle &requestedRectangle,
+                    std::vector<Point> &accumulator );
+            // Tombstones one live copy of point, returning false if
+            // there is none
+            bool tombstonePoint( const Point &point );
+            // Drops tombstoned entries, returning how many there were
+            unsigned purgeTombstones();
 
 			tree_node_handle chooseNode(Point givenPoint);
 			tree_node_handle findLeaf(Point givenPoint);
@@ -173,6 +196,7 @@ namespace nirtreedisk
 			std::vector<Point> search(Point &requestedPoint);
 			std::vector<Point> search(Rectangle &requestedRectangle);
 			tree_node_handle insert(Point givenPoint);
+			// The new root, or nullptr if givenPoint is not in the tree
 			tree_node_handle remove(Point givenPoint);
 
 			// Miscellaneous
@@ -746,6 +770,7 @@ namespace nirtreedisk
 			std::vector<Point> search(Point &requestedPoint);
 			std::vector<Point> search(Rectangle &requestedRectangle);
 			tree_node_handle insert(Point givenPoint);
+			// The new root, or nullptr if givenPoint is not in the tree
 			tree_node_handle remove(Point givenPoint);
 
 			// Miscellaneous
@@ -48,19 +48,178 @@ NODE_TEMPLATE_PARAMS
 void LEAF_NODE_CLASS_TYPES::removePoint(
     const Point &point
 ) {
+    // Copies come out of the overflow chain first, so the leaf keeps
+    // one for as long as the chain lasts
+    if( removeOverflowPoint( point ) ) {
+        return;
+    }
+
     // Locate the child
     size_t childIndex;
-    for( childIndex = 0; entries.at( childIndex ) != point and
-            childIndex < this->cur_offset_; childIndex++ ) { }
+    for( childIndex = 0; childIndex < this->cur_offset_ and
+            (entries.at( childIndex ) != point or
+             tombstones_.test( childIndex )); childIndex++ ) { }
     assert( entries.at( childIndex ) == point );
 
     // Replace this index with whatever is in the last position
     entries.at(childIndex) = entries.at( this->cur_offset_-1 );
+    tombstones_[childIndex] = tombstones_[this->cur_offset_-1];
+    tombstones_.reset( this->cur_offset_-1 );
 
     // Truncate array size
     this->cur_offset_--;
 }
 
+NODE_TEMPLATE_PARAMS
+void LEAF_NODE_CLASS_TYPES::addPoint(
+    const Point &point
+) {
+    if( overflow_ != nullptr ) {
+        tree_node_allocator *allocator = get_node_allocator( this->treeRef );
+        if( overflow_front( allocator, overflow_ ) == point ) {
+            overflow_ = overflow_push( allocator, overflow_, point );
+            return;
+        }
+    }
+
+    if( tombstones_.any() ) {
+        size_t slot;
+        for( slot = 0; not tombstones_.test( slot ); slot++ ) { }
+        entries.at( slot ) = point;
+        tombstones_.reset( slot );
+        this->treeRef->tombstone_count_--;
+        return;
+    }
+    entries.at( this->cur_offset_++ ) = point;
+}
+
+NODE_TEMPLATE_PARAMS
+void LEAF_NODE_CLASS_TYPES::spillDuplicates()
+{
+    if( this->cur_offset_ <= max_branch_factor ) {
+        return;
+    }
+    assert( tombstones_.none() );
+
+    size_t most_index = 0;
+    size_t most_count = 0;
+    for( size_t i = 0; i < this->cur_offset_; i++ ) {
+        size_t count = 0;
+        for( size_t j = 0; j < this->cur_offset_; j++ ) {
+            if( entries.at(j) == entries.at(i) ) {
+                count++;
+            }
+        }
+        if( count > most_count ) {
+            most_index = i;
+            most_count = count;
+        }
+    }
+
+    // Up to half the entries can be copies of one point and the split
+    // still leaves something on both sides
+    if( most_count <= max_branch_factor / 2 ) {
+        return;
+    }
+
+    Point duplicate = entries.at( most_index );
+    tree_node_allocator *allocator = get_node_allocator( this->treeRef );
+    if( overflow_ != nullptr and overflow_front( allocator, overflow_ ) !=
+            duplicate ) {
+        // Another point has the chain, so split and let the halves sort
+        // it out
+        return;
+    }
+
+    // Keep the first copy and chain the rest
+    bool kept = false;
+    for( size_t i = 0; i < this->cur_offset_; ) {
+        if( entries.at(i) != duplicate ) {
+            i++;
+        } else if( not kept ) {
+            kept = true;
+            i++;
+        } else {
+            overflow_ = overflow_push( allocator, overflow_, duplicate );
+            entries.at(i) = entries.at( this->cur_offset_-1 );
+            this->cur_offset_--;
+        }
+    }
+}
+
+NODE_TEMPLATE_PARAMS
+bool LEAF_NODE_CLASS_TYPES::removeOverflowPoint(
+    const Point &point
+) {
+    if( overflow_ == nullptr ) {
+        return false;
+    }
+    tree_node_allocator *allocator = get_node_allocator( this->treeRef );
+    if( overflow_front( allocator, overflow_ ) != point ) {
+        return false;
+    }
+    overflow_ = overflow_pop( allocator, overflow_ );
+    return true;
+}
+
+NODE_TEMPLATE_PARAMS
+void LEAF_NODE_CLASS_TYPES::searchOverflow(
+    const Point &requestedPoint,
+    std::vector<Point> &accumulator
+) {
+    if( overflow_ == nullptr ) {
+        return;
+    }
+    tree_node_allocator *allocator = get_node_allocator( this->treeRef );
+    if( overflow_front( allocator, overflow_ ) == requestedPoint ) {
+        overflow_scan( allocator, overflow_, accumulator );
+    }
+}
+
+NODE_TEMPLATE_PARAMS
+void LEAF_NODE_CLASS_TYPES::searchOverflow(
+    const Rectangle &requestedRectangle,
+    std::vector<Point> &accumulator
+) {
+    if( overflow_ == nullptr ) {
+        return;
+    }
+    tree_node_allocator *allocator = get_node_allocator( this->treeRef );
+    if( requestedRectangle.containsPoint( overflow_front( allocator,
+                    overflow_ ) ) ) {
+        overflow_scan( allocator, overflow_, accumulator );
+    }
+}
+
+NODE_TEMPLATE_PARAMS
+bool LEAF_NODE_CLASS_TYPES::tombstonePoint(
+    const Point &point
+) {
+    for( size_t i = 0; i < this->cur_offset_; i++ ) {
+        if( entries.at(i) == point and not tombstones_.test(i) ) {
+            tombstones_.set(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+NODE_TEMPLATE_PARAMS
+unsigned LEAF_NODE_CLASS_TYPES::purgeTombstones()
+{
+    // Keeps the live entries in order
+    size_t kept = 0;
+    for( size_t i = 0; i < this->cur_offset_; i++ ) {
+        if( not tombstones_.test(i) ) {
+            entries.at( kept++ ) = entries.at(i);
+        }
+    }
+    unsigned purged = this->cur_offset_ - kept;
+    this->cur_offset_ = kept;
+    tombstones_.reset();
+    return purged;
+}
+
 NODE_TEMPLATE_PARAMS
 void LEAF_NODE_CLASS_TYPES::exhaustiveSearch(
     Point &requestedPoint,
@@ -69,10 +228,11 @@ void LEAF_NODE_CLASS_TYPES::exhaustiveSearch(
     // We are a leaf so add our data points when they are the search point
     for( size_t i = 0; i < this->cur_offset_; i++ ) {
         Point &p = entries.at(i);
-        if( requestedPoint == p ) {
+        if( requestedPoint == p and not tombstones_.test(i) ) {
             accumulator.push_back( p );
         }
     }
+    searchOverflow( requestedPoint, accumulator );
 }
 
 NODE_TEMPLATE_PARAMS
@@ -85,10 +245,11 @@ std::vector<Point> LEAF_NODE_CLASS_TYPES::search(
 
     for( size_t i = 0; i < this->cur_offset_; i++ ) {
         // We are a leaf so add our data points when they are the search point
-        if( requestedPoint == entries.at(i) ) {
+        if( requestedPoint == entries.at(i) and not tombstones_.test(i) ) {
             accumulator.push_back( requestedPoint );
         }
     }
+    searchOverflow( requestedPoint, accumulator );
 #ifdef STAT
     this->treeRef->stats.markLeafSearched();
     treeRef->stats.resetSearchTracker( false );
@@ -108,10 +269,12 @@ std::vector<Point> LEAF_NODE_CLASS_TYPES::search(
 
     // We are a leaf so add our data points when they are within the search rectangle
     for( size_t i = 0; i < this->cur_offset_; i++ ) {
-        if( requestedRectangle.containsPoint( entries.at(i) ) ) {
+        if( requestedRectangle.containsPoint( entries.at(i) ) and
+                not tombstones_.test(i) ) {
             accumulator.push_back( entries.at(i) );
         }
     }
+    searchOverflow( requestedRectangle, accumulator );
 
 #ifdef STAT
     this->treeRef->stats.markLeafSearched();
@@ -173,8 +336,8 @@ tree_node_handle LEAF_NODE_CLASS_TYPES::findLeaf(Point givenPoint)
     // FL2 [Search leaf node for record]
     // Check each entry to see if it matches E
     for( size_t i = 0; i < this->cur_offset_; i++ ) {
-        Point &p = std::get<Point>(entries.at(i) );
-        if( p == givenPoint ) {
+        Point &p = entries.at(i);
+        if( p == givenPoint and not tombstones_.test(i) ) {
             return this->self_handle_;
         }
     }
@@ -264,16 +427,31 @@ SplitResult LEAF_NODE_CLASS_TYPES::splitNode(
         containedRight = dataPoint[ p.dimension ] >= p.location;
         assert( containedLeft or containedRight );
 
+        // Tombstones move with their entries
         if( containedLeft and not containedRight ) {
+            left_node->tombstones_[left_node->cur_offset_] =
+                tombstones_[i];
             left_node->entries.at( left_node->cur_offset_++ ) =
                 dataPoint;
         } else if( not containedLeft and containedRight ) {
+            right_node->tombstones_[right_node->cur_offset_] =
+                tombstones_[i];
             right_node->entries.at( right_node->cur_offset_++ ) =
                 dataPoint;
         }
     }
 
-    // All points have been routed.
+    // All points have been routed. The overflow chain goes with its
+    // point's copy.
+    if( overflow_ != nullptr ) {
+        if( overflow_front( allocator, overflow_ )[ p.dimension ] <
+                p.location ) {
+            left_node->overflow_ = overflow_;
+        } else {
+            right_node->overflow_ = overflow_;
+        }
+        overflow_ = tree_node_handle( nullptr );
+    }
 
     IsotheticPolygon left_polygon( left_node->boundingBox() );
     IsotheticPolygon right_polygon( right_node->boundingBox() );
@@ -327,6 +505,7 @@ SplitResult LEAF_NODE_CLASS_TYPES::splitNode(
 
     }
     this->cur_offset_ = 0;
+    tombstones_.reset();
 
     // Push left to disk
     if( left_polygon.basicRectangles.size() <= MAX_RECTANGLE_COUNT ) {
@@ -523,7 +702,8 @@ NODE_TEMPLATE_PARAMS
 tree_node_handle LEAF_NODE_CLASS_TYPES::insert( Point givenPoint ) {
 
     // This is a leaf, so we are the ONLY node.
-    entries.at( this->cur_offset_++ ) = givenPoint;
+    addPoint( givenPoint );
+    spillDuplicates();
 
     SplitResult finalSplit = adjustTree();
 
@@ -560,43 +740,32 @@ tree_node_handle LEAF_NODE_CLASS_TYPES::insert( Point givenPoint ) {
 }
 
 // To be called on a leaf
+// Unlinks this leaf if it is empty, along with any ancestors that
+// leaves empty. removeBranch frees what it unlinks, so nothing here
+// touches a node after its parent has let go of it.
 NODE_TEMPLATE_PARAMS
 void LEAF_NODE_CLASS_TYPES::condenseTree()
 {
-    auto current_node_handle = this->self_handle_;
-    auto previous_node_handle = tree_node_handle( nullptr );
-
-    while( current_node_handle != nullptr ) {
-        if( current_node_handle.get_type() == LEAF_NODE ) {
-            auto current_node = treeRef->get_leaf_node( current_node_handle );
-            current_node_handle = current_node->parent;
-        } else {
-            auto current_node = treeRef->get_branch_node( current_node_handle );
-            current_node_handle = current_node->parent;
-        }
-        if( previous_node_handle != nullptr ) {
-            auto current_parent_node = this->treeRef->get_branch_node( current_node_handle );
-            size_t loc_cur_offset = 0;
-            if( previous_node_handle.get_type() == LEAF_NODE ) {
-                auto previous_node = treeRef->get_leaf_node(
-                        previous_node_handle );
-                loc_cur_offset = previous_node->cur_offset_;
-            } else {
-                auto previous_node = treeRef->get_branch_node(
-                        previous_node_handle );
-                loc_cur_offset = previous_node->cur_offset_;
-            }
-            if( loc_cur_offset == 0 ) {
-                current_parent_node->removeBranch( previous_node_handle );
-            }
-        }
-        previous_node_handle = current_node_handle;
+    tree_node_handle current_handle = this->self_handle_;
+    tree_node_handle parent_handle = this->parent;
+    size_t current_offset = this->cur_offset_;
+
+    while( current_offset == 0 and parent_handle != nullptr ) {
+        auto parent_node = treeRef->get_branch_node( parent_handle );
+        parent_node->removeBranch( current_handle );
+        current_handle = parent_handle;
+        parent_handle = parent_node->parent;
+        current_offset = parent_node->cur_offset_;
     }
 }
 
 // Always called on root, this = root
 NODE_TEMPLATE_PARAMS
 tree_node_handle LEAF_NODE_CLASS_TYPES::remove( Point givenPoint ) {
+    // Record not in the tree
+    if( findLeaf( givenPoint ) == nullptr ) {
+        return tree_node_handle( nullptr );
+    }
 
     removePoint( givenPoint );
     return this->self_handle_;
@@ -607,11 +776,22 @@ unsigned LEAF_NODE_CLASS_TYPES::checksum() {
     unsigned sum = 0;
 
     for( size_t i = 0; i < this->cur_offset_; i++ ) {
+        if( tombstones_.test(i) ) {
+            continue;
+        }
         Point &dataPoint = entries.at(i);
         for( unsigned d = 0; d < dimensions; d++ ) {
             sum += (unsigned) dataPoint[d];
         }
     }
+    if( overflow_ != nullptr ) {
+        tree_node_allocator *allocator = get_node_allocator( this->treeRef );
+        Point duplicate = overflow_front( allocator, overflow_ );
+        uint64_t copies = overflow_count( allocator, overflow_ );
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            sum += (unsigned) copies * (unsigned) duplicate[d];
+        }
+    }
     return sum;
 }
 
@@ -628,6 +808,20 @@ std::vector<Point> LEAF_NODE_CLASS_TYPES::bounding_box_validate()
 NODE_TEMPLATE_PARAMS
 bool LEAF_NODE_CLASS_TYPES::validate( tree_node_handle expectedParent, unsigned index) {
 
+    if( overflow_ != nullptr ) {
+        Point duplicate = overflow_front( get_node_allocator( this->treeRef ),
+                overflow_ );
+        bool anchored = false;
+        for( size_t i = 0; i < this->cur_offset_; i++ ) {
+            anchored = anchored or entries.at(i) == duplicate;
+        }
+        if( not anchored ) {
+            std::cout << "Overflow chain of " << duplicate <<
+                " has no copy in its leaf" << std::endl;
+            assert( anchored );
+        }
+    }
+
     if( expectedParent != nullptr and (this->parent != expectedParent ||
                 this->cur_offset_ > max_branch_factor )) {
         std::cout << "node = " << (void *)this << std::endl;
@@ -893,10 +1087,12 @@ std::vector<Point> BRANCH_NODE_CLASS_TYPES::search(
             for( size_t i = 0; i < current_node->cur_offset_; i++ ) {
                 // We are a leaf so add our data points when they are the search point
                 Point &p = current_node->entries.at(i);
-                if( requestedPoint == p ) {
+                if( requestedPoint == p and
+                        not current_node->tombstones_.test(i) ) {
                     accumulator.push_back( p );
                 }
             }
+            current_node->searchOverflow( requestedPoint, accumulator );
 #ifdef STAT
             this->treeRef->stats.markLeafSearched();
 #endif
@@ -959,10 +1155,12 @@ std::vector<Point> BRANCH_NODE_CLASS_TYPES::search(
             // We are a leaf so add our data points when they are within the search rectangle
             for( size_t i = 0; i < current_node->cur_offset_; i++ ) {
                 Point &p = current_node->entries.at(i);
-                if( requestedRectangle.containsPoint(p) ) {
+                if( requestedRectangle.containsPoint(p) and
+                        not current_node->tombstones_.test(i) ) {
                     accumulator.push_back( p );
                 }
             }
+            current_node->searchOverflow( requestedRectangle, accumulator );
 
 #ifdef STAT
             this->treeRef->stats.markLeafSearched();
@@ -1067,11 +1265,15 @@ tree_node_handle BRANCH_NODE_CLASS_TYPES::chooseNode(Point givenPoint)
 
     // CL1 [Initialize]
     tree_node_handle cur_node_handle = this->self_handle_;
+    tree_node_handle parent_handle;
 
     assert( cur_node_handle != nullptr );
 
     for( ;; ) {
         assert( cur_node_handle != nullptr );
+        // Lets the allocator place what we add by subtree
+        get_node_allocator( this->treeRef )->enter_subtree( cur_node_handle,
+                parent_handle );
         if( cur_node_handle.get_type() == LEAF_NODE ) {
             return cur_node_handle;
         } else {
@@ -1242,6 +1444,7 @@ tree_node_handle BRANCH_NODE_CLASS_TYPES::chooseNode(Point givenPoint)
 
             // Descend
             Branch &b = cur_node->entries.at(smallestExpansionBranchIndex);
+            parent_handle = cur_node_handle;
             cur_node_handle = b.child;
             assert( cur_node_handle != nullptr );
         }
@@ -1270,7 +1473,8 @@ tree_node_handle BRANCH_NODE_CLASS_TYPES::findLeaf(Point givenPoint)
             // Check each entry to see if it matches E
             for( size_t i = 0; i < current_node->cur_offset_; i++ ) {
                 Point &p = current_node->entries.at(i);
-                if( p == givenPoint ) {
+                if( p == givenPoint and
+                        not current_node->tombstones_.test(i) ) {
                     return current_node_handle;
                 }
             }
@@ -1679,6 +1883,7 @@ tree_node_handle BRANCH_NODE_CLASS_TYPES::insert( Point givenPoint ) {
 
     auto current_node = treeRef->get_leaf_node( current_handle );
     current_node->addPoint( givenPoint );
+    current_node->spillDuplicates();
 
     SplitResult finalSplit = current_node->adjustTree();
 
@@ -1728,7 +1933,7 @@ tree_node_handle BRANCH_NODE_CLASS_TYPES::remove( Point givenPoint ) {
     tree_node_handle leaf_handle = findLeaf( givenPoint );
     // Record not in the tree
     if( leaf_handle == nullptr ) {
-        return this->self_handle_;
+        return tree_node_handle( nullptr );
     }
 
     // D2 [Delete record]
@@ -0,0 +1,108 @@
+#ifndef __PARTITIONEDINDEX__
+#define __PARTITIONEDINDEX__
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <iostream>
+#include <util/geometry.h>
+#include <index/index.h>
+
+namespace partitionedindex
+{
+	// Builds the child index for a partition. Every call must return a
+	// new, independent index; disk trees need their own backing file,
+	// which the partition id can be used to name.
+	typedef std::function<Index *(unsigned partitionId)> IndexFactory;
+
+	// Called once a split partition's index has been deleted, so the
+	// caller can clean up after it (e.g. unlink its backing file).
+	typedef std::function<void(unsigned partitionId)> IndexRetirer;
+
+	// Splits space into disjoint regions with a kd-tree learned from a
+	// sample of the data and keeps an independent child index per region.
+	// Inserts touch exactly one child, so inserts into different
+	// partitions run concurrently. Queries only visit the children whose
+	// region they intersect, in parallel when there is more than one.
+	class PartitionedIndex: public Index
+	{
+		public:
+			// One node of the kd-tree. Points with
+			// p[dimension] < value go left, the rest go right. Leaves
+			// name a partition instead.
+			struct SplitNode
+			{
+				unsigned dimension;
+				double value;
+				int left;
+				int right;
+				int partition;
+			};
+
+			struct Partition
+			{
+				unsigned id;
+				int splitNode;
+				Rectangle region;
+				Index *index;
+				uint64_t pointCount;
+				std::mutex lock;
+			};
+
+			std::vector<SplitNode> splits;
+			std::vector<std::unique_ptr<Partition>> partitions;
+
+			// Constructors and destructors
+			PartitionedIndex(unsigned partitionCount, std::vector<Point> sample, IndexFactory factory, IndexRetirer retirer = nullptr);
+			~PartitionedIndex();
+
+			// Datastructure interface
+			std::vector<Point> exhaustiveSearch(Point requestedPoint);
+			std::vector<Point> search(Point requestedPoint);
+			std::vector<Point> search(Rectangle requestedRectangle);
+			std::vector<Point> pageOrderSearch(Rectangle requestedRectangle);
+			void insert(Point givenPoint);
+			void remove(Point givenPoint);
+
+			// Routes every point first and then inserts into each
+			// partition on its own thread.
+			void bulkInsert(const std::vector<Point> &points);
+
+			// Splits every partition holding more than maxPoints points
+			// in two at the median of its widest dimension, repeating
+			// until none do or a partition can't be split any further.
+			// Returns the number of splits made.
+			unsigned rebalance(uint64_t maxPoints);
+
+			// Miscellaneous
+			unsigned checksum();
+			bool validate();
+			void stat();
+			void print();
+			void visualize();
+			void write_metadata() override;
+
+			unsigned partitionFor(const Point &givenPoint);
+			std::vector<unsigned> partitionsFor(const Rectangle &givenRectangle);
+
+		private:
+			IndexFactory factory;
+			IndexRetirer retirer;
+			unsigned nextPartitionId;
+
+			// Held shared by every operation and exclusively while
+			// rebalancing rewrites the kd-tree.
+			std::shared_mutex structureLock;
+
+			int buildSplits(std::vector<Point> &sample, size_t begin, size_t end, Rectangle region, unsigned partitionCount);
+			int newPartition(Rectangle region, int splitNode);
+			bool splitPartition(unsigned partitionIndex);
+			std::vector<Point> scatterGather(const std::vector<unsigned> &targets, const std::function<std::vector<Point>(Index *)> &query);
+	};
+}
+
+#endif
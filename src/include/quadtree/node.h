@@ -17,6 +17,7 @@
 #include <globals/globals.h>
 #include <util/geometry.h>
 #include <util/statistics.h>
+#include <util/interleave.h>
 
 namespace quadtree
 {
@@ -56,6 +57,21 @@ namespace quadtree
 			unsigned height();
 			void stat();
 	};
+
+	// One point search of a batch, run a step at a time by runInterleaved
+	class PointLookup
+	{
+		public:
+			Point requestedPoint;
+			std::vector<Point> *accumulator;
+			Node *current;
+			// Quadrant of current to follow once its branch has arrived,
+			// or -1 while current itself is still on its way
+			int nextIndex;
+
+			PointLookup(Node *root, const Point &requestedPoint, std::vector<Point> *accumulator);
+			bool step();
+	};
 }
 
 #endif
@@ -31,6 +31,7 @@ namespace quadtree
 			std::vector<Point> exhaustiveSearch(Point requestedPoint);
 			std::vector<Point> search(Point requestedPoint);
 			std::vector<Point> search(Rectangle requestedRectangle);
+			std::vector<std::vector<Point>> batchSearch(const std::vector<Point> &requestedPoints);
 			void insert(Point givenPoint);
 			void remove(Point givenPoint);
 
@@ -17,6 +17,7 @@
 #include <util/geometry.h>
 #include <util/debug.h>
 #include <util/statistics.h>
+#include <util/interleave.h>
 
 namespace revisedrstartree
 {
@@ -80,6 +81,19 @@ namespace revisedrstartree
 			unsigned height();
 			void stat();
 	};
+
+	// One point search of a batch, run a node at a time by runInterleaved
+	class PointLookup
+	{
+		public:
+			Point requestedPoint;
+			std::vector<Point> *accumulator;
+			std::vector<Node *> context;
+			Node *current;
+
+			PointLookup(Node *root, const Point &requestedPoint, std::vector<Point> *accumulator);
+			bool step();
+	};
 }
 
 #endif
@@ -32,6 +32,7 @@ namespace revisedrstartree
 			std::vector<Point> exhaustiveSearch(Point requestedPoint);
 			std::vector<Point> search(Point requestedPoint);
 			std::vector<Point> search(Rectangle requestedRectangle);
+			std::vector<std::vector<Point>> batchSearch(const std::vector<Point> &requestedPoints);
 			void insert(Point givenPoint);
 			void remove(Point givenPoint);
 
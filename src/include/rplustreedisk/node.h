@@ -13,10 +13,12 @@
 #include <iostream>
 #include <chrono>
 #include <algorithm>
+#include <bitset>
 #include <util/geometry.h>
 #include <util/graph.h>
 #include <util/debug.h>
 #include <util/statistics.h>
+#include <storage/overflow_chain.h>
 
 namespace rplustreedisk
 {
@@ -86,6 +88,11 @@ namespace rplustreedisk
 			tree_node_handle parent_;
             unsigned cur_offset_ = 0;
             typename std::array<NodeEntry, max_branch_factor+1> entries;
+            // Leaf entries removed by a lazy delete, which searches skip
+            std::bitset<max_branch_factor+1> tombstones_;
+            // Further copies of one of a leaf's entries, see
+            // overflow_chain.h
+            tree_node_handle overflow_;
 
 			// Constructors and destructors
 			Node(RPlusTreeDisk<min_branch_factor,max_branch_factor> *treeRef, tree_node_handle self_handle,
@@ -93,7 +100,8 @@ namespace rplustreedisk
                 treeRef( treeRef ),
                 self_handle_( self_handle ),
                 parent_( parent_handle ),
-                cur_offset_( 0 ) {}
+                cur_offset_( 0 ),
+                overflow_( nullptr ) {}
 
 			void deleteSubtrees();
 
@@ -102,6 +110,24 @@ namespace rplustreedisk
 			void updateBranch(tree_node_handle child, Rectangle &boundingBox);
 			void removeBranch(tree_node_handle child);
 			void removePoint(Point &givenPoint);
+			// Reuses the slot of a tombstoned entry if there is one.
+			// Copies of the overflow chain's point go to the chain.
+			void addPoint(Point &givenPoint);
+			// Moves all but one copy of a point to the overflow chain
+			// if an overfull leaf is mostly copies of it
+			void spillDuplicates();
+			// Takes a copy of givenPoint out of the overflow chain,
+			// returning false if the chain has none
+			bool removeOverflowPoint(Point &givenPoint);
+			// Appends the overflow chain to accumulator if its point
+			// matches
+			void searchOverflow(Point &requestedPoint, std::vector<Point> &accumulator);
+			void searchOverflow(Rectangle &requestedRectangle, std::vector<Point> &accumulator);
+			// Tombstones one live copy of givenPoint, returning false if
+			// there is none
+			bool tombstonePoint(Point &givenPoint);
+			// Drops tombstoned entries, returning how many there were
+			unsigned purgeTombstones();
 			tree_node_handle chooseNode(Point givenPoint);
 			tree_node_handle findLeaf(Point givenPoint);
 			Partition partitionNode();
@@ -116,6 +142,7 @@ namespace rplustreedisk
 			std::vector<Point> search(Point &requestedPoint);
 			std::vector<Point> search(Rectangle &requestedRectangle);
 			tree_node_handle insert(Point givenPoint);
+			// The new root, or nullptr if givenPoint is not in the tree
 			tree_node_handle remove(Point givenPoint);
 
 			// Miscellaneous
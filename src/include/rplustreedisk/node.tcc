@@ -47,7 +47,7 @@ void NODE_CLASS_TYPES::updateBranch(
     for( unsigned child_index = 0; child_index < cur_offset_;
             child_index++ ) {
         Branch &b = std::get<Branch>( entries.at( child_index ) );
-        if( b.child != child_handle ) {
+        if( b.child == child_handle ) {
             b.boundingBox = bounding_box;
             return;
         }
@@ -73,16 +73,175 @@ NODE_TEMPLATE_TYPES
 void NODE_CLASS_TYPES::removePoint( Point &givenPoint ) {
     assert( isLeaf() );
 
+    // Copies come out of the overflow chain first, so the leaf keeps
+    // one for as long as the chain lasts
+    if( removeOverflowPoint( givenPoint ) ) {
+        return;
+    }
+
     for( unsigned i = 0; i < cur_offset_; i++ ) {
         Point &p = std::get<Point>( entries.at(i) );
-        if( p == givenPoint) {
-            entries.at(i) == entries.at(cur_offset_-1);
+        if( p == givenPoint and not tombstones_.test(i) ) {
+            entries.at(i) = entries.at(cur_offset_-1);
+            tombstones_[i] = tombstones_[cur_offset_-1];
+            tombstones_.reset( cur_offset_-1 );
             cur_offset_--;
             break;
         }
     }
 }
 
+NODE_TEMPLATE_TYPES
+void NODE_CLASS_TYPES::addPoint( Point &givenPoint ) {
+    assert( isLeaf() );
+
+    if( overflow_ != nullptr ) {
+        tree_node_allocator *allocator = get_node_allocator( treeRef );
+        if( overflow_front( allocator, overflow_ ) == givenPoint ) {
+            overflow_ = overflow_push( allocator, overflow_, givenPoint );
+            return;
+        }
+    }
+
+    if( tombstones_.any() ) {
+        unsigned slot;
+        for( slot = 0; not tombstones_.test( slot ); slot++ ) { }
+        entries.at( slot ) = givenPoint;
+        tombstones_.reset( slot );
+        treeRef->tombstone_count_--;
+        return;
+    }
+    entries.at( cur_offset_++ ) = givenPoint;
+}
+
+NODE_TEMPLATE_TYPES
+void NODE_CLASS_TYPES::spillDuplicates() {
+    if( cur_offset_ <= max_branch_factor ) {
+        return;
+    }
+    assert( isLeaf() );
+    assert( tombstones_.none() );
+
+    unsigned most_index = 0;
+    unsigned most_count = 0;
+    for( unsigned i = 0; i < cur_offset_; i++ ) {
+        Point &p = std::get<Point>( entries.at(i) );
+        unsigned count = 0;
+        for( unsigned j = 0; j < cur_offset_; j++ ) {
+            if( std::get<Point>( entries.at(j) ) == p ) {
+                count++;
+            }
+        }
+        if( count > most_count ) {
+            most_index = i;
+            most_count = count;
+        }
+    }
+
+    // Up to half the entries can be copies of one point and the split
+    // still keeps them together
+    if( most_count <= max_branch_factor / 2 ) {
+        return;
+    }
+
+    Point duplicate = std::get<Point>( entries.at( most_index ) );
+    tree_node_allocator *allocator = get_node_allocator( treeRef );
+    if( overflow_ != nullptr and overflow_front( allocator, overflow_ ) !=
+            duplicate ) {
+        // Another point has the chain, so split and let the halves sort
+        // it out
+        return;
+    }
+
+    // Keep the first copy and chain the rest
+    bool kept = false;
+    for( unsigned i = 0; i < cur_offset_; ) {
+        if( std::get<Point>( entries.at(i) ) != duplicate ) {
+            i++;
+        } else if( not kept ) {
+            kept = true;
+            i++;
+        } else {
+            overflow_ = overflow_push( allocator, overflow_, duplicate );
+            entries.at(i) = entries.at( cur_offset_-1 );
+            cur_offset_--;
+        }
+    }
+}
+
+NODE_TEMPLATE_TYPES
+bool NODE_CLASS_TYPES::removeOverflowPoint( Point &givenPoint ) {
+    if( overflow_ == nullptr ) {
+        return false;
+    }
+    tree_node_allocator *allocator = get_node_allocator( treeRef );
+    if( overflow_front( allocator, overflow_ ) != givenPoint ) {
+        return false;
+    }
+    overflow_ = overflow_pop( allocator, overflow_ );
+    return true;
+}
+
+NODE_TEMPLATE_TYPES
+void NODE_CLASS_TYPES::searchOverflow(
+    Point &requestedPoint,
+    std::vector<Point> &accumulator
+) {
+    if( overflow_ == nullptr ) {
+        return;
+    }
+    tree_node_allocator *allocator = get_node_allocator( treeRef );
+    if( overflow_front( allocator, overflow_ ) == requestedPoint ) {
+        overflow_scan( allocator, overflow_, accumulator );
+    }
+}
+
+NODE_TEMPLATE_TYPES
+void NODE_CLASS_TYPES::searchOverflow(
+    Rectangle &requestedRectangle,
+    std::vector<Point> &accumulator
+) {
+    if( overflow_ == nullptr ) {
+        return;
+    }
+    tree_node_allocator *allocator = get_node_allocator( treeRef );
+    if( requestedRectangle.containsPoint( overflow_front( allocator,
+                    overflow_ ) ) ) {
+        overflow_scan( allocator, overflow_, accumulator );
+    }
+}
+
+NODE_TEMPLATE_TYPES
+bool NODE_CLASS_TYPES::tombstonePoint( Point &givenPoint ) {
+    assert( isLeaf() );
+
+    for( unsigned i = 0; i < cur_offset_; i++ ) {
+        Point &p = std::get<Point>( entries.at(i) );
+        if( p == givenPoint and not tombstones_.test(i) ) {
+            tombstones_.set(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+NODE_TEMPLATE_TYPES
+unsigned NODE_CLASS_TYPES::purgeTombstones() {
+    assert( isLeaf() );
+
+    // Keeps the live entries in order
+    unsigned kept = 0;
+    for( unsigned i = 0; i < cur_offset_; i++ ) {
+        if( not tombstones_.test(i) ) {
+            entries.at( kept++ ) = entries.at(i);
+        }
+    }
+    unsigned purged = cur_offset_ - kept;
+    cur_offset_ = kept;
+    tombstones_.reset();
+    return purged;
+}
+
 
 NODE_TEMPLATE_TYPES
 void NODE_CLASS_TYPES::exhaustiveSearch(
@@ -93,7 +252,7 @@ void NODE_CLASS_TYPES::exhaustiveSearch(
         // Scan
         for( unsigned i = 0; i < cur_offset_; i++ ) {
             Point &p = std::get<Point>( entries.at(i) );
-            if( p == requestedPoint ) {
+            if( p == requestedPoint and not tombstones_.test(i) ) {
                 accumulator.push_back( requestedPoint );
                 break;
             }
@@ -130,10 +289,12 @@ std::vector<Point> NODE_CLASS_TYPES::search(
             // We are a leaf so add our data points when they are the search point
             for( unsigned i = 0; i < current_node->cur_offset_; i++ ) {
                 Point &p = std::get<Point>( current_node->entries.at(i) );
-                if( requestedPoint == p ) {
+                if( requestedPoint == p and
+                        not current_node->tombstones_.test(i) ) {
                     matchingPoints.push_back( p );
                 }
             }
+            current_node->searchOverflow( requestedPoint, matchingPoints );
 
 #ifdef STAT
             treeRef->stats.markLeafSearched();
@@ -180,10 +341,12 @@ std::vector<Point> NODE_CLASS_TYPES::search(
             // We are a leaf so add our data points when they are within the search rectangle
             for( unsigned i = 0; i < current_node->cur_offset_; i++ ) {
                 Point &p = std::get<Point>( current_node->entries.at(i) ); 
-                if( requestedRectangle.containsPoint( p ) ) {
+                if( requestedRectangle.containsPoint( p ) and
+                        not current_node->tombstones_.test(i) ) {
                     matchingPoints.push_back( p );
                 }
             }
+            current_node->searchOverflow( requestedRectangle, matchingPoints );
 
 #ifdef STAT
             treeRef->stats.markLeafSearched();
@@ -219,8 +382,13 @@ tree_node_handle NODE_CLASS_TYPES::chooseNode(Point givenPoint)
 {
     // CL1 [Initialize]
     tree_node_handle current_handle = self_handle_;
+    tree_node_handle parent_handle;
 
     for (;;) {
+        // Lets the allocator place what we add by subtree
+        get_node_allocator( treeRef )->enter_subtree( current_handle,
+                parent_handle );
+
         // CL2 [Leaf check]
         auto current_node = treeRef->get_node( current_handle );
         if( current_node->isLeaf() ) {
@@ -251,6 +419,7 @@ tree_node_handle NODE_CLASS_TYPES::chooseNode(Point givenPoint)
 
         // Descend
         Branch &b = std::get<Branch>( current_node->entries.at( smallestExpansionIndex ) );
+        parent_handle = current_handle;
         current_handle = b.child;
     }
 }
@@ -277,7 +446,8 @@ tree_node_handle NODE_CLASS_TYPES::findLeaf(
             // Check each entry to see if it matches E
             for( unsigned i = 0; i < current_node->cur_offset_; i++ ) {
                 Point &p = std::get<Point>( current_node->entries.at(i) );
-                if( p == givenPoint ) {
+                if( p == givenPoint and
+                        not current_node->tombstones_.test(i) ) {
                     return current_handle;
                 }
             }
@@ -307,6 +477,10 @@ Partition NODE_CLASS_TYPES::partitionNode()
     double location;
 
     if( isLeaf() ) {
+        // The sorts below would separate entries from their
+        // tombstones, but addPoint never lets a leaf with tombstones
+        // overflow
+        assert( tombstones_.none() );
 
         for( unsigned d = 0; d < dimensions; d++ ) {
             // Sort along dimension d
@@ -480,19 +654,43 @@ SplitResult NODE_CLASS_TYPES::splitNode( Partition p ) {
     auto right_node = alloc_data.first;
 
     if( isLeaf() ) {
+        // Tombstones move with their entries
         for( unsigned i = 0; i < cur_offset_; i++ ) {
             Point &data_point = std::get<Point>( entries.at(i) );
             if( data_point[p.dimension] < p.location and
                     left_node->cur_offset_ < max_branch_factor ) {
+                left_node->tombstones_[left_node->cur_offset_] =
+                    tombstones_[i];
                 left_node->entries.at( left_node->cur_offset_++ ) =
                     data_point;
             } else {
+                right_node->tombstones_[right_node->cur_offset_] =
+                    tombstones_[i];
                 right_node->entries.at( right_node->cur_offset_++ ) =
                     data_point;
             }
             assert( left_node->cur_offset_ <= max_branch_factor );
             assert( right_node->cur_offset_ <= max_branch_factor );
         }
+
+        // The overflow chain goes with a copy of its point
+        if( overflow_ != nullptr ) {
+            Point duplicate = overflow_front( allocator, overflow_ );
+            bool goes_left = false;
+            for( unsigned i = 0; i < left_node->cur_offset_; i++ ) {
+                if( std::get<Point>( left_node->entries.at(i) ) ==
+                        duplicate ) {
+                    goes_left = true;
+                    break;
+                }
+            }
+            if( goes_left ) {
+                left_node->overflow_ = overflow_;
+            } else {
+                right_node->overflow_ = overflow_;
+            }
+            overflow_ = tree_node_handle( nullptr );
+        }
     } else {
         assert( left_node->cur_offset_ == 0 );
         assert( right_node->cur_offset_ == 0 );
@@ -629,7 +827,8 @@ tree_node_handle NODE_CLASS_TYPES::insert( Point givenPoint ) {
     tree_node_handle adjustContext = chooseNode(givenPoint);
     auto adjust_node = treeRef->get_node( adjustContext );
     assert( adjust_node->isLeaf() );
-    adjust_node->entries.at( adjust_node->cur_offset_++ ) = givenPoint;
+    adjust_node->addPoint( givenPoint );
+    adjust_node->spillDuplicates();
 
     auto finalSplit = adjust_node->adjustTree();
 
@@ -686,8 +885,9 @@ tree_node_handle NODE_CLASS_TYPES::remove( Point givenPoint ) {
     // D1 [Find node containing record]
 
     tree_node_handle leaf_handle = findLeaf(givenPoint);
+    // Record not in the tree
     if( leaf_handle == nullptr ) {
-        return self_handle_;
+        return tree_node_handle( nullptr );
     }
 
     auto leaf_node = treeRef->get_node( leaf_handle );
@@ -720,11 +920,23 @@ unsigned NODE_CLASS_TYPES::checksum()
 
     if( isLeaf() ) {
         for( unsigned i = 0; i < cur_offset_; i++ ) {
+            if( tombstones_.test(i) ) {
+                continue;
+            }
             Point &p = std::get<Point>( entries.at(i) );
             for( unsigned d = 0; d < dimensions; d++ ) {
                 sum += (unsigned) p[d];
             }
         }
+        if( overflow_ != nullptr ) {
+            Point duplicate = overflow_front( get_node_allocator( treeRef ),
+                    overflow_ );
+            uint64_t copies = overflow_count( get_node_allocator( treeRef ),
+                    overflow_ );
+            for( unsigned d = 0; d < dimensions; d++ ) {
+                sum += (unsigned) copies * (unsigned) duplicate[d];
+            }
+        }
         return sum;
     }
 
@@ -750,6 +962,20 @@ bool NODE_CLASS_TYPES::validate( tree_node_handle expectedParent, unsigned index
     }
 
     if( isLeaf() ) {
+        if( overflow_ != nullptr ) {
+            Point duplicate = overflow_front( get_node_allocator( treeRef ),
+                    overflow_ );
+            bool anchored = false;
+            for( unsigned i = 0; i < cur_offset_; i++ ) {
+                anchored = anchored or
+                    std::get<Point>( entries.at(i) ) == duplicate;
+            }
+            if( not anchored ) {
+                std::cout << "Overflow chain of " << duplicate <<
+                    " has no copy in its leaf" << std::endl;
+                assert( anchored );
+            }
+        }
         if( expectedParent != nullptr ) {
             auto parent_node = treeRef->get_node( parent_ );
             Branch &parent_branch = std::get<Branch>( parent_node->entries.at( index ) );
@@ -825,7 +1051,6 @@ NODE_TEMPLATE_TYPES
 unsigned NODE_CLASS_TYPES::height()
 {
     unsigned ret = 0;
-    Node *node = this;
     tree_node_handle current_handle = self_handle_;
     for( ;; ) {
         auto current_node = treeRef->get_node( current_handle );
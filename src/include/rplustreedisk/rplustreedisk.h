@@ -11,8 +11,10 @@
 #include <rplustreedisk/node.h>
 #include <index/index.h>
 #include <util/statistics.h>
-#include <unistd.h>
-#include <fcntl.h>
+#include <storage/superblock.h>
+#include <storage/range_estimator.h>
+#include <storage/point_scan.h>
+#include <util/densityRenderer.h>
 
 namespace rplustreedisk
 {
@@ -23,40 +25,51 @@ namespace rplustreedisk
 			tree_node_handle root_;
             tree_node_allocator node_allocator_;
             std::string backing_file_;
+            uint64_t point_count_;
+
+            // Entries tombstoned by lazy deletes and not yet compacted
+            uint64_t tombstone_count_;
+            bool lazy_deletes_;
+            unsigned compaction_percent_;
+
+            // Backs estimate(), kept current by every insert and remove
+            range_estimator range_estimator_;
 #ifdef STAT
 			Statistics stats;
 #endif
 
 			// Constructors and destructors
-			RPlusTreeDisk( size_t memory_budget, const std::string &backing_file )
-                : node_allocator_( memory_budget, backing_file ),
-                backing_file_( backing_file )
+			RPlusTreeDisk( buffer_budget memory_budget, const std::string &backing_file,
+                    page_encoding encoding = RAW_PAGES )
+                : node_allocator_( memory_budget, backing_file, encoding ),
+                backing_file_( backing_file ), point_count_( 0 ),
+                tombstone_count_( 0 ), lazy_deletes_( false ),
+                compaction_percent_( 0 )
             {
                 node_allocator_.initialize();
 
-                size_t existing_page_count =
-                    node_allocator_.buffer_pool_.get_preexisting_page_count();
-
-                // If existing page count is zero, then create a new
-                // root node.
-                if( existing_page_count == 0 ) {
-                    auto alloc_data =
-                        node_allocator_.create_new_tree_node<Node<min_branch_factor,max_branch_factor>>();
-                    root_ = alloc_data.second;
-                    new (&(*(alloc_data.first)))
-                        Node<min_branch_factor,max_branch_factor>( this,
-                                root_, tree_node_handle( nullptr ) );
+                // Find existing root node.
+                superblock sb;
+                superblock expected = superblock::describe(
+                        RPLUSTREE_DISK, min_branch_factor,
+                        max_branch_factor );
+                if( node_allocator_.load_superblock( expected, sb ) ) {
+                    root_ = sb.root_;
+                    point_count_ = sb.point_count_;
+                    tombstone_count_ = sb.tombstone_count_;
+                    range_estimator_.load( node_allocator_,
+                            sb.range_estimator_head_ );
                     return;
                 }
 
-                // Find existing root node.
-                std::string meta_file = backing_file_ + ".meta";
-                int fd = open( meta_file.c_str(), O_RDONLY );
-                assert( fd >= 0 );
-
-                int rc = read( fd, (char *) &root_, sizeof( root_ ) );
-                assert( rc == sizeof( root_ ) );
-
+                // Fresh file, so create a new root node.
+                node_allocator_.reserve_superblock();
+                auto alloc_data =
+                    node_allocator_.create_new_tree_node<Node<min_branch_factor,max_branch_factor>>();
+                root_ = alloc_data.second;
+                new (&(*(alloc_data.first)))
+                    Node<min_branch_factor,max_branch_factor>( this,
+                            root_, tree_node_handle( nullptr ) );
             }
 
 			~RPlusTreeDisk();
@@ -65,8 +78,33 @@ namespace rplustreedisk
 			std::vector<Point> exhaustiveSearch(Point requestedPoint);
 			std::vector<Point> search(Point requestedPoint);
 			std::vector<Point> search(Rectangle requestedRectangle);
+			// Same results as search(Rectangle), but walks the tree a
+			// level at a time reading each level's nodes in page order
+			std::vector<Point> pageOrderSearch(Rectangle requestedRectangle);
 			void insert(Point givenPoint);
 			void remove(Point givenPoint);
+			range_estimate estimate(Rectangle requestedRectangle);
+			bool extent(Rectangle &boundingBox, uint64_t &pointCount) override;
+			// Starts estimate()'s summary over, reading every node
+			void buildRangeEstimator();
+			// Appends a node's live branches or, for a leaf, its points
+			void expandNode(tree_node_handle node_handle, range_estimator::branch_list &branches, std::vector<Point> &points);
+			// Writes a density tile pyramid under directory, see
+			// DensityRenderer. Returns how many tiles were written.
+			unsigned renderDensity(const std::string &directory, unsigned maxZoom, unsigned threadCount = 0);
+			// Every live point, leaf by leaf in storage order, see point_scan
+			point_scan scan();
+			uint64_t exportPoints(const std::string &path) override;
+
+			// From here on remove() only tombstones the point in its
+			// leaf rather than condensing the tree. Once tombstones make
+			// up more than compaction_percent of the leaf entries,
+			// compactTombstones() runs.
+			void enableLazyDeletes(unsigned compaction_percent = 25);
+			// Drops tombstoned entries from every leaf, then
+			// reinserts the points of leaves left underfull and unlinks
+			// those leaves. Safe to call at any time.
+			void compactTombstones();
 
 			// Miscellaneous
 			unsigned checksum();
@@ -84,23 +122,20 @@ namespace rplustreedisk
             }
 
             void write_metadata() override {
-                // Step 1:
-                // Writeback everything to disk
-                node_allocator_.buffer_pool_.writeback_all_pages();
-
-                // Step 2:
-                // Write metadata file
-
                 auto root_node = get_node( root_ );
                 assert( root_node->self_handle_ == root_ );
-                std::string meta_fname = backing_file_ + ".meta";
-                int fd = open( meta_fname.c_str(), O_WRONLY |
-                        O_TRUNC | O_CREAT, S_IRUSR | S_IWUSR );
-                assert( fd >= 0 );
-                // yes, yes, i should loop this whatever
-                int rc = write( fd, (char *) &root_, sizeof(root_) );
-                assert( rc == sizeof(root_) );
-                close( fd );
+
+                superblock sb = superblock::describe( RPLUSTREE_DISK,
+                        min_branch_factor, max_branch_factor );
+                sb.root_ = root_;
+                sb.point_count_ = point_count_;
+                sb.tombstone_count_ = tombstone_count_;
+                sb.tree_height_ = root_node->height();
+                sb.range_estimator_head_ = range_estimator_.persist(
+                        node_allocator_ );
+
+                // Writes back everything to disk along with the superblock
+                node_allocator_.write_superblock( sb );
             }
 	};
 #include "rplustreedisk.tcc"
@@ -36,12 +36,63 @@ std::vector<Point> TREE_CLASS_TYPES::search(
     return root_node->search( requestedRectangle );
 }
 
+TREE_TEMPLATE_TYPES
+std::vector<Point> TREE_CLASS_TYPES::pageOrderSearch(
+    Rectangle requestedRectangle
+) {
+    std::vector<Point> matchingPoints;
+    std::vector<tree_node_handle> frontier = { root_ };
+    std::vector<tree_node_handle> next_frontier;
+
+    while( not frontier.empty() ) {
+        node_allocator_.visit_in_page_order( frontier,
+                [&]( tree_node_handle node_handle ) {
+            auto current_node = get_node( node_handle );
+
+            if( current_node->isLeaf() ) {
+                for( unsigned i = 0; i < current_node->cur_offset_; i++ ) {
+                    Point &p = std::get<Point>( current_node->entries.at(i) );
+                    if( requestedRectangle.containsPoint( p ) and
+                            not current_node->tombstones_.test(i) ) {
+                        matchingPoints.push_back( p );
+                    }
+                }
+                current_node->searchOverflow( requestedRectangle,
+                        matchingPoints );
+#ifdef STAT
+                stats.markLeafSearched();
+#endif
+            } else {
+                for( unsigned i = 0; i < current_node->cur_offset_; i++ ) {
+                    Branch &b = std::get<Branch>( current_node->entries.at(i) );
+                    if( b.boundingBox.intersectsRectangle( requestedRectangle ) ) {
+                        next_frontier.push_back( b.child );
+                    }
+                }
+#ifdef STAT
+                stats.markNonLeafNodeSearched();
+#endif
+            }
+        } );
+        frontier.swap( next_frontier );
+        next_frontier.clear();
+    }
+
+#ifdef STAT
+    stats.resetSearchTracker( true );
+#endif
+
+    return matchingPoints;
+}
+
 TREE_TEMPLATE_TYPES
 void TREE_CLASS_TYPES::insert(
     Point givenPoint
 ) {
     auto root_node = get_node( root_ );
     root_ = root_node->insert( givenPoint );
+    point_count_++;
+    range_estimator_.note_insert( givenPoint );
 }
 
 TREE_TEMPLATE_TYPES
@@ -49,7 +100,186 @@ void TREE_CLASS_TYPES::remove(
     Point givenPoint
 ) {
     auto root_node = get_node( root_ );
-    root_ = root_node->remove( givenPoint );
+    if( lazy_deletes_ ) {
+        tree_node_handle leaf_handle = root_node->findLeaf( givenPoint );
+        // Record not in the tree
+        if( leaf_handle == nullptr ) {
+            return;
+        }
+
+        point_count_--;
+        range_estimator_.note_remove( givenPoint );
+        // Copies in an overflow chain come straight out
+        auto leaf_node = get_node( leaf_handle );
+        if( leaf_node->removeOverflowPoint( givenPoint ) ) {
+            return;
+        }
+        leaf_node->tombstonePoint( givenPoint );
+        tombstone_count_++;
+        if( tombstone_count_ * 100 > compaction_percent_ *
+                (point_count_ + tombstone_count_) ) {
+            compactTombstones();
+        }
+        return;
+    }
+
+    tree_node_handle new_root = root_node->remove( givenPoint );
+    // Record not in the tree
+    if( not new_root ) {
+        return;
+    }
+    root_ = new_root;
+    point_count_--;
+    range_estimator_.note_remove( givenPoint );
+}
+
+TREE_TEMPLATE_TYPES
+range_estimate TREE_CLASS_TYPES::estimate(
+    Rectangle requestedRectangle
+) {
+    return range_estimator_.estimate( requestedRectangle );
+}
+
+TREE_TEMPLATE_TYPES
+bool TREE_CLASS_TYPES::extent( Rectangle &boundingBox, uint64_t
+        &pointCount ) {
+    pointCount = point_count_;
+    if( point_count_ > 0 ) {
+        boundingBox = get_node( root_ )->boundingBox();
+    }
+    return true;
+}
+
+TREE_TEMPLATE_TYPES
+void TREE_CLASS_TYPES::buildRangeEstimator() {
+    range_estimator_.rebuild( root_, [&]( tree_node_handle node_handle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( node_handle, branches, points );
+    } );
+}
+
+TREE_TEMPLATE_TYPES
+void TREE_CLASS_TYPES::expandNode(
+    tree_node_handle node_handle,
+    range_estimator::branch_list &branches,
+    std::vector<Point> &points
+) {
+    auto node = get_node( node_handle );
+    for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+        if( node->isLeaf() ) {
+            if( not node->tombstones_.test(i) ) {
+                points.push_back( std::get<Point>( node->entries.at(i) ) );
+            }
+        } else {
+            const Branch &b = std::get<Branch>( node->entries.at(i) );
+            branches.push_back( std::make_pair( b.boundingBox, b.child ) );
+        }
+    }
+    overflow_scan( &node_allocator_, node->overflow_, points );
+}
+
+TREE_TEMPLATE_TYPES
+unsigned TREE_CLASS_TYPES::renderDensity(
+    const std::string &directory,
+    unsigned maxZoom,
+    unsigned threadCount
+) {
+    DensityRenderer renderer( root_, point_count_, [&]( tree_node_handle node_handle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( node_handle, branches, points );
+    } );
+    return renderer.render( directory, maxZoom, 256, threadCount );
+}
+
+TREE_TEMPLATE_TYPES
+point_scan TREE_CLASS_TYPES::scan() {
+    return point_scan( &node_allocator_, root_, [this]( tree_node_handle node_handle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( node_handle, branches, points );
+    } );
+}
+
+TREE_TEMPLATE_TYPES
+uint64_t TREE_CLASS_TYPES::exportPoints(
+    const std::string &path
+) {
+    return scan().export_points( path );
+}
+
+TREE_TEMPLATE_TYPES
+void TREE_CLASS_TYPES::enableLazyDeletes(
+    unsigned compaction_percent
+) {
+    lazy_deletes_ = true;
+    compaction_percent_ = compaction_percent;
+}
+
+TREE_TEMPLATE_TYPES
+void TREE_CLASS_TYPES::compactTombstones()
+{
+    std::vector<Point> orphans;
+    std::vector<tree_node_handle> underfull_leaves;
+    std::stack<tree_node_handle> context;
+    context.push( root_ );
+
+    // Compact each leaf in place, setting aside the points of any that
+    // end up underfull
+    while( not context.empty() ) {
+        tree_node_handle current_handle = context.top();
+        context.pop();
+        auto current_node = get_node( current_handle );
+
+        if( not current_node->isLeaf() ) {
+            for( unsigned i = 0; i < current_node->cur_offset_; i++ ) {
+                context.push( std::get<Branch>(
+                            current_node->entries.at(i) ).child );
+            }
+            continue;
+        }
+
+        if( current_node->tombstones_.none() ) {
+            continue;
+        }
+        current_node->purgeTombstones();
+        if( current_handle != root_ and
+                current_node->cur_offset_ < min_branch_factor ) {
+            for( unsigned i = 0; i < current_node->cur_offset_; i++ ) {
+                orphans.push_back( std::get<Point>(
+                            current_node->entries.at(i) ) );
+            }
+            overflow_scan( &node_allocator_, current_node->overflow_,
+                    orphans );
+            overflow_free( &node_allocator_, current_node->overflow_ );
+            current_node->overflow_ = tree_node_handle( nullptr );
+            current_node->cur_offset_ = 0;
+            underfull_leaves.push_back( current_handle );
+        }
+    }
+    tombstone_count_ = 0;
+
+    // Unlinks the emptied leaves and shrinks their ancestors' boxes
+    for( tree_node_handle leaf_handle : underfull_leaves ) {
+        get_node( leaf_handle )->condenseTree();
+    }
+
+    // Shorten the tree. A root that lost every branch is an empty leaf.
+    for( ;; ) {
+        auto root_node = get_node( root_ );
+        if( root_node->isLeaf() or root_node->cur_offset_ > 1 ) {
+            break;
+        }
+        // FIXME: GC existing root
+        root_ = std::get<Branch>( root_node->entries.at(0) ).child;
+        get_node( root_ )->parent_ = tree_node_handle( nullptr );
+    }
+
+    for( Point &orphan : orphans ) {
+        auto root_node = get_node( root_ );
+        root_ = root_node->insert( orphan );
+    }
 }
 
 TREE_TEMPLATE_TYPES
@@ -82,6 +312,5 @@ void TREE_CLASS_TYPES::print()
 TREE_TEMPLATE_TYPES
 void TREE_CLASS_TYPES::visualize()
 {
-    //BMPPrinter p( 1000, 1000 );
-    //p.printToBMP( root_node );
+    renderDensity( "density", 6 );
 }
@@ -16,6 +16,7 @@
 #include <globals/globals.h>
 #include <util/geometry.h>
 #include <util/statistics.h>
+#include <util/interleave.h>
 
 namespace rstartree
 {
@@ -93,6 +94,19 @@ namespace rstartree
 
 	Rectangle boxFromNodeEntry(const Node::NodeEntry &entry);
 	double computeOverlapGrowth(unsigned index, const std::vector<Node::NodeEntry> &entries, const Rectangle &rect);
+
+	// One point search of a batch, run a node at a time by runInterleaved
+	class PointLookup
+	{
+		public:
+			Point requestedPoint;
+			std::vector<Point> *accumulator;
+			std::vector<const Node *> context;
+			const Node *current;
+
+			PointLookup(const Node *root, const Point &requestedPoint, std::vector<Point> *accumulator);
+			bool step();
+	};
 }
 
 #endif
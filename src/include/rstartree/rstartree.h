@@ -9,6 +9,7 @@
 #include <util/geometry.h>
 #include <rstartree/node.h>
 #include <util/bmpPrinter.h>
+#include <util/packedtree.h>
 
 namespace rstartree
 {
@@ -32,6 +33,7 @@ namespace rstartree
 			std::vector<Point> exhaustiveSearch(Point requestedPoint);
 			std::vector<Point> search(Point requestedPoint);
 			std::vector<Point> search(Rectangle requestedRectangle);
+			std::vector<std::vector<Point>> batchSearch(const std::vector<Point> &requestedPoints);
 			void insert(Point givenPoint);
 			void remove(Point givenPoint);
 
@@ -41,6 +43,9 @@ namespace rstartree
 			bool validate();
 			void stat();
 			void visualize();
+
+			// A read-only copy laid out for searching, see util/packedtree.h
+			PackedTree pack();
 	};
 }
 
@@ -91,12 +91,17 @@ namespace rstartreedisk
                 }
 
             void addEntryToNode( const NodeEntry &entry ) {
+                holdForWrite();
                 entries.at( cur_offset_ ) = entry;
                 cur_offset_++;
             }
 
 			void deleteSubtrees();
 
+			// Keeps optimistic readers out of this node's page until the
+			// insert or remove is done. Called before changing the node.
+			void holdForWrite();
+
 			// Helper functions
 			Rectangle boundingBox() const;
 			bool updateBoundingBox(tree_node_handle child, Rectangle updatedBoundingBox);
@@ -105,6 +110,8 @@ namespace rstartreedisk
 			tree_node_handle chooseSubtree(const NodeEntry &nodeEntry);
 			tree_node_handle findLeaf(const Point &givenPoint);
 			inline bool isLeafNode() const { return level == 0; }
+			// Rebuilds this leaf's filter from its current entries
+			void refreshLeafFilter();
 			unsigned chooseSplitLeafAxis();
 			unsigned chooseSplitNonLeafAxis();
 			unsigned chooseSplitAxis();
@@ -122,7 +129,8 @@ namespace rstartreedisk
 			std::vector<Point> search(const Rectangle
                     &requestedRectangle);
 
-			// These return the root of the tree.
+			// These return the root of the tree, remove nullptr if
+			// givenPoint is not in it.
 			tree_node_handle insert(NodeEntry nodeEntry, std::vector<bool> &hasReinsertedOnLevel);
 			tree_node_handle remove(Point &givenPoint, std::vector<bool> hasReinsertedOnLevel);
 
@@ -195,5 +203,23 @@ namespace rstartreedisk
 
     }
 
+    // One point search of a batch, run a node at a time by
+    // runInterleaved. Children are pulled into cache as they are pushed
+    // so that they have usually arrived by the time they are popped.
+    template <int min_branch_factor, int max_branch_factor>
+    class PointLookup
+    {
+        public:
+            RStarTreeDisk<min_branch_factor,max_branch_factor> *treeRef;
+            Point requestedPoint;
+            std::vector<Point> *accumulator;
+            std::vector<tree_node_handle> context;
+
+            PointLookup( RStarTreeDisk<min_branch_factor,max_branch_factor>
+                    *treeRef, tree_node_handle root, const Point
+                    &requestedPoint, std::vector<Point> *accumulator );
+            bool step();
+    };
+
 #include "node.tcc"
 }
@@ -59,6 +59,12 @@ void Node<min_branch_factor, max_branch_factor>::deleteSubtrees()
     }
 }
 
+template <int min_branch_factor, int max_branch_factor>
+void Node<min_branch_factor, max_branch_factor>::holdForWrite()
+{
+    get_node_allocator( treeRef )->hold_for_write( self_handle_ );
+}
+
 template <int min_branch_factor, int max_branch_factor>
 Rectangle Node<min_branch_factor, max_branch_factor>::boundingBox() const
 {
@@ -83,6 +89,7 @@ bool Node<min_branch_factor, max_branch_factor>::updateBoundingBox(tree_node_han
         {
             if (b.boundingBox != updatedBoundingBox)
             {
+                holdForWrite();
                 b.boundingBox = updatedBoundingBox;
                 return true;
             }
@@ -103,6 +110,7 @@ void Node<min_branch_factor, max_branch_factor>::removeChild(tree_node_handle ch
     using BranchType = typename
         Node<min_branch_factor,max_branch_factor>::Branch;
 
+    holdForWrite();
     auto iter = std::remove_if( entries.begin(),
        entries.begin() + cur_offset_, [&child]( NodeEntry &entry ) {
         return std::get<BranchType>( entry ).child == child; });
@@ -112,11 +120,31 @@ void Node<min_branch_factor, max_branch_factor>::removeChild(tree_node_handle ch
 template <int min_branch_factor, int max_branch_factor>
 void Node<min_branch_factor, max_branch_factor>::removeData(const Point &givenPoint)
 {
-    auto iter = std::remove_if( entries.begin(),
+    // Just the one copy, duplicates stay
+    auto iter = std::find_if( entries.begin(),
             entries.begin() + cur_offset_, [&givenPoint]( NodeEntry &entry
                 ) { return std::get<Point>( entry) == givenPoint; }
             );
-    cur_offset_ = (iter - entries.begin());
+    assert( iter != entries.begin() + cur_offset_ );
+    holdForWrite();
+    *iter = entries[cur_offset_ - 1];
+    cur_offset_--;
+}
+
+template <int min_branch_factor, int max_branch_factor>
+void Node<min_branch_factor, max_branch_factor>::refreshLeafFilter()
+{
+    assert( isLeafNode() );
+    if( !treeRef->leaf_filters_.enabled() ) {
+        return;
+    }
+
+    std::vector<Point> points;
+    points.reserve( cur_offset_ );
+    for( unsigned i = 0; i < cur_offset_; i++ ) {
+        points.push_back( std::get<Point>( entries.at(i) ) );
+    }
+    treeRef->leaf_filters_.rebuild( self_handle_, points );
 }
 
 template <int min_branch_factor, int max_branch_factor>
@@ -189,6 +217,12 @@ void Node<min_branch_factor,max_branch_factor>::searchSub(const Point &requested
 
 
                 if( b.boundingBox.containsPoint( requestedPoint ) ) {
+                    // Rule the leaf out before fetching it if we can
+                    if( curNode->level == 1 and
+                            !treeRef->leaf_filters_.may_contain( b.child,
+                                requestedPoint ) ) {
+                        continue;
+                    }
                     tree_node_handle child_handle = b.child;
                     pinned_node_ptr<NodeType> child = treeRef->get_node( child_handle );
                     context.push( child );
@@ -198,6 +232,63 @@ void Node<min_branch_factor,max_branch_factor>::searchSub(const Point &requested
     }
 }
 
+template <int min_branch_factor, int max_branch_factor>
+PointLookup<min_branch_factor,max_branch_factor>::PointLookup(
+        RStarTreeDisk<min_branch_factor,max_branch_factor> *treeRef,
+        tree_node_handle root, const Point &requestedPoint,
+        std::vector<Point> *accumulator ) : treeRef( treeRef ),
+    requestedPoint( requestedPoint ), accumulator( accumulator )
+{
+    context.push_back( root );
+    get_node_allocator( treeRef )->prefetch_tree_node( root,
+            sizeof( Node<min_branch_factor,max_branch_factor> ) );
+}
+
+template <int min_branch_factor, int max_branch_factor>
+bool PointLookup<min_branch_factor,max_branch_factor>::step()
+{
+    using NodeType = Node<min_branch_factor,max_branch_factor>;
+
+    if( context.empty() ) {
+        return false;
+    }
+    tree_node_handle current_handle = context.back();
+    context.pop_back();
+
+    // Straight from the allocator, as get_node would write to the node
+    tree_node_allocator *allocator = get_node_allocator( treeRef );
+    pinned_node_ptr<NodeType> curNode =
+        allocator->get_tree_node<NodeType>( current_handle );
+
+    if( curNode->isLeafNode() ) {
+        for( unsigned i = 0; i < curNode->cur_offset_; i++ ) {
+            const Point &p = std::get<Point>( curNode->entries.at(i) );
+
+            if( p == requestedPoint ) {
+                accumulator->push_back( p );
+            }
+        }
+    } else {
+        for( unsigned i = 0; i < curNode->cur_offset_; i++ ) {
+            const typename NodeType::Branch &b = std::get<typename
+                NodeType::Branch>( curNode->entries.at( i ) );
+
+            if( b.boundingBox.containsPoint( requestedPoint ) ) {
+                // Rule the leaf out before fetching it if we can
+                if( curNode->level == 1 and
+                        !treeRef->leaf_filters_.may_contain( b.child,
+                            requestedPoint ) ) {
+                    continue;
+                }
+                context.push_back( b.child );
+                allocator->prefetch_tree_node( b.child, sizeof( NodeType ) );
+            }
+        }
+    }
+
+    return !context.empty();
+}
+
 template <int min_branch_factor, int max_branch_factor>
 void Node<min_branch_factor,max_branch_factor>::searchSub(const Rectangle &rectangle, std::vector<Point> &accumulator)
 {
@@ -294,6 +385,7 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::chooseSubtree(const
 
     // CL1 [Initialize]
     tree_node_handle node_handle = self_handle_;
+    tree_node_handle parent_handle;
 
     // Always called on root, this = root
     assert( !parent );
@@ -311,6 +403,9 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::chooseSubtree(const
 
     for (;;)
     {
+        // Lets the allocator place what we add by subtree
+        get_node_allocator(treeRef)->enter_subtree(node_handle, parent_handle);
+
         pinned_node_ptr<NodeType> node = treeRef->get_node( node_handle );
 
         if (node->level == stoppingLevel)
@@ -423,6 +518,7 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::chooseSubtree(const
         }
 
         // Descend
+        parent_handle = node_handle;
         node_handle = std::get<Branch>(node->entries[descentIndex]).child;
     }
 }
@@ -448,7 +544,8 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::findLeaf(const Poin
     for( unsigned i = 0; i < cur_offset_; i++ ) {
         const Branch &b = std::get<Branch>( entries.at( i ) );
 
-        if (b.boundingBox.containsPoint(givenPoint))
+        if (b.boundingBox.containsPoint(givenPoint) and (level != 1 or
+                    treeRef->leaf_filters_.may_contain(b.child, givenPoint)))
         {
             tree_node_handle child_handle = b.child;
             pinned_node_ptr<NodeType> child = treeRef->get_node( child_handle );
@@ -757,6 +854,8 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::splitNode()
     // Call chooseSplitAxis to determine the axis perpendicular to which the split is performed
     // For now we will save the axis as a int -> since this allows for room for growth in the future
     // Call ChooseSplitIndex to create optimal splitting of data array
+    // Both of these sort our entries in place
+    holdForWrite();
     unsigned splitAxis = chooseSplitAxis();
     unsigned splitIndex = chooseSplitIndex(splitAxis);
 
@@ -789,12 +888,22 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::splitNode()
 
     newSibling->cur_offset_ = cur_offset_ - splitIndex;
 
+    if (isLeafNode() and treeRef->has_point_index_)
+    {
+        for( unsigned i = 0; i < newSibling->cur_offset_; i++ ) {
+            treeRef->point_index_.move( std::get<Point>(
+                        newSibling->entries.at(i) ), self_handle_,
+                    sibling_handle );
+        }
+    }
+
     if (std::holds_alternative<Branch>(newSibling->entries[0]))
     {
         for( unsigned i = 0; i < newSibling->cur_offset_; i++ ) {
             // Update parents
             Branch &b = std::get<Branch>( newSibling->entries.at(i) );
             pinned_node_ptr<NodeType> child = treeRef->get_node( b.child );
+            child->holdForWrite();
             child->parent = sibling_handle;
 
             assert(level == child->level + 1);
@@ -805,6 +914,12 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::splitNode()
     // Chop our node's data down
     cur_offset_ = splitIndex;
 
+    if (isLeafNode())
+    {
+        refreshLeafFilter();
+        newSibling->refreshLeafFilter();
+    }
+
     assert( cur_offset_ > 0 );
     assert( newSibling->cur_offset_ > 0 );
 
@@ -847,6 +962,7 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::adjustTree(tree_node
 
                 // AT4 [Propogate the node split upwards]
                 Branch b(sibling_ptr->boundingBox(), sibling_handle);
+                parent_ptr->holdForWrite();
                 parent_ptr->entries.at(parent_ptr->cur_offset_) = std::move(b) ;
                 parent_ptr->cur_offset_++;
                 // FIXME check for overflow
@@ -919,6 +1035,7 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::reInsert(std::vector
 
     assert(hasReinsertedOnLevel.at(level));
 
+    holdForWrite();
     std::sort(entries.begin(), entries.begin() + cur_offset_,
         [&globalCenterPoint](NodeEntry &a, NodeEntry &b)
         {
@@ -948,6 +1065,20 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::reInsert(std::vector
     //adjust ending of array
     cur_offset_ = remainder; 
 
+    if (isLeafNode())
+    {
+        refreshLeafFilter();
+    }
+
+    // Reinsertion indexes these points again wherever they land
+    if (isLeafNode() and treeRef->has_point_index_)
+    {
+        for( const NodeEntry &entry : entriesToReinsert ) {
+            treeRef->point_index_.remove( std::get<Point>( entry ),
+                    self_handle_ );
+        }
+    }
+
     // During this recursive insert (we are already in an insert, since we are reInserting), we
     // may end up here again. If we do, we should still be using the same hasReinsertedOnLevel
     // vector because it corresponds to the activities we have performed during a single
@@ -1018,14 +1149,27 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::insert(NodeEntry nod
         std::holds_alternative<Point>(insertion_point->entries[0]);
     assert((givenIsLeaf && firstIsPoint) || (!givenIsLeaf && !firstIsPoint));
 #endif
+    insertion_point->holdForWrite();
     insertion_point->entries.at(insertion_point->cur_offset_) = nodeEntry;
     insertion_point->cur_offset_++;
 
+    if (givenIsLeaf)
+    {
+        treeRef->leaf_filters_.add( insertion_point_handle,
+                std::get<Point>(nodeEntry) );
+        if (treeRef->has_point_index_)
+        {
+            treeRef->point_index_.add( std::get<Point>(nodeEntry),
+                    insertion_point_handle );
+        }
+    }
+
     if (!givenIsLeaf)
     {
         const Branch &b = std::get<Branch>(nodeEntry);
         pinned_node_ptr<NodeType> child = treeRef->get_node( b.child );
         assert(insertion_point->level == child->level + 1);
+        child->holdForWrite();
         child->parent = insertion_point_handle;
     }
 
@@ -1058,6 +1202,7 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::insert(NodeEntry nod
             NodeType( treeRef, root_handle,
                 tree_node_handle( nullptr ), this->level+1 );
         
+        holdForWrite();
         this->parent = root_handle;
 
         // Make the existing root a child of newRoot
@@ -1066,6 +1211,7 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::insert(NodeEntry nod
         newRoot->cur_offset_++;
 
         // Make the new sibling node a child of newRoot
+        sibling->holdForWrite();
         sibling->parent = root_handle;
         Branch b2( sibling->boundingBox(), sibling_handle );
         newRoot->entries.at( newRoot->cur_offset_ ) = std::move( b2 );
@@ -1146,6 +1292,18 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::condenseTree(std::ve
             std::copy(node->entries.begin(),
                     node->entries.begin() + node->cur_offset_, std::back_inserter(Q));
 
+            if (node->isLeafNode())
+            {
+                treeRef->leaf_filters_.erase( node_handle );
+            }
+            if (node->isLeafNode() and treeRef->has_point_index_)
+            {
+                for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+                    treeRef->point_index_.remove( std::get<Point>(
+                                node->entries.at(i) ), node_handle );
+                }
+            }
+
             // FIXME: Should garbage collect node_ptr, it is dead now
             //tree_node_handle garbage = node_handle;
 
@@ -1175,7 +1333,19 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::remove(Point &givenP
     assert( !parent );
 
     // D1 [Find node containing record]
-    tree_node_handle leaf_ptr = findLeaf(givenPoint);
+    tree_node_handle leaf_ptr;
+    if( cur_offset_ == 0 ) {
+        // Empty tree
+        return leaf_ptr; /*nullptr*/
+    }
+    if( treeRef->has_point_index_ ) {
+        std::vector<tree_node_handle> leaves =
+            treeRef->point_index_.leaves_for( givenPoint );
+        leaf_ptr = leaves.empty() ? tree_node_handle( nullptr ) :
+            leaves.front();
+    } else {
+        leaf_ptr = findLeaf(givenPoint);
+    }
     if(!leaf_ptr) {
         return leaf_ptr; /*nullptr*/ 
     }
@@ -1184,6 +1354,10 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::remove(Point &givenP
     // D2 [Delete record]
 
     leaf->removeData(givenPoint);
+    leaf->refreshLeafFilter();
+    if( treeRef->has_point_index_ ) {
+        treeRef->point_index_.remove( givenPoint, leaf_ptr );
+    }
 
     // D3 [Propagate changes]
     tree_node_handle root_handle = leaf->condenseTree(hasReinsertedOnLevel);
@@ -1206,6 +1380,7 @@ tree_node_handle Node<min_branch_factor,max_branch_factor>::remove(Point &givenP
 
 
         // I'm the root now!
+        child->holdForWrite();
         child->parent = tree_node_handle( nullptr );
 
         return b.child;
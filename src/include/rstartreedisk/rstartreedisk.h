@@ -1,5 +1,8 @@
 #pragma once
+#include <atomic>
 #include <cassert>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <stack>
 #include <iostream>
@@ -7,10 +10,14 @@
 #include <util/geometry.h>
 #include <rstartreedisk/node.h>
 #include <util/bmpPrinter.h>
+#include <util/interleave.h>
 #include <storage/tree_node_allocator.h>
-
-#include <unistd.h>
-#include <fcntl.h>
+#include <storage/superblock.h>
+#include <storage/point_location_index.h>
+#include <storage/leaf_filter.h>
+#include <storage/range_estimator.h>
+#include <storage/point_scan.h>
+#include <util/densityRenderer.h>
 
 namespace rstartreedisk
 {
@@ -24,13 +31,39 @@ namespace rstartreedisk
 			Statistics stats;
             tree_node_allocator node_allocator_;
             std::string backing_file_;
+            uint64_t point_count_;
+
+            // Exact match lookups and deletes go straight to the leaf
+            // through point_index_ when has_point_index_ is set
+            point_location_index point_index_;
+            bool has_point_index_;
+
+            // Lets point searches skip leaves that can't hold the point
+            leaf_filter_set leaf_filters_;
 
 			std::vector<bool> hasReinsertedOnLevel;
 
+            // See enableOptimisticReads()
+            bool optimistic_reads_;
+            // Odd while a writer is replacing root
+            std::atomic<uint32_t> root_version_;
+            // Searches that had to start over because of a writer
+            std::atomic<uint64_t> optimistic_restarts_;
+
+            // Backs estimate(), kept current by every insert and remove
+            range_estimator range_estimator_;
+
 			// Constructors and destructors
-            RStarTreeDisk(size_t memory_budget, std::string backing_file
-                    ) : node_allocator_( memory_budget, backing_file ),
-                    backing_file_( backing_file )
+            RStarTreeDisk(buffer_budget memory_budget, std::string backing_file,
+                    page_encoding encoding = RAW_PAGES,
+                    bool point_index = false,
+                    unsigned filter_bits_per_entry = 0
+                    ) : node_allocator_( memory_budget, backing_file, encoding ),
+                    backing_file_( backing_file ), point_count_( 0 ),
+                    has_point_index_( point_index ),
+                    leaf_filters_( filter_bits_per_entry, max_branch_factor ),
+                    optimistic_reads_( false ), root_version_( 0 ),
+                    optimistic_restarts_( 0 )
             {
                 // Initialize buffer pool
                 node_allocator_.initialize();
@@ -39,27 +72,37 @@ namespace rstartreedisk
 
                 /* We need to figure out if there was already data, and read
                  * that into memory if we have it. */
-
-                size_t existing_page_count =
-                    node_allocator_.buffer_pool_.get_preexisting_page_count();
-
-                // If this is a fresh tree, then make a fresh root
-                if( existing_page_count == 0 ) { 
-                    std::pair<pinned_node_ptr<Node<min_branch_factor,max_branch_factor>>, tree_node_handle> alloc =
-                        node_allocator_.create_new_tree_node<Node<min_branch_factor,max_branch_factor>>();
-                    root = alloc.second;
-                    new (&(*(alloc.first))) Node<min_branch_factor,max_branch_factor>( this, root, tree_node_handle() /*nullptr*/, 0
-                            );
+                superblock sb;
+                superblock expected = superblock::describe(
+                        RSTARTREE_DISK, min_branch_factor,
+                        max_branch_factor );
+                if( node_allocator_.load_superblock( expected, sb ) ) {
+                    root = sb.root_;
+                    point_count_ = sb.point_count_;
+                    range_estimator_.load( node_allocator_,
+                            sb.range_estimator_head_ );
+                    hasReinsertedOnLevel.resize( sb.tree_height_, false );
+                    if( sb.has_point_index_ ) {
+                        point_index_.load( node_allocator_,
+                                sb.point_index_head_,
+                                sb.point_index_entry_count_ );
+                        has_point_index_ = true;
+                    } else if( has_point_index_ ) {
+                        buildPointIndex();
+                    }
+                    if( leaf_filters_.enabled() ) {
+                        buildLeafFilters();
+                    }
                     return;
                 }
 
-                std::string meta_file = backing_file_ + ".meta";
-                int fd = open( meta_file.c_str(), O_RDONLY );
-                assert( fd >= 0 );
-
-                int rc = read( fd, (char *) &root, sizeof( root ) );
-                assert( rc == sizeof( root ) );
-
+                // This is a fresh tree, so make a fresh root
+                node_allocator_.reserve_superblock();
+                std::pair<pinned_node_ptr<Node<min_branch_factor,max_branch_factor>>, tree_node_handle> alloc =
+                    node_allocator_.create_new_tree_node<Node<min_branch_factor,max_branch_factor>>();
+                root = alloc.second;
+                new (&(*(alloc.first))) Node<min_branch_factor,max_branch_factor>( this, root, tree_node_handle() /*nullptr*/, 0
+                        );
             }
 
 			~RStarTreeDisk() {
@@ -69,8 +112,46 @@ namespace rstartreedisk
 			std::vector<Point> exhaustiveSearch(Point requestedPoint);
 			std::vector<Point> search(Point requestedPoint);
 			std::vector<Point> search(Rectangle requestedRectangle);
+			// Same results as search(Rectangle), but walks the tree a
+			// level at a time reading each level's nodes in page order
+			std::vector<Point> pageOrderSearch(Rectangle requestedRectangle);
+			// Interleaves the searches so that each one's node fetches
+			// overlap the others' work
+			std::vector<std::vector<Point>> batchSearch(const std::vector<Point> &requestedPoints);
+			task<std::vector<Point>> searchAsync(executor &ex, Point requestedPoint);
+			task<std::vector<Point>> searchAsync(executor &ex, Rectangle requestedRectangle);
 			void insert(Point givenPoint);
 			void remove(Point givenPoint);
+			range_estimate estimate(Rectangle requestedRectangle);
+			bool extent(Rectangle &boundingBox, uint64_t &pointCount) override;
+			// Starts estimate()'s summary over, reading every node
+			void buildRangeEstimator();
+			// Appends a node's branches or, for a leaf, its points
+			void expandNode(tree_node_handle nodeHandle, range_estimator::branch_list &branches, std::vector<Point> &points);
+			// Writes a density tile pyramid under directory, see
+			// DensityRenderer. Returns how many tiles were written.
+			unsigned renderDensity(const std::string &directory, unsigned maxZoom, unsigned threadCount = 0);
+			// Every live point, leaf by leaf in storage order, see point_scan
+			point_scan scan();
+			uint64_t exportPoints(const std::string &path) override;
+
+			// From here on search() may be called from any number of
+			// threads at once, alongside inserts and removes made one at
+			// a time. Searches pin nothing and take no latch: they copy
+			// each node out of its page and start over if a writer
+			// changed the page meanwhile, falling back to the latch if
+			// writers keep getting in the way. They don't use the point
+			// index or leaf filters. The other searches are still only
+			// safe with no writer about.
+			void enableOptimisticReads();
+			std::vector<Point> optimisticSearch(Point requestedPoint);
+			std::vector<Point> optimisticSearch(Rectangle requestedRectangle);
+
+			// Indexes every point already in the tree
+			void buildPointIndex();
+
+			// Filters are not persisted, so reopened trees rebuild them
+			void buildLeafFilters();
 
 			// Miscellaneous
 			unsigned checksum();
@@ -88,26 +169,34 @@ namespace rstartreedisk
             }
 
             void write_metadata() {
-                // Step 1:
-                // Writeback everything to disk
-                node_allocator_.buffer_pool_.writeback_all_pages();
-
-                // Step 2:
-                // Write metadata file
-
+                write_section section( node_allocator_.buffer_pool_ );
                 auto root_node = get_node( root );
                 assert( root_node->self_handle_ == root );
-                std::string meta_fname = backing_file_ + ".meta";
-                int fd = open( meta_fname.c_str(), O_WRONLY |
-                        O_TRUNC | O_CREAT, S_IRUSR | S_IWUSR );
-                assert( fd >= 0 );
-                // yes, yes, i should loop this whatever
-                int rc = write( fd, (char *) &root, sizeof(root) );
-                assert( rc == sizeof(root) );
-                close( fd );
 
+                superblock sb = superblock::describe( RSTARTREE_DISK,
+                        min_branch_factor, max_branch_factor );
+                sb.root_ = root;
+                sb.point_count_ = point_count_;
+                sb.tree_height_ = root_node->height();
+                sb.range_estimator_head_ = range_estimator_.persist(
+                        node_allocator_ );
+                if( has_point_index_ ) {
+                    sb.has_point_index_ = 1;
+                    sb.point_index_head_ = point_index_.persist(
+                            node_allocator_ );
+                    sb.point_index_entry_count_ = point_index_.size();
+                }
+
+                // Writes back everything to disk along with the superblock
+                node_allocator_.write_superblock( sb );
             }
 
+		private:
+			// Runs one optimistic search, returning false if it has to
+			// start over
+			template <typename BranchTest, typename PointTest>
+			bool tryOptimisticSearch(BranchTest visitBranch, PointTest matchPoint, std::vector<Point> &matchingPoints);
+			void setRoot(tree_node_handle newRoot);
 	};
 
 #include "rstartreedisk.tcc"
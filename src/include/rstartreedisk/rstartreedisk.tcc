@@ -11,6 +11,35 @@ std::vector<Point> RStarTreeDisk<min_branch_factor,max_branch_factor>::exhaustiv
 template <int min_branch_factor, int max_branch_factor>
 std::vector<Point> RStarTreeDisk<min_branch_factor, max_branch_factor>::search( Point requestedPoint )
 {
+    if( optimistic_reads_ )
+    {
+        return optimisticSearch( requestedPoint );
+    }
+
+    if( has_point_index_ )
+    {
+        std::vector<Point> matchingPoints;
+        for( tree_node_handle leaf_handle : point_index_.leaves_for( requestedPoint ) )
+        {
+            auto leaf = get_node( leaf_handle );
+            assert( leaf->isLeafNode() );
+#ifdef STAT
+            stats.markLeafSearched();
+#endif
+            for( unsigned i = 0; i < leaf->cur_offset_; i++ ) {
+                const Point &p = std::get<Point>( leaf->entries.at(i) );
+                if( p == requestedPoint )
+                {
+                    matchingPoints.push_back( p );
+                }
+            }
+        }
+#ifdef STAT
+        stats.resetSearchTracker( false );
+#endif
+        return matchingPoints;
+    }
+
     auto  root_ptr = get_node( root );
     assert( !root_ptr->parent );
 
@@ -18,34 +47,216 @@ std::vector<Point> RStarTreeDisk<min_branch_factor, max_branch_factor>::search(
 }
 
 
+template <int min_branch_factor, int max_branch_factor>
+std::vector<std::vector<Point>> RStarTreeDisk<min_branch_factor,max_branch_factor>::batchSearch(
+        const std::vector<Point> &requestedPoints )
+{
+#ifdef STAT
+    // Statistics are gathered a search at a time
+    return Index::batchSearch( requestedPoints );
+#endif
+    if( has_point_index_ ) {
+        // Lookups go straight to their leaf, there is no descent to
+        // overlap
+        return Index::batchSearch( requestedPoints );
+    }
+
+    std::vector<std::vector<Point>> results( requestedPoints.size() );
+    std::vector<PointLookup<min_branch_factor,max_branch_factor>> lookups;
+    lookups.reserve( requestedPoints.size() );
+    for( unsigned i = 0; i < requestedPoints.size(); i++ ) {
+        lookups.emplace_back( this, root, requestedPoints[i], &results[i] );
+    }
+    runInterleaved( lookups );
+
+    return results;
+}
+
+template <int min_branch_factor, int max_branch_factor>
+task<std::vector<Point>> RStarTreeDisk<min_branch_factor,max_branch_factor>::searchAsync(
+        executor &ex, Point requestedPoint )
+{
+    using NodeType = Node<min_branch_factor,max_branch_factor>;
+
+    std::vector<Point> matchingPoints;
+    std::vector<tree_node_handle> context;
+    if( has_point_index_ ) {
+        context = point_index_.leaves_for( requestedPoint );
+    } else {
+        context.push_back( root );
+    }
+
+    while( !context.empty() ) {
+        tree_node_handle current_handle = context.back();
+        context.pop_back();
+        pinned_node_ptr<NodeType> curNode = co_await
+            node_allocator_.get_tree_node_async<NodeType>( ex,
+                    current_handle );
+
+        if( curNode->isLeafNode() ) {
+            for( unsigned i = 0; i < curNode->cur_offset_; i++ ) {
+                const Point &p = std::get<Point>( curNode->entries.at(i) );
+                if( p == requestedPoint ) {
+                    matchingPoints.push_back( p );
+                }
+            }
+            continue;
+        }
+        for( unsigned i = 0; i < curNode->cur_offset_; i++ ) {
+            const typename NodeType::Branch &b = std::get<typename
+                NodeType::Branch>( curNode->entries.at( i ) );
+            if( b.boundingBox.containsPoint( requestedPoint ) ) {
+                // Rule the leaf out before fetching it if we can
+                if( curNode->level == 1 and
+                        !leaf_filters_.may_contain( b.child,
+                            requestedPoint ) ) {
+                    continue;
+                }
+                context.push_back( b.child );
+            }
+        }
+    }
+
+    co_return matchingPoints;
+}
+
+template <int min_branch_factor, int max_branch_factor>
+task<std::vector<Point>> RStarTreeDisk<min_branch_factor,max_branch_factor>::searchAsync(
+        executor &ex, Rectangle requestedRectangle )
+{
+    using NodeType = Node<min_branch_factor,max_branch_factor>;
+
+    std::vector<Point> matchingPoints;
+    std::vector<tree_node_handle> context;
+    context.push_back( root );
+
+    while( !context.empty() ) {
+        tree_node_handle current_handle = context.back();
+        context.pop_back();
+        pinned_node_ptr<NodeType> curNode = co_await
+            node_allocator_.get_tree_node_async<NodeType>( ex,
+                    current_handle );
+
+        if( curNode->isLeafNode() ) {
+            for( unsigned i = 0; i < curNode->cur_offset_; i++ ) {
+                const Point &p = std::get<Point>( curNode->entries.at(i) );
+                if( requestedRectangle.containsPoint( p ) ) {
+                    matchingPoints.push_back( p );
+                }
+            }
+            continue;
+        }
+        for( unsigned i = 0; i < curNode->cur_offset_; i++ ) {
+            const typename NodeType::Branch &b = std::get<typename
+                NodeType::Branch>( curNode->entries.at( i ) );
+            if( b.boundingBox.intersectsRectangle( requestedRectangle ) ) {
+                context.push_back( b.child );
+            }
+        }
+    }
+
+    co_return matchingPoints;
+}
+
 template <int min_branch_factor, int max_branch_factor>
 std::vector<Point> RStarTreeDisk<min_branch_factor,max_branch_factor>::search( Rectangle
         requestedRectangle )
 {
+    if( optimistic_reads_ )
+    {
+        return optimisticSearch( requestedRectangle );
+    }
+
     auto root_ptr = get_node( root );
     assert( !root_ptr->parent );
     return root_ptr->search( requestedRectangle );
 }
 
+template <int min_branch_factor, int max_branch_factor>
+std::vector<Point> RStarTreeDisk<min_branch_factor,max_branch_factor>::pageOrderSearch( Rectangle
+        requestedRectangle )
+{
+    using NodeType = Node<min_branch_factor,max_branch_factor>;
+
+    std::vector<Point> matchingPoints;
+    std::vector<tree_node_handle> frontier = { root };
+    std::vector<tree_node_handle> nextFrontier;
+
+    while( !frontier.empty() )
+    {
+        node_allocator_.visit_in_page_order( frontier,
+                [&]( tree_node_handle node_handle ) {
+            auto node = get_node( node_handle );
+            if( node->isLeafNode() )
+            {
+#ifdef STAT
+                stats.markLeafSearched();
+#endif
+                for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+                    const Point &p = std::get<Point>( node->entries.at(i) );
+                    if( requestedRectangle.containsPoint( p ) )
+                    {
+                        matchingPoints.push_back( p );
+                    }
+                }
+            }
+            else
+            {
+#ifdef STAT
+                stats.markNonLeafNodeSearched();
+#endif
+                for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+                    const typename NodeType::Branch &b =
+                        std::get<typename NodeType::Branch>( node->entries.at(i) );
+                    if( b.boundingBox.intersectsRectangle( requestedRectangle ) )
+                    {
+                        nextFrontier.push_back( b.child );
+                    }
+                }
+            }
+        } );
+        frontier.swap( nextFrontier );
+        nextFrontier.clear();
+    }
+
+#ifdef STAT
+    stats.resetSearchTracker( true );
+#endif
+    return matchingPoints;
+}
+
 
 template <int min_branch_factor, int max_branch_factor>
 void RStarTreeDisk<min_branch_factor, max_branch_factor>::insert( Point givenPoint )
 {
+    write_section section( node_allocator_.buffer_pool_ );
     auto root_ptr = get_node( root );
     assert( !root_ptr->parent );
 
     std::fill( hasReinsertedOnLevel.begin(), hasReinsertedOnLevel.end(), false );
-    root = root_ptr->insert( givenPoint, hasReinsertedOnLevel );
+    setRoot( root_ptr->insert( givenPoint, hasReinsertedOnLevel ) );
+    point_count_++;
+    range_estimator_.note_insert( givenPoint );
 }
 
 
 template <int min_branch_factor, int max_branch_factor>
 void RStarTreeDisk<min_branch_factor, max_branch_factor>::remove( Point givenPoint )
 {
+    write_section section( node_allocator_.buffer_pool_ );
     std::fill( hasReinsertedOnLevel.begin(), hasReinsertedOnLevel.end(), false );
     auto root_ptr = get_node( root );
 
-    root = root_ptr->remove( givenPoint, hasReinsertedOnLevel );
+    tree_node_handle new_root = root_ptr->remove( givenPoint,
+            hasReinsertedOnLevel );
+    // Record not in the tree, so nothing to remove or count
+    if( not new_root ) {
+        return;
+    }
+
+    setRoot( new_root );
+    point_count_--;
+    range_estimator_.note_remove( givenPoint );
 
     // Get new root
     root_ptr = get_node( root );
@@ -53,6 +264,323 @@ void RStarTreeDisk<min_branch_factor, max_branch_factor>::remove( Point givenPoi
 }
 
 
+template <int min_branch_factor, int max_branch_factor>
+range_estimate RStarTreeDisk<min_branch_factor, max_branch_factor>::estimate( Rectangle requestedRectangle )
+{
+    return range_estimator_.estimate( requestedRectangle );
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+bool RStarTreeDisk<min_branch_factor, max_branch_factor>::extent( Rectangle &boundingBox, uint64_t &pointCount )
+{
+    pointCount = point_count_;
+    if( point_count_ > 0 )
+    {
+        boundingBox = get_node( root )->boundingBox();
+    }
+    return true;
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+void RStarTreeDisk<min_branch_factor, max_branch_factor>::buildRangeEstimator()
+{
+    range_estimator_.rebuild( root, [&]( tree_node_handle nodeHandle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( nodeHandle, branches, points );
+    } );
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+void RStarTreeDisk<min_branch_factor, max_branch_factor>::expandNode( tree_node_handle nodeHandle,
+        range_estimator::branch_list &branches, std::vector<Point> &points )
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor>;
+    using BranchType = typename NodeType::Branch;
+
+    auto node = get_node( nodeHandle );
+    for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+        if( node->isLeafNode() ) {
+            points.push_back( std::get<Point>( node->entries.at(i) ) );
+        } else {
+            const BranchType &b = std::get<BranchType>( node->entries.at(i) );
+            branches.push_back( std::make_pair( b.boundingBox, b.child ) );
+        }
+    }
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+unsigned RStarTreeDisk<min_branch_factor, max_branch_factor>::renderDensity( const std::string &directory,
+        unsigned maxZoom, unsigned threadCount )
+{
+    DensityRenderer renderer( root, point_count_, [&]( tree_node_handle nodeHandle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( nodeHandle, branches, points );
+    } );
+    return renderer.render( directory, maxZoom, 256, threadCount );
+}
+
+template <int min_branch_factor, int max_branch_factor>
+point_scan RStarTreeDisk<min_branch_factor, max_branch_factor>::scan()
+{
+    return point_scan( &node_allocator_, root, [this]( tree_node_handle nodeHandle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( nodeHandle, branches, points );
+    } );
+}
+
+template <int min_branch_factor, int max_branch_factor>
+uint64_t RStarTreeDisk<min_branch_factor, max_branch_factor>::exportPoints( const std::string &path )
+{
+    return scan().export_points( path );
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+void RStarTreeDisk<min_branch_factor, max_branch_factor>::setRoot( tree_node_handle newRoot )
+{
+    if( newRoot == root )
+    {
+        return;
+    }
+    root_version_.store( root_version_.load( std::memory_order_relaxed ) + 1,
+            std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    root = newRoot;
+    root_version_.store( root_version_.load( std::memory_order_relaxed ) + 1,
+            std::memory_order_release );
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+void RStarTreeDisk<min_branch_factor, max_branch_factor>::enableOptimisticReads()
+{
+    node_allocator_.buffer_pool_.enable_optimistic_reads();
+    optimistic_reads_ = true;
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+template <typename BranchTest, typename PointTest>
+bool RStarTreeDisk<min_branch_factor, max_branch_factor>::tryOptimisticSearch(
+        BranchTest visitBranch, PointTest matchPoint,
+        std::vector<Point> &matchingPoints )
+{
+    using NodeType = Node<min_branch_factor,max_branch_factor>;
+    using BranchType = typename NodeType::Branch;
+
+    // A node to visit, along with the version of the page holding the
+    // branch that led us to it
+    struct Visit
+    {
+        tree_node_handle handle;
+        size_t parentPage;
+        uint32_t parentVersion;
+    };
+
+    uint32_t rootVersion = root_version_.load( std::memory_order_acquire );
+    if( rootVersion & 1 )
+    {
+        return false;
+    }
+    tree_node_handle rootHandle = root;
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if( root_version_.load( std::memory_order_relaxed ) != rootVersion )
+    {
+        return false;
+    }
+
+    std::vector<Visit> context = { { rootHandle, 0, 0 } };
+    matchingPoints.clear();
+    while( !context.empty() )
+    {
+        Visit visit = context.back();
+        context.pop_back();
+
+        // Read in place, where a writer may be changing it under us
+        const NodeType *node;
+        uint32_t version;
+        buffer_pool::optimistic_status status;
+        while( (status = node_allocator_.read_tree_node_optimistic(
+                        visit.handle, node, version )) ==
+                buffer_pool::OPTIMISTIC_MISS )
+        {
+            node_allocator_.buffer_pool_.fault_in( visit.handle.get_page_id() );
+        }
+        if( status == buffer_pool::OPTIMISTIC_CONFLICT )
+        {
+            return false;
+        }
+
+        // Whatever led us here must still lead here for the copy to
+        // belong to the tree
+        bool stillLinked = visit.handle == rootHandle ?
+            root_version_.load( std::memory_order_acquire ) == rootVersion :
+            node_allocator_.buffer_pool_.validate_optimistic(
+                    visit.parentPage, visit.parentVersion );
+        unsigned entryCount = node->cur_offset_;
+        if( !stillLinked or entryCount > max_branch_factor + 1 )
+        {
+            return false;
+        }
+
+        // The version check below catches torn entries, but one holding
+        // the wrong alternative would throw before we got there
+        if( node->isLeafNode() )
+        {
+            for( unsigned i = 0; i < entryCount; i++ ) {
+                const Point *p = std::get_if<Point>( &node->entries[i] );
+                if( p == nullptr )
+                {
+                    return false;
+                }
+                if( matchPoint( *p ) )
+                {
+                    matchingPoints.push_back( *p );
+                }
+            }
+        }
+        else
+        {
+            for( unsigned i = 0; i < entryCount; i++ ) {
+                const BranchType *b = std::get_if<BranchType>( &node->entries[i] );
+                if( b == nullptr )
+                {
+                    return false;
+                }
+                if( visitBranch( b->boundingBox ) )
+                {
+                    context.push_back( { b->child, visit.handle.get_page_id(),
+                            version } );
+                }
+            }
+        }
+
+        // Nothing read from the node counts unless it held still
+        if( !node_allocator_.buffer_pool_.validate_optimistic(
+                    visit.handle.get_page_id(), version ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+std::vector<Point> RStarTreeDisk<min_branch_factor, max_branch_factor>::optimisticSearch( Point requestedPoint )
+{
+    std::vector<Point> matchingPoints;
+    auto visitBranch = [&]( const Rectangle &boundingBox ) {
+        return boundingBox.containsPoint( requestedPoint );
+    };
+    auto matchPoint = [&]( const Point &p ) {
+        return p == requestedPoint;
+    };
+    for( unsigned attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; attempt++ )
+    {
+        if( tryOptimisticSearch( visitBranch, matchPoint, matchingPoints ) )
+        {
+            return matchingPoints;
+        }
+        optimistic_restarts_.fetch_add( 1, std::memory_order_relaxed );
+        std::this_thread::yield();
+    }
+
+    // Writers keep getting in the way, so wait them out
+    std::lock_guard<std::mutex> guard( node_allocator_.buffer_pool_.get_latch() );
+    auto root_ptr = get_node( root );
+    return root_ptr->search( requestedPoint );
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+std::vector<Point> RStarTreeDisk<min_branch_factor, max_branch_factor>::optimisticSearch( Rectangle requestedRectangle )
+{
+    std::vector<Point> matchingPoints;
+    auto visitBranch = [&]( const Rectangle &boundingBox ) {
+        return boundingBox.intersectsRectangle( requestedRectangle );
+    };
+    auto matchPoint = [&]( const Point &p ) {
+        return requestedRectangle.containsPoint( p );
+    };
+    for( unsigned attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; attempt++ )
+    {
+        if( tryOptimisticSearch( visitBranch, matchPoint, matchingPoints ) )
+        {
+            return matchingPoints;
+        }
+        optimistic_restarts_.fetch_add( 1, std::memory_order_relaxed );
+        std::this_thread::yield();
+    }
+
+    std::lock_guard<std::mutex> guard( node_allocator_.buffer_pool_.get_latch() );
+    auto root_ptr = get_node( root );
+    return root_ptr->search( requestedRectangle );
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+void RStarTreeDisk<min_branch_factor, max_branch_factor>::buildPointIndex()
+{
+    using NodeType = Node<min_branch_factor,max_branch_factor>;
+
+    point_index_.clear();
+    std::stack<tree_node_handle> context;
+    context.push( root );
+    while( !context.empty() )
+    {
+        auto node = get_node( context.top() );
+        context.pop();
+        for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+            if( node->isLeafNode() )
+            {
+                point_index_.add( std::get<Point>( node->entries.at(i) ),
+                        node->self_handle_ );
+            }
+            else
+            {
+                context.push( std::get<typename NodeType::Branch>(
+                            node->entries.at(i) ).child );
+            }
+        }
+    }
+    has_point_index_ = true;
+}
+
+
+template <int min_branch_factor, int max_branch_factor>
+void RStarTreeDisk<min_branch_factor, max_branch_factor>::buildLeafFilters()
+{
+    using NodeType = Node<min_branch_factor,max_branch_factor>;
+
+    leaf_filters_.clear();
+    std::stack<tree_node_handle> context;
+    context.push( root );
+    while( !context.empty() )
+    {
+        auto node = get_node( context.top() );
+        context.pop();
+        if( node->isLeafNode() )
+        {
+            node->refreshLeafFilter();
+            continue;
+        }
+        for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+            context.push( std::get<typename NodeType::Branch>(
+                        node->entries.at(i) ).child );
+        }
+    }
+}
+
+
 template <int min_branch_factor, int max_branch_factor>
 unsigned RStarTreeDisk<min_branch_factor,max_branch_factor>::checksum()
 {
@@ -87,6 +615,5 @@ void RStarTreeDisk<min_branch_factor,max_branch_factor>::stat()
 template <int min_branch_factor, int max_branch_factor>
 void RStarTreeDisk<min_branch_factor,max_branch_factor>::visualize()
 {
-    BMPPrinter p(1000, 1000);
-    auto root_ptr = get_node( root );
+    renderDensity( "density", 6 );
 }
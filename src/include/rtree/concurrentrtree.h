@@ -0,0 +1,136 @@
+#ifndef __CONCURRENTRTREE__
+#define __CONCURRENTRTREE__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <util/geometry.h>
+#include <util/epochs.h>
+#include <index/index.h>
+
+namespace rtree
+{
+	// An in-memory R-Tree for hot indexes searched from many threads
+	// while they are being updated. Searches take no locks and never
+	// wait or start over, whatever the writers are doing.
+	//
+	// Nothing other threads can see is changed in place, except that a
+	// branch swaps one entry at a time through an atomic pointer. An
+	// entry pairs a child with its bounding box and is immutable too, so
+	// a search always sees a child along with a box covering it. A leaf
+	// is changed by copying it with the change made and swapping the
+	// copy into its parent's entry. A split copies the parent with both
+	// halves in place of the old child and swaps that in one level up,
+	// and so on up to wherever the split stops, so the whole split
+	// appears at once. Boxes grow before an insert publishes its point
+	// and shrink after a remove unpublishes one. Whatever gets replaced
+	// is retired through the EpochManager and freed once no search can
+	// still be looking at it.
+	//
+	// Writers under different children of the root hold only that
+	// child's latch and run in parallel. A change that would replace the
+	// root, because one of its children splits or empties, waits for
+	// every other writer to finish and then has the tree to itself.
+	//
+	// Nodes may underflow: removes drop nodes that empty but don't
+	// reinsert the entries of ones left underfull.
+	class ConcurrentRTree: public Index
+	{
+		public:
+			class Node;
+
+			class Entry
+			{
+				public:
+					Rectangle boundingBox;
+					Node *child;
+			};
+
+			class Node
+			{
+				public:
+					// A leaf holding data
+					explicit Node(std::vector<Point> &&data);
+					// A branch taking over entries
+					explicit Node(const std::vector<Entry *> &entries);
+
+					Rectangle boundingBox() const;
+
+					bool isLeaf;
+					std::vector<Point> data;
+					std::vector<std::atomic<Entry *>> entries;
+					// Held by the writers working under this node while it
+					// is a child of the root
+					std::mutex writeLatch;
+			};
+
+			std::atomic<Node *> root;
+
+			// Changes that had to wait for every other writer
+			std::atomic<uint64_t> exclusiveWrites;
+
+			// Constructors and destructors
+			ConcurrentRTree(unsigned minBranchFactor, unsigned maxBranchFactor);
+			~ConcurrentRTree();
+
+			// Datastructure interface
+			std::vector<Point> exhaustiveSearch(Point requestedPoint);
+			std::vector<Point> search(Point requestedPoint);
+			std::vector<Point> search(Rectangle requestedRectangle);
+			void insert(Point givenPoint);
+			void remove(Point givenPoint);
+
+			// Miscellaneous
+			unsigned checksum();
+			bool validate();
+			void stat();
+			void print();
+			void visualize();
+
+			// Frees whatever writers have retired that no search can still
+			// see, returning how many things were freed
+			size_t reclaim();
+
+		private:
+			// A branch on the way down and the entry taken out of it
+			class Step
+			{
+				public:
+					Node *node;
+					unsigned index;
+			};
+
+			Node *loadRoot();
+			unsigned chooseEntry(Node *node, const Point &givenPoint);
+			Node *chooseLeaf(Node *node, const Point &givenPoint, std::vector<Step> &path);
+			Node *findLeaf(Node *node, const Point &givenPoint, std::vector<Step> &path);
+			// Both return false, having changed nothing, if the change
+			// would replace the root and exclusive is not set
+			bool insertAlong(std::vector<Step> &path, Node *leaf, const Point &givenPoint, bool exclusive);
+			bool removeAlong(std::vector<Step> &path, Node *leaf, const Point &givenPoint, bool exclusive);
+			std::vector<Node *> splitLeaf(std::vector<Point> &points);
+			std::vector<Node *> splitBranch(std::vector<Entry *> &entries);
+			void quadraticSplit(const std::vector<Rectangle> &boxes, std::vector<unsigned> &groupA, std::vector<unsigned> &groupB);
+			void publishRoot(Node *newRoot);
+			void swapEntry(const Step &step, Entry *entry);
+			void retireEntry(Entry *entry);
+			void retireNode(Node *node);
+			void deleteSubtree(Node *node);
+			unsigned checksum(Node *node);
+			bool validate(Node *node, unsigned depth, int &leafDepth);
+
+			unsigned minBranchFactor;
+			unsigned maxBranchFactor;
+
+			// Taken shared by writers working under one child of the root
+			// and exclusively by writers replacing the root. Searches
+			// never touch it.
+			std::shared_mutex structureLatch;
+
+			EpochManager epochs;
+	};
+}
+
+#endif
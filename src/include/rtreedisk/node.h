@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <numeric>
+#include <type_traits>
 #include <vector>
 #include <stack>
 #include <map>
@@ -15,31 +19,50 @@
 
 namespace rtreedisk
 {
-    template <int min_branch_factor, int max_branch_factor>
+    // How an overflowing node picks which entries go to its new sibling
+    struct SplitStrategy {};
+
+    // Guttman's quadratic split
+    struct QuadraticSplit : SplitStrategy {};
+
+    // Guttman's linear split
+    struct LinearSplit : SplitStrategy {};
+
+    // Ang and Tan's linear split, which sends each entry towards the
+    // nearer side of the node along the most evenly split dimension
+    struct AngTanSplit : SplitStrategy {};
+
+    // Sorts the entries along each dimension and cuts wherever the two
+    // halves overlap least, then cover the least area
+    struct SweepSplit : SplitStrategy {};
+
+    template <int min_branch_factor, int max_branch_factor,
+             class split_strategy = QuadraticSplit>
     class RTreeDisk;
 
-    template <int min_branch_factor, int max_branch_factor>
+    template <int min_branch_factor, int max_branch_factor, class split_strategy>
     tree_node_allocator *get_node_allocator(
-        RTreeDisk<min_branch_factor, max_branch_factor> *treeRef)
+        RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef)
     {
         return &(treeRef->node_allocator_);
     }
 
-    template <int min_branch_factor, int max_branch_factor>
+    template <int min_branch_factor, int max_branch_factor, class split_strategy>
     float get_p_value(
-        RTreeDisk<min_branch_factor, max_branch_factor> *treeRef)
+        RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef)
     {
         return treeRef->p;
     }
 
-    template <int min_branch_factor, int max_branch_factor>
+    template <int min_branch_factor, int max_branch_factor, class split_strategy>
     tree_node_handle get_root_handle(
-        RTreeDisk<min_branch_factor, max_branch_factor> *treeRef)
+        RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef)
     {
         return treeRef->root;
     }
 
-    template <int min_branch_factor, int max_branch_factor>
+    template <int min_branch_factor, int max_branch_factor,
+             class split_strategy = QuadraticSplit>
     class Node
     {
         class ReinsertionEntry
@@ -51,9 +74,9 @@ namespace rtreedisk
             unsigned level;
         };
 
-        RTreeDisk<min_branch_factor, max_branch_factor> *treeRef;
-
     public:
+        RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef;
+
         class Branch
         {
             public:
@@ -66,7 +89,7 @@ namespace rtreedisk
                 Branch(const Branch &other) : boundingBox(other.boundingBox), child(other.child) {}
 
                 bool operator==(const
-                        Node<min_branch_factor,max_branch_factor>::Branch &o) const
+                        Node<min_branch_factor, max_branch_factor, split_strategy>::Branch &o) const
                 {
                     return child == o.child && boundingBox == o.boundingBox;
                 }
@@ -84,14 +107,19 @@ namespace rtreedisk
         }
 
         void addEntryToNode( const NodeEntry &entry ) {
+            holdForWrite();
             entries.at( cur_offset_++ ) = entry;
         }
 
         // Constructors and destructors
-        Node(RTreeDisk<min_branch_factor, max_branch_factor> *treeRef, tree_node_handle self_handle);
-        Node(RTreeDisk<min_branch_factor, max_branch_factor> *treeRef, tree_node_handle self_handle, tree_node_handle parent);
+        Node(RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef, tree_node_handle self_handle);
+        Node(RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef, tree_node_handle self_handle, tree_node_handle parent);
         void deleteSubtrees();
 
+        // Keeps optimistic readers out of this node's page until the
+        // insert or remove is done. Called before changing the node.
+        void holdForWrite();
+
         // Helper functions
         Rectangle boundingBox();
         void updateBoundingBox(tree_node_handle child, Rectangle updatedBoundingBox);
@@ -99,6 +127,8 @@ namespace rtreedisk
         void removeData(Point givenPoint);
         void removeChild(unsigned idx);
         void removeData(unsigned idx);
+        // Rebuilds this leaf's filter from its current entries
+        void refreshLeafFilter();
         tree_node_handle chooseLeaf(Point givenPoint);
         tree_node_handle chooseNode(ReinsertionEntry e);
         tree_node_handle findLeaf(Point givenPoint);
@@ -108,6 +138,10 @@ namespace rtreedisk
         void moveChildren(std::vector<tree_node_handle> &fromChildren, std::vector<Rectangle> &fromBoxes);
         tree_node_handle splitNode(tree_node_handle newChildHandle);
         tree_node_handle splitNode(Point newData);
+        // Picks the entries that move to the new sibling, for any
+        // split_strategy but QuadraticSplit
+        std::vector<bool> chooseSplit();
+        tree_node_handle splitEntries(const std::vector<bool> &toSibling);
         tree_node_handle adjustTree(tree_node_handle siblingLeaf);
         tree_node_handle condenseTree();
         tree_node_handle insert(ReinsertionEntry e);
@@ -117,6 +151,7 @@ namespace rtreedisk
         std::vector<Point> search(Point &requestedPoint);
         std::vector<Point> search(Rectangle &requestedRectangle);
         tree_node_handle insert(Point givenPoint);
+        // The new root, or nullptr if givenPoint is not in the tree
         tree_node_handle remove(Point givenPoint);
 
         // Miscellaneous
@@ -130,6 +165,25 @@ namespace rtreedisk
         void stat();
     };
 
+    // One point search of a batch, run a node at a time by
+    // runInterleaved. Children are pulled into cache as they are pushed
+    // so that they have usually arrived by the time they are popped.
+    template <int min_branch_factor, int max_branch_factor,
+             class split_strategy = QuadraticSplit>
+    class PointLookup
+    {
+    public:
+        RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef;
+        Point requestedPoint;
+        std::vector<Point> *accumulator;
+        std::vector<tree_node_handle> context;
+
+        PointLookup(RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef,
+                tree_node_handle root, const Point &requestedPoint,
+                std::vector<Point> *accumulator);
+        bool step();
+    };
+
     template <class NE, class B>
     NE createBranchEntry(const Rectangle
                 &boundingBox,
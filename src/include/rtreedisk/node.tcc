@@ -1,5 +1,5 @@
-template <int min_branch_factor, int max_branch_factor>
-Node<min_branch_factor, max_branch_factor>::Node(RTreeDisk<min_branch_factor, max_branch_factor> *treeRef, tree_node_handle self_handle)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+Node<min_branch_factor, max_branch_factor, split_strategy>::Node(RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef, tree_node_handle self_handle)
 {
     this->parent = tree_node_handle(nullptr);
     this->self_handle_ = self_handle;
@@ -7,8 +7,8 @@ Node<min_branch_factor, max_branch_factor>::Node(RTreeDisk<min_branch_factor, ma
     this->cur_offset_ = 0;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-Node<min_branch_factor, max_branch_factor>::Node(RTreeDisk<min_branch_factor, max_branch_factor> *treeRef, tree_node_handle self_handle, tree_node_handle parent)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+Node<min_branch_factor, max_branch_factor, split_strategy>::Node(RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef, tree_node_handle self_handle, tree_node_handle parent)
 {
     this->parent = parent;
     this->self_handle_ = self_handle;
@@ -16,11 +16,10 @@ Node<min_branch_factor, max_branch_factor>::Node(RTreeDisk<min_branch_factor, ma
     this->cur_offset_ = 0;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::deleteSubtrees()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::deleteSubtrees()
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
 
     if (isLeafNode()) {
         return;
@@ -34,13 +33,19 @@ void Node<min_branch_factor, max_branch_factor>::deleteSubtrees()
         assert(child_handle != nullptr);
 
         pinned_node_ptr<NodeType> child =
-            allocator->get_tree_node<NodeType>(child_handle);
+            treeRef->get_node(child_handle);
         child->deleteSubtrees();
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-Rectangle Node<min_branch_factor, max_branch_factor>::boundingBox()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::holdForWrite()
+{
+    get_node_allocator(treeRef)->hold_for_write(self_handle_);
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+Rectangle Node<min_branch_factor, max_branch_factor, split_strategy>::boundingBox()
 {
     Rectangle boundingBox;
 
@@ -68,17 +73,22 @@ Rectangle Node<min_branch_factor, max_branch_factor>::boundingBox()
     return boundingBox;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::updateBoundingBox(tree_node_handle child, Rectangle updatedBoundingBox)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::updateBoundingBox(tree_node_handle child, Rectangle updatedBoundingBox)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     using BranchType = NodeType::Branch;
     for (unsigned i = 0; i < cur_offset_; i++)
     {
         Branch &b = std::get<Branch>( entries.at(i) );
         if (b.child == child)
         {
-            entries[i] = createBranchEntry<NodeType::NodeEntry, BranchType>(updatedBoundingBox, b.child);
+            // Left alone if it still fits, so readers above can carry on
+            if (b.boundingBox != updatedBoundingBox)
+            {
+                holdForWrite();
+                entries[i] = createBranchEntry<NodeType::NodeEntry, BranchType>(updatedBoundingBox, b.child);
+            }
             return;
         }
     }
@@ -88,8 +98,8 @@ void Node<min_branch_factor, max_branch_factor>::updateBoundingBox(tree_node_han
 #endif
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::removeChild(tree_node_handle child)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::removeChild(tree_node_handle child)
 {
     for (unsigned i = 0; i < cur_offset_; i++)
     {
@@ -103,24 +113,26 @@ void Node<min_branch_factor, max_branch_factor>::removeChild(tree_node_handle ch
     assert(false);
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::removeChild(unsigned idx)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::removeChild(unsigned idx)
 {
     assert(!isLeafNode());
+    holdForWrite();
     entries[idx] = entries[cur_offset_ - 1];
     cur_offset_--;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::removeData(unsigned idx)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::removeData(unsigned idx)
 {
     assert(isLeafNode());
+    holdForWrite();
     entries[idx] = entries[cur_offset_ - 1];
     cur_offset_--;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::removeData(Point givenPoint)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::removeData(Point givenPoint)
 {
     for (unsigned i = 0; i < cur_offset_; ++i)
     {
@@ -133,11 +145,28 @@ void Node<min_branch_factor, max_branch_factor>::removeData(Point givenPoint)
     assert(false);
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::exhaustiveSearch(Point &requestedPoint, std::vector<Point> &accumulator)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::refreshLeafFilter()
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
+    assert(isLeafNode());
+    if (!treeRef->leaf_filters_.enabled())
+    {
+        return;
+    }
+
+    std::vector<Point> points;
+    points.reserve(cur_offset_);
+    for (unsigned i = 0; i < cur_offset_; ++i)
+    {
+        points.push_back(std::get<Point>( entries[i] ));
+    }
+    treeRef->leaf_filters_.rebuild(self_handle_, points);
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::exhaustiveSearch(Point &requestedPoint, std::vector<Point> &accumulator)
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
 
     if (isLeafNode())
     {
@@ -158,20 +187,19 @@ void Node<min_branch_factor, max_branch_factor>::exhaustiveSearch(Point &request
         {
             // Recurse
             tree_node_handle child_handle = std::get<Branch>( entries.at(i) ).child;
-            pinned_node_ptr<NodeType> child = allocator->get_tree_node<NodeType>(child_handle);
+            pinned_node_ptr<NodeType> child = treeRef->get_node(child_handle);
             child->exhaustiveSearch(requestedPoint, accumulator);
         }
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-std::vector<Point> Node<min_branch_factor, max_branch_factor>::search(Point &requestedPoint)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<Point> Node<min_branch_factor, max_branch_factor, split_strategy>::search(Point &requestedPoint)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     std::vector<Point> matchingPoints;
 
-    pinned_node_ptr<NodeType> self_node = allocator->get_tree_node<NodeType>(self_handle_);
+    pinned_node_ptr<NodeType> self_node = treeRef->get_node(self_handle_);
     std::stack<pinned_node_ptr<NodeType>> context;
     context.push(self_node);
 
@@ -200,10 +228,12 @@ std::vector<Point> Node<min_branch_factor, max_branch_factor>::search(Point &req
             for (unsigned i = 0; i < currentContext->cur_offset_; i++)
             {
                 Branch &b = std::get<Branch>(currentContext->entries[i]);
-                if (b.boundingBox.containsPoint(requestedPoint))
+                // Rule a leaf out before fetching it if we can
+                if (b.boundingBox.containsPoint(requestedPoint) and
+                        treeRef->leaf_filters_.may_contain(b.child, requestedPoint))
                 {
                     tree_node_handle child_handle = b.child;
-                    pinned_node_ptr<NodeType> child = allocator->get_tree_node<NodeType>(child_handle);
+                    pinned_node_ptr<NodeType> child = treeRef->get_node(child_handle);
                     context.push(child);
                 }
             }
@@ -220,13 +250,71 @@ std::vector<Point> Node<min_branch_factor, max_branch_factor>::search(Point &req
     return matchingPoints;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-std::vector<Point> Node<min_branch_factor, max_branch_factor>::search(Rectangle &requestedRectangle)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+PointLookup<min_branch_factor, max_branch_factor, split_strategy>::PointLookup(
+        RTreeDisk<min_branch_factor, max_branch_factor, split_strategy> *treeRef,
+        tree_node_handle root, const Point &requestedPoint,
+        std::vector<Point> *accumulator) :
+    treeRef(treeRef), requestedPoint(requestedPoint),
+    accumulator(accumulator)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
+    context.push_back(root);
+    get_node_allocator(treeRef)->prefetch_tree_node(root,
+            sizeof(Node<min_branch_factor, max_branch_factor, split_strategy>));
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+bool PointLookup<min_branch_factor, max_branch_factor, split_strategy>::step()
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+
+    if (context.empty())
+    {
+        return false;
+    }
+    tree_node_handle current_handle = context.back();
+    context.pop_back();
+
+    // Straight from the allocator, as get_node would write to the node
     tree_node_allocator *allocator = get_node_allocator(treeRef);
+    pinned_node_ptr<NodeType> currentContext =
+        allocator->get_tree_node<NodeType>(current_handle);
+
+    if (currentContext->isLeafNode())
+    {
+        for (unsigned i = 0; i < currentContext->cur_offset_; ++i)
+        {
+            Point &p = std::get<Point>(currentContext->entries[i]);
+            if (requestedPoint == p)
+            {
+                accumulator->push_back(p);
+            }
+        }
+    }
+    else
+    {
+        for (unsigned i = 0; i < currentContext->cur_offset_; i++)
+        {
+            typename NodeType::Branch &b = std::get<typename
+                NodeType::Branch>(currentContext->entries[i]);
+            if (b.boundingBox.containsPoint(requestedPoint) and
+                    treeRef->leaf_filters_.may_contain(b.child, requestedPoint))
+            {
+                context.push_back(b.child);
+                allocator->prefetch_tree_node(b.child, sizeof(NodeType));
+            }
+        }
+    }
+
+    return !context.empty();
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<Point> Node<min_branch_factor, max_branch_factor, split_strategy>::search(Rectangle &requestedRectangle)
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     pinned_node_ptr<NodeType> self_node =
-        allocator->get_tree_node<NodeType>(self_handle_);
+        treeRef->get_node(self_handle_);
     std::vector<Point> matchingPoints;
     std::stack<pinned_node_ptr<NodeType>> context;
     context.push(self_node);
@@ -263,9 +351,8 @@ std::vector<Point> Node<min_branch_factor, max_branch_factor>::search(Rectangle
                 if (b.boundingBox.intersectsRectangle(requestedRectangle))
                 {
                     tree_node_handle child_handle = b.child;
-                    tree_node_allocator *allocator = get_node_allocator(treeRef);
                     pinned_node_ptr<NodeType> child =
-                        allocator->get_tree_node<NodeType>(child_handle);
+                        treeRef->get_node(child_handle);
                     context.push(child);
                 }
             }
@@ -275,15 +362,18 @@ std::vector<Point> Node<min_branch_factor, max_branch_factor>::search(Rectangle
     return matchingPoints;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::chooseLeaf(Point givenPoint)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::chooseLeaf(Point givenPoint)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
-    pinned_node_ptr<NodeType> node = allocator->get_tree_node<NodeType>(self_handle_);
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    pinned_node_ptr<NodeType> node = treeRef->get_node(self_handle_);
+    tree_node_handle descended_from;
 
     while (true)
     {
+        // Lets the allocator place what we add by subtree
+        get_node_allocator(treeRef)->enter_subtree(node->self_handle_, descended_from);
+
         if (node->isLeafNode())
         {
             // Leaf
@@ -305,27 +395,31 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::chooseLeaf(Point gi
             }
 
             // CL4 [Descend until a leaf is reached]
+            descended_from = node->self_handle_;
             tree_node_handle node_handle = std::get<Branch>( node->entries[smallestExpansionIndex] ).child;
-            node = allocator->get_tree_node<NodeType>(node_handle);
+            node = treeRef->get_node(node_handle);
         }
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::chooseNode(ReinsertionEntry e)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::chooseNode(ReinsertionEntry e)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
-    pinned_node_ptr<NodeType> node = allocator->get_tree_node<NodeType>(self_handle_);
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    pinned_node_ptr<NodeType> node = treeRef->get_node(self_handle_);
+    tree_node_handle descended_from;
 
     while (true)
     {
+        // Lets the allocator place what we add by subtree
+        get_node_allocator(treeRef)->enter_subtree(node->self_handle_, descended_from);
+
         if (node->isLeafNode())
         {
             for (unsigned i = 0; i < e.level; ++i)
             {
                 tree_node_handle parent_handle = node->parent;
-                node = allocator->get_tree_node<NodeType>(parent_handle);
+                node = treeRef->get_node(parent_handle);
             }
 
             return node->self_handle_;
@@ -346,18 +440,18 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::chooseNode(Reinsert
             }
 
             // CL4 [Descend until a leaf is reached]
+            descended_from = node->self_handle_;
             tree_node_handle node_handle = std::get<Branch>( node->entries[smallestExpansionIndex] ).child;
-            node = allocator->get_tree_node<NodeType>(node_handle);
+            node = treeRef->get_node(node_handle);
         }
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::findLeaf(Point givenPoint)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::findLeaf(Point givenPoint)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
-    pinned_node_ptr<NodeType> node = allocator->get_tree_node<NodeType>(self_handle_);
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    pinned_node_ptr<NodeType> node = treeRef->get_node(self_handle_);
     std::stack<pinned_node_ptr<NodeType>> context;
     context.push(node);
 
@@ -383,10 +477,11 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::findLeaf(Point give
             for (unsigned i = 0; i < currentContext->cur_offset_; ++i)
             {
                 Branch &b = std::get<Branch>( currentContext->entries[i] );
-                if (b.boundingBox.containsPoint(givenPoint))
+                if (b.boundingBox.containsPoint(givenPoint) and
+                        treeRef->leaf_filters_.may_contain(b.child, givenPoint))
                 {
                     // Add the child to the nodes we will consider
-                    context.push(allocator->get_tree_node<NodeType>(b.child));
+                    context.push(treeRef->get_node(b.child));
                 }
             }
         }
@@ -394,17 +489,19 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::findLeaf(Point give
     return tree_node_handle(nullptr);
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::moveData(unsigned fromIndex, std::vector<Point> &toData)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::moveData(unsigned fromIndex, std::vector<Point> &toData)
 {
     toData.push_back(std::get<Point>( entries[fromIndex] ));
+    holdForWrite();
     entries[fromIndex] = entries[cur_offset_ - 1];
     cur_offset_--;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::moveData(std::vector<Point> &fromData)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::moveData(std::vector<Point> &fromData)
 {
+    holdForWrite();
     cur_offset_ = fromData.size();
     for (unsigned i = 0; i < cur_offset_; i++)
     {
@@ -412,12 +509,13 @@ void Node<min_branch_factor, max_branch_factor>::moveData(std::vector<Point> &fr
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::moveChildren(std::vector<tree_node_handle> &fromChildren, std::vector<Rectangle> &fromBoxes)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::moveChildren(std::vector<tree_node_handle> &fromChildren, std::vector<Rectangle> &fromBoxes)
 {
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     using BranchType = NodeType::Branch;
     assert(fromChildren.size() == fromBoxes.size());
+    holdForWrite();
     cur_offset_ = fromChildren.size();
     for (unsigned i = 0; i < cur_offset_; i++)
     {
@@ -428,27 +526,389 @@ void Node<min_branch_factor, max_branch_factor>::moveChildren(std::vector<tree_n
     fromBoxes.clear();
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::moveChild(unsigned fromIndex, std::vector<Rectangle> &toRectangles, std::vector<tree_node_handle> &toChildren)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::moveChild(unsigned fromIndex, std::vector<Rectangle> &toRectangles, std::vector<tree_node_handle> &toChildren)
 {
     Branch &b = std::get<Branch>( entries[fromIndex] );
     toRectangles.push_back(b.boundingBox);
     toChildren.push_back(b.child);
+    holdForWrite();
     entries[fromIndex] = entries[cur_offset_ - 1];
     cur_offset_--;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::splitNode(tree_node_handle newChildHandle)
+// Hands out the entries not yet in either group, in index order, to
+// whichever group's box grows least, unless one group needs all that
+// are left to reach minFill
+inline void distributeRemaining(const std::vector<Rectangle> &boxes, unsigned minFill, std::vector<bool> &assigned, std::vector<bool> &toSibling, Rectangle &boxA, Rectangle &boxB, unsigned countA, unsigned countB)
+{
+    unsigned remaining = std::count(assigned.begin(), assigned.end(), false);
+    for (unsigned i = 0; i < boxes.size(); ++i)
+    {
+        if (assigned[i])
+        {
+            continue;
+        }
+
+        bool toB;
+        if (countA + remaining == minFill)
+        {
+            toB = false;
+        }
+        else if (countB + remaining == minFill)
+        {
+            toB = true;
+        }
+        else
+        {
+            double growthA = boxA.computeExpansionArea(boxes[i]);
+            double growthB = boxB.computeExpansionArea(boxes[i]);
+            toB = growthB < growthA || (growthB == growthA && (boxB.area() < boxA.area() || (boxB.area() == boxA.area() && countB < countA)));
+        }
+
+        assigned[i] = true;
+        toSibling[i] = toB;
+        if (toB)
+        {
+            boxB.expand(boxes[i]);
+            ++countB;
+        }
+        else
+        {
+            boxA.expand(boxes[i]);
+            ++countA;
+        }
+        --remaining;
+    }
+}
+
+// Guttman's linear split. The seeds are the pair of entries furthest
+// apart along any one dimension, relative to the node's width there.
+inline std::vector<bool> linearSplit(const std::vector<Rectangle> &boxes, unsigned minFill)
+{
+    unsigned n = boxes.size();
+    unsigned seedA = 0;
+    unsigned seedB = 1;
+    double bestSeparation = -std::numeric_limits<double>::infinity();
+
+    // LPS1 [Find extreme rectangles along all dimensions]
+    for (unsigned d = 0; d < dimensions; ++d)
+    {
+        unsigned highestLow = 0;
+        unsigned lowestHigh = 0;
+        double lowest = boxes[0].lowerLeft[d];
+        double highest = boxes[0].upperRight[d];
+        for (unsigned i = 1; i < n; ++i)
+        {
+            if (boxes[i].lowerLeft[d] > boxes[highestLow].lowerLeft[d])
+            {
+                highestLow = i;
+            }
+            if (boxes[i].upperRight[d] < boxes[lowestHigh].upperRight[d])
+            {
+                lowestHigh = i;
+            }
+            lowest = std::min(lowest, boxes[i].lowerLeft[d]);
+            highest = std::max(highest, boxes[i].upperRight[d]);
+        }
+        if (highestLow == lowestHigh)
+        {
+            continue;
+        }
+
+        // LPS2 [Adjust for shape of the rectangle cluster]
+        double width = highest - lowest;
+        double separation = boxes[highestLow].lowerLeft[d] - boxes[lowestHigh].upperRight[d];
+        if (width > 0.0)
+        {
+            separation /= width;
+        }
+
+        // LPS3 [Select the most extreme pair]
+        if (separation > bestSeparation)
+        {
+            bestSeparation = separation;
+            seedA = lowestHigh;
+            seedB = highestLow;
+        }
+    }
+
+    std::vector<bool> assigned(n, false);
+    std::vector<bool> toSibling(n, false);
+    assigned[seedA] = assigned[seedB] = true;
+    toSibling[seedB] = true;
+    Rectangle boxA = boxes[seedA];
+    Rectangle boxB = boxes[seedB];
+    distributeRemaining(boxes, minFill, assigned, toSibling, boxA, boxB, 1, 1);
+    return toSibling;
+}
+
+// Ang and Tan's split. Along each dimension every entry goes to
+// whichever side of the node it is nearer; the dimension that splits
+// most evenly wins, ties going to the least overlap and then the least
+// total area. Entries nearest the cut top up a side short of minFill.
+inline std::vector<bool> angTanSplit(const std::vector<Rectangle> &boxes, unsigned minFill)
+{
+    unsigned n = boxes.size();
+    Rectangle bounds = boxes[0];
+    for (unsigned i = 1; i < n; ++i)
+    {
+        bounds.expand(boxes[i]);
+    }
+
+    unsigned bestDimension = 0;
+    unsigned bestLargerSide = n + 1;
+    double bestOverlap = 0.0;
+    double bestArea = 0.0;
+    for (unsigned d = 0; d < dimensions; ++d)
+    {
+        unsigned leftCount = 0;
+        Rectangle leftBox, rightBox;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            bool left = boxes[i].lowerLeft[d] - bounds.lowerLeft[d] < bounds.upperRight[d] - boxes[i].upperRight[d];
+            Rectangle &sideBox = left ? leftBox : rightBox;
+            unsigned sideCount = left ? leftCount : i - leftCount;
+            if (sideCount == 0)
+            {
+                sideBox = boxes[i];
+            }
+            else
+            {
+                sideBox.expand(boxes[i]);
+            }
+            leftCount += left;
+        }
+
+        unsigned largerSide = std::max(leftCount, n - leftCount);
+        double overlap = (leftCount == 0 || leftCount == n) ? 0.0 : leftBox.computeIntersectionArea(rightBox);
+        double area = (leftCount == 0 ? 0.0 : leftBox.area()) + (leftCount == n ? 0.0 : rightBox.area());
+        if (largerSide < bestLargerSide || (largerSide == bestLargerSide && (overlap < bestOverlap || (overlap == bestOverlap && area < bestArea))))
+        {
+            bestDimension = d;
+            bestLargerSide = largerSide;
+            bestOverlap = overlap;
+            bestArea = area;
+        }
+    }
+
+    unsigned d = bestDimension;
+    std::vector<bool> toSibling(n, false);
+    unsigned siblingCount = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        toSibling[i] = !(boxes[i].lowerLeft[d] - bounds.lowerLeft[d] < bounds.upperRight[d] - boxes[i].upperRight[d]);
+        siblingCount += toSibling[i];
+    }
+
+    // Top up a short side from the other side's entries nearest it
+    if (siblingCount < minFill || n - siblingCount < minFill)
+    {
+        bool shortSide = siblingCount < minFill;
+        std::vector<unsigned> candidates;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            if (toSibling[i] != shortSide)
+            {
+                candidates.push_back(i);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](unsigned a, unsigned b) {
+            double centerA = boxes[a].lowerLeft[d] + boxes[a].upperRight[d];
+            double centerB = boxes[b].lowerLeft[d] + boxes[b].upperRight[d];
+            return shortSide ? centerA > centerB : centerA < centerB;
+        });
+        unsigned shortCount = shortSide ? siblingCount : n - siblingCount;
+        for (unsigned j = 0; shortCount < minFill; ++j, ++shortCount)
+        {
+            toSibling[candidates[j]] = shortSide;
+        }
+    }
+
+    return toSibling;
+}
+
+// Sort-based split. For each dimension the entries are sorted by
+// center and every cut leaving minFill on both sides is scored, with
+// the prefix and suffix bounds laid out one dimension after another so
+// that scoring all the cuts is a handful of loops the compiler can
+// vectorize.
+inline std::vector<bool> sweepSplit(const std::vector<Rectangle> &boxes, unsigned minFill)
+{
+    unsigned n = boxes.size();
+    unsigned cuts = n - 2 * minFill + 1;
+    assert(n >= 2 * minFill);
+
+    std::vector<unsigned> order(n);
+    std::vector<unsigned> bestOrder;
+    unsigned bestCut = minFill;
+    double bestOverlap = std::numeric_limits<double>::infinity();
+    double bestArea = std::numeric_limits<double>::infinity();
+
+    // prefixLo[e * n + k] is the low side along e of the first k + 1
+    // entries, suffixLo[e * n + k] that of entries k onwards
+    std::vector<double> prefixLo(dimensions * n), prefixHi(dimensions * n);
+    std::vector<double> suffixLo(dimensions * n), suffixHi(dimensions * n);
+    std::vector<double> overlap(cuts), area(cuts), areaA(cuts), areaB(cuts);
+
+    for (unsigned d = 0; d < dimensions; ++d)
+    {
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+            return boxes[a].lowerLeft[d] + boxes[a].upperRight[d] < boxes[b].lowerLeft[d] + boxes[b].upperRight[d];
+        });
+
+        for (unsigned e = 0; e < dimensions; ++e)
+        {
+            double *pLo = &prefixLo[e * n];
+            double *pHi = &prefixHi[e * n];
+            double *sLo = &suffixLo[e * n];
+            double *sHi = &suffixHi[e * n];
+            pLo[0] = boxes[order[0]].lowerLeft[e];
+            pHi[0] = boxes[order[0]].upperRight[e];
+            for (unsigned k = 1; k < n; ++k)
+            {
+                pLo[k] = std::min(pLo[k - 1], boxes[order[k]].lowerLeft[e]);
+                pHi[k] = std::max(pHi[k - 1], boxes[order[k]].upperRight[e]);
+            }
+            sLo[n - 1] = boxes[order[n - 1]].lowerLeft[e];
+            sHi[n - 1] = boxes[order[n - 1]].upperRight[e];
+            for (unsigned k = n - 1; k > 0; --k)
+            {
+                sLo[k - 1] = std::min(sLo[k], boxes[order[k - 1]].lowerLeft[e]);
+                sHi[k - 1] = std::max(sHi[k], boxes[order[k - 1]].upperRight[e]);
+            }
+        }
+
+        // Cut c puts the first minFill + c entries in group A
+        std::fill(overlap.begin(), overlap.end(), 1.0);
+        std::fill(areaA.begin(), areaA.end(), 1.0);
+        std::fill(areaB.begin(), areaB.end(), 1.0);
+        for (unsigned e = 0; e < dimensions; ++e)
+        {
+            const double *aLo = &prefixLo[e * n + minFill - 1];
+            const double *aHi = &prefixHi[e * n + minFill - 1];
+            const double *bLo = &suffixLo[e * n + minFill];
+            const double *bHi = &suffixHi[e * n + minFill];
+            for (unsigned c = 0; c < cuts; ++c)
+            {
+                areaA[c] *= aHi[c] - aLo[c];
+                areaB[c] *= bHi[c] - bLo[c];
+                overlap[c] *= std::max(0.0, std::min(aHi[c], bHi[c]) - std::max(aLo[c], bLo[c]));
+            }
+        }
+        for (unsigned c = 0; c < cuts; ++c)
+        {
+            area[c] = areaA[c] + areaB[c];
+        }
+
+        for (unsigned c = 0; c < cuts; ++c)
+        {
+            if (overlap[c] < bestOverlap || (overlap[c] == bestOverlap && area[c] < bestArea))
+            {
+                bestOverlap = overlap[c];
+                bestArea = area[c];
+                bestCut = minFill + c;
+                bestOrder = order;
+            }
+        }
+    }
+
+    std::vector<bool> toSibling(n, false);
+    for (unsigned k = bestCut; k < n; ++k)
+    {
+        toSibling[bestOrder[k]] = true;
+    }
+    return toSibling;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<bool> Node<min_branch_factor, max_branch_factor, split_strategy>::chooseSplit()
+{
+    std::vector<Rectangle> boxes;
+    boxes.reserve(cur_offset_);
+    for (unsigned i = 0; i < cur_offset_; ++i)
+    {
+        if (isLeafNode())
+        {
+            Point &p = std::get<Point>( entries[i] );
+            boxes.emplace_back(p, p);
+        }
+        else
+        {
+            boxes.push_back(std::get<Branch>( entries[i] ).boundingBox);
+        }
+    }
+
+    if constexpr (std::is_same<split_strategy, LinearSplit>::value)
+    {
+        return linearSplit(boxes, min_branch_factor);
+    }
+    else if constexpr (std::is_same<split_strategy, AngTanSplit>::value)
+    {
+        return angTanSplit(boxes, min_branch_factor);
+    }
+    else
+    {
+        static_assert(std::is_same<split_strategy, SweepSplit>::value);
+        return sweepSplit(boxes, min_branch_factor);
+    }
+}
+
+// Moves the chosen entries into a new sibling, keeping the rest in
+// order
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::splitEntries(const std::vector<bool> &toSibling)
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    tree_node_allocator *allocator = get_node_allocator(treeRef);
+
+    auto alloc_data = allocator->create_new_tree_node<NodeType>();
+    tree_node_handle siblingHandle = alloc_data.second;
+    auto newSibling = alloc_data.first;
+    new (&(*newSibling)) NodeType(treeRef, siblingHandle, parent);
+
+    bool leaf = isLeafNode();
+    unsigned kept = 0;
+    holdForWrite();
+    for (unsigned i = 0; i < cur_offset_; ++i)
+    {
+        if (!toSibling[i])
+        {
+            entries[kept++] = entries[i];
+            continue;
+        }
+        if (!leaf)
+        {
+            pinned_node_ptr<NodeType> child = treeRef->get_node(std::get<Branch>( entries[i] ).child);
+            child->holdForWrite();
+            child->parent = siblingHandle;
+        }
+        newSibling->addEntryToNode(entries[i]);
+    }
+    cur_offset_ = kept;
+    assert(cur_offset_ >= min_branch_factor);
+    assert(newSibling->cur_offset_ >= min_branch_factor);
+
+    return siblingHandle;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::splitNode(tree_node_handle newChildHandle)
 {
     // Consider newChild when splitting
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     using BranchType = NodeType::Branch;
     tree_node_allocator *allocator = get_node_allocator(treeRef);
-    pinned_node_ptr<NodeType> newChild = allocator->get_tree_node<NodeType>(newChildHandle);
+    pinned_node_ptr<NodeType> newChild = treeRef->get_node(newChildHandle);
 
     addEntryToNode(createBranchEntry<NodeType::NodeEntry, BranchType>( newChild->boundingBox(), newChildHandle ));
+    newChild->holdForWrite();
     newChild->parent = self_handle_;
+    if constexpr (!std::is_same<split_strategy, QuadraticSplit>::value)
+    {
+        return splitEntries(chooseSplit());
+    }
     unsigned boundingBoxesSize = (isLeafNode()) ? 0 : cur_offset_;
 
     // Setup the two groups which will be the entries in the two new nodes
@@ -591,8 +1051,9 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::splitNode(tree_node
     }
     else
     {
-        // We really shouldn't be here so panic!
-        assert(false);
+        // Every entry was handed out before either group ran short,
+        // which happens when the entries split evenly
+        assert(cur_offset_ == 0);
     }
 
     // Create the new node and fill it
@@ -607,28 +1068,34 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::splitNode(tree_node
     for (unsigned i = 0; i < cur_offset_; i++)
     {
         Branch &b = std::get<Branch>( entries[i] );
-        assert(allocator->get_tree_node<NodeType>(b.child)->parent == self_handle_);
+        assert(treeRef->get_node(b.child)->parent == self_handle_);
     }
 #endif
     newSibling->moveChildren(groupBChildren, groupBBoundingBoxes);
     for (unsigned i = 0; i < newSibling->cur_offset_; i++)
     {
         Branch &b = std::get<Branch>( newSibling->entries[i] );
-        allocator->get_tree_node<NodeType>(b.child)->parent = newSiblingHandle;
+        pinned_node_ptr<NodeType> child = treeRef->get_node(b.child);
+        child->holdForWrite();
+        child->parent = newSiblingHandle;
     }
 
     // Return our newly minted sibling
     return newSiblingHandle;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::splitNode(Point newData)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::splitNode(Point newData)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     tree_node_allocator *allocator = get_node_allocator(treeRef);
     // Helper functions
     // Include the new point in our split consideration
     addEntryToNode(newData);
+    if constexpr (!std::is_same<split_strategy, QuadraticSplit>::value)
+    {
+        return splitEntries(chooseSplit());
+    }
     double dataSize = cur_offset_;
 
     // Compute the first entry in each group based on PS1 & PS2
@@ -764,8 +1231,9 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::splitNode(Point new
     }
     else
     {
-        // We really shouldn't be here so panic!
-        assert(false);
+        // Every entry was handed out before either group ran short,
+        // which happens when the entries split evenly
+        assert(cur_offset_ == 0);
     }
 
     // Create the new node and fill it
@@ -782,15 +1250,14 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::splitNode(Point new
     return newSibling->self_handle_;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::adjustTree(tree_node_handle siblingHandle)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::adjustTree(tree_node_handle siblingHandle)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     using BranchType = NodeType::Branch;
-    tree_node_allocator *allocator = get_node_allocator(treeRef); // Helper functions
 
     // AT1 [Initialize]
-    auto node = allocator->get_tree_node<NodeType>(self_handle_);
+    auto node = treeRef->get_node(self_handle_);
 
     while (true)
     {
@@ -803,17 +1270,18 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::adjustTree(tree_nod
         {
             // AT3 [Adjust covering rectangle in parent entry]
             tree_node_handle parent_handle = node->parent;
-            pinned_node_ptr<NodeType> parentNode = allocator->get_tree_node<NodeType>(parent_handle);
+            pinned_node_ptr<NodeType> parentNode = treeRef->get_node(parent_handle);
             parentNode->updateBoundingBox(node->self_handle_, node->boundingBox());
 
             // If we have a split then deal with it otherwise move up the tree
             if (siblingHandle != nullptr)
             {
-                pinned_node_ptr<NodeType> siblingNode = allocator->get_tree_node<NodeType>(siblingHandle);
+                pinned_node_ptr<NodeType> siblingNode = treeRef->get_node(siblingHandle);
                 // AT4 [Propagate the node split upwards]
                 if (!parentNode->isLeafNode() && parentNode->cur_offset_ < max_branch_factor)
                 {
                     parentNode->addEntryToNode(createBranchEntry<NodeType::NodeEntry, BranchType>( siblingNode->boundingBox(), siblingNode->self_handle_ ));
+                    siblingNode->holdForWrite();
                     siblingNode->parent = parentNode->self_handle_;
 
                     node = parentNode;
@@ -831,7 +1299,7 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::adjustTree(tree_nod
             {
                 // AT5 [Move up to next level]
                 tree_node_handle parent_handle = node->parent;
-                pinned_node_ptr<NodeType> parentNode = allocator->get_tree_node<NodeType>(parent_handle);
+                pinned_node_ptr<NodeType> parentNode = treeRef->get_node(parent_handle);
                 node = parentNode;
             }
         }
@@ -840,24 +1308,27 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::adjustTree(tree_nod
     return siblingHandle;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::insert(Point givenPoint)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::insert(Point givenPoint)
 {
     // I1 [Find position for new record]
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     using BranchType = NodeType::Branch;
     tree_node_allocator *allocator = get_node_allocator(treeRef); // Helper functions
-    pinned_node_ptr<NodeType> leaf = allocator->get_tree_node<NodeType>(chooseLeaf(givenPoint));
+    pinned_node_ptr<NodeType> leaf = treeRef->get_node(chooseLeaf(givenPoint));
     tree_node_handle siblingLeaf = tree_node_handle(nullptr);
 
     // I2 [Add record to leaf node]
     if (leaf->isLeafNode() && leaf->cur_offset_ < max_branch_factor)
     {
         leaf->addEntryToNode(givenPoint);
+        treeRef->leaf_filters_.add(leaf->self_handle_, givenPoint);
     }
     else
     {
         siblingLeaf = leaf->splitNode(givenPoint);
+        leaf->refreshLeafFilter();
+        treeRef->get_node(siblingLeaf)->refreshLeafFilter();
     }
 
     // I3 [Propogate changes upward]
@@ -866,16 +1337,18 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::insert(Point givenP
     // I4 [Grow tree taller]
     if (siblingNodeHandle != nullptr)
     {
-        auto siblingNode = allocator->get_tree_node<NodeType>(siblingNodeHandle);
+        auto siblingNode = treeRef->get_node(siblingNodeHandle);
 
         auto alloc_data = allocator->create_new_tree_node<NodeType>();
         tree_node_handle root_handle = alloc_data.second;
         auto newRoot = alloc_data.first;
         new (&(*newRoot)) NodeType(treeRef, root_handle);
 
+        holdForWrite();
         parent = root_handle;
         newRoot->addEntryToNode(createBranchEntry<NodeType::NodeEntry, BranchType>( this->boundingBox(), self_handle_ ));
 
+        siblingNode->holdForWrite();
         siblingNode->parent = newRoot->self_handle_;
         newRoot->addEntryToNode(createBranchEntry<NodeType::NodeEntry, BranchType>( siblingNode->boundingBox(), siblingNode->self_handle_ ));
 
@@ -888,10 +1361,10 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::insert(Point givenP
 }
 
 // Always called on root, this = root
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::insert(ReinsertionEntry e)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::insert(ReinsertionEntry e)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     using BranchType = NodeType::Branch;
     tree_node_allocator *allocator = get_node_allocator(treeRef);
 
@@ -904,12 +1377,14 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::insert(ReinsertionE
     // I1 [Find position for new record]
     tree_node_handle nodeHandle = chooseNode(e);
     tree_node_handle siblingNode = tree_node_handle(nullptr);
-    auto node = allocator->get_tree_node<NodeType>(nodeHandle);
+    auto node = treeRef->get_node(nodeHandle);
 
     // I2 [Add record to node]
     if (node->cur_offset_ < max_branch_factor)
     {
-        allocator->get_tree_node<NodeType>(e.child)->parent = nodeHandle;
+        pinned_node_ptr<NodeType> child = treeRef->get_node(e.child);
+        child->holdForWrite();
+        child->parent = nodeHandle;
         node->addEntryToNode(createBranchEntry<NodeType::NodeEntry, BranchType>(e.boundingBox, e.child));
     }
     else
@@ -928,11 +1403,13 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::insert(ReinsertionE
         auto newRoot = alloc_data.first;
         new (&(*newRoot)) NodeType(treeRef, root_handle);
 
+        holdForWrite();
         this->parent = root_handle;
 
         newRoot->addEntryToNode(createBranchEntry<NodeType::NodeEntry, BranchType>( boundingBox(), self_handle_ ));
 
-        auto siblingPtr = allocator->get_tree_node<NodeType>(siblingNode);
+        auto siblingPtr = treeRef->get_node(siblingNode);
+        siblingPtr->holdForWrite();
         siblingPtr->parent = newRoot->self_handle_;
 
         siblingPtr->addEntryToNode(createBranchEntry<NodeType::NodeEntry, BranchType>( siblingPtr->boundingBox(), siblingNode ));
@@ -946,15 +1423,13 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::insert(ReinsertionE
 }
 
 // To be called on a leaf
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::condenseTree()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::condenseTree()
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
 
     // CT1 [Initialize]
     tree_node_handle nodeHandle = self_handle_;
-    auto node = allocator->get_tree_node<NodeType>(nodeHandle);
+    auto node = treeRef->get_node(nodeHandle);
     unsigned level = 0;
 
     std::vector<ReinsertionEntry> Q;
@@ -964,7 +1439,7 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::condenseTree()
     {
         unsigned nodeBoundingBoxesSize = (node->isLeafNode()) ? 0 : node->cur_offset_;
         unsigned nodeDataSize = (node->isLeafNode()) ? node->cur_offset_ : 0;
-        auto parentNode = allocator->get_tree_node<NodeType>(node->parent);
+        auto parentNode = treeRef->get_node(node->parent);
         // CT3 & CT4 [Eliminate under-full node. & Adjust covering rectangle.]
         if (nodeBoundingBoxesSize >= min_branch_factor || nodeDataSize >= min_branch_factor)
         {
@@ -972,7 +1447,7 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::condenseTree()
 
             // CT5 [Move up one level in the tree]
             // Move up a level without deleting ourselves
-            node = allocator->get_tree_node<NodeType>(node->parent);
+            node = treeRef->get_node(node->parent);
             nodeHandle = node->self_handle_;
             level++;
         }
@@ -980,6 +1455,10 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::condenseTree()
         {
             // Remove ourselves from our parent
             parentNode->removeChild(nodeHandle);
+            if (node->isLeafNode())
+            {
+                treeRef->leaf_filters_.erase(nodeHandle);
+            }
 
             // Add a reinsertion entry for each data point or branch of this node
             for (unsigned i = 0; i < nodeDataSize; ++i)
@@ -1017,37 +1496,35 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::condenseTree()
     // CT6 [Re-insert oprhaned entries]
     for (unsigned i = 0; i < Q.size(); ++i)
     {
-        node = allocator->get_tree_node<NodeType>(node->insert(Q[i]));
+        node = treeRef->get_node(node->insert(Q[i]));
     }
 
     return node->self_handle_;
 }
 
 // Always called on root, this = root
-template <int min_branch_factor, int max_branch_factor>
-tree_node_handle Node<min_branch_factor, max_branch_factor>::remove(Point givenPoint)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+tree_node_handle Node<min_branch_factor, max_branch_factor, split_strategy>::remove(Point givenPoint)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
     // D1 [Find node containing record]
     tree_node_handle leafHandle = findLeaf(givenPoint);
-    auto leaf = allocator->get_tree_node<NodeType>(leafHandle);
-
     if (leafHandle == nullptr)
     {
         return tree_node_handle(nullptr);
     }
+    auto leaf = treeRef->get_node(leafHandle);
 
     // D2 [Delete record]
     leaf->removeData(givenPoint);
 
     // D3 [Propagate changes]
-    auto root = allocator->get_tree_node<NodeType>(leaf->condenseTree());
+    auto root = treeRef->get_node(leaf->condenseTree());
 
     // D4 [Shorten tree]
     if (!root->isLeafNode() && root->cur_offset_ == 1)
     {
-        auto firstChild = allocator->get_tree_node<NodeType>(std::get<Branch>( root->entries[0] ).child);
+        auto firstChild = treeRef->get_node(std::get<Branch>( root->entries[0] ).child);
+        firstChild->holdForWrite();
         firstChild->parent = tree_node_handle(nullptr);
         return std::get<Branch>( root->entries[0] ).child;
     }
@@ -1057,11 +1534,9 @@ tree_node_handle Node<min_branch_factor, max_branch_factor>::remove(Point givenP
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-bool Node<min_branch_factor, max_branch_factor>::validate(tree_node_handle expectedParent, unsigned index)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+bool Node<min_branch_factor, max_branch_factor, split_strategy>::validate(tree_node_handle expectedParent, unsigned index)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
 
     if ( parent != expectedParent || cur_offset_ > max_branch_factor )
     {
@@ -1074,15 +1549,15 @@ bool Node<min_branch_factor, max_branch_factor>::validate(tree_node_handle expec
 
     if (expectedParent != nullptr)
     {
-        auto parentNode = allocator->get_tree_node<NodeType>(parent);
+        auto parentNode = treeRef->get_node(parent);
         for (unsigned i = 0; i < cur_offset_ && isLeafNode(); i++)
         {
             Point &dataPoint = std::get<Point>( entries[i] );
 
-            Rectangle parentBox = std::get<Branch>( allocator->get_tree_node<NodeType>(parent)->entries[index] ).boundingBox;
+            Rectangle parentBox = std::get<Branch>( treeRef->get_node(parent)->entries[index] ).boundingBox;
             if (!parentBox.containsPoint(dataPoint))
             {
-                auto parentPtr = allocator->get_tree_node<NodeType>(parent);
+                auto parentPtr = treeRef->get_node(parent);
                 std::cout << parentBox << " fails to contain " << dataPoint << std::endl;
                 assert(parentBox.containsPoint(dataPoint));
             }
@@ -1092,15 +1567,15 @@ bool Node<min_branch_factor, max_branch_factor>::validate(tree_node_handle expec
     bool valid = true;
     if( !isLeafNode() ) {
         for (unsigned i = 0; i < cur_offset_; i++ ) {
-            valid = valid && allocator->get_tree_node<NodeType>(std::get<Branch>(entries[i]).child)->validate(this->self_handle_, i);
+            valid = valid && treeRef->get_node(std::get<Branch>(entries[i]).child)->validate(this->self_handle_, i);
         }
     }
 
     return valid;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::print(unsigned n)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::print(unsigned n)
 {
     std::string indendtation(n * 4, ' ');
     std::cout << indendtation << "Node " << this->self_handle_ << std::endl;
@@ -1127,8 +1602,8 @@ void Node<min_branch_factor, max_branch_factor>::print(unsigned n)
               << indendtation << "}" << std::endl;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::printErr(unsigned n)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::printErr(unsigned n)
 {
     std::string indendtation(n * 4, ' ');
     std::cerr << indendtation << "Node " << this->self_handle_ << std::endl;
@@ -1155,11 +1630,9 @@ void Node<min_branch_factor, max_branch_factor>::printErr(unsigned n)
               << indendtation << "}" << std::endl;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::printTreeErr(unsigned n)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::printTreeErr(unsigned n)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
     // Print this node first
     printErr(n);
 
@@ -1169,16 +1642,14 @@ void Node<min_branch_factor, max_branch_factor>::printTreeErr(unsigned n)
         for (unsigned i = 0; i < cur_offset_; ++i)
         {
             // Recurse
-            allocator->get_tree_node<NodeType>(std::get<Branch>( entries[i] ).child)->printTreeErr(n + 1);
+            treeRef->get_node(std::get<Branch>( entries[i] ).child)->printTreeErr(n + 1);
         }
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::printTree(unsigned n)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::printTree(unsigned n)
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
     // Print this node first
     print(n);
 
@@ -1188,16 +1659,14 @@ void Node<min_branch_factor, max_branch_factor>::printTree(unsigned n)
         for (unsigned i = 0; i < cur_offset_; ++i)
         {
             // Recurse
-            allocator->get_tree_node<NodeType>(std::get<Branch>( entries[i] ).child)->printTree(n + 1);
+            treeRef->get_node(std::get<Branch>( entries[i] ).child)->printTree(n + 1);
         }
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-unsigned Node<min_branch_factor, max_branch_factor>::checksum()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+unsigned Node<min_branch_factor, max_branch_factor, split_strategy>::checksum()
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
 
     unsigned sum = 0;
 
@@ -1216,41 +1685,38 @@ unsigned Node<min_branch_factor, max_branch_factor>::checksum()
         for (unsigned i = 0; i < cur_offset_; ++i)
         {
             // Recurse
-            sum += allocator->get_tree_node<NodeType>(std::get<Branch>( entries[i] ).child)->checksum();
+            sum += treeRef->get_node(std::get<Branch>( entries[i] ).child)->checksum();
         }
     }
 
     return sum;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-unsigned Node<min_branch_factor, max_branch_factor>::height()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+unsigned Node<min_branch_factor, max_branch_factor, split_strategy>::height()
 {
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
     unsigned ret = 0;
-    auto node = allocator->get_tree_node<NodeType>(self_handle_);
+    auto node = treeRef->get_node(self_handle_);
 
     while (true)
     {
         ret++;
-        if (isLeafNode())
+        if (node->isLeafNode())
         {
             return ret;
         }
         else
         {
-            node = allocator->get_tree_node<NodeType>(std::get<Branch>( node->entries[0] ).child);
+            node = treeRef->get_node(std::get<Branch>( node->entries[0] ).child);
         }
     }
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void Node<min_branch_factor, max_branch_factor>::stat()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void Node<min_branch_factor, max_branch_factor, split_strategy>::stat()
 {
 #ifdef STAT
-    using NodeType = Node<min_branch_factor, max_branch_factor>;
-    tree_node_allocator *allocator = get_node_allocator(treeRef);
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     size_t memoryFootprint = 0;
     unsigned long totalNodes = 1;
     unsigned long singularBranches = 0;
@@ -1269,7 +1735,7 @@ void Node<min_branch_factor, max_branch_factor>::stat()
 
     while (!context.empty())
     {
-        currentContext = allocator->get_tree_node<NodeType>(context.top());
+        currentContext = treeRef->get_node(context.top());
         context.pop();
 
         unsigned long childrenSize = (!currentContext->isLeafNode()) ? currentContext->cur_offset_ : 0;
@@ -1309,7 +1775,7 @@ void Node<min_branch_factor, max_branch_factor>::stat()
             // Determine which branches we need to follow
             for (unsigned i = 0; i < currentContext->cur_offset_ && !currentContext->isLeafNode(); ++i)
             {
-                auto child = allocator->get_tree_node<NodeType>(std::get<Branch>( currentContext->entries[i] ).child);
+                auto child = treeRef->get_node(std::get<Branch>( currentContext->entries[i] ).child);
                 if (child->cur_offset_ == 1)
                 {
                     singularBranches++;
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <stack>
 #include <iostream>
@@ -9,13 +12,17 @@
 #include <rtreedisk/node.h>
 #include <index/index.h>
 #include <util/bmpPrinter.h>
+#include <util/interleave.h>
 #include <storage/tree_node_allocator.h>
-#include <unistd.h>
-#include <fcntl.h>
+#include <storage/superblock.h>
+#include <storage/range_estimator.h>
+#include <storage/leaf_filter.h>
+#include <storage/point_scan.h>
+#include <util/densityRenderer.h>
 
 namespace rtreedisk
 {
-    template <int min_branch_factor, int max_branch_factor>
+    template <int min_branch_factor, int max_branch_factor, class split_strategy>
     class RTreeDisk : public Index
     {
     public:
@@ -23,14 +30,28 @@ namespace rtreedisk
         Statistics stats;
         tree_node_allocator node_allocator_;
         std::string backing_file_;
+        uint64_t point_count_;
+
+        // Lets point searches skip leaves that can't hold the point.
+        // Only leaves have filters, so a branch always passes.
+        leaf_filter_set leaf_filters_;
+
+        // See enableOptimisticReads()
+        bool optimistic_reads_;
+        // Odd while a writer is replacing root
+        std::atomic<uint32_t> root_version_;
+        // Searches that had to start over because of a writer
+        std::atomic<uint64_t> optimistic_restarts_;
+
+        // Backs estimate(), kept current by every insert and remove
+        range_estimator range_estimator_;
 
         // Constructors and destructors
-        RTreeDisk(size_t memory_budget, std::string backing_file);
+        RTreeDisk(buffer_budget memory_budget, std::string backing_file, page_encoding encoding = RAW_PAGES, unsigned filter_bits_per_entry = 0);
         //RTreeDisk(tree_node_handle root);
         ~RTreeDisk()
         {
-            pinned_node_ptr<Node<min_branch_factor, max_branch_factor>> root_ptr =
-                node_allocator_.get_tree_node<Node<min_branch_factor, max_branch_factor>>(root);
+            auto root_ptr = get_node( root );
             root_ptr->deleteSubtrees();
         };
 
@@ -38,8 +59,39 @@ namespace rtreedisk
         std::vector<Point> exhaustiveSearch(Point requestedPoint);
         std::vector<Point> search(Point requestedPoint);
         std::vector<Point> search(Rectangle requestedRectangle);
+        // Same results as search(Rectangle), but walks the tree a level
+        // at a time reading each level's nodes in page order
+        std::vector<Point> pageOrderSearch(Rectangle requestedRectangle);
+        // Interleaves the searches so that each one's node fetches
+        // overlap the others' work
+        std::vector<std::vector<Point>> batchSearch(const std::vector<Point> &requestedPoints);
+        task<std::vector<Point>> searchAsync(executor &ex, Point requestedPoint);
+        task<std::vector<Point>> searchAsync(executor &ex, Rectangle requestedRectangle);
         void insert(Point givenPoint);
         void remove(Point givenPoint);
+        range_estimate estimate(Rectangle requestedRectangle);
+        bool extent(Rectangle &boundingBox, uint64_t &pointCount) override;
+        // Starts estimate()'s summary over, reading every node
+        void buildRangeEstimator();
+        // Appends a node's branches or, for a leaf, its points
+        void expandNode(tree_node_handle nodeHandle, range_estimator::branch_list &branches, std::vector<Point> &points);
+        // Writes a density tile pyramid under directory, see
+        // DensityRenderer. Returns how many tiles were written.
+        unsigned renderDensity(const std::string &directory, unsigned maxZoom, unsigned threadCount = 0);
+        // Every live point, leaf by leaf in storage order, see point_scan
+        point_scan scan();
+        uint64_t exportPoints(const std::string &path) override;
+
+        // From here on search() may be called from any number of threads
+        // at once, alongside inserts and removes made one at a time,
+        // without pinning or latching anything. See the R*-tree disk
+        // tree's enableOptimisticReads().
+        void enableOptimisticReads();
+        std::vector<Point> optimisticSearch(Point requestedPoint);
+        std::vector<Point> optimisticSearch(Rectangle requestedRectangle);
+
+        // Filters are not persisted, so reopened trees rebuild them
+        void buildLeafFilters();
 
         // Miscellaneous
         unsigned checksum();
@@ -48,23 +100,34 @@ namespace rtreedisk
         void print();
         void visualize();
 
+        inline pinned_node_ptr<Node<min_branch_factor, max_branch_factor, split_strategy>> get_node( tree_node_handle node_handle ) {
+            auto ptr =
+                node_allocator_.get_tree_node<Node<min_branch_factor, max_branch_factor, split_strategy>>(
+                        node_handle );
+            ptr->treeRef = this;
+            return ptr;
+        }
+
         void write_metadata() override {
-            // Step 1:
-            // Writeback everything to disk
-            node_allocator_.buffer_pool_.writeback_all_pages();
+            write_section section( node_allocator_.buffer_pool_ );
+            superblock sb = superblock::describe( RTREE_DISK,
+                    min_branch_factor, max_branch_factor );
+            sb.root_ = root;
+            sb.point_count_ = point_count_;
+            sb.tree_height_ = get_node( root )->height();
+            sb.range_estimator_head_ = range_estimator_.persist(
+                    node_allocator_ );
 
-            // Step 2:
-            // Write metadata file
-            std::string meta_fname = backing_file_ + ".meta";
-            int fd = open( meta_fname.c_str(), O_WRONLY |
-                    O_TRUNC | O_CREAT, S_IRUSR | S_IWUSR );
-            assert( fd >= 0 );
-            // yes, yes, i should loop this whatever
-            int rc = write( fd, (char *) &root, sizeof(root) );
-            assert( rc == sizeof(root) );
-            close( fd );
+            // Writes back everything to disk along with the superblock
+            node_allocator_.write_superblock( sb );
         }
 
+    private:
+        // Runs one optimistic search, returning false if it has to start
+        // over
+        template <typename BranchTest, typename PointTest>
+        bool tryOptimisticSearch(BranchTest visitBranch, PointTest matchPoint, std::vector<Point> &matchingPoints);
+        void setRoot(tree_node_handle newRoot);
     };
 #include "rtreedisk.tcc"
 
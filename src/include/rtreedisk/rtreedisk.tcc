@@ -1,149 +1,564 @@
-template <int min_branch_factor, int max_branch_factor>
-RTreeDisk<min_branch_factor,max_branch_factor>::RTreeDisk(size_t memory_budget, std::string backing_file): node_allocator_(memory_budget, backing_file)
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::RTreeDisk(buffer_budget memory_budget, std::string backing_file, page_encoding encoding, unsigned filter_bits_per_entry): node_allocator_(memory_budget, backing_file, encoding), backing_file_(backing_file), point_count_(0),
+    leaf_filters_(filter_bits_per_entry, max_branch_factor),
+    optimistic_reads_(false), root_version_(0), optimistic_restarts_(0)
 {
     // Initialize buffer pool
     node_allocator_.initialize();
 
-    backing_file_ = backing_file_;
-
     /* We need to figure out if there was already data, and read
         * that into memory if we have it. */
-
-    size_t existing_page_count =
-        node_allocator_.buffer_pool_.get_preexisting_page_count();
-
-    // If this is a fresh tree, then make a fresh root
-    if (existing_page_count == 0)
+    superblock sb;
+    superblock expected = superblock::describe( RTREE_DISK,
+            min_branch_factor, max_branch_factor );
+    if (node_allocator_.load_superblock( expected, sb ))
     {
-        std::pair<pinned_node_ptr<Node<min_branch_factor, max_branch_factor>>, tree_node_handle> alloc =
-            node_allocator_.create_new_tree_node<Node<min_branch_factor, max_branch_factor>>();
-        root = alloc.second;
-        new (&(*(alloc.first))) Node<min_branch_factor, max_branch_factor>(this, root, tree_node_handle( nullptr ) /*nullptr*/);
+        root = sb.root_;
+        point_count_ = sb.point_count_;
+        range_estimator_.load( node_allocator_, sb.range_estimator_head_ );
+        if (leaf_filters_.enabled())
+        {
+            buildLeafFilters();
+        }
         return;
     }
 
-    std::string meta_file = backing_file_ + ".meta";
-    int fd = open( meta_file.c_str(), O_RDONLY );
-    assert( fd >= 0 );
-
-    int rc = read( fd, (char *) &root, sizeof( root ) );
-    assert( rc == sizeof( root ) );
+    // This is a fresh tree, so make a fresh root
+    node_allocator_.reserve_superblock();
+    std::pair<pinned_node_ptr<Node<min_branch_factor, max_branch_factor, split_strategy>>, tree_node_handle> alloc =
+        node_allocator_.create_new_tree_node<Node<min_branch_factor, max_branch_factor, split_strategy>>();
+    root = alloc.second;
+    new (&(*(alloc.first))) Node<min_branch_factor, max_branch_factor, split_strategy>(this, root, tree_node_handle( nullptr ) /*nullptr*/);
 }
 
-template <int min_branch_factor, int max_branch_factor>
-std::vector<Point> RTreeDisk<min_branch_factor,max_branch_factor>::exhaustiveSearch( Point requestedPoint )
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<Point> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::exhaustiveSearch( Point requestedPoint )
 {
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
     std::vector<Point> v;
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
     root_ptr->exhaustiveSearch( requestedPoint, v );
 
     return v;
 }
 
-template <int min_branch_factor, int max_branch_factor>
-std::vector<Point> RTreeDisk<min_branch_factor, max_branch_factor>::search( Point requestedPoint )
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<Point> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::search( Point requestedPoint )
 {
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+
+    if( optimistic_reads_ ) {
+        return optimisticSearch( requestedPoint );
+    }
 
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
     assert( !root_ptr->parent );
 
     return root_ptr->search( requestedPoint );
 }
 
 
-template <int min_branch_factor, int max_branch_factor>
-std::vector<Point> RTreeDisk<min_branch_factor,max_branch_factor>::search( Rectangle
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<std::vector<Point>> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::batchSearch(
+        const std::vector<Point> &requestedPoints )
+{
+#ifdef STAT
+    // Statistics are gathered a search at a time
+    return Index::batchSearch( requestedPoints );
+#endif
+    std::vector<std::vector<Point>> results( requestedPoints.size() );
+    std::vector<PointLookup<min_branch_factor, max_branch_factor, split_strategy>> lookups;
+    lookups.reserve( requestedPoints.size() );
+    for( unsigned i = 0; i < requestedPoints.size(); i++ ) {
+        lookups.emplace_back( this, root, requestedPoints[i], &results[i] );
+    }
+    runInterleaved( lookups );
+
+    return results;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+task<std::vector<Point>> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::searchAsync(
+        executor &ex, Point requestedPoint )
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+
+    std::vector<Point> matchingPoints;
+    std::vector<tree_node_handle> context;
+    context.push_back( root );
+
+    while( !context.empty() ) {
+        tree_node_handle current_handle = context.back();
+        context.pop_back();
+        pinned_node_ptr<NodeType> currentContext = co_await
+            node_allocator_.get_tree_node_async<NodeType>( ex,
+                    current_handle );
+
+        if( currentContext->isLeafNode() ) {
+            for( unsigned i = 0; i < currentContext->cur_offset_; i++ ) {
+                Point &p = std::get<Point>( currentContext->entries[i] );
+                if( requestedPoint == p ) {
+                    matchingPoints.push_back( p );
+                }
+            }
+            continue;
+        }
+        for( unsigned i = 0; i < currentContext->cur_offset_; i++ ) {
+            typename NodeType::Branch &b = std::get<typename
+                NodeType::Branch>( currentContext->entries[i] );
+            // Rule a leaf out before fetching it if we can
+            if( b.boundingBox.containsPoint( requestedPoint ) and
+                    leaf_filters_.may_contain( b.child, requestedPoint ) ) {
+                context.push_back( b.child );
+            }
+        }
+    }
+
+    co_return matchingPoints;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+task<std::vector<Point>> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::searchAsync(
+        executor &ex, Rectangle requestedRectangle )
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+
+    std::vector<Point> matchingPoints;
+    std::vector<tree_node_handle> context;
+    context.push_back( root );
+
+    while( !context.empty() ) {
+        tree_node_handle current_handle = context.back();
+        context.pop_back();
+        pinned_node_ptr<NodeType> currentContext = co_await
+            node_allocator_.get_tree_node_async<NodeType>( ex,
+                    current_handle );
+
+        if( currentContext->isLeafNode() ) {
+            for( unsigned i = 0; i < currentContext->cur_offset_; i++ ) {
+                Point &p = std::get<Point>( currentContext->entries[i] );
+                if( requestedRectangle.containsPoint( p ) ) {
+                    matchingPoints.push_back( p );
+                }
+            }
+            continue;
+        }
+        for( unsigned i = 0; i < currentContext->cur_offset_; i++ ) {
+            typename NodeType::Branch &b = std::get<typename
+                NodeType::Branch>( currentContext->entries[i] );
+            if( b.boundingBox.intersectsRectangle( requestedRectangle ) ) {
+                context.push_back( b.child );
+            }
+        }
+    }
+
+    co_return matchingPoints;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<Point> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::search( Rectangle
         requestedRectangle )
 {
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
 
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    if( optimistic_reads_ ) {
+        return optimisticSearch( requestedRectangle );
+    }
+
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
     assert( !root_ptr->parent );
     return root_ptr->search( requestedRectangle );
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void RTreeDisk<min_branch_factor, max_branch_factor>::insert( Point givenPoint )
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<Point> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::pageOrderSearch( Rectangle
+        requestedRectangle )
 {
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
 
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    std::vector<Point> matchingPoints;
+    std::vector<tree_node_handle> frontier = { root };
+    std::vector<tree_node_handle> nextFrontier;
+
+    while (!frontier.empty())
+    {
+        node_allocator_.visit_in_page_order( frontier,
+                [&]( tree_node_handle node_handle ) {
+            pinned_node_ptr<NodeType> node = get_node( node_handle );
+            if (node->isLeafNode())
+            {
+                for (unsigned i = 0; i < node->cur_offset_; i++)
+                {
+                    Point &p = std::get<Point>( node->entries.at(i) );
+                    if (requestedRectangle.containsPoint(p))
+                    {
+                        matchingPoints.push_back(p);
+                    }
+                }
+#ifdef STAT
+                stats.markLeafSearched();
+#endif
+            }
+            else
+            {
+#ifdef STAT
+                stats.markNonLeafNodeSearched();
+#endif
+                for (unsigned i = 0; i < node->cur_offset_; i++)
+                {
+                    typename NodeType::Branch &b =
+                        std::get<typename NodeType::Branch>( node->entries.at(i) );
+                    if (b.boundingBox.intersectsRectangle(requestedRectangle))
+                    {
+                        nextFrontier.push_back(b.child);
+                    }
+                }
+            }
+        } );
+        frontier.swap(nextFrontier);
+        nextFrontier.clear();
+    }
+
+    return matchingPoints;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::insert( Point givenPoint )
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    write_section section( node_allocator_.buffer_pool_ );
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
     assert( !root_ptr->parent );
 
-    root = root_ptr->insert( givenPoint );
+    setRoot( root_ptr->insert( givenPoint ) );
+    point_count_++;
+    range_estimator_.note_insert( givenPoint );
 }
 
-template <int min_branch_factor, int max_branch_factor>
-void RTreeDisk<min_branch_factor, max_branch_factor>::remove( Point givenPoint )
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::remove( Point givenPoint )
 {
 
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    write_section section( node_allocator_.buffer_pool_ );
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
+
+    tree_node_handle new_root = root_ptr->remove( givenPoint );
+    // Record not in the tree, so nothing to remove or count
+    if( not new_root ) {
+        return;
+    }
 
-    root = root_ptr->remove( givenPoint );
+    setRoot( new_root );
+    point_count_--;
+    range_estimator_.note_remove( givenPoint );
 
     // Get new root
-    root_ptr = node_allocator_.get_tree_node<NodeType>( root );
+    root_ptr = get_node( root );
     assert( !root_ptr->parent );
 }
 
-template <int min_branch_factor, int max_branch_factor>
-unsigned RTreeDisk<min_branch_factor,max_branch_factor>::checksum()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+range_estimate RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::estimate( Rectangle requestedRectangle )
 {
+    return range_estimator_.estimate( requestedRectangle );
+}
 
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+bool RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::extent( Rectangle &boundingBox, uint64_t &pointCount )
+{
+    pointCount = point_count_;
+    if( point_count_ > 0 )
+    {
+        boundingBox = get_node( root )->boundingBox();
+    }
+    return true;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::buildRangeEstimator()
+{
+    range_estimator_.rebuild( root, [&]( tree_node_handle nodeHandle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( nodeHandle, branches, points );
+    } );
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::expandNode( tree_node_handle nodeHandle,
+        range_estimator::branch_list &branches, std::vector<Point> &points )
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    using BranchType = typename NodeType::Branch;
+
+    pinned_node_ptr<NodeType> node = get_node( nodeHandle );
+    for (unsigned i = 0; i < node->cur_offset_; i++)
+    {
+        if (node->isLeafNode())
+        {
+            points.push_back( std::get<Point>( node->entries.at(i) ) );
+        }
+        else
+        {
+            const BranchType &b = std::get<BranchType>( node->entries.at(i) );
+            branches.push_back( std::make_pair( b.boundingBox, b.child ) );
+        }
+    }
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+unsigned RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::renderDensity( const std::string &directory,
+        unsigned maxZoom, unsigned threadCount )
+{
+    DensityRenderer renderer( root, point_count_, [&]( tree_node_handle nodeHandle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( nodeHandle, branches, points );
+    } );
+    return renderer.render( directory, maxZoom, 256, threadCount );
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+point_scan RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::scan()
+{
+    return point_scan( &node_allocator_, root, [this]( tree_node_handle nodeHandle,
+                range_estimator::branch_list &branches,
+                std::vector<Point> &points ) {
+        expandNode( nodeHandle, branches, points );
+    } );
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+uint64_t RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::exportPoints( const std::string &path )
+{
+    return scan().export_points( path );
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::setRoot( tree_node_handle newRoot )
+{
+    if( newRoot == root ) {
+        return;
+    }
+    root_version_.store( root_version_.load( std::memory_order_relaxed ) + 1,
+            std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    root = newRoot;
+    root_version_.store( root_version_.load( std::memory_order_relaxed ) + 1,
+            std::memory_order_release );
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::enableOptimisticReads()
+{
+    node_allocator_.buffer_pool_.enable_optimistic_reads();
+    optimistic_reads_ = true;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+template <typename BranchTest, typename PointTest>
+bool RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::tryOptimisticSearch(
+        BranchTest visitBranch, PointTest matchPoint,
+        std::vector<Point> &matchingPoints )
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    using BranchType = typename NodeType::Branch;
+
+    // A node to visit, along with the version of the page holding the
+    // branch that led us to it
+    struct Visit {
+        tree_node_handle handle;
+        size_t parentPage;
+        uint32_t parentVersion;
+    };
+
+    uint32_t rootVersion = root_version_.load( std::memory_order_acquire );
+    if( rootVersion & 1 ) {
+        return false;
+    }
+    tree_node_handle rootHandle = root;
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if( root_version_.load( std::memory_order_relaxed ) != rootVersion ) {
+        return false;
+    }
+
+    std::vector<Visit> context = { { rootHandle, 0, 0 } };
+    matchingPoints.clear();
+    while( !context.empty() ) {
+        Visit visit = context.back();
+        context.pop_back();
+
+        // Read in place, where a writer may be changing it under us
+        const NodeType *node;
+        uint32_t version;
+        buffer_pool::optimistic_status status;
+        while( (status = node_allocator_.read_tree_node_optimistic(
+                        visit.handle, node, version )) ==
+                buffer_pool::OPTIMISTIC_MISS ) {
+            node_allocator_.buffer_pool_.fault_in( visit.handle.get_page_id() );
+        }
+        if( status == buffer_pool::OPTIMISTIC_CONFLICT ) {
+            return false;
+        }
+
+        // Whatever led us here must still lead here for the copy to
+        // belong to the tree
+        bool stillLinked = visit.handle == rootHandle ?
+            root_version_.load( std::memory_order_acquire ) == rootVersion :
+            node_allocator_.buffer_pool_.validate_optimistic(
+                    visit.parentPage, visit.parentVersion );
+        unsigned entryCount = node->cur_offset_;
+        if( !stillLinked or entryCount > max_branch_factor + 1 ) {
+            return false;
+        }
+
+        // The version check below catches torn entries, but one holding
+        // the wrong alternative would throw before we got there
+        if( node->isLeafNode() ) {
+            for( unsigned i = 0; i < entryCount; i++ ) {
+                const Point *p = std::get_if<Point>( &node->entries[i] );
+                if( p == nullptr ) {
+                    return false;
+                }
+                if( matchPoint( *p ) ) {
+                    matchingPoints.push_back( *p );
+                }
+            }
+        } else {
+            for( unsigned i = 0; i < entryCount; i++ ) {
+                const BranchType *b = std::get_if<BranchType>( &node->entries[i] );
+                if( b == nullptr ) {
+                    return false;
+                }
+                if( visitBranch( b->boundingBox ) ) {
+                    context.push_back( { b->child, visit.handle.get_page_id(),
+                            version } );
+                }
+            }
+        }
+
+        // Nothing read from the node counts unless it held still
+        if( !node_allocator_.buffer_pool_.validate_optimistic(
+                    visit.handle.get_page_id(), version ) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<Point> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::optimisticSearch( Point requestedPoint )
+{
+    std::vector<Point> matchingPoints;
+    auto visitBranch = [&]( const Rectangle &boundingBox ) {
+        return boundingBox.containsPoint( requestedPoint );
+    };
+    auto matchPoint = [&]( const Point &p ) {
+        return p == requestedPoint;
+    };
+    for( unsigned attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; attempt++ ) {
+        if( tryOptimisticSearch( visitBranch, matchPoint, matchingPoints ) ) {
+            return matchingPoints;
+        }
+        optimistic_restarts_.fetch_add( 1, std::memory_order_relaxed );
+        std::this_thread::yield();
+    }
+
+    // Writers keep getting in the way, so wait them out
+    std::lock_guard<std::mutex> guard( node_allocator_.buffer_pool_.get_latch() );
+    auto root_ptr = get_node( root );
+    return root_ptr->search( requestedPoint );
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+std::vector<Point> RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::optimisticSearch( Rectangle requestedRectangle )
+{
+    std::vector<Point> matchingPoints;
+    auto visitBranch = [&]( const Rectangle &boundingBox ) {
+        return boundingBox.intersectsRectangle( requestedRectangle );
+    };
+    auto matchPoint = [&]( const Point &p ) {
+        return requestedRectangle.containsPoint( p );
+    };
+    for( unsigned attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; attempt++ ) {
+        if( tryOptimisticSearch( visitBranch, matchPoint, matchingPoints ) ) {
+            return matchingPoints;
+        }
+        optimistic_restarts_.fetch_add( 1, std::memory_order_relaxed );
+        std::this_thread::yield();
+    }
+
+    std::lock_guard<std::mutex> guard( node_allocator_.buffer_pool_.get_latch() );
+    auto root_ptr = get_node( root );
+    return root_ptr->search( requestedRectangle );
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::buildLeafFilters()
+{
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+
+    leaf_filters_.clear();
+    std::stack<tree_node_handle> context;
+    context.push( root );
+    while( !context.empty() ) {
+        pinned_node_ptr<NodeType> node = get_node( context.top() );
+        context.pop();
+        if( node->isLeafNode() ) {
+            node->refreshLeafFilter();
+            continue;
+        }
+        for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+            context.push( std::get<typename NodeType::Branch>(
+                        node->entries[i] ).child );
+        }
+    }
+}
+
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+unsigned RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::checksum()
+{
+
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
     return root_ptr->checksum();
 }
 
 
-template <int min_branch_factor, int max_branch_factor>
-void RTreeDisk<min_branch_factor,max_branch_factor>::print()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::print()
 {
 
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
     root_ptr->printTree();
 }
 
 
-template <int min_branch_factor, int max_branch_factor>
-bool RTreeDisk<min_branch_factor,max_branch_factor>::validate()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+bool RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::validate()
 {
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
     return root_ptr->validate( tree_node_handle( nullptr ), 0);
 }
 
 
-template <int min_branch_factor, int max_branch_factor>
-void RTreeDisk<min_branch_factor,max_branch_factor>::stat()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::stat()
 {
 
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    using NodeType = Node<min_branch_factor, max_branch_factor, split_strategy>;
+    pinned_node_ptr<NodeType> root_ptr = get_node( root );
     root_ptr->stat();
 }
 
 
-template <int min_branch_factor, int max_branch_factor>
-void RTreeDisk<min_branch_factor,max_branch_factor>::visualize()
+template <int min_branch_factor, int max_branch_factor, class split_strategy>
+void RTreeDisk<min_branch_factor, max_branch_factor, split_strategy>::visualize()
 {
-    using NodeType = Node<min_branch_factor,max_branch_factor>;
-
-    BMPPrinter p(1000, 1000);
-    pinned_node_ptr<NodeType> root_ptr =
-        node_allocator_.get_tree_node<NodeType>( root );
+    renderDensity( "density", 6 );
 }
 
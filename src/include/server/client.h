@@ -0,0 +1,42 @@
+#pragma once
+
+#include <server/protocol.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Blocking client for query_server. Not thread safe; give each thread
+// its own connection.
+class query_client {
+public:
+    // Throws std::runtime_error if the server can't be reached.
+    explicit query_client( const std::string &socket_path );
+    ~query_client();
+
+    query_client( const query_client & ) = delete;
+    query_client &operator=( const query_client & ) = delete;
+
+    void insert( const Point &p );
+    std::vector<Point> search( const Point &p );
+    std::vector<Point> search( const Rectangle &r );
+    std::vector<Point> nearest( const Point &p, uint32_t k );
+
+    // Sends every operation in one frame and returns one result per
+    // operation, in order.
+    std::vector<std::vector<Point>> batch( const std::vector<operation>
+            &ops );
+
+    // Pipelining: send() queues a request on the socket without waiting
+    // and returns its id, receive() waits for the next reply. Replies
+    // come back in the order requests were sent.
+    uint32_t send( const std::vector<operation> &ops );
+    std::vector<std::vector<Point>> receive( uint32_t &request_id );
+
+private:
+    void write_fully( const char *data, size_t len );
+    void read_fully( char *data, size_t len );
+
+    int fd_;
+    uint32_t next_request_id_;
+    std::vector<char> buffer_;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <util/geometry.h>
+#include <cstddef>
+#include <string>
+
+struct load_generator_config {
+    std::string socket_path_;
+    // One thread and one connection each
+    unsigned connections_;
+    unsigned requests_per_connection_;
+    // Operations per request frame
+    unsigned batch_size_;
+    // Requests a connection keeps in flight
+    unsigned pipeline_depth_;
+    unsigned seed_;
+
+    // Operation mix, the rest are point queries
+    double insert_fraction_;
+    double range_fraction_;
+    double knn_fraction_;
+    unsigned k_;
+
+    // Points and query rectangles are drawn from here. Range queries
+    // cover range_extent_ of each side.
+    Rectangle space_;
+    double range_extent_;
+
+    load_generator_config();
+};
+
+struct load_generator_report {
+    size_t requests_;
+    size_t operations_;
+    size_t points_returned_;
+    double seconds_;
+    double p50_latency_;
+    double p99_latency_;
+    double max_latency_;
+};
+
+// Drives a query_server with the configured mix and reports throughput
+// and per-request latency.
+load_generator_report run_load_generator( const load_generator_config
+        &config );
+
+void print_load_generator_report( const load_generator_report &report );
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <util/geometry.h>
+#include <globals/globals.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Wire format spoken between query_server and query_client over a Unix
+// domain socket. Both ends are on the same machine, so everything is
+// sent in host byte order with no attempt at portability.
+//
+// A request frame is a request_header followed by count_ operations.
+// Each operation is an operation_header followed by its coordinates:
+// one point (dimensions doubles) for inserts, point and kNN queries, or
+// lower left then upper right for range queries. A single request is
+// just a frame with one operation; batching is sending more than one.
+//
+// The reply is a response_header followed by one result per operation,
+// in order. Each result is a uint32_t point count followed by that many
+// points. Inserts always return zero points.
+
+// Frames larger than this are treated as garbage and the connection is
+// dropped.
+#define MAX_FRAME_SIZE (1u << 24)
+
+enum operation_code : uint16_t {
+    OP_INSERT = 1,
+    OP_POINT_QUERY = 2,
+    OP_RANGE_QUERY = 3,
+    OP_KNN_QUERY = 4
+};
+
+enum response_status : uint16_t {
+    STATUS_OK = 0,
+    STATUS_BAD_REQUEST = 1
+};
+
+struct request_header {
+    // Whole frame, header included
+    uint32_t frame_length_;
+    uint32_t request_id_;
+    uint32_t count_;
+    uint32_t padding_;
+};
+
+struct operation_header {
+    uint16_t opcode_;
+    uint16_t padding_;
+    // Neighbours wanted, kNN only
+    uint32_t k_;
+};
+
+struct response_header {
+    uint32_t frame_length_;
+    uint32_t request_id_;
+    uint32_t count_;
+    uint16_t status_;
+    uint16_t padding_;
+};
+
+static_assert( sizeof(request_header) == 16 );
+static_assert( sizeof(operation_header) == 8 );
+static_assert( sizeof(response_header) == 16 );
+
+struct operation {
+    operation_code opcode_;
+    uint32_t k_;
+    Point point_;
+    Rectangle rectangle_;
+
+    static operation insert( const Point &p );
+    static operation point_query( const Point &p );
+    static operation range_query( const Rectangle &r );
+    static operation knn_query( const Point &p, uint32_t k );
+
+    inline bool is_read() const { return opcode_ != OP_INSERT; }
+};
+
+// Appends one operation, header and coordinates, to a frame under
+// construction.
+void encode_operation( const operation &op, std::vector<char> &out );
+
+// Decodes the operations of a complete request frame. Returns false if
+// the frame is malformed.
+bool decode_request( const char *frame, size_t frame_length,
+        request_header &header, std::vector<operation> &ops );
+
+// Builds a complete request frame.
+void encode_request( uint32_t request_id, const std::vector<operation>
+        &ops, std::vector<char> &out );
+
+// Builds a complete response frame.
+void encode_response( uint32_t request_id, response_status status, const
+        std::vector<std::vector<Point>> &results, std::vector<char> &out );
+
+// Decodes a complete response frame. Returns false if the frame is
+// malformed.
+bool decode_response( const char *frame, size_t frame_length,
+        response_header &header, std::vector<std::vector<Point>> &results );
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <index/index.h>
+#include <server/protocol.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Exact k nearest neighbours of p, closest first, built on range
+// searches: grow a box around p until it holds k points, then search
+// once more out to the kth distance since points in the corners of the
+// box may not be the closest.
+std::vector<Point> nearest_neighbours( Index *index, const Point &p,
+        unsigned k );
+
+// A long-lived process front end for one index. A single thread runs an
+// epoll loop over a listening Unix domain socket and its connections.
+// Requests that arrive in the same pass of the loop, across every
+// connection, are executed as one batch before any replies go out.
+class query_server {
+public:
+    query_server( Index *index, std::string socket_path );
+    ~query_server();
+
+    // Binds the socket, replacing any stale socket file. Throws
+    // std::runtime_error if it can't.
+    void listen();
+
+    // Serves until stop() is called.
+    void run();
+
+    // Safe to call from another thread or a signal handler.
+    void stop();
+
+    inline size_t get_requests_served() { return requests_served_; }
+    inline size_t get_batches_executed() { return batches_executed_; }
+
+protected:
+    struct connection {
+        int fd_;
+        std::vector<char> in_;
+        std::vector<char> out_;
+        size_t out_offset_;
+        bool want_write_;
+    };
+
+    struct pending_request {
+        int fd_;
+        uint32_t request_id_;
+        std::vector<operation> ops_;
+        std::vector<std::vector<Point>> results_;
+    };
+
+    void accept_connections();
+    bool read_from( connection &conn );
+    bool flush( connection &conn );
+    void close_connection( int fd );
+    void execute_batch();
+    void execute_reads( std::vector<std::pair<pending_request *, size_t>>
+            &reads );
+
+    Index *index_;
+    std::string socket_path_;
+    int listen_fd_;
+    int epoll_fd_;
+    int wake_fds_[2];
+    std::unordered_map<int, std::unique_ptr<connection>> connections_;
+    std::vector<pending_request> pending_;
+
+    size_t requests_served_;
+    size_t batches_executed_;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <storage/buffer_pool.h>
+#include <storage/io_engine.h>
+#include <cassert>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Coroutine support for queries that wait on page reads instead of
+// blocking on them. A query is a task<T> that co_awaits its pages; an
+// executor runs any number of them on one thread, resuming each as its
+// reads come back from the executor's io_engine.
+//
+// Nothing here is thread safe: an index may only be used from the
+// executor's thread while queries on it are in flight.
+
+class executor;
+
+// A coroutine returning T. Tasks start suspended and run when awaited
+// by another task, or when handed to an executor.
+template <typename T>
+class task {
+public:
+    struct promise_type {
+        std::optional<T> value_;
+        std::exception_ptr exception_;
+        std::coroutine_handle<> continuation_;
+
+        task get_return_object() {
+            return task( std::coroutine_handle<promise_type>::from_promise(
+                        *this ) );
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // Goes straight on to whoever awaited us, if anyone did
+        struct final_awaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> handle ) noexcept {
+                std::coroutine_handle<> continuation =
+                    handle.promise().continuation_;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        final_awaiter final_suspend() noexcept { return {}; }
+
+        void return_value( T value ) { value_ = std::move( value ); }
+        void unhandled_exception() {
+            exception_ = std::current_exception();
+        }
+    };
+
+    task( task &&other ) : handle_( std::exchange( other.handle_, nullptr ) )
+    {}
+    task( const task & ) = delete;
+    task &operator=( task other ) {
+        std::swap( handle_, other.handle_ );
+        return *this;
+    }
+    ~task() {
+        if( handle_ ) {
+            handle_.destroy();
+        }
+    }
+
+    bool await_ready() { return handle_.done(); }
+    std::coroutine_handle<> await_suspend( std::coroutine_handle<>
+            awaiting ) {
+        handle_.promise().continuation_ = awaiting;
+        return handle_;
+    }
+    T await_resume() { return get_result(); }
+
+    inline bool is_done() { return handle_.done(); }
+
+protected:
+    friend class executor;
+
+    explicit task( std::coroutine_handle<promise_type> handle ) :
+        handle_( handle ) {}
+
+    T get_result() {
+        assert( handle_.done() );
+        if( handle_.promise().exception_ ) {
+            std::rethrow_exception( handle_.promise().exception_ );
+        }
+        return std::move( *handle_.promise().value_ );
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Runs tasks on the calling thread. Suspended tasks are resumed as the
+// reads they wait on complete, so a single thread can keep hundreds of
+// queries in flight.
+class executor {
+public:
+    explicit executor( unsigned io_workers = 4 );
+
+    inline io_engine &get_io_engine() { return engine_; }
+
+    // Resumes handle on the next round
+    void schedule( std::coroutine_handle<> handle );
+
+    // Calls retry on every round until it returns true. For work that
+    // has to wait for something else in flight to finish, like a frame
+    // to read into.
+    void defer( std::function<bool()> retry );
+
+    // Runs everything scheduled until nothing is left to run or wait
+    // for. Throws if the only work left can never make progress.
+    void run();
+
+    // The synchronous adapter: runs t, along with whatever else has
+    // been scheduled, and returns its result.
+    template <typename T>
+    T run_sync( task<T> t ) {
+        schedule( t.handle_ );
+        run();
+        return t.get_result();
+    }
+
+    // Runs every task concurrently, results in the same order
+    template <typename T>
+    std::vector<T> run_all( std::vector<task<T>> &tasks ) {
+        for( task<T> &t : tasks ) {
+            schedule( t.handle_ );
+        }
+        run();
+        std::vector<T> results;
+        results.reserve( tasks.size() );
+        for( task<T> &t : tasks ) {
+            results.push_back( t.get_result() );
+        }
+        return results;
+    }
+
+protected:
+    io_engine engine_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::deque<std::function<bool()>> deferred_;
+};
+
+// co_await page_fetch( ex, pool, page_id ) gives the page, pinned once
+// on the awaiting coroutine's behalf. Resident pages are handed over
+// without suspending.
+class page_fetch {
+public:
+    page_fetch( executor &ex, buffer_pool &pool, size_t page_id ) :
+        executor_( ex ), pool_( pool ), page_id_( page_id ),
+        page_( nullptr ) {}
+
+    bool await_ready();
+    void await_suspend( std::coroutine_handle<> awaiting );
+    inline page *await_resume() { return page_; }
+
+protected:
+    // Starts the fetch, or returns false if there is no frame to read
+    // into yet
+    bool start( std::coroutine_handle<> awaiting );
+
+    executor &executor_;
+    buffer_pool &pool_;
+    size_t page_id_;
+    page *page_;
+};
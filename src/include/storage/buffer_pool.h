@@ -1,21 +1,139 @@
 #pragma once
 
 #include <storage/page.h>
+#include <storage/io_engine.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+enum page_encoding {
+    // Page i lives at offset i * PAGE_SIZE in the backing file.
+    RAW_PAGES,
+    // Pages are XOR-compressed (see page_codec.h) and stored at variable
+    // offsets, found through a page map kept at the end of the backing
+    // file. Frames in memory always hold decoded pages.
+    COMPRESSED_PAGES
+};
+
+class shared_buffer_pool;
+
+// How many times an optimistic search starts over because of writers
+// before it gives up and searches under the latch instead
+#define OPTIMISTIC_READ_ATTEMPTS 8
+
+// Where a buffer_pool gets its frames from: either a budget of its own,
+// or a shared_buffer_pool along with the file's quotas in pages there.
+// Converts from a plain byte count, so anything taking a memory budget
+// can be handed a share of a shared pool instead.
+struct buffer_budget {
+    // A partition count of 0 means one per NUMA node
+    buffer_budget( size_t pool_size_bytes, unsigned partitions = 0 ) :
+        pool_size_bytes_( pool_size_bytes ), shared_( nullptr ),
+        min_pages_( 0 ), max_pages_( 0 ), partitions_( partitions ) {}
+
+    buffer_budget( shared_buffer_pool &shared, size_t min_pages = 0,
+            size_t max_pages = std::numeric_limits<size_t>::max() ) :
+        pool_size_bytes_( 0 ), shared_( &shared ), min_pages_( min_pages ),
+        max_pages_( max_pages ), partitions_( 1 ) {}
+
+    size_t pool_size_bytes_;
+    shared_buffer_pool *shared_;
+    size_t min_pages_;
+    size_t max_pages_;
+    unsigned partitions_;
+};
+
+// The frames of a private pool are split into partitions, one per NUMA
+// node by default, each allocated on its node. Every page belongs to a
+// partition and is read into one of that partition's frames, unless
+// they are all pinned, so that threads working on pages placed on
+// their own node stay in local memory. Machines without NUMA get a
+// single partition, which behaves exactly like one pool of frames.
 class buffer_pool {
 public:
-    buffer_pool( size_t pool_size_bytes, std::string backing_file_name );
+    // The encoding only applies to fresh backing files. Existing files
+    // are reopened in whatever encoding they were written in.
+    buffer_pool( buffer_budget budget, std::string backing_file_name,
+            page_encoding encoding = RAW_PAGES );
     ~buffer_pool();
     void initialize();
 
     page *get_page( size_t page_id );
     page *create_new_page();
 
+    // Reads every listed page that isn't already in memory, in page
+    // order, coalescing pages that sit next to each other on disk into
+    // a single read. Returns how many pages were read; this stops early
+    // if we run out of unpinned frames.
+    size_t prefetch_pages( std::vector<size_t> page_ids );
+
+    // Asks the CPU to pull bytes at offset into a page, and the page's
+    // header, into cache ahead of a get_page. Pages that aren't in
+    // memory are left alone: this never reads from disk.
+    void prefetch_resident( size_t page_id, size_t offset, size_t bytes );
+
+    // Asynchronous reads, for the coroutine API in storage/async.h.
+    // get_resident_page returns the page if it is in memory and nullptr
+    // otherwise, without reading anything. read_page_async starts
+    // reading the page through engine, or joins the read already under
+    // way, and calls on_ready with the page from engine.reap() once it
+    // is in. The page is pinned once for each caller, who must unpin
+    // it. Returns false, and never calls on_ready, if every frame is
+    // pinned.
+    page *get_resident_page( size_t page_id );
+    bool read_page_async( size_t page_id, io_engine &engine,
+            std::function<void( page * )> on_ready );
+
+    // Optimistic reads, for trees searched from many threads at once.
+    // Once enabled, readers look at pages through read_optimistic()
+    // without pinning anything or taking a latch, while one writer at a
+    // time changes pages inside a write_section. Every page has a
+    // version that is odd while a writer holds the page and moves on
+    // whenever the page changes or leaves memory, so a reader that sees
+    // the same even version before and after looking knows what it saw
+    // was consistent. Anything else done to the pool, including reading
+    // in pages readers miss with fault_in(), happens under the pool's
+    // latch. Private pools only.
+    enum optimistic_status {
+        OPTIMISTIC_OK,
+        // A writer got in the way, start over
+        OPTIMISTIC_CONFLICT,
+        // Not in memory, fault_in() the page and try again
+        OPTIMISTIC_MISS
+    };
+    void enable_optimistic_reads();
+    inline bool has_optimistic_reads() {
+        return resident_chunks_ != nullptr;
+    }
+    // On OPTIMISTIC_OK, data is the page's data. It may change under
+    // the reader at any moment, or belong to another page altogether,
+    // so nothing read through it can be trusted until
+    // validate_optimistic() says the page is still at version.
+    optimistic_status read_optimistic( size_t page_id, const char *&data,
+            uint32_t &version );
+    // Whether page_id is still at the version a read returned
+    bool validate_optimistic( size_t page_id, uint32_t version );
+    void fault_in( size_t page_id );
+    inline std::mutex &get_latch() { return latch_; }
+    // Between these, every page create_new_page() hands out is held
+    // against readers, and so is every page passed to hold_for_write().
+    // Called with the latch held, see write_section.
+    void begin_writes();
+    void end_writes();
+    // A writer calls this before changing a page readers may be looking
+    // at. Pages it only reads stay open to readers, so a search in a
+    // part of the tree an insert leaves alone carries on undisturbed.
+    // Does nothing outside a write_section.
+    void hold_for_write( size_t page_id );
+
     void writeback_page( size_t page_id );
     void pin_page( page *page_ptr );
     void unpin_page( page *page_ptr );
@@ -35,22 +153,169 @@ public:
         return existing_page_count_;
     }
 
+    inline page_encoding get_page_encoding() { return encoding_; }
+
+    // Decides which partition each page belongs to. The tree node
+    // allocator places pages by the subtree they hold, see
+    // tree_node_allocator::enter_subtree(). Pages the placement returns
+    // nothing for, and every page without one, go round the partitions
+    // in runs of consecutive pages, which keeps nodes created together
+    // (such as both halves of a split) in the same partition.
+    void set_page_placement( std::function<std::optional<size_t>(size_t
+                page_id)> placement );
+    size_t partition_for( size_t page_id );
+
+    inline size_t get_partition_count() { return partitions_.size(); }
+    inline unsigned get_partition_node( size_t partition ) {
+        return partitions_.at( partition ).node_;
+    }
+    // Lookups that found their page in one of the partition's frames
+    // and that read it into one
+    inline size_t get_partition_hits( size_t partition ) {
+        return partitions_.at( partition ).hits_;
+    }
+    inline size_t get_partition_misses( size_t partition ) {
+        return partitions_.at( partition ).misses_;
+    }
+    // Of the partition's hits, those from a thread on its node
+    inline size_t get_partition_local_hits( size_t partition ) {
+        return partitions_.at( partition ).local_hits_;
+    }
+    // Lookups made from a thread on a different node than the frame
+    // holding the page. Only counted with more than one partition.
+    inline size_t get_remote_accesses() { return remote_accesses_; }
+
+    inline bool is_shared() { return shared_ != nullptr; }
+    // Which file of the shared pool this is, see
+    // shared_buffer_pool::get_resident_page_count()
+    inline unsigned get_shared_file_id() { return shared_file_id_; }
+
+    // I/O accounting since the pool was created
+    inline size_t get_pages_read() { return pages_read_; }
+    inline size_t get_bytes_read() { return bytes_read_; }
+    inline size_t get_bytes_written() { return bytes_written_; }
+    inline size_t get_read_calls() { return read_calls_; }
+    size_t get_backing_file_size();
+
 protected:
-    page *obtain_clean_page();
-    void evict( std::unique_ptr<page> &page );
+    // Where a compressed page lives in the backing file. A length of 0
+    // means the page was never written and is all zeroes, a length of
+    // PAGE_SIZE means it did not compress and is stored raw.
+    struct page_extent {
+        uint64_t offset_;
+        uint32_t length_;
+        uint32_t capacity_;
+    };
+
+    // The frame stays pinned and out of the page index until the read
+    // completes. Workers read into buffer_ rather than the frame so
+    // that the clock can look at the frame's header meanwhile.
+    struct pending_read {
+        page *frame_;
+        io_engine *engine_;
+        io_request request_;
+        std::unique_ptr<char[]> buffer_;
+        std::vector<std::function<void( page * )>> waiters_;
+    };
+
+    // What optimistic readers know about a page: its frame while it is
+    // in memory and nullptr otherwise, and its version.
+    struct resident_slot {
+        std::atomic<page *> frame_;
+        std::atomic<uint32_t> version_;
+    };
+
+    struct frame_partition {
+        unsigned node_;
+        size_t capacity_;
+        // capacity_ frames on node_, of which the first frames_in_use_
+        // have been handed out
+        page *frames_;
+        size_t frames_in_use_;
+        size_t clock_hand_pos_;
+        size_t hits_;
+        size_t local_hits_;
+        size_t misses_;
+    };
+
+    friend class shared_buffer_pool;
+
+    // A frame for page_id, from its own partition if possible
+    page *obtain_clean_page( size_t page_id );
+    page *obtain_partition_frame( frame_partition &partition );
+    void count_access( page *page_ptr, bool hit );
+    // Writes back the page in a frame that is being reused
+    void evict_frame( page *page_ptr );
     void writeback_page( page *page_ptr );
+    void read_page_from_disk( size_t page_id, page *page_ptr );
+    void complete_read( size_t page_id );
+    // Puts a page that has just been read or created into the index
+    void index_page( size_t page_id, page *page_ptr );
+    resident_slot *find_slot( size_t page_id, bool create );
+    // Makes a slot's version odd, returning false if it already was
+    bool lock_slot( resident_slot &slot );
+    void unlock_slot( resident_slot &slot );
+    // Holds page_id against readers until end_writes()
+    void hold_page( size_t page_id );
+    // Reaps until no read of page_id is in flight
+    void wait_for_read( size_t page_id );
+    bool are_adjacent_on_disk( size_t first_page_id, size_t
+            second_page_id );
+    size_t read_page_run( const size_t *page_ids, size_t count );
+    bool load_page_map();
+    void write_page_map();
 
+    // For a shared pool, the most frames this file may get there
     size_t max_mem_pages_;
     size_t existing_page_count_;
-    std::list<std::unique_ptr<page>> freelist_;
-    std::vector<std::unique_ptr<page>> allocated_pages_;
+    std::vector<frame_partition> partitions_;
+    std::function<std::optional<size_t>(size_t)> page_placement_;
+    size_t remote_accesses_;
     std::string backing_file_name_;
 
-    // These pointers come from the allocated_pages_ vector unique_ptrs.
-    // I can't use references to those unique_ptrs because if the vector
-    // gets resized then my references are dangling.
+    // These pointers point into the partitions' frames, which never
+    // move.
     std::unordered_map<size_t, page *> page_index_;
-    size_t clock_hand_pos_;
+    std::unordered_map<size_t, std::unique_ptr<pending_read>>
+        pending_reads_;
     int backing_file_fd_;
     size_t highest_allocated_page_id_;
+
+    // Slots by page id, in chunks that are allocated as pages first go
+    // into memory and not freed until the pool is, so that readers can
+    // look them up without the latch. Null until optimistic reads are
+    // enabled.
+    std::unique_ptr<std::atomic<resident_slot *>[]> resident_chunks_;
+    std::mutex latch_;
+    bool writing_;
+    // Pages the current writer holds
+    std::vector<size_t> held_pages_;
+
+    page_encoding encoding_;
+    std::vector<page_extent> page_map_;
+    uint64_t append_offset_;
+
+    // Null unless frames come from a shared_buffer_pool, in which case
+    // there are no partitions
+    shared_buffer_pool *shared_;
+    unsigned shared_file_id_;
+
+    size_t pages_read_;
+    size_t bytes_read_;
+    size_t bytes_written_;
+    size_t read_calls_;
+};
+
+// Held around every change to the pages of a pool with optimistic
+// readers, which it keeps out of the pages it changes until it goes.
+// Writers are serialized by the pool's latch. Does nothing for pools
+// without optimistic reads.
+class write_section {
+public:
+    explicit write_section( buffer_pool &pool );
+    ~write_section();
+
+protected:
+    buffer_pool &pool_;
+    bool active_;
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+// A read handed to an io_engine. The buffer must stay put until the
+// request completes.
+struct io_request {
+    int fd_;
+    char *buffer_;
+    size_t length_;
+    off_t offset_;
+
+    // Bytes read, or -1 with errno_ set
+    ssize_t result_;
+    int errno_;
+
+    // Called from reap(), on the thread that reaps
+    std::function<void( io_request * )> on_complete_;
+};
+
+// Completes reads in the background so that a single thread can keep
+// many of them in flight. Reads are issued with pread by a few worker
+// threads and come back through a completion queue, which the owning
+// thread drains with reap(). Only the workers touch the file; all the
+// completion callbacks run on the reaping thread, so whatever they
+// update needs no locking of its own.
+class io_engine {
+public:
+    explicit io_engine( unsigned worker_count = 4 );
+    ~io_engine();
+
+    void submit( io_request *request );
+
+    // Runs the callback of every read that has completed. With block
+    // set, waits for at least one if there are reads in flight and none
+    // have completed yet. Returns how many callbacks ran.
+    size_t reap( bool block );
+
+    // Submitted but not yet reaped
+    inline size_t get_in_flight() { return in_flight_; }
+
+protected:
+    void work();
+
+    std::vector<std::thread> workers_;
+    std::mutex lock_;
+    std::condition_variable submitted_;
+    std::condition_variable completed_;
+    std::deque<io_request *> submission_queue_;
+    std::deque<io_request *> completion_queue_;
+    bool stopping_;
+
+    // Only touched by the owning thread
+    size_t in_flight_;
+};
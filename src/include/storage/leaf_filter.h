@@ -0,0 +1,64 @@
+#pragma once
+
+#include <storage/tree_node_allocator.h>
+#include <util/geometry.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Bloom filter over points in which every key lands in a single 64-bit
+// word, so a probe touches one word no matter how many bits it checks.
+class blocked_bloom_filter {
+public:
+    explicit blocked_bloom_filter( size_t word_count );
+
+    void add( const Point &p );
+
+    // Never false for a point that was added.
+    bool may_contain( const Point &p ) const;
+
+    void clear();
+
+    inline size_t size_in_bytes() const {
+        return words_.size() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint64_t> words_;
+};
+
+// One blocked_bloom_filter per leaf, held in memory beside the tree so
+// that a point search can rule a leaf out without fetching its page.
+// Filters are only ever supersets of their leaf's contents: inserts add
+// to them, and anything that takes entries out of a leaf rebuilds its
+// filter from what is left. A leaf without a filter may hold anything.
+//
+// bits_per_entry trades memory for the false positive rate; zero turns
+// filtering off altogether.
+class leaf_filter_set {
+public:
+    leaf_filter_set( unsigned bits_per_entry, unsigned entries_per_leaf );
+
+    inline bool enabled() const { return words_per_filter_ > 0; }
+
+    void add( tree_node_handle leaf, const Point &p );
+
+    // Replaces leaf's filter with one over exactly these points.
+    void rebuild( tree_node_handle leaf, const std::vector<Point> &points );
+
+    void erase( tree_node_handle leaf );
+
+    void clear();
+
+    bool may_contain( tree_node_handle leaf, const Point &p ) const;
+
+    inline size_t filter_count() const { return filters_.size(); }
+
+    size_t size_in_bytes() const;
+
+private:
+    static uint64_t key_for( tree_node_handle leaf );
+
+    size_t words_per_filter_;
+    std::unordered_map<uint64_t, blocked_bloom_filter> filters_;
+};
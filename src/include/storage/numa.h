@@ -0,0 +1,24 @@
+#pragma once
+
+#include <storage/page.h>
+#include <cstddef>
+
+// Just enough NUMA support for placing buffer pool frames, straight on
+// top of the system calls so that nothing extra needs linking. On
+// machines without NUMA everything reports a single node 0 and memory
+// is placed as usual.
+
+// Memory nodes of this machine
+unsigned numa_node_count();
+
+// Node of the CPU the calling thread is running on, cheap enough for
+// every page lookup
+unsigned numa_current_node();
+
+// Maps memory for count frames and asks for it to be placed on node.
+// Placement is best effort: if the kernel won't bind it the memory is
+// still usable, just not necessarily local. The memory starts out
+// zeroed and is only backed once touched.
+page *numa_alloc_frames( size_t count, unsigned node );
+
+void numa_free_frames( page *frames, size_t count );
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <storage/tree_node_allocator.h>
+#include <util/geometry.h>
+#include <cstdint>
+#include <vector>
+
+// Overflow chains hold the copies of a point that a partitioning leaf
+// cannot split between two children. A leaf keeps one copy among its
+// entries and the rest go to a chain of whole pages hanging off the
+// leaf, so duplicates never make the leaf overflow and its splits stay
+// O(fanout): the chain moves as a single handle to whichever side gets
+// the copy. Searches that reach the leaf scan the chain page by page.
+//
+// Pages are added and emptied at the head, so the head is the only page
+// that can be partly full.
+constexpr size_t OVERFLOW_PAGE_CAPACITY = (PAGE_DATA_SIZE -
+        sizeof(tree_node_handle) - sizeof(uint64_t)) / sizeof(Point);
+
+struct overflow_page {
+    tree_node_handle next_;
+    uint32_t count_;
+    Point points_[OVERFLOW_PAGE_CAPACITY];
+};
+
+static_assert( sizeof(overflow_page) <= PAGE_DATA_SIZE );
+
+// Adds p to the chain starting at head, which may be null, and returns
+// the new head
+tree_node_handle overflow_push( tree_node_allocator *allocator,
+        tree_node_handle head, const Point &p );
+
+// Removes one point from the chain and returns the new head, which is
+// null once the chain is empty
+tree_node_handle overflow_pop( tree_node_allocator *allocator,
+        tree_node_handle head );
+
+// The point every copy in the chain is equal to
+Point overflow_front( tree_node_allocator *allocator, tree_node_handle head );
+
+uint64_t overflow_count( tree_node_allocator *allocator,
+        tree_node_handle head );
+
+// Appends every point in the chain to accumulator
+void overflow_scan( tree_node_allocator *allocator, tree_node_handle head,
+        std::vector<Point> &accumulator );
+
+// Frees every page of the chain
+void overflow_free( tree_node_allocator *allocator, tree_node_handle head );
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <storage/page.h>
+#include <cstddef>
+#include <cstdint>
+
+// Gorilla-style XOR encoding of a whole page, treated as a sequence of
+// 64-bit words. Each word is XORed with the one before it; repeats cost
+// a single bit and words sharing their high bits with the previous word
+// (spatially clustered doubles, small integers, zeroed free space) only
+// store the bits that differ.
+//
+// Returns the number of bytes written to out, or 0 if the encoded page
+// would not fit in out_capacity bytes. Callers store such pages raw.
+size_t compress_page( const page *page_ptr, char *out, size_t
+        out_capacity );
+
+// Decodes exactly one page worth of words from in.
+void decompress_page( const char *in, size_t in_len, page *page_ptr );
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <storage/tree_node_allocator.h>
+#include <util/geometry.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct point_hash {
+    size_t operator()( const Point &p ) const;
+};
+
+// Secondary index from each stored point to the leaf holding it, so
+// that exact match lookups and deletes can skip the descent from the
+// root. A point stored n times has n mappings, one per copy.
+//
+// The table lives in memory while the tree is open. It is persisted as
+// a blob in the tree's backing file, see
+// tree_node_allocator::write_blob(), and read back in when the tree is
+// reopened.
+class point_location_index {
+public:
+    void add( const Point &p, tree_node_handle leaf );
+
+    // Removes one mapping of p to leaf.
+    void remove( const Point &p, tree_node_handle leaf );
+
+    // Removes every mapping of p to leaf.
+    void remove_all( const Point &p, tree_node_handle leaf );
+
+    // Repoints one mapping of p from one leaf to another, for entries
+    // moved by a split.
+    void move( const Point &p, tree_node_handle from, tree_node_handle to );
+
+    // Every distinct leaf holding p.
+    std::vector<tree_node_handle> leaves_for( const Point &p ) const;
+
+    inline size_t size() const { return locations_.size(); }
+
+    void clear();
+
+    // Reads back a table written by persist().
+    void load( tree_node_allocator &allocator, tree_node_handle head,
+            uint64_t entry_count );
+
+    // Writes the table to a blob, recycling the pages from the last
+    // call, and returns the head of its chain. Must be called before the
+    // allocator's write_superblock() so that the free list it persists
+    // is current.
+    tree_node_handle persist( tree_node_allocator &allocator );
+
+private:
+    std::unordered_multimap<Point, tree_node_handle, point_hash> locations_;
+
+    // Pages holding the last persisted copy of the table
+    std::vector<tree_node_handle> chunks_;
+};
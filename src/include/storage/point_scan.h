@@ -0,0 +1,60 @@
+#pragma once
+
+#include <storage/range_estimator.h>
+#include <storage/tree_node_allocator.h>
+#include <util/geometry.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A cursor over every point of a disk tree, for backups and reindexing
+// jobs that need the whole index out of it. Points come out leaf by
+// leaf in the order the leaves sit in the backing file rather than in
+// tree order, so reading them is one pass over the file instead of a
+// seek per leaf, and only one leaf's points are held at a time.
+//
+// Opening the scan walks the branch levels, in page order, to list the
+// leaves; none of the leaves are read until the cursor reaches them.
+// The cursor reads ahead of itself, pulling the pages of the next
+// stretch of leaves into the pool with coalesced reads before visiting
+// them.
+//
+// The tree must not change while a scan is open.
+class point_scan {
+public:
+    // Appends a node's children to branches if it is a branch node, or
+    // its live points to points if it is a leaf
+    typedef std::function<void( tree_node_handle,
+            range_estimator::branch_list &, std::vector<Point> & )>
+        node_expander;
+
+    point_scan( tree_node_allocator *allocator, tree_node_handle root,
+            node_expander expand );
+
+    // Appends the next leaf's points to points. Returns false, leaving
+    // points alone, once every leaf has been read.
+    bool next( std::vector<Point> &points );
+
+    // Writes every point the cursor has yet to reach to path, as
+    // dimensions doubles per point with nothing in between, the format
+    // the benchmarks read their datasets from. Returns how many points
+    // were written. Throws if the file can't be written.
+    uint64_t export_points( const std::string &path );
+
+    inline size_t get_leaf_count() const { return leaves_.size(); }
+
+private:
+    void read_ahead();
+
+    tree_node_allocator *allocator_;
+    node_expander expand_;
+
+    // Sorted by page, then offset
+    std::vector<tree_node_handle> leaves_;
+    size_t next_leaf_;
+    // Leaves before this one have had their pages read ahead
+    size_t read_ahead_end_;
+
+    range_estimator::branch_list branches_;
+};
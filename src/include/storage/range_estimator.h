@@ -0,0 +1,129 @@
+#pragma once
+
+#include <storage/tree_node_allocator.h>
+#include <util/geometry.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// How many points a range search would return, without running it. The
+// true count is always within [lower_, upper_]; count_ is the best
+// guess between them.
+struct range_estimate {
+    double count_;
+    uint64_t lower_;
+    uint64_t upper_;
+};
+
+// Summary of a tree's points for estimating range search result sizes
+// without reading any pages. Until the tree holds more than max_cells
+// points the summary keeps a copy of each and answers exactly. Past
+// that it keeps a count of the points in each cell of a grid over them:
+// cells inside the query count in full, cells it cuts count in
+// proportion to the volume cut off, and cells it misses not at all.
+//
+// The tree notes every insert and remove as it makes it, and each one
+// only touches the cell holding the point, so the counts are always
+// exact and the bounds always hold. Cell widths are powers of two and
+// cells start at multiples of their width, so the cell a point falls in
+// never depends on rounding. A point beyond the grid doubles the widths
+// in its dimension, merging neighbouring cells, until the grid covers it.
+//
+// The grid is the summary's own rather than the tree's upper levels.
+// Splits and reinsertion keep reshaping the tree's boxes, so counts under
+// them drift unless every branch entry carries the count beneath it, and
+// keeping those current rewrites every page on an insert's path, the
+// root included. A grid cell never moves, so one counter per change keeps
+// it exact.
+//
+// The summary is persisted with the tree, see persist().
+class range_estimator {
+public:
+    range_estimator( size_t max_cells = 4096 );
+
+    // A branch node's children, each with its bounding box
+    typedef std::vector<std::pair<Rectangle, tree_node_handle>> branch_list;
+
+    // Recounts the summary from the points of the tree under root, for a
+    // tree whose summary was lost; estimate() never reads the tree.
+    // expand( handle, branches, points ) must append handle's entries to
+    // branches if it is a branch node, or its points to points if it is
+    // a leaf.
+    template <typename Expand>
+    void rebuild( tree_node_handle root, Expand expand );
+
+    void note_insert( const Point &p );
+    // Ignores a point the summary does not hold
+    void note_remove( const Point &p );
+
+    range_estimate estimate( const Rectangle &requested_rectangle ) const;
+
+    // Points kept, or grid cells once there are too many of those
+    size_t cell_count() const;
+
+    inline bool is_gridded() const { return gridded_; }
+
+    void clear();
+
+    // Reads back a summary written by persist().
+    void load( tree_node_allocator &allocator, tree_node_handle head );
+
+    // Writes the summary to a blob, recycling the pages from the last
+    // call, and returns the head of its chain. Must be called before the
+    // allocator's write_superblock() so that the free list it persists
+    // is current.
+    tree_node_handle persist( tree_node_allocator &allocator );
+
+private:
+    // Lays a grid over the points kept so far and counts them into it
+    void build_grid();
+    // Doubles cell widths in dimension d until the grid covers column,
+    // a cell position at the current width
+    void widen( unsigned d, int64_t column );
+    // Cell position of value along d at the current width
+    int64_t column_for( unsigned d, double value ) const;
+    double cell_edge( unsigned d, int64_t column ) const;
+    size_t cell_for( const Point &p );
+
+    size_t max_cells_;
+    // Cells along each dimension of the grid
+    size_t side_;
+    bool gridded_;
+
+    // Every point, before the grid
+    std::vector<Point> points_;
+
+    // Cells along d are 2^exponents_[d] wide, the first starting at
+    // origins_[d] widths from zero
+    std::vector<int> exponents_;
+    std::vector<int64_t> origins_;
+    // Row-major over the cells
+    std::vector<uint64_t> cell_counts_;
+    // Points with a coordinate no grid can hold, infinite or NaN. They
+    // may be in any range.
+    uint64_t unplaced_;
+
+    // Pages holding the last persisted copy of the summary
+    std::vector<tree_node_handle> chunks_;
+};
+
+template <typename Expand>
+void range_estimator::rebuild( tree_node_handle root, Expand expand ) {
+    clear();
+    std::vector<tree_node_handle> stack = { root };
+    branch_list branches;
+    std::vector<Point> points;
+    while( not stack.empty() ) {
+        tree_node_handle handle = stack.back();
+        stack.pop_back();
+        branches.clear();
+        points.clear();
+        expand( handle, branches, points );
+        for( const Point &p : points ) {
+            note_insert( p );
+        }
+        for( const auto &branch : branches ) {
+            stack.push_back( branch.second );
+        }
+    }
+}
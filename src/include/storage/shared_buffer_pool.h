@@ -0,0 +1,73 @@
+#pragma once
+
+#include <storage/page.h>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+class buffer_pool;
+
+// A fixed set of frames shared by the buffer_pools of several backing
+// files, so that memory follows whichever index is hot instead of being
+// split up front. Every frame is tagged with the file it holds a page
+// of; together with the page id in its header that is the frame's key.
+//
+// Replacement is one clock over every frame, whatever file it belongs
+// to. Each file may also be given quotas in pages: it never has frames
+// taken away below its minimum, and once it holds its maximum it
+// recycles its own frames instead of taking anyone else's.
+//
+// Like buffer_pool this is not thread safe. Indexes sharing a pool must
+// not be used concurrently.
+class shared_buffer_pool {
+public:
+    explicit shared_buffer_pool( size_t pool_size_bytes );
+    ~shared_buffer_pool();
+
+    inline size_t get_capacity() { return max_mem_pages_; }
+    inline size_t get_frame_count() { return frames_.size(); }
+    inline size_t get_attached_file_count() { return attached_files_; }
+
+    // Frames holding pages of the file a buffer_pool was attached as
+    size_t get_resident_page_count( unsigned file_id );
+
+protected:
+    friend class buffer_pool;
+
+    static constexpr unsigned NO_FILE = std::numeric_limits<unsigned>::max();
+
+    struct frame {
+        std::unique_ptr<page> page_;
+        unsigned file_id_;
+    };
+
+    struct file_entry {
+        buffer_pool *pool_;
+        size_t min_pages_;
+        size_t max_pages_;
+        size_t resident_pages_;
+    };
+
+    // Returns the id the pool's frames are tagged with. The minimums of
+    // every attached file must fit in the pool together.
+    unsigned attach( buffer_pool *pool, size_t min_pages, size_t
+            max_pages );
+
+    // Takes back every frame of the file. Its pages must already have
+    // been written back.
+    void detach( unsigned file_id );
+
+    // A frame for a new page of file_id, evicting some other page if
+    // need be. Returns nullptr if every frame that could be taken is
+    // pinned.
+    page *obtain_frame( unsigned file_id );
+
+    size_t max_mem_pages_;
+    std::vector<frame> frames_;
+    std::vector<size_t> free_frames_;
+    std::vector<file_entry> files_;
+    size_t attached_files_;
+    size_t reserved_pages_;
+    size_t clock_hand_pos_;
+};
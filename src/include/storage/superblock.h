@@ -0,0 +1,84 @@
+#pragma once
+
+#include <storage/page.h>
+#include <storage/tree_node_allocator.h>
+#include <globals/globals.h>
+#include <cstdint>
+#include <string>
+
+// Reads as "NIRSUPER" in a hexdump of the backing file
+#define SUPERBLOCK_MAGIC 0x524550555352494EULL
+// Bump this whenever the on-disk layout of the superblock or of any
+// tree node changes.
+#define SUPERBLOCK_VERSION 7
+
+// Which tree wrote the backing file. Never reorder these, they are
+// persisted.
+enum disk_tree_type : uint32_t {
+    UNKNOWN_TREE_DISK = 0,
+    RTREE_DISK = 1,
+    RPLUSTREE_DISK = 2,
+    RSTARTREE_DISK = 3,
+    NIRTREE_DISK = 4,
+    GRIDFILE_DISK = 5,
+    BKDTREE_DISK = 6
+};
+
+// The superblock is always the first allocation in a backing file, so
+// it sits at page 0, offset 0. Everything needed to decide whether a
+// file can be reopened by a given tree instantiation lives here, along
+// with the allocator state needed to keep allocating after reopen.
+struct superblock {
+    uint64_t magic_;
+    uint32_t version_;
+    uint32_t tree_type_;
+    uint32_t min_branch_factor_;
+    uint32_t max_branch_factor_;
+    uint32_t page_size_;
+    uint32_t dimensions_;
+    uint64_t point_count_;
+    uint32_t tree_height_;
+    tree_node_handle root_;
+
+    // Allocator state
+    uint32_t cur_page_;
+    uint16_t space_left_in_cur_page_;
+
+    // Free space map: a chain of pages holding the allocator's free
+    // list, starting at this handle.
+    tree_node_handle free_list_head_;
+    uint32_t free_list_entry_count_;
+
+    // Optional point_location_index, persisted as a chain of pages
+    // starting at this handle. Once a file has one it is maintained on
+    // every open.
+    uint32_t has_point_index_;
+    tree_node_handle point_index_head_;
+    uint64_t point_index_entry_count_;
+
+    // Entries deleted lazily but still taking up space in their
+    // leaves, for trees that support lazy deletes.
+    uint64_t tombstone_count_;
+
+    // The tree's range_estimator summary, persisted as a chain of pages
+    // starting at this handle.
+    tree_node_handle range_estimator_head_;
+
+    // The subtree each page was allocated for, see
+    // tree_node_allocator::enter_subtree(), as a chain of pages
+    // starting at this handle.
+    tree_node_handle page_subtrees_head_;
+
+    // What a tree expects to find on disk, with nothing else filled in.
+    static superblock describe( disk_tree_type tree_type,
+            unsigned min_branch_factor, unsigned max_branch_factor );
+
+    // Throws std::runtime_error naming the first mismatched field if
+    // this superblock was written by a different tree layout than
+    // expected.
+    void validate_against( const superblock &expected, const
+            std::string &backing_file ) const;
+};
+
+static_assert( std::is_trivially_copyable<superblock>::value );
+static_assert( sizeof(superblock) <= PAGE_DATA_SIZE );
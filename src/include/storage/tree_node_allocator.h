@@ -1,15 +1,21 @@
 #pragma once 
 
+#include <storage/async.h>
 #include <storage/buffer_pool.h>
 #include <storage/page.h>
+#include <algorithm>
 #include <cassert>
 #include <optional>
 #include <iostream>
 #include <string>
 #include <list>
+#include <unordered_map>
+#include <vector>
 #include <cstdint>
 #include <limits>
 
+struct superblock;
+
 template <typename T>
 class pinned_node_ptr {
 public:
@@ -193,10 +199,39 @@ pinned_node_ptr<U> reinterpret_handle_ptr( const pinned_node_ptr<T> &ptr )
 
 static_assert( std::is_trivially_copyable<tree_node_handle>::value );
 
+// co_await allocator.get_tree_node_async<T>( ex, handle ) gives the same
+// pinned_node_ptr as get_tree_node, reading the page through the
+// executor if it isn't in memory.
+template <typename T>
+class tree_node_fetch {
+public:
+    tree_node_fetch( executor &ex, buffer_pool &pool, tree_node_handle
+            node_ptr ) : fetch_( ex, pool, node_ptr.get_page_id() ),
+        pool_( pool ), node_ptr_( node_ptr ) {}
+
+    inline bool await_ready() { return fetch_.await_ready(); }
+    inline void await_suspend( std::coroutine_handle<> awaiting ) {
+        fetch_.await_suspend( awaiting );
+    }
+    pinned_node_ptr<T> await_resume() {
+        page *page_ptr = fetch_.await_resume();
+        T *obj_ptr = (T *) (page_ptr->data_ + node_ptr_.get_offset() );
+        pinned_node_ptr<T> node( pool_, obj_ptr, page_ptr );
+        // The node holds its own pin now
+        pool_.unpin_page( page_ptr );
+        return node;
+    }
+
+protected:
+    page_fetch fetch_;
+    buffer_pool &pool_;
+    tree_node_handle node_ptr_;
+};
+
 class tree_node_allocator {
 public:
-    tree_node_allocator( size_t memory_budget,
-            std::string backing_file );
+    tree_node_allocator( buffer_budget memory_budget,
+            std::string backing_file, page_encoding encoding = RAW_PAGES );
 
     inline void initialize() {
         buffer_pool_.initialize();
@@ -206,6 +241,54 @@ public:
         return buffer_pool_.get_backing_file_name();
     }
 
+    // Claims page 0, offset 0 for the superblock. Must be the first
+    // allocation made against a fresh backing file.
+    void reserve_superblock();
+
+    // Reads the superblock into sb, checks it against what the caller
+    // expects and restores the allocator state recorded in it, including
+    // the persisted free list. Returns false for a fresh backing file,
+    // and throws if the file has data but no superblock or was written
+    // by a different tree layout.
+    bool load_superblock( const superblock &expected, superblock &sb );
+
+    // Fills in the allocator state of sb, persists the free list and
+    // writes sb to page 0 before flushing every page to disk.
+    void write_superblock( superblock &sb );
+
+    // Stores bytes in a chain of whole pages and returns the head of
+    // the chain. The pages of the previous chain, listed in chunks, are
+    // freed first and chunks is replaced with the new chain. Call before
+    // write_superblock() so that the free list it persists is current.
+    tree_node_handle write_blob( const std::vector<char> &bytes,
+            std::vector<tree_node_handle> &chunks );
+
+    // Reads back a chain written by write_blob(), listing its pages in
+    // chunks.
+    std::vector<char> read_blob( tree_node_handle head,
+            std::vector<tree_node_handle> &chunks );
+
+    // Pages are placed in the buffer pool's partitions by the child of
+    // the root whose subtree they hold, so that threads working in part
+    // of the tree mostly touch frames on one node. Trees call this for
+    // each node on their way down from the root, with its parent
+    // (nullptr for the root itself). Only insert descents make these
+    // calls, searches never do. From them the allocator keeps its own
+    // copy of the tree's parent links, which catches up with splits and
+    // the tree growing taller the next time an insert passes through,
+    // and drops a node's link when the node is freed. Nodes allocated
+    // from now on start out as children of node, and each subtree's
+    // nodes go on pages of their own. With a single partition it does
+    // nothing, since keeping subtrees apart could only waste space.
+    void enter_subtree( tree_node_handle node, tree_node_handle parent );
+
+    // The node first allocated on page_id while inside a subtree, 0 if
+    // none
+    inline uint64_t get_page_subtree( size_t page_id ) {
+        return page_id < page_subtrees_.size() ? page_subtrees_[page_id] :
+            0;
+    }
+
     template <typename T>
     std::pair<pinned_node_ptr<T>, tree_node_handle>
     create_new_tree_node( NodeHandleType type_code = NodeHandleType(0) ) {
@@ -220,7 +303,9 @@ public:
         for( auto iter = free_list_.begin(); iter != free_list_.end();
                 iter++ ) {
             auto alloc_location = *iter;
-            if( alloc_location.second < node_size ) {
+            if( alloc_location.second < node_size or not
+                    on_cur_subtree_page( alloc_location.first.get_page_id()
+                        ) ) {
                 continue;
             }
 
@@ -249,10 +334,11 @@ public:
                             remainder ) );
             }
 
+            note_allocation( alloc_location.first );
+            buffer_pool_.hold_for_write( alloc_location.first.get_page_id()
+                    );
             return std::make_pair( pinned_node_ptr( buffer_pool_,
                         obj_ptr, page_ptr ), alloc_location.first );
-
-
         }
 
         // Fall through, need new location
@@ -268,7 +354,9 @@ public:
         space_left_in_cur_page_ -= node_size;
         tree_node_handle meta_ptr( page_ptr->header_.page_id_,
                 offset_into_page, type_code );
-        
+        note_allocation( meta_ptr );
+        buffer_pool_.hold_for_write( page_ptr->header_.page_id_ );
+
         return std::make_pair( pinned_node_ptr( buffer_pool_, obj_ptr,
                     page_ptr ), std::move(meta_ptr) );
     }
@@ -276,12 +364,13 @@ public:
     void free( tree_node_handle handle, uint16_t alloc_size ) {
 #ifndef NDEBUG
         if( handle.get_type() == 1 ) {
-            assert( alloc_size == 176 );
+            assert( alloc_size == 200 );
         } else if( handle.get_type() == 2 ) {
             assert( alloc_size == 1840 );
         }
 #endif
         free_list_.push_back( std::make_pair( handle, alloc_size ) );
+        forget_subtree_node( handle );
     }
 
     template <typename T>
@@ -301,6 +390,83 @@ public:
         return pinned_node_ptr( buffer_pool_, obj_ptr, page_ptr );
     }
 
+    // Before a writer changes node_ptr's node, see
+    // buffer_pool::hold_for_write(). New nodes are held already.
+    void hold_for_write( tree_node_handle node_ptr ) {
+        buffer_pool_.hold_for_write( node_ptr.get_page_id() );
+    }
+
+    // Points node at node_ptr's node for a reader that holds no latch,
+    // see buffer_pool::read_optimistic()
+    template <typename T>
+    buffer_pool::optimistic_status read_tree_node_optimistic(
+            tree_node_handle node_ptr, const T *&node, uint32_t &version ) {
+        const char *data = nullptr;
+        buffer_pool::optimistic_status status =
+            buffer_pool_.read_optimistic( node_ptr.get_page_id(), data,
+                    version );
+        if( status == buffer_pool::OPTIMISTIC_OK ) {
+            node = (const T *) (data + node_ptr.get_offset());
+        }
+        return status;
+    }
+
+    template <typename T>
+    tree_node_fetch<T> get_tree_node_async( executor &ex, tree_node_handle
+            node_ptr ) {
+        return tree_node_fetch<T>( ex, buffer_pool_, node_ptr );
+    }
+
+    // Pulls a node that is already in memory into the CPU cache ahead
+    // of get_tree_node, for lookups that interleave their node visits
+    inline void prefetch_tree_node( tree_node_handle node_ptr, size_t
+            node_size ) {
+        buffer_pool_.prefetch_resident( node_ptr.get_page_id(),
+                node_ptr.get_offset(), node_size );
+    }
+
+    // Calls visit on every handle in page order rather than in the
+    // order given. Handles are handed over in batches of at most half
+    // the pool, and each batch's pages are prefetched with coalesced
+    // reads first so that visiting them doesn't seek around the file.
+    template <typename F>
+    void visit_in_page_order( std::vector<tree_node_handle> &handles, F
+            visit ) {
+        std::sort( handles.begin(), handles.end(),
+                []( tree_node_handle a, tree_node_handle b ) {
+                    if( a.get_page_id() != b.get_page_id() ) {
+                        return a.get_page_id() < b.get_page_id();
+                    }
+                    return a.get_offset() < b.get_offset();
+                } );
+
+        size_t batch_size = std::max( (size_t) 1,
+                buffer_pool_.get_in_memory_page_count() / 2 );
+        std::vector<size_t> page_ids;
+        size_t batch_start = 0;
+        while( batch_start < handles.size() ) {
+            // Batches are counted in distinct pages, not handles
+            size_t batch_end = batch_start;
+            page_ids.clear();
+            while( batch_end < handles.size() ) {
+                size_t page_id = handles[batch_end].get_page_id();
+                if( page_ids.empty() or page_ids.back() != page_id ) {
+                    if( page_ids.size() == batch_size ) {
+                        break;
+                    }
+                    page_ids.push_back( page_id );
+                }
+                batch_end++;
+            }
+
+            buffer_pool_.prefetch_pages( page_ids );
+            for( size_t i = batch_start; i < batch_end; i++ ) {
+                visit( handles[i] );
+            }
+            batch_start = batch_end;
+        }
+    }
+
     buffer_pool buffer_pool_;
 
 protected:
@@ -309,4 +475,44 @@ protected:
     uint16_t space_left_in_cur_page_;
     uint32_t cur_page_;
     std::list<std::pair<tree_node_handle,uint16_t>> free_list_;
+
+    // Pages currently holding the persisted free list, recycled the next
+    // time we write the superblock.
+    std::vector<tree_node_handle> free_list_chunks_;
+
+    // A node's key in the parent links, never 0
+    static inline uint64_t subtree_key( tree_node_handle node ) {
+        return (((uint64_t) node.get_page_id() << 16) | node.get_offset()) +
+            1;
+    }
+
+    // The child of the root above node, as far as the parent links go,
+    // or node itself if it is the root
+    uint64_t resolve_subtree( uint64_t node );
+
+    // The partition of the subtree node is in, if it has been given one
+    std::optional<size_t> subtree_partition( uint64_t node );
+
+    // Whether the current subtree may allocate on page_id
+    bool on_cur_subtree_page( size_t page_id );
+
+    // Files a new node under the current subtree, and its page too if
+    // the node starts it
+    void note_allocation( tree_node_handle node );
+
+    // Drops a freed node's parent link and partition, so that whatever
+    // reuses its handle starts afresh. A page it started stays with its
+    // subtree.
+    void forget_subtree_node( tree_node_handle node );
+
+    // Node new nodes go under, see enter_subtree(), and the node each
+    // page was started with, by page id. Once that node is freed, its
+    // page is filed under the child of the root above it instead.
+    uint64_t cur_subtree_;
+    std::vector<uint64_t> page_subtrees_;
+    // The parent of each node seen, and the partitions of the subtrees
+    // under the root's children
+    std::unordered_map<uint64_t, uint64_t> subtree_parents_;
+    std::unordered_map<uint64_t, uint64_t> subtree_partitions_;
+    std::vector<tree_node_handle> page_subtree_chunks_;
 };
@@ -0,0 +1,59 @@
+#ifndef __DENSITYRENDERER__
+#define __DENSITYRENDERER__
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <util/geometry.h>
+#include <storage/range_estimator.h>
+
+// Renders point density in the first two dimensions of a disk tree as a
+// pyramid of square BMP tiles, directory/zoom/x/y.bmp, with 4^zoom
+// tiles at each zoom covering the root's bounding box and tile (0, 0)
+// at the top left. Tiles are rendered in parallel, each thread holding
+// one tile's counts at a time, and tiles with nothing in them are not
+// written.
+//
+// A tile is drawn by descending from the root through the entries that
+// touch it. An entry whose box is no bigger than a pixel is not
+// descended into: its node's fill count, scaled by the tree's average
+// fanout to the node's height, goes to the pixel under the box's
+// centre. Colours run from black through blue, red and yellow to white
+// on a log scale that saturates at 100 times the average density.
+class DensityRenderer
+{
+	public:
+		// Appends a node's children to branches if it is a branch node,
+		// or its points to points if it is a leaf. Only ever called by
+		// one thread at a time.
+		typedef std::function<void(tree_node_handle, range_estimator::branch_list &, std::vector<Point> &)> NodeExpander;
+
+		DensityRenderer(tree_node_handle root, uint64_t pointCount, NodeExpander expand);
+
+		// Renders zooms 0 to maxZoom, returning how many tiles were
+		// written. threadCount of 0 uses every hardware thread.
+		unsigned render(const std::string &directory, unsigned maxZoom, unsigned tileSize = 256, unsigned threadCount = 0);
+
+		// The estimated points under each pixel of a tile, row by row
+		// from the top
+		std::vector<double> tileCounts(unsigned zoom, unsigned x, unsigned y, unsigned tileSize);
+
+	private:
+		void expandNode(tree_node_handle node, range_estimator::branch_list &branches, std::vector<Point> &points);
+		void writeTile(const std::string &path, const std::vector<double> &counts, unsigned tileSize, double saturation);
+
+		tree_node_handle root;
+		uint64_t pointCount;
+		NodeExpander expand;
+		std::mutex expandLatch;
+
+		Rectangle world;
+		// Root height, leaves being height 0, and the fanout that would
+		// give pointCount points at that height
+		unsigned height;
+		double fanout;
+};
+
+#endif
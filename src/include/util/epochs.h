@@ -0,0 +1,67 @@
+#ifndef __EPOCHS__
+#define __EPOCHS__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation, RCU style, for structures that are read
+// without locks. A reader holds a Guard for as long as it holds
+// pointers into the structure. A writer unlinks what it replaces and
+// then retires it, and it is freed once every reader that could still
+// have been looking at it has let go of its guard. Readers never wait
+// on anything: entering and leaving are a few atomic operations on a
+// slot of their own.
+class EpochManager
+{
+	public:
+		EpochManager();
+		// Frees everything retired, so nothing may be reading
+		~EpochManager();
+
+		class Guard
+		{
+			public:
+				explicit Guard(EpochManager &manager);
+				~Guard();
+				Guard(const Guard &) = delete;
+				Guard &operator=(const Guard &) = delete;
+
+			private:
+				EpochManager &manager;
+				unsigned slot;
+		};
+
+		// Runs deleter once no reader can still see what it frees. Call
+		// after unlinking it.
+		void retire(std::function<void()> deleter);
+
+		// Runs the deleters that are safe to run now, returning how many
+		size_t reclaim();
+
+		// Retired but not yet freed
+		size_t pending();
+
+	private:
+		size_t reclaimLocked();
+
+		// A reader's slot holds the epoch it entered in, or 0 when free.
+		// More readers than slots wait for one to come free.
+		static constexpr unsigned slotCount = 256;
+		struct alignas(64) Slot
+		{
+			std::atomic<uint64_t> epoch;
+		};
+		Slot slots[slotCount];
+
+		std::atomic<uint64_t> globalEpoch;
+
+		std::mutex retireLatch;
+		// Each deleter with the epoch it was retired in
+		std::vector<std::pair<uint64_t, std::function<void()>>> retired;
+};
+
+#endif
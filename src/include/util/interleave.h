@@ -0,0 +1,68 @@
+#ifndef __INTERLEAVE__
+#define __INTERLEAVE__
+
+#include <vector>
+#include <cstddef>
+
+// Batches of lookups whose nodes are already in memory spend most of
+// their time waiting on cache misses, one node at a time. Running them
+// interleaved (asynchronous memory access chaining) hides that: every
+// lookup does one step of work, prefetches whatever it touches next and
+// steps aside for the others, so by the time it comes round again its
+// memory has arrived.
+
+#define INTERLEAVE_WIDTH 16
+#define CACHE_LINE_SIZE 64
+
+// Prefetches every cache line of an object, up to maxLines of them
+inline void prefetchObject(const void *ptr, size_t bytes, size_t maxLines = 16)
+{
+	const char *start = (const char *) ptr;
+	size_t lines = (bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+	if (lines > maxLines)
+	{
+		lines = maxLines;
+	}
+	for (size_t i = 0; i < lines; ++i)
+	{
+		__builtin_prefetch(start + i * CACHE_LINE_SIZE);
+	}
+}
+
+// Runs every lookup to completion, keeping width of them in flight. A
+// Lookup has a bool step() that does a bounded amount of work and
+// returns false once the lookup has finished.
+template <typename Lookup>
+void runInterleaved(std::vector<Lookup> &lookups, size_t width = INTERLEAVE_WIDTH)
+{
+	std::vector<size_t> inFlight;
+	size_t next = 0;
+	for (; next < lookups.size() && inFlight.size() < width; ++next)
+	{
+		inFlight.push_back(next);
+	}
+
+	while (!inFlight.empty())
+	{
+		for (size_t slot = 0; slot < inFlight.size();)
+		{
+			if (lookups[inFlight[slot]].step())
+			{
+				++slot;
+			}
+			else if (next < lookups.size())
+			{
+				// Hand the slot to the next lookup waiting
+				inFlight[slot] = next++;
+				++slot;
+			}
+			else
+			{
+				inFlight[slot] = inFlight.back();
+				inFlight.pop_back();
+			}
+		}
+	}
+}
+
+#endif
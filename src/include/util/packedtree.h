@@ -0,0 +1,204 @@
+#ifndef __PACKEDTREE__
+#define __PACKEDTREE__
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+#include <util/geometry.h>
+#include <util/interleave.h>
+
+// A read-only copy of an in-memory tree laid out for searching. The
+// pointer-based nodes keep their boxes and children in separate heap
+// vectors behind a header of bookkeeping, so visiting a branch touches
+// several scattered cache lines before comparing anything. Here every
+// node is one block in a single arena, starting on a cache line with
+// its boxes packed together, then its children, then the cold fields
+// searches never read:
+//
+//   branch: boxes[boxCount] children[childCount] (owners[boxCount]) Footer
+//   leaf:   points[boxCount] Footer
+//
+// A child's box count lives in the reference to it rather than in the
+// child, so a search knows how much to read before touching the child.
+// A child may have several boxes, as a NIR-Tree polygon does; its boxes
+// are then next to one another and owners maps each box to its child.
+// Searches give the same answers as the tree packed, until it changes.
+//
+// Once packed, the upper levels can learn to route point searches
+// instead of scanning every box, see learnRouting.
+class PackedTree
+{
+	public:
+		// How a parent reaches a node
+		struct Ref
+		{
+			// Cache lines from the start of the arena
+			uint32_t line;
+			// Boxes in a branch, points in a leaf
+			uint16_t boxCount;
+			// Zero for a leaf
+			uint16_t childCount;
+		};
+
+		// Bookkeeping at the end of every node
+		struct Footer
+		{
+			uint32_t depth;
+			uint32_t parentLine;
+		};
+
+		// Packs the tree under root. expand(node, boxes, owners, children,
+		// points) lists a node's boxes and children, or its points if it
+		// is a leaf. owners gives the child each box belongs to and may be
+		// left empty when every child has exactly one box.
+		template <typename N, typename Expand>
+		PackedTree(const N *root, Expand expand);
+
+		std::vector<Point> search(const Point &requestedPoint) const;
+		std::vector<Point> search(const Rectangle &requestedRectangle) const;
+
+		// Gives every branch above depth with enough children a model
+		// from a point's key on a Z-order curve to the children that can
+		// hold it, learned from the points under the branch. Children are
+		// ranked by the median key of their points and each model is a
+		// run of line segments predicting a rank, each with the largest
+		// errors seen either side of it. A point search then checks only
+		// the children in the predicted range, which includes every one
+		// holding the point if it is in the tree. Depth 0 drops the models.
+		void learnRouting(unsigned depth);
+
+		size_t nodeCount() const;
+		size_t routedNodeCount() const;
+		unsigned height() const;
+		// Bytes the arena takes
+		size_t size() const;
+		bool validate() const;
+		void stat() const;
+
+	private:
+		struct alignas(CACHE_LINE_SIZE) Line
+		{
+			unsigned char bytes[CACHE_LINE_SIZE];
+		};
+
+		// A node gathered from the source tree, waiting to be written
+		struct Pending
+		{
+			std::vector<Rectangle> boxes;
+			std::vector<uint16_t> owners;
+			std::vector<uint32_t> children;
+			std::vector<Point> points;
+			Footer footer;
+			Ref ref;
+		};
+
+		// One run of a routing model, from its first key up to the next
+		// segment's
+		struct Segment
+		{
+			double slope;
+			double intercept;
+			// Largest distances of a trained rank below and above the
+			// predicted one
+			uint16_t below;
+			uint16_t above;
+		};
+
+		struct RoutingModel
+		{
+			// First key of each segment, ascending
+			std::vector<uint64_t> segmentKeys;
+			std::vector<Segment> segments;
+			// Each rank's child and its boxes
+			std::vector<uint16_t> children;
+			std::vector<uint16_t> firstBoxes;
+			std::vector<uint16_t> boxCounts;
+		};
+
+		static size_t nodeBytes(const Pending &node);
+		void write(std::deque<Pending> &pending);
+		uint64_t curveKey(const Point &p) const;
+		void collectPoints(Ref ref, std::vector<Point> &points) const;
+		RoutingModel learnModel(Ref ref) const;
+		static int64_t predictRank(const Segment &segment, uint64_t offset, unsigned childCount);
+		static void route(const RoutingModel &model, uint64_t key, const Point &requestedPoint, const Rectangle *boxes, const Ref *children, std::vector<Ref> &context);
+
+		const unsigned char *at(uint32_t line) const
+		{
+			return arena[line].bytes;
+		}
+
+		std::vector<Line> arena;
+		Ref root;
+		size_t nodes;
+
+		// Keys are taken over this, the box around every point
+		Rectangle curveBounds;
+		// Index into models for each line starting a routed node, -1 for
+		// the rest. Routed nodes are at the top, so this stays short.
+		std::vector<int32_t> modelAtLine;
+		std::vector<RoutingModel> models;
+};
+
+template <typename N, typename Expand>
+PackedTree::PackedTree(const N *rootNode, Expand expand)
+{
+	// Breadth first, so the upper levels searches always visit sit
+	// together at the front of the arena
+	std::deque<Pending> pending;
+	std::vector<const N *> sources = {rootNode};
+	std::vector<const N *> children;
+	uint32_t nextLine = 0;
+	pending.emplace_back();
+	pending.back().footer = {0, 0};
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		Pending &node = pending[i];
+		children.clear();
+		expand(sources[i], node.boxes, node.owners, children, node.points);
+		if (node.owners.empty())
+		{
+			for (size_t j = 0; j < node.boxes.size(); ++j)
+			{
+				node.owners.push_back(j);
+			}
+		}
+		// Searches rely on each child having boxes, listed together
+		for (size_t j = 0; j < node.owners.size(); ++j)
+		{
+			uint16_t previous = j == 0 ? 0 : node.owners[j - 1];
+			if (node.owners[j] != previous and node.owners[j] != previous + 1)
+			{
+				throw std::invalid_argument("Boxes must list each child's boxes together");
+			}
+		}
+		if (not children.empty() and (node.owners.empty() or node.owners.front() != 0 or node.owners.back() != children.size() - 1))
+		{
+			throw std::invalid_argument("Every child needs a box");
+		}
+		if (node.boxes.size() > UINT16_MAX or node.points.size() > UINT16_MAX or children.size() > UINT16_MAX)
+		{
+			throw std::length_error("Node too large to pack");
+		}
+
+		node.ref.line = nextLine;
+		node.ref.boxCount = children.empty() ? node.points.size() : node.boxes.size();
+		node.ref.childCount = children.size();
+		nextLine += (nodeBytes(node) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+
+		for (const N *child : children)
+		{
+			node.children.push_back(sources.size());
+			sources.push_back(child);
+			pending.emplace_back();
+			pending.back().footer = {node.footer.depth + 1, node.ref.line};
+		}
+	}
+
+	arena.resize(nextLine);
+	write(pending);
+}
+
+#endif
@@ -7,12 +7,84 @@
 #include <rstartree/rstartree.h>
 #include <nirtree/nirtree.h>
 #include <bench/randomPoints.h>
+#include <bench/contention.h>
+#include <bench/splits.h>
+#include <bench/layout.h>
+#include <server/server.h>
+#include <server/loadgen.h>
+#include <csignal>
 #include <unistd.h>
 
+static query_server *runningServer = nullptr;
+
+static void stopServer(int)
+{
+	if (runningServer != nullptr)
+	{
+		runningServer->stop();
+	}
+}
+
+static int serve(std::map<std::string, unsigned> &configU, const std::string &socketPath)
+{
+	Index *spatialIndex = createIndex(configU);
+	if (spatialIndex == nullptr)
+	{
+		std::cout << "Unknown tree selected. Exiting." << std::endl;
+		return 1;
+	}
+
+	query_server server(spatialIndex, socketPath);
+	try
+	{
+		server.listen();
+	}
+	catch (std::runtime_error &e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	runningServer = &server;
+	signal(SIGINT, stopServer);
+	signal(SIGTERM, stopServer);
+	std::cout << "Serving on " << socketPath << std::endl;
+	server.run();
+	runningServer = nullptr;
+
+	std::cout << "Requests served: " << server.get_requests_served() << std::endl;
+	std::cout << "Batches executed: " << server.get_batches_executed() << std::endl;
+	spatialIndex->write_metadata();
+	std::cout << "Metadata written." << std::endl;
+	return 0;
+}
+
+static int generateLoad(std::map<std::string, unsigned> &configU, const std::string &socketPath)
+{
+	load_generator_config config;
+	config.socket_path_ = socketPath;
+	config.connections_ = configU["connections"];
+	config.requests_per_connection_ = configU["requests"];
+	config.batch_size_ = configU["batchsize"];
+	config.pipeline_depth_ = configU["pipelinedepth"];
+	config.seed_ = configU["seed"];
+
+	try
+	{
+		print_load_generator_report(run_load_generator(config));
+	}
+	catch (std::runtime_error &e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
 void parameters(std::map<std::string, unsigned> &configU, std::map<std::string, double> configD)
 {
-	std::string treeTypes[] = {"R_TREE", "R_PLUS_TREE", "R_STAR_TREE", "NIR_TREE", "QUAD_TREE", "REVISED_R_STAR_TREE"};
-	std::string benchTypes[] = {"UNIFORM", "SKEW", "CLUSTER", "CALIFORNIA", "BIOLOGICAL", "FOREST", "CANADA", "GAIA", "MICROSOFTBUILDINGS"};
+	std::string treeTypes[] = {"R_TREE", "R_PLUS_TREE", "R_STAR_TREE", "NIR_TREE", "QUAD_TREE", "REVISED_R_STAR_TREE", "GRID_FILE", "BKD_TREE"};
+	std::string benchTypes[] = {"UNIFORM", "SKEW", "CLUSTER", "CALIFORNIA", "BIOLOGICAL", "FOREST", "CANADA", "GAIA", "MICROSOFTBUILDINGS", "GENERATED_UNIFORM", "ZIPF", "GAUSSIAN_CLUSTERS", "ROAD_NETWORK", "DUPLICATES"};
 
 	std::cout << "### BENCHMARK PARAMETERS ###" << std::endl;
 	std::cout << "  tree = " << treeTypes[configU["tree"]] << std::endl;
@@ -21,8 +93,22 @@ void parameters(std::map<std::string, unsigned> &configU, std::map<std::string,
 	std::cout << "  n = " << configU["size"] << std::endl;
 	std::cout << "  dimensions = " << dimensions << std::endl;
 	std::cout << "  seed = " << configU["seed"] << std::endl;
+	std::cout << "  generator threads = " << configU["generatorthreads"] << std::endl;
 	std::cout << "  search rectangles = " << configU["rectanglescount"] << std::endl;
 	std::cout << "  visualization = " << (configU["visualization"] ? "on" : "off") << std::endl;
+	std::cout << "  page compression = " << (configU["compression"] ? "on" : "off") << std::endl;
+	std::cout << "  page order range search = " << (configU["pageorder"] ? "on" : "off") << std::endl;
+	std::cout << "  point index = " << (configU["pointindex"] ? "on" : "off") << std::endl;
+	std::cout << "  leaf filter bits per entry = " << configU["filterbits"] << std::endl;
+	std::cout << "  interleaved point searches = " << configU["interleave"] << std::endl;
+	std::cout << "  async queries in flight = " << configU["async"] << std::endl;
+	std::cout << "  contention benchmark threads = " << configU["contention"] << std::endl;
+	std::cout << "  concurrent in-memory benchmark threads = " << configU["concurrent"] << std::endl;
+	std::cout << "  split benchmark = " << (configU["splitbench"] ? "on" : "off") << std::endl;
+	std::cout << "  layout benchmark = " << (configU["layoutbench"] ? "on" : "off") << std::endl;
+	std::cout << "  range estimates = " << (configU["estimate"] ? "on" : "off") << std::endl;
+	std::cout << "  selectivity sweep = " << (configU["selectivity"] ? "on" : "off") << std::endl;
+	std::cout << "  export = " << (configU["export"] ? "on" : "off") << std::endl;
 	std::cout << "### ### ### ### ### ###" << std::endl << std::endl;
 }
 
@@ -39,12 +125,32 @@ int main(int argc, char *argv[])
 	configU.emplace("size", 10000);
 	configU.emplace("distribution", UNIFORM);
 	configU.emplace("seed", 3141);
+	configU.emplace("generatorthreads", 0);
 	configU.emplace("rectanglescount", 5000);
 	configU.emplace("visualization", false);
+	configU.emplace("compression", false);
+	configU.emplace("pageorder", false);
+	configU.emplace("pointindex", false);
+	configU.emplace("filterbits", 0);
+	configU.emplace("interleave", 0);
+	configU.emplace("async", 0);
+	configU.emplace("contention", 0);
+	configU.emplace("concurrent", 0);
+	configU.emplace("splitbench", false);
+	configU.emplace("layoutbench", false);
+	configU.emplace("estimate", false);
+	configU.emplace("selectivity", false);
+	configU.emplace("export", false);
+	configU.emplace("connections", 4);
+	configU.emplace("requests", 10000);
+	configU.emplace("batchsize", 1);
+	configU.emplace("pipelinedepth", 8);
 
 	std::map<std::string, double> configD;
+	std::string serverSocket;
+	std::string loadSocket;
 
-	while ((option = getopt(argc, argv, "t:m:a:b:n:s:r:v:")) != -1)
+	while ((option = getopt(argc, argv, "t:m:a:b:n:s:g:r:v:cpxf:i:A:O:C:PHeQXS:L:w:q:k:d:")) != -1)
 	{
 		switch (option)
 		{
@@ -70,7 +176,7 @@ int main(int argc, char *argv[])
 			}
 			case 'n': // Benchmark size
 			{
-				configU["size"] = atoi(optarg);
+				configU["size"] = strtoul(optarg, nullptr, 10);
 				break;
 			}
 			case 's': // Benchmark seed
@@ -78,6 +184,11 @@ int main(int argc, char *argv[])
 				configU["seed"] = atoi(optarg);
 				break;
 			}
+			case 'g': // Generator threads
+			{
+				configU["generatorthreads"] = atoi(optarg);
+				break;
+			}
 			case 'r': // Number of search rectangles
 			{
 				configU["rectanglescount"] = atoi(optarg);
@@ -88,25 +199,174 @@ int main(int argc, char *argv[])
 				configU["visualization"] = true;
 				break;
 			}
+			case 'c': // Page compression
+			{
+				configU["compression"] = true;
+				break;
+			}
+			case 'p': // Page order range search
+			{
+				configU["pageorder"] = true;
+				break;
+			}
+			case 'x': // Exact match point index
+			{
+				configU["pointindex"] = true;
+				break;
+			}
+			case 'f': // Leaf filter bits per entry
+			{
+				configU["filterbits"] = atoi(optarg);
+				break;
+			}
+			case 'i': // Interleaved point search batch size
+			{
+				configU["interleave"] = atoi(optarg);
+				break;
+			}
+			case 'A': // Coroutine queries in flight
+			{
+				configU["async"] = atoi(optarg);
+				break;
+			}
+			case 'O': // Optimistic read contention benchmark
+			{
+				configU["contention"] = atoi(optarg);
+				break;
+			}
+			case 'C': // Concurrent in-memory R-Tree benchmark
+			{
+				configU["concurrent"] = atoi(optarg);
+				break;
+			}
+			case 'P': // Split strategy benchmark
+			{
+				configU["splitbench"] = true;
+				break;
+			}
+			case 'H': // Packed node layout benchmark
+			{
+				configU["layoutbench"] = true;
+				break;
+			}
+			case 'e': // Range search result size estimates
+			{
+				configU["estimate"] = true;
+				break;
+			}
+			case 'Q': // Selectivity sweep
+			{
+				configU["selectivity"] = true;
+				break;
+			}
+			case 'X': // Export in storage order
+			{
+				configU["export"] = true;
+				break;
+			}
+			case 'S': // Serve queries on a socket
+			{
+				serverSocket = optarg;
+				break;
+			}
+			case 'L': // Generate load against a socket
+			{
+				loadSocket = optarg;
+				break;
+			}
+			case 'w': // Load generator connections
+			{
+				configU["connections"] = atoi(optarg);
+				break;
+			}
+			case 'q': // Load generator requests per connection
+			{
+				configU["requests"] = atoi(optarg);
+				break;
+			}
+			case 'k': // Load generator operations per request
+			{
+				configU["batchsize"] = atoi(optarg);
+				break;
+			}
+			case 'd': // Load generator pipeline depth
+			{
+				configU["pipelinedepth"] = atoi(optarg);
+				break;
+			}
 			default:
 			{
 				std::cout << "Bad option. Usage:" << std::endl;
-				std::cout << "    -t  Specifies tree type {0 = R-Tree, 1 = R+-Tree, 2 = R*-Tree, 3 = NIR-Tree, 4 = Quad-Tree, 5 = RR*-Tree}" << std::endl;
-				std::cout << "    -m  Specifies benchmark type {0 = Uniform, 1 = Skew, 2 = Clustered, 3 = California, 4 = Biological, 5 = Forest, 6 = Canada, 7 = Gaia, 8 = MSBuildings}" << std::endl;
+				std::cout << "    -t  Specifies tree type {0 = R-Tree, 1 = R+-Tree, 2 = R*-Tree, 3 = NIR-Tree, 4 = Quad-Tree, 5 = RR*-Tree, 6 = Grid File, 7 = BKD-Tree}" << std::endl;
+				std::cout << "    -m  Specifies benchmark type {0 = Uniform, 1 = Skew, 2 = Clustered, 3 = California, 4 = Biological, 5 = Forest, 6 = Canada, 7 = Gaia, 8 = MSBuildings, 9 = Generated Uniform, 10 = Zipf, 11 = Gaussian Clusters, 12 = Road Network, 13 = Duplicates}" << std::endl;
 				std::cout << "    -a  Minimum fanout for nodes in the selected tree" << std::endl;
 				std::cout << "    -b  Maximum fanout for nodes in the selected tree" << std::endl;
 				std::cout << "    -n  Specified benchmark size if size is not constant for benchmark type" << std::endl;
 				std::cout << "    -s  Specifies benchmark seed if benchmark type is randomly generated" << std::endl;
+				std::cout << "    -g  Threads generating points for benchmark types 9 and up, 0 for one per hardware thread" << std::endl;
 				std::cout << "    -r  Specifies number of rectangles to search in benchmark if size is not constant for benchmark type" << std::endl;
-				std::cout << "    -v  Turns visualization on or off for first two dimensions of the selected tree" << std::endl;
+				std::cout << "    -v  Turns visualization on or off for first two dimensions of the selected tree, disk trees writing density tiles under density/" << std::endl;
+				std::cout << "    -c  Compresses pages in a freshly created backing file for disk trees" << std::endl;
+				std::cout << "    -p  Runs range searches level by level in page order for disk trees" << std::endl;
+				std::cout << "    -x  Maintains a hash index from points to leaves for exact match lookups and deletes in the R*-Tree disk tree" << std::endl;
+				std::cout << "    -f  Bits per entry for the R-Tree and R*-Tree disk trees' per-leaf point filters, 0 for none" << std::endl;
+				std::cout << "    -i  Runs point searches interleaved in batches of this many points, 0 for one at a time" << std::endl;
+				std::cout << "    -A  Runs searches through the coroutine API, with range searches this many at a time on one thread, 0 for ordinary calls" << std::endl;
+				std::cout << "    -O  Runs the root contention benchmark for optimistic searches of the R-Tree or R*-Tree disk tree with up to this many threads instead of benchmarking" << std::endl;
+				std::cout << "    -C  Compares the concurrent in-memory R-Tree against one behind a reader-writer latch with up to this many threads instead of benchmarking" << std::endl;
+				std::cout << "    -P  Compares the R-Tree disk tree's split strategies on insert throughput and range search cost instead of benchmarking" << std::endl;
+				std::cout << "    -H  Compares searches through the in-memory R*-Tree and NIR-Tree against their packed cache-line-aligned copies, with and without learned routing, with cache misses per query, instead of benchmarking" << std::endl;
+				std::cout << "    -e  Estimates each range search's result size after running them and reports accuracy and latency" << std::endl;
+				std::cout << "    -Q  Also times range searches returning 1 to 1e7 points with square, skinny and hotspot-centred boxes" << std::endl;
+				std::cout << "    -X  Writes every point to export.bin in the binary point format after benchmarking, disk trees reading their leaves in storage order" << std::endl;
+				std::cout << "    -S  Serves queries against the selected tree on the given Unix socket instead of benchmarking" << std::endl;
+				std::cout << "    -L  Generates query load against a server on the given Unix socket" << std::endl;
+				std::cout << "    -w  Number of load generator connections" << std::endl;
+				std::cout << "    -q  Number of requests each load generator connection sends" << std::endl;
+				std::cout << "    -k  Number of operations in each load generator request" << std::endl;
+				std::cout << "    -d  Number of requests each load generator connection keeps in flight" << std::endl;
 				return 1;
 			}
 		}
 	}
 
+	if (!loadSocket.empty())
+	{
+		return generateLoad(configU, loadSocket);
+	}
+
 	// Print test parameters
 	parameters(configU, configD);
 
+	if (!serverSocket.empty())
+	{
+		return serve(configU, serverSocket);
+	}
+
+	if (configU["contention"] > 0)
+	{
+		contentionBenchmark(configU);
+		return 0;
+	}
+
+	if (configU["concurrent"] > 0)
+	{
+		concurrentRTreeBenchmark(configU);
+		return 0;
+	}
+
+	if (configU["splitbench"])
+	{
+		splitBenchmark(configU);
+		return 0;
+	}
+
+	if (configU["layoutbench"])
+	{
+		layoutBenchmark(configU);
+		return 0;
+	}
+
 	// Run the benchmark
 	randomPoints(configU, configD);
 }
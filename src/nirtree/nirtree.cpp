@@ -86,4 +86,22 @@ namespace nirtree
 
 		p.printToBMP(root);
 	}
+
+	PackedTree NIRTree::pack()
+	{
+		return PackedTree(root, [](const Node *node, std::vector<Rectangle> &boxes, std::vector<uint16_t> &owners, std::vector<const Node *> &children, std::vector<Point> &points)
+		{
+			for (const Node::Branch &branch : node->branches)
+			{
+				// One box for each rectangle of the polygon
+				for (const Rectangle &rectangle : branch.boundingPoly.basicRectangles)
+				{
+					boxes.push_back(rectangle);
+					owners.push_back(children.size());
+				}
+				children.push_back(branch.child);
+			}
+			points.insert(points.end(), node->data.begin(), node->data.end());
+		});
+	}
 }
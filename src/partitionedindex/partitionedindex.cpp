@@ -0,0 +1,453 @@
+#include <partitionedindex/partitionedindex.h>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+namespace partitionedindex
+{
+	PartitionedIndex::PartitionedIndex(unsigned partitionCount, std::vector<Point> sample, IndexFactory factory, IndexRetirer retirer) :
+		factory(factory), retirer(retirer), nextPartitionId(0)
+	{
+		assert(partitionCount > 0);
+		buildSplits(sample, 0, sample.size(), Rectangle(Point::atNegInfinity, Point::atInfinity), partitionCount);
+	}
+
+	PartitionedIndex::~PartitionedIndex()
+	{
+		for (auto &partition : partitions)
+		{
+			delete partition->index;
+		}
+	}
+
+	int PartitionedIndex::newPartition(Rectangle region, int splitNode)
+	{
+		std::unique_ptr<Partition> partition = std::make_unique<Partition>();
+		partition->id = nextPartitionId++;
+		partition->splitNode = splitNode;
+		partition->region = region;
+		partition->index = factory(partition->id);
+		partition->pointCount = 0;
+		partitions.emplace_back(std::move(partition));
+
+		return partitions.size() - 1;
+	}
+
+	static unsigned widestDimension(std::vector<Point> &points, size_t begin, size_t end)
+	{
+		unsigned widest = 0;
+		double widestExtent = -1.0;
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			auto extremes = std::minmax_element(points.begin() + begin, points.begin() + end,
+				[d](const Point &a, const Point &b) { return a[d] < b[d]; });
+			double extent = (*extremes.second)[d] - (*extremes.first)[d];
+			if (extent > widestExtent)
+			{
+				widest = d;
+				widestExtent = extent;
+			}
+		}
+
+		return widest;
+	}
+
+	int PartitionedIndex::buildSplits(std::vector<Point> &sample, size_t begin, size_t end, Rectangle region, unsigned partitionCount)
+	{
+		int nodeIndex = splits.size();
+		splits.push_back({0, 0.0, -1, -1, -1});
+
+		if (partitionCount == 1)
+		{
+			splits[nodeIndex].partition = newPartition(region, nodeIndex);
+			return nodeIndex;
+		}
+
+		// Uneven counts are split proportionally so every partition
+		// starts out with about the same share of the sample
+		unsigned leftCount = partitionCount / 2;
+		size_t middle = begin + (end - begin) * leftCount / partitionCount;
+		unsigned dimension;
+		double value;
+		if (end - begin >= 2)
+		{
+			dimension = widestDimension(sample, begin, end);
+			std::nth_element(sample.begin() + begin, sample.begin() + middle, sample.begin() + end,
+				[dimension](const Point &a, const Point &b) { return a[dimension] < b[dimension]; });
+			value = sample[middle][dimension];
+		}
+		else
+		{
+			// Ran out of sample, halve the region instead
+			dimension = 0;
+			for (unsigned d = 1; d < dimensions; ++d)
+			{
+				if (region.upperRight[d] - region.lowerLeft[d] > region.upperRight[dimension] - region.lowerLeft[dimension])
+				{
+					dimension = d;
+				}
+			}
+			double lower = std::max(region.lowerLeft[dimension], -std::numeric_limits<double>::max());
+			double upper = std::min(region.upperRight[dimension], std::numeric_limits<double>::max());
+			value = lower / 2.0 + upper / 2.0;
+		}
+
+		Rectangle leftRegion = region;
+		leftRegion.upperRight[dimension] = value;
+		Rectangle rightRegion = region;
+		rightRegion.lowerLeft[dimension] = value;
+
+		int left = buildSplits(sample, begin, middle, leftRegion, leftCount);
+		int right = buildSplits(sample, middle, end, rightRegion, partitionCount - leftCount);
+
+		splits[nodeIndex].dimension = dimension;
+		splits[nodeIndex].value = value;
+		splits[nodeIndex].left = left;
+		splits[nodeIndex].right = right;
+
+		return nodeIndex;
+	}
+
+	unsigned PartitionedIndex::partitionFor(const Point &givenPoint)
+	{
+		int nodeIndex = 0;
+		while (splits[nodeIndex].partition < 0)
+		{
+			const SplitNode &node = splits[nodeIndex];
+			nodeIndex = givenPoint[node.dimension] < node.value ? node.left : node.right;
+		}
+
+		return splits[nodeIndex].partition;
+	}
+
+	std::vector<unsigned> PartitionedIndex::partitionsFor(const Rectangle &givenRectangle)
+	{
+		// Upper corners are exclusive, so a rectangle ending exactly on
+		// a split value never reaches the right side
+		std::vector<unsigned> matching;
+		std::vector<int> context = {0};
+		while (!context.empty())
+		{
+			const SplitNode &node = splits[context.back()];
+			context.pop_back();
+
+			if (node.partition >= 0)
+			{
+				matching.push_back(node.partition);
+				continue;
+			}
+
+			if (givenRectangle.lowerLeft[node.dimension] < node.value)
+			{
+				context.push_back(node.left);
+			}
+			if (givenRectangle.upperRight[node.dimension] > node.value)
+			{
+				context.push_back(node.right);
+			}
+		}
+
+		return matching;
+	}
+
+	std::vector<Point> PartitionedIndex::scatterGather(const std::vector<unsigned> &targets, const std::function<std::vector<Point>(Index *)> &query)
+	{
+		auto runOn = [this, &query](unsigned partitionIndex)
+		{
+			Partition &partition = *partitions[partitionIndex];
+			std::lock_guard<std::mutex> guard(partition.lock);
+			return query(partition.index);
+		};
+
+		if (targets.empty())
+		{
+			return {};
+		}
+
+		// The calling thread takes the first partition itself so a query
+		// hitting a single partition never starts a thread
+		std::vector<std::future<std::vector<Point>>> pending;
+		for (size_t i = 1; i < targets.size(); ++i)
+		{
+			pending.emplace_back(std::async(std::launch::async, runOn, targets[i]));
+		}
+
+		std::vector<Point> accumulator = runOn(targets[0]);
+		for (auto &future : pending)
+		{
+			std::vector<Point> partial = future.get();
+			accumulator.insert(accumulator.end(), partial.begin(), partial.end());
+		}
+
+		return accumulator;
+	}
+
+	std::vector<Point> PartitionedIndex::exhaustiveSearch(Point requestedPoint)
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		return scatterGather({partitionFor(requestedPoint)},
+			[&requestedPoint](Index *index) { return index->exhaustiveSearch(requestedPoint); });
+	}
+
+	std::vector<Point> PartitionedIndex::search(Point requestedPoint)
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		return scatterGather({partitionFor(requestedPoint)},
+			[&requestedPoint](Index *index) { return index->search(requestedPoint); });
+	}
+
+	std::vector<Point> PartitionedIndex::search(Rectangle requestedRectangle)
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		return scatterGather(partitionsFor(requestedRectangle),
+			[&requestedRectangle](Index *index) { return index->search(requestedRectangle); });
+	}
+
+	std::vector<Point> PartitionedIndex::pageOrderSearch(Rectangle requestedRectangle)
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		return scatterGather(partitionsFor(requestedRectangle),
+			[&requestedRectangle](Index *index) { return index->pageOrderSearch(requestedRectangle); });
+	}
+
+	void PartitionedIndex::insert(Point givenPoint)
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		Partition &partition = *partitions[partitionFor(givenPoint)];
+		std::lock_guard<std::mutex> guard(partition.lock);
+		partition.index->insert(givenPoint);
+		partition.pointCount++;
+	}
+
+	void PartitionedIndex::remove(Point givenPoint)
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		Partition &partition = *partitions[partitionFor(givenPoint)];
+		std::lock_guard<std::mutex> guard(partition.lock);
+		if (!partition.index->search(givenPoint).empty())
+		{
+			partition.index->remove(givenPoint);
+			partition.pointCount--;
+		}
+	}
+
+	void PartitionedIndex::bulkInsert(const std::vector<Point> &points)
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+
+		std::vector<std::vector<Point>> routed(partitions.size());
+		for (const Point &p : points)
+		{
+			routed[partitionFor(p)].push_back(p);
+		}
+
+		std::vector<std::thread> workers;
+		for (unsigned i = 0; i < routed.size(); ++i)
+		{
+			if (routed[i].empty())
+			{
+				continue;
+			}
+
+			workers.emplace_back([this, i, &routed]()
+			{
+				Partition &partition = *partitions[i];
+				std::lock_guard<std::mutex> guard(partition.lock);
+				for (const Point &p : routed[i])
+				{
+					partition.index->insert(p);
+				}
+				partition.pointCount += routed[i].size();
+			});
+		}
+
+		for (std::thread &worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	bool PartitionedIndex::splitPartition(unsigned partitionIndex)
+	{
+		Partition &partition = *partitions[partitionIndex];
+		std::vector<Point> points = partition.index->search(Rectangle(Point::atNegInfinity, Point::atInfinity));
+		if (points.empty())
+		{
+			return false;
+		}
+
+		// Find a dimension and value that leave points on both sides
+		unsigned dimension = widestDimension(points, 0, points.size());
+		auto lessAlong = [dimension](const Point &a, const Point &b) { return a[dimension] < b[dimension]; };
+		std::sort(points.begin(), points.end(), lessAlong);
+
+		// Everything below the median goes left. Ties with the median
+		// must all land on the same side, so if the median is also the
+		// minimum the split moves up past it instead.
+		auto middle = std::lower_bound(points.begin(), points.end(), points[points.size() / 2], lessAlong);
+		if (middle == points.begin())
+		{
+			middle = std::upper_bound(points.begin(), points.end(), points[0], lessAlong);
+		}
+		if (middle == points.end())
+		{
+			// Every point is identical along the widest dimension, so
+			// along every dimension. Nothing to split on.
+			return false;
+		}
+		double value = (*middle)[dimension];
+		size_t leftCount = middle - points.begin();
+
+		Rectangle leftRegion = partition.region;
+		leftRegion.upperRight[dimension] = value;
+		Rectangle rightRegion = partition.region;
+		rightRegion.lowerLeft[dimension] = value;
+
+		// The partition's kd leaf becomes a split over two new leaves.
+		// The left half reuses this partition's slot so indices held by
+		// other leaves stay valid.
+		int nodeIndex = partition.splitNode;
+		int leftNode = splits.size();
+		int rightNode = leftNode + 1;
+		splits.push_back({0, 0.0, -1, -1, (int) partitionIndex});
+		splits.push_back({0, 0.0, -1, -1, -1});
+		splits[nodeIndex] = {dimension, value, leftNode, rightNode, -1};
+
+		Index *oldIndex = partition.index;
+		unsigned oldId = partition.id;
+
+		partition.id = nextPartitionId++;
+		partition.splitNode = leftNode;
+		partition.region = leftRegion;
+		partition.index = factory(partition.id);
+		partition.pointCount = leftCount;
+
+		int rightPartition = newPartition(rightRegion, rightNode);
+		splits[rightNode].partition = rightPartition;
+		Partition &right = *partitions[rightPartition];
+		right.pointCount = points.size() - leftCount;
+
+		for (size_t i = 0; i < leftCount; ++i)
+		{
+			partitions[partitionIndex]->index->insert(points[i]);
+		}
+		for (size_t i = leftCount; i < points.size(); ++i)
+		{
+			right.index->insert(points[i]);
+		}
+
+		delete oldIndex;
+		if (retirer)
+		{
+			retirer(oldId);
+		}
+
+		return true;
+	}
+
+	unsigned PartitionedIndex::rebalance(uint64_t maxPoints)
+	{
+		std::unique_lock<std::shared_mutex> structureGuard(structureLock);
+
+		unsigned splitCount = 0;
+		std::vector<bool> unsplittable(partitions.size(), false);
+		for (unsigned i = 0; i < partitions.size(); ++i)
+		{
+			// Halves land back in slot i and at the end, so both are
+			// checked again before we are done
+			while (i < unsplittable.size() && !unsplittable[i] && partitions[i]->pointCount > maxPoints)
+			{
+				if (splitPartition(i))
+				{
+					splitCount++;
+					unsplittable.push_back(false);
+				}
+				else
+				{
+					unsplittable[i] = true;
+				}
+			}
+		}
+
+		return splitCount;
+	}
+
+	unsigned PartitionedIndex::checksum()
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		unsigned sum = 0;
+		for (auto &partition : partitions)
+		{
+			std::lock_guard<std::mutex> guard(partition->lock);
+			sum += partition->index->checksum();
+		}
+
+		return sum;
+	}
+
+	bool PartitionedIndex::validate()
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		for (auto &partition : partitions)
+		{
+			std::lock_guard<std::mutex> guard(partition->lock);
+			if (!partition->index->validate())
+			{
+				return false;
+			}
+
+			// Every point must have been routed to this partition
+			std::vector<Point> points = partition->index->search(Rectangle(Point::atNegInfinity, Point::atInfinity));
+			for (const Point &p : points)
+			{
+				if (!partition->region.containsPoint(p))
+				{
+					std::cout << p << " is outside of partition " << partition->id << " " << partition->region << std::endl;
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void PartitionedIndex::stat()
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		STATEXEC(std::cout << "### PARTITIONED INDEX STATISTICS ###" << std::endl);
+		STATEXEC(std::cout << "Partitions: " << partitions.size() << std::endl);
+		for (auto &partition : partitions)
+		{
+			std::lock_guard<std::mutex> guard(partition->lock);
+			STATEXEC(std::cout << "Partition " << partition->id << " " << partition->region << ": " << partition->pointCount << " points" << std::endl);
+			partition->index->stat();
+		}
+	}
+
+	void PartitionedIndex::print()
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		for (auto &partition : partitions)
+		{
+			std::lock_guard<std::mutex> guard(partition->lock);
+			std::cout << "Partition " << partition->id << " " << partition->region << std::endl;
+			partition->index->print();
+		}
+	}
+
+	void PartitionedIndex::visualize()
+	{
+		// Each child would overwrite the same image
+		std::cout << "Visualization is not supported for partitioned indexes." << std::endl;
+	}
+
+	void PartitionedIndex::write_metadata()
+	{
+		std::shared_lock<std::shared_mutex> structureGuard(structureLock);
+		for (auto &partition : partitions)
+		{
+			std::lock_guard<std::mutex> guard(partition->lock);
+			partition->index->write_metadata();
+		}
+	}
+}
@@ -156,6 +156,44 @@ namespace quadtree
 		return accumulator;
 	}
 
+	PointLookup::PointLookup(Node *root, const Point &requestedPoint, std::vector<Point> *accumulator) :
+		requestedPoint(requestedPoint), accumulator(accumulator), current(root), nextIndex(-1)
+	{
+		prefetchObject(root, sizeof(Node));
+	}
+
+	bool PointLookup::step()
+	{
+		if (current == nullptr)
+		{
+			return false;
+		}
+
+		if (nextIndex == -1)
+		{
+			if (current->data == requestedPoint)
+			{
+				// This node contains the data so we may stop
+				accumulator->push_back(current->data);
+				return false;
+			}
+
+			// The branch pointer lives in a separate allocation
+			nextIndex = current->nextBranch(requestedPoint);
+			__builtin_prefetch(&current->branches[nextIndex]);
+			return true;
+		}
+
+		current = current->branches[nextIndex];
+		nextIndex = -1;
+		if (current == nullptr)
+		{
+			return false;
+		}
+		prefetchObject(current, sizeof(Node));
+		return true;
+	}
+
 	std::vector<Point> Node::search(Rectangle &requestedRectangle)
 	{
 		std::vector<Point> accumulator;
@@ -43,6 +43,24 @@ namespace quadtree
 		return root->search(requestedRectangle);
 	}
 
+	std::vector<std::vector<Point>> QuadTree::batchSearch(const std::vector<Point> &requestedPoints)
+	{
+#ifdef STAT
+		// Statistics are gathered a search at a time
+		return Index::batchSearch(requestedPoints);
+#endif
+		std::vector<std::vector<Point>> results(requestedPoints.size());
+		std::vector<PointLookup> lookups;
+		lookups.reserve(requestedPoints.size());
+		for (unsigned i = 0; i < requestedPoints.size(); ++i)
+		{
+			lookups.emplace_back(root, requestedPoints[i], &results[i]);
+		}
+		runInterleaved(lookups);
+
+		return results;
+	}
+
 	void QuadTree::insert(Point givenPoint)
 	{
 		// Root special case
@@ -168,6 +168,62 @@ namespace revisedrstartree
 		return accumulator;
 	}
 
+	PointLookup::PointLookup(Node *root, const Point &requestedPoint, std::vector<Point> *accumulator) :
+		requestedPoint(requestedPoint), accumulator(accumulator), current(nullptr)
+	{
+		context.push_back(root);
+		prefetchObject(root, sizeof(Node));
+	}
+
+	bool PointLookup::step()
+	{
+		if (current == nullptr)
+		{
+			if (context.empty())
+			{
+				return false;
+			}
+
+			// The node arrived while the others ran, now fetch its entries
+			current = context.back();
+			context.pop_back();
+			if (current->isLeaf())
+			{
+				prefetchObject(current->data.data(), current->data.size() * sizeof(Point));
+			}
+			else
+			{
+				prefetchObject(current->branches.data(), current->branches.size() * sizeof(Node::Branch));
+			}
+			return true;
+		}
+
+		if (current->isLeaf())
+		{
+			for (Point &dataPoint : current->data)
+			{
+				if (requestedPoint == dataPoint)
+				{
+					accumulator->push_back(dataPoint);
+				}
+			}
+		}
+		else
+		{
+			for (Node::Branch &branch : current->branches)
+			{
+				if (branch.boundingBox.containsPoint(requestedPoint))
+				{
+					context.push_back(branch.child);
+					prefetchObject(branch.child, sizeof(Node));
+				}
+			}
+		}
+		current = nullptr;
+
+		return !context.empty();
+	}
+
 	std::vector<Point> Node::search(Rectangle &requestedRectangle)
 	{
 		std::vector<Point> accumulator;
@@ -31,6 +31,24 @@ namespace revisedrstartree
 		return root->search(requestedRectangle);
 	}
 
+	std::vector<std::vector<Point>> RevisedRStarTree::batchSearch(const std::vector<Point> &requestedPoints)
+	{
+#ifdef STAT
+		// Statistics are gathered a search at a time
+		return Index::batchSearch(requestedPoints);
+#endif
+		std::vector<std::vector<Point>> results(requestedPoints.size());
+		std::vector<PointLookup> lookups;
+		lookups.reserve(requestedPoints.size());
+		for (unsigned i = 0; i < requestedPoints.size(); ++i)
+		{
+			lookups.emplace_back(root, requestedPoints[i], &results[i]);
+		}
+		runInterleaved(lookups);
+
+		return results;
+	}
+
 	void RevisedRStarTree::insert(Point givenPoint)
 	{
 		root = root->insert(givenPoint);
@@ -210,6 +210,59 @@ namespace rstartree
 		}
 	}
 
+	PointLookup::PointLookup(const Node *root, const Point &requestedPoint, std::vector<Point> *accumulator) :
+		requestedPoint(requestedPoint), accumulator(accumulator), current(nullptr)
+	{
+		context.push_back(root);
+		prefetchObject(root, sizeof(Node));
+	}
+
+	bool PointLookup::step()
+	{
+		if (current == nullptr)
+		{
+			if (context.empty())
+			{
+				return false;
+			}
+
+			// The node arrived while the others ran, now fetch its entries
+			current = context.back();
+			context.pop_back();
+			prefetchObject(current->entries.data(), current->entries.size() * sizeof(Node::NodeEntry));
+			return true;
+		}
+
+		if (current->isLeafNode())
+		{
+			for (const auto &entry : current->entries)
+			{
+				const Point &p = std::get<Point>(entry);
+
+				if (p == requestedPoint)
+				{
+					accumulator->push_back(p);
+				}
+			}
+		}
+		else
+		{
+			for (const auto &entry : current->entries)
+			{
+				const Node::Branch &b = std::get<Node::Branch>(entry);
+
+				if (b.boundingBox.containsPoint(requestedPoint))
+				{
+					context.push_back(b.child);
+					prefetchObject(b.child, sizeof(Node));
+				}
+			}
+		}
+		current = nullptr;
+
+		return !context.empty();
+	}
+
 	void Node::searchSub(const Rectangle &rectangle, std::vector<Point> &accumulator) CONST_IF_NOT_STAT
 	{
 		std::stack<const Node *> context;
@@ -35,6 +35,24 @@ namespace rstartree
 		return root->search(requestedRectangle);
 	}
 
+	std::vector<std::vector<Point>> RStarTree::batchSearch(const std::vector<Point> &requestedPoints)
+	{
+#ifdef STAT
+		// Statistics are gathered a search at a time
+		return Index::batchSearch(requestedPoints);
+#endif
+		std::vector<std::vector<Point>> results(requestedPoints.size());
+		std::vector<PointLookup> lookups;
+		lookups.reserve(requestedPoints.size());
+		for (unsigned i = 0; i < requestedPoints.size(); ++i)
+		{
+			lookups.emplace_back(root, requestedPoints[i], &results[i]);
+		}
+		runInterleaved(lookups);
+
+		return results;
+	}
+
 	void RStarTree::insert(Point givenPoint)
 	{
 		assert(root->parent == nullptr);
@@ -76,4 +94,24 @@ namespace rstartree
 
 		p.printToBMP(root);
 	}
+
+	PackedTree RStarTree::pack()
+	{
+		return PackedTree(root, [](const Node *node, std::vector<Rectangle> &boxes, std::vector<uint16_t> &owners, std::vector<const Node *> &children, std::vector<Point> &points)
+		{
+			for (const Node::NodeEntry &entry : node->entries)
+			{
+				if (std::holds_alternative<Node::Branch>(entry))
+				{
+					const Node::Branch &branch = std::get<Node::Branch>(entry);
+					boxes.push_back(branch.boundingBox);
+					children.push_back(branch.child);
+				}
+				else
+				{
+					points.push_back(std::get<Point>(entry));
+				}
+			}
+		});
+	}
 }
@@ -0,0 +1,806 @@
+#include <rtree/concurrentrtree.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stack>
+#include <string>
+#include <utility>
+
+namespace rtree
+{
+	ConcurrentRTree::Node::Node(std::vector<Point> &&data) :
+		isLeaf(true), data(std::move(data))
+	{
+	}
+
+	ConcurrentRTree::Node::Node(const std::vector<Entry *> &entries) :
+		isLeaf(false), entries(entries.size())
+	{
+		for (unsigned i = 0; i < entries.size(); ++i)
+		{
+			this->entries[i].store(entries[i], std::memory_order_relaxed);
+		}
+	}
+
+	Rectangle ConcurrentRTree::Node::boundingBox() const
+	{
+		if (isLeaf)
+		{
+			assert(!data.empty());
+			Rectangle boundingBox(data[0], Point::closest_larger_point(data[0]));
+			for (unsigned i = 1; i < data.size(); ++i)
+			{
+				boundingBox.expand(data[i]);
+			}
+			return boundingBox;
+		}
+
+		Rectangle boundingBox = entries[0].load(std::memory_order_acquire)->boundingBox;
+		for (unsigned i = 1; i < entries.size(); ++i)
+		{
+			boundingBox.expand(entries[i].load(std::memory_order_acquire)->boundingBox);
+		}
+		return boundingBox;
+	}
+
+	ConcurrentRTree::ConcurrentRTree(unsigned minBranchFactor, unsigned maxBranchFactor) :
+		exclusiveWrites(0), minBranchFactor(minBranchFactor), maxBranchFactor(maxBranchFactor)
+	{
+		assert(minBranchFactor >= 1 && 2 * minBranchFactor <= maxBranchFactor + 1);
+		root.store(new Node(std::vector<Point>()), std::memory_order_release);
+	}
+
+	ConcurrentRTree::~ConcurrentRTree()
+	{
+		// Whatever is retired goes with the EpochManager
+		deleteSubtree(root.load());
+	}
+
+	void ConcurrentRTree::deleteSubtree(Node *node)
+	{
+		for (auto &slot : node->entries)
+		{
+			Entry *entry = slot.load();
+			deleteSubtree(entry->child);
+			delete entry;
+		}
+		delete node;
+	}
+
+	ConcurrentRTree::Node *ConcurrentRTree::loadRoot()
+	{
+		return root.load(std::memory_order_acquire);
+	}
+
+	std::vector<Point> ConcurrentRTree::exhaustiveSearch(Point requestedPoint)
+	{
+		EpochManager::Guard guard(epochs);
+		std::vector<Point> accumulator;
+		std::stack<Node *> context;
+		context.push(loadRoot());
+		while (!context.empty())
+		{
+			Node *node = context.top();
+			context.pop();
+			if (node->isLeaf)
+			{
+				for (const Point &p : node->data)
+				{
+					if (p == requestedPoint)
+					{
+						accumulator.push_back(p);
+					}
+				}
+				continue;
+			}
+			for (auto &slot : node->entries)
+			{
+				context.push(slot.load(std::memory_order_acquire)->child);
+			}
+		}
+		return accumulator;
+	}
+
+	std::vector<Point> ConcurrentRTree::search(Point requestedPoint)
+	{
+		EpochManager::Guard guard(epochs);
+		std::vector<Point> accumulator;
+		std::stack<Node *> context;
+		context.push(loadRoot());
+		while (!context.empty())
+		{
+			Node *node = context.top();
+			context.pop();
+			if (node->isLeaf)
+			{
+				for (const Point &p : node->data)
+				{
+					if (p == requestedPoint)
+					{
+						accumulator.push_back(p);
+					}
+				}
+				continue;
+			}
+			for (auto &slot : node->entries)
+			{
+				Entry *entry = slot.load(std::memory_order_acquire);
+				if (entry->boundingBox.containsPoint(requestedPoint))
+				{
+					context.push(entry->child);
+				}
+			}
+		}
+		return accumulator;
+	}
+
+	std::vector<Point> ConcurrentRTree::search(Rectangle requestedRectangle)
+	{
+		EpochManager::Guard guard(epochs);
+		std::vector<Point> accumulator;
+		std::stack<Node *> context;
+		context.push(loadRoot());
+		while (!context.empty())
+		{
+			Node *node = context.top();
+			context.pop();
+			if (node->isLeaf)
+			{
+				for (const Point &p : node->data)
+				{
+					if (requestedRectangle.containsPoint(p))
+					{
+						accumulator.push_back(p);
+					}
+				}
+				continue;
+			}
+			for (auto &slot : node->entries)
+			{
+				Entry *entry = slot.load(std::memory_order_acquire);
+				if (entry->boundingBox.intersectsRectangle(requestedRectangle))
+				{
+					context.push(entry->child);
+				}
+			}
+		}
+		return accumulator;
+	}
+
+	unsigned ConcurrentRTree::chooseEntry(Node *node, const Point &givenPoint)
+	{
+		// Least enlargement, then least area
+		unsigned chosen = 0;
+		double chosenEnlargement = std::numeric_limits<double>::infinity();
+		double chosenArea = std::numeric_limits<double>::infinity();
+		for (unsigned i = 0; i < node->entries.size(); ++i)
+		{
+			const Rectangle &box = node->entries[i].load(std::memory_order_acquire)->boundingBox;
+			double enlargement = std::max(0.0, box.computeExpansionArea(givenPoint));
+			double area = box.area();
+			if (enlargement < chosenEnlargement || (enlargement == chosenEnlargement && area < chosenArea))
+			{
+				chosen = i;
+				chosenEnlargement = enlargement;
+				chosenArea = area;
+			}
+		}
+		return chosen;
+	}
+
+	ConcurrentRTree::Node *ConcurrentRTree::chooseLeaf(Node *node, const Point &givenPoint, std::vector<Step> &path)
+	{
+		while (!node->isLeaf)
+		{
+			unsigned index = chooseEntry(node, givenPoint);
+			path.push_back({node, index});
+			node = node->entries[index].load(std::memory_order_acquire)->child;
+		}
+		return node;
+	}
+
+	ConcurrentRTree::Node *ConcurrentRTree::findLeaf(Node *node, const Point &givenPoint, std::vector<Step> &path)
+	{
+		if (node->isLeaf)
+		{
+			return std::find(node->data.begin(), node->data.end(), givenPoint) != node->data.end() ? node : nullptr;
+		}
+
+		for (unsigned i = 0; i < node->entries.size(); ++i)
+		{
+			Entry *entry = node->entries[i].load(std::memory_order_acquire);
+			if (!entry->boundingBox.containsPoint(givenPoint))
+			{
+				continue;
+			}
+			path.push_back({node, i});
+			Node *leaf = findLeaf(entry->child, givenPoint, path);
+			if (leaf != nullptr)
+			{
+				return leaf;
+			}
+			path.pop_back();
+		}
+		return nullptr;
+	}
+
+	void ConcurrentRTree::insert(Point givenPoint)
+	{
+		// Writers hold a guard too, so that nothing they are looking at,
+		// including a latch they are waiting on, is freed under them
+		EpochManager::Guard guard(epochs);
+		{
+			std::shared_lock<std::shared_mutex> structure(structureLatch);
+			for (;;)
+			{
+				// The root can't change while we hold the structure
+				// latch, but its entries can
+				Node *rootNode = loadRoot();
+				if (rootNode->isLeaf)
+				{
+					break;
+				}
+				unsigned index = chooseEntry(rootNode, givenPoint);
+				Node *subtree = rootNode->entries[index].load(std::memory_order_acquire)->child;
+				std::lock_guard<std::mutex> subtreeGuard(subtree->writeLatch);
+				if (rootNode->entries[index].load(std::memory_order_acquire)->child != subtree)
+				{
+					// Replaced by the writer we waited for
+					continue;
+				}
+
+				std::vector<Step> path = {{rootNode, index}};
+				Node *leaf = chooseLeaf(subtree, givenPoint, path);
+				if (insertAlong(path, leaf, givenPoint, false))
+				{
+					return;
+				}
+				break;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> structure(structureLatch);
+		exclusiveWrites++;
+		std::vector<Step> path;
+		Node *leaf = chooseLeaf(loadRoot(), givenPoint, path);
+		insertAlong(path, leaf, givenPoint, true);
+	}
+
+	bool ConcurrentRTree::insertAlong(std::vector<Step> &path, Node *leaf, const Point &givenPoint, bool exclusive)
+	{
+		// Work out the shallowest node the insert replaces before
+		// changing anything. The leaf is replaced, and if it splits its
+		// parent is replaced with one more entry, which splits it in
+		// turn if it was full. -1 means the root splits.
+		int depth = path.size();
+		int replaced = depth;
+		if (leaf->data.size() + 1 > maxBranchFactor)
+		{
+			replaced = depth - 1;
+			while (replaced >= 0 && path[replaced].node->entries.size() + 1 > maxBranchFactor)
+			{
+				replaced--;
+			}
+		}
+		if (!exclusive && replaced < 1)
+		{
+			return false;
+		}
+
+		// Grow the boxes above the change first, so that searches find
+		// the point as soon as it appears
+		for (int level = 0; level < replaced - 1; ++level)
+		{
+			Entry *entry = path[level].node->entries[path[level].index].load(std::memory_order_acquire);
+			if (!entry->boundingBox.containsPoint(givenPoint))
+			{
+				Entry *grown = new Entry{entry->boundingBox, entry->child};
+				grown->boundingBox.expand(givenPoint);
+				swapEntry(path[level], grown);
+			}
+		}
+
+		// Build the replacements bottom up, out of sight of searches
+		std::vector<Point> points = leaf->data;
+		points.push_back(givenPoint);
+		std::vector<Node *> replacements;
+		if (points.size() <= maxBranchFactor)
+		{
+			replacements.push_back(new Node(std::move(points)));
+		}
+		else
+		{
+			replacements = splitLeaf(points);
+		}
+		retireNode(leaf);
+
+		for (int level = depth - 1; level >= std::max(replaced, 0); --level)
+		{
+			Node *node = path[level].node;
+			unsigned index = path[level].index;
+			std::vector<Entry *> entries;
+			for (auto &slot : node->entries)
+			{
+				entries.push_back(slot.load(std::memory_order_acquire));
+			}
+			retireEntry(entries[index]);
+			entries[index] = new Entry{replacements[0]->boundingBox(), replacements[0]};
+			for (unsigned i = 1; i < replacements.size(); ++i)
+			{
+				entries.push_back(new Entry{replacements[i]->boundingBox(), replacements[i]});
+			}
+			replacements.clear();
+			if (entries.size() <= maxBranchFactor)
+			{
+				replacements.push_back(new Node(entries));
+			}
+			else
+			{
+				replacements = splitBranch(entries);
+			}
+			retireNode(node);
+		}
+
+		// And publish them with a single swap
+		if (replaced >= 1)
+		{
+			assert(replacements.size() == 1);
+			swapEntry(path[replaced - 1], new Entry{replacements[0]->boundingBox(), replacements[0]});
+		}
+		else if (replacements.size() == 1)
+		{
+			publishRoot(replacements[0]);
+		}
+		else
+		{
+			std::vector<Entry *> rootEntries;
+			for (Node *replacement : replacements)
+			{
+				rootEntries.push_back(new Entry{replacement->boundingBox(), replacement});
+			}
+			publishRoot(new Node(rootEntries));
+		}
+		return true;
+	}
+
+	void ConcurrentRTree::remove(Point givenPoint)
+	{
+		EpochManager::Guard guard(epochs);
+		{
+			std::shared_lock<std::shared_mutex> structure(structureLatch);
+			Node *rootNode = loadRoot();
+			bool needsExclusive = rootNode->isLeaf;
+			for (unsigned index = 0; !needsExclusive && index < rootNode->entries.size(); ++index)
+			{
+				Node *subtree = rootNode->entries[index].load(std::memory_order_acquire)->child;
+				std::unique_lock<std::mutex> subtreeGuard(subtree->writeLatch);
+				while (rootNode->entries[index].load(std::memory_order_acquire)->child != subtree)
+				{
+					// Replaced by the writer we waited for
+					subtreeGuard.unlock();
+					subtree = rootNode->entries[index].load(std::memory_order_acquire)->child;
+					subtreeGuard = std::unique_lock<std::mutex>(subtree->writeLatch);
+				}
+				Entry *entry = rootNode->entries[index].load(std::memory_order_acquire);
+				if (!entry->boundingBox.containsPoint(givenPoint))
+				{
+					continue;
+				}
+
+				std::vector<Step> path = {{rootNode, index}};
+				Node *leaf = findLeaf(subtree, givenPoint, path);
+				if (leaf == nullptr)
+				{
+					continue;
+				}
+				if (removeAlong(path, leaf, givenPoint, false))
+				{
+					return;
+				}
+				needsExclusive = true;
+			}
+			if (!needsExclusive)
+			{
+				return;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> structure(structureLatch);
+		exclusiveWrites++;
+		std::vector<Step> path;
+		Node *leaf = findLeaf(loadRoot(), givenPoint, path);
+		if (leaf != nullptr)
+		{
+			removeAlong(path, leaf, givenPoint, true);
+		}
+	}
+
+	bool ConcurrentRTree::removeAlong(std::vector<Step> &path, Node *leaf, const Point &givenPoint, bool exclusive)
+	{
+		std::vector<Point> points = leaf->data;
+		points.erase(std::find(points.begin(), points.end(), givenPoint));
+
+		// Work out the shallowest node the remove replaces. A leaf that
+		// empties is dropped from its parent, which is replaced with one
+		// entry fewer, and dropped in turn if that was its last. -1 means
+		// the root loses its last entry. A root leaf is just replaced.
+		int depth = path.size();
+		int replaced = depth;
+		if (points.empty() && depth > 0)
+		{
+			replaced = depth - 1;
+			while (replaced >= 0 && path[replaced].node->entries.size() == 1)
+			{
+				replaced--;
+			}
+		}
+		if (!exclusive && replaced < 1)
+		{
+			return false;
+		}
+
+		Node *replacement = nullptr;
+		if (!points.empty() || depth == 0)
+		{
+			replacement = new Node(std::move(points));
+		}
+		retireNode(leaf);
+
+		for (int level = depth - 1; level >= std::max(replaced, 0); --level)
+		{
+			Node *node = path[level].node;
+			unsigned index = path[level].index;
+			std::vector<Entry *> entries;
+			for (auto &slot : node->entries)
+			{
+				entries.push_back(slot.load(std::memory_order_acquire));
+			}
+			retireEntry(entries[index]);
+			if (replacement != nullptr)
+			{
+				entries[index] = new Entry{replacement->boundingBox(), replacement};
+			}
+			else
+			{
+				entries.erase(entries.begin() + index);
+			}
+			replacement = entries.empty() ? nullptr : new Node(entries);
+			retireNode(node);
+		}
+
+		if (replaced >= 1)
+		{
+			assert(replacement != nullptr);
+			swapEntry(path[replaced - 1], new Entry{replacement->boundingBox(), replacement});
+		}
+		else
+		{
+			publishRoot(replacement != nullptr ? replacement : new Node(std::vector<Point>()));
+		}
+
+		// Shrink the boxes above the change now the point is gone,
+		// stopping at the first that doesn't
+		for (int level = replaced - 2; level >= 0; --level)
+		{
+			Entry *entry = path[level].node->entries[path[level].index].load(std::memory_order_acquire);
+			Rectangle boundingBox = entry->child->boundingBox();
+			if (boundingBox == entry->boundingBox)
+			{
+				break;
+			}
+			swapEntry(path[level], new Entry{boundingBox, entry->child});
+		}
+		return true;
+	}
+
+	std::vector<ConcurrentRTree::Node *> ConcurrentRTree::splitLeaf(std::vector<Point> &points)
+	{
+		std::vector<Rectangle> boxes;
+		for (const Point &p : points)
+		{
+			boxes.push_back(Rectangle(p, Point::closest_larger_point(p)));
+		}
+		std::vector<unsigned> groupA, groupB;
+		quadraticSplit(boxes, groupA, groupB);
+
+		std::vector<Point> dataA, dataB;
+		for (unsigned i : groupA)
+		{
+			dataA.push_back(points[i]);
+		}
+		for (unsigned i : groupB)
+		{
+			dataB.push_back(points[i]);
+		}
+		return {new Node(std::move(dataA)), new Node(std::move(dataB))};
+	}
+
+	std::vector<ConcurrentRTree::Node *> ConcurrentRTree::splitBranch(std::vector<Entry *> &entries)
+	{
+		std::vector<Rectangle> boxes;
+		for (Entry *entry : entries)
+		{
+			boxes.push_back(entry->boundingBox);
+		}
+		std::vector<unsigned> groupA, groupB;
+		quadraticSplit(boxes, groupA, groupB);
+
+		std::vector<Entry *> entriesA, entriesB;
+		for (unsigned i : groupA)
+		{
+			entriesA.push_back(entries[i]);
+		}
+		for (unsigned i : groupB)
+		{
+			entriesB.push_back(entries[i]);
+		}
+		return {new Node(entriesA), new Node(entriesB)};
+	}
+
+	void ConcurrentRTree::quadraticSplit(const std::vector<Rectangle> &boxes, std::vector<unsigned> &groupA, std::vector<unsigned> &groupB)
+	{
+		// QS1 [Pick the pair that would waste the most area together]
+		unsigned seedA = 0;
+		unsigned seedB = 1;
+		double maxWasted = -std::numeric_limits<double>::infinity();
+		for (unsigned i = 0; i < boxes.size(); ++i)
+		{
+			for (unsigned j = i + 1; j < boxes.size(); ++j)
+			{
+				Rectangle combined = boxes[i];
+				combined.expand(boxes[j]);
+				double wasted = combined.area() - boxes[i].area() - boxes[j].area();
+				if (wasted > maxWasted)
+				{
+					maxWasted = wasted;
+					seedA = i;
+					seedB = j;
+				}
+			}
+		}
+
+		groupA.push_back(seedA);
+		groupB.push_back(seedB);
+		Rectangle boundingBoxA = boxes[seedA];
+		Rectangle boundingBoxB = boxes[seedB];
+		std::vector<bool> assigned(boxes.size(), false);
+		assigned[seedA] = true;
+		assigned[seedB] = true;
+		unsigned remaining = boxes.size() - 2;
+
+		while (remaining > 0)
+		{
+			// QS2 [Give a group everything left if it needs it all]
+			if (groupA.size() + remaining <= minBranchFactor || groupB.size() + remaining <= minBranchFactor)
+			{
+				std::vector<unsigned> &group = groupA.size() + remaining <= minBranchFactor ? groupA : groupB;
+				for (unsigned i = 0; i < boxes.size(); ++i)
+				{
+					if (!assigned[i])
+					{
+						group.push_back(i);
+					}
+				}
+				break;
+			}
+
+			// PN1 [Find the entry with the greatest preference for a group]
+			unsigned chosen = 0;
+			double chosenA = 0.0;
+			double chosenB = 0.0;
+			double maxPreference = -1.0;
+			for (unsigned i = 0; i < boxes.size(); ++i)
+			{
+				if (assigned[i])
+				{
+					continue;
+				}
+				double expansionA = std::max(0.0, boundingBoxA.computeExpansionArea(boxes[i]));
+				double expansionB = std::max(0.0, boundingBoxB.computeExpansionArea(boxes[i]));
+				double preference = std::fabs(expansionA - expansionB);
+				if (preference > maxPreference)
+				{
+					maxPreference = preference;
+					chosen = i;
+					chosenA = expansionA;
+					chosenB = expansionB;
+				}
+			}
+
+			// QS3 [Least enlargement, then least area, then fewest entries]
+			bool toA = chosenA < chosenB;
+			if (chosenA == chosenB)
+			{
+				toA = boundingBoxA.area() < boundingBoxB.area() || (boundingBoxA.area() == boundingBoxB.area() && groupA.size() <= groupB.size());
+			}
+			if (toA)
+			{
+				groupA.push_back(chosen);
+				boundingBoxA.expand(boxes[chosen]);
+			}
+			else
+			{
+				groupB.push_back(chosen);
+				boundingBoxB.expand(boxes[chosen]);
+			}
+			assigned[chosen] = true;
+			remaining--;
+		}
+	}
+
+	void ConcurrentRTree::publishRoot(Node *newRoot)
+	{
+		root.store(newRoot, std::memory_order_release);
+	}
+
+	void ConcurrentRTree::swapEntry(const Step &step, Entry *entry)
+	{
+		Entry *old = step.node->entries[step.index].exchange(entry, std::memory_order_acq_rel);
+		retireEntry(old);
+	}
+
+	void ConcurrentRTree::retireEntry(Entry *entry)
+	{
+		epochs.retire([entry]() { delete entry; });
+	}
+
+	void ConcurrentRTree::retireNode(Node *node)
+	{
+		// Its entries live on in whatever replaced it, or are retired on
+		// their own
+		epochs.retire([node]() { delete node; });
+	}
+
+	size_t ConcurrentRTree::reclaim()
+	{
+		return epochs.reclaim();
+	}
+
+	unsigned ConcurrentRTree::checksum(Node *node)
+	{
+		unsigned sum = 0;
+		if (node->isLeaf)
+		{
+			for (const Point &p : node->data)
+			{
+				for (unsigned d = 0; d < dimensions; ++d)
+				{
+					sum += (unsigned) p[d];
+				}
+			}
+			return sum;
+		}
+
+		for (auto &slot : node->entries)
+		{
+			sum += checksum(slot.load(std::memory_order_acquire)->child);
+		}
+		return sum;
+	}
+
+	unsigned ConcurrentRTree::checksum()
+	{
+		EpochManager::Guard guard(epochs);
+		return checksum(loadRoot());
+	}
+
+	bool ConcurrentRTree::validate(Node *node, unsigned depth, int &leafDepth)
+	{
+		if (node->isLeaf)
+		{
+			if (leafDepth == -1)
+			{
+				leafDepth = depth;
+			}
+			if ((int) depth != leafDepth)
+			{
+				std::cout << "Leaf at depth " << depth << " rather than " << leafDepth << std::endl;
+				return false;
+			}
+			if (node->data.size() > maxBranchFactor || (depth > 0 && node->data.empty()))
+			{
+				std::cout << "Leaf holds " << node->data.size() << " points" << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+		if (node->entries.empty() || node->entries.size() > maxBranchFactor)
+		{
+			std::cout << "Branch holds " << node->entries.size() << " entries" << std::endl;
+			return false;
+		}
+		for (auto &slot : node->entries)
+		{
+			Entry *entry = slot.load(std::memory_order_acquire);
+			if (!entry->boundingBox.containsRectangle(entry->child->boundingBox()))
+			{
+				std::cout << "Box " << entry->boundingBox << " doesn't cover its child's " << entry->child->boundingBox() << std::endl;
+				return false;
+			}
+			if (!validate(entry->child, depth + 1, leafDepth))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ConcurrentRTree::validate()
+	{
+		EpochManager::Guard guard(epochs);
+		int leafDepth = -1;
+		return validate(loadRoot(), 0, leafDepth);
+	}
+
+	void ConcurrentRTree::stat()
+	{
+		EpochManager::Guard guard(epochs);
+		size_t branches = 0;
+		size_t leaves = 0;
+		size_t points = 0;
+		unsigned height = 0;
+		std::stack<std::pair<Node *, unsigned>> context;
+		context.push(std::make_pair(loadRoot(), 1));
+		while (!context.empty())
+		{
+			Node *node = context.top().first;
+			unsigned depth = context.top().second;
+			context.pop();
+			height = std::max(height, depth);
+			if (node->isLeaf)
+			{
+				leaves++;
+				points += node->data.size();
+				continue;
+			}
+			branches++;
+			for (auto &slot : node->entries)
+			{
+				context.push(std::make_pair(slot.load(std::memory_order_acquire)->child, depth + 1));
+			}
+		}
+
+		std::cout << "Height: " << height << std::endl;
+		std::cout << "Branches: " << branches << std::endl;
+		std::cout << "Leaves: " << leaves << std::endl;
+		std::cout << "Points: " << points << std::endl;
+		std::cout << "Writes that held the whole tree: " << exclusiveWrites.load() << std::endl;
+		std::cout << "Retired and not yet freed: " << epochs.pending() << std::endl;
+	}
+
+	void ConcurrentRTree::print()
+	{
+		EpochManager::Guard guard(epochs);
+		std::stack<std::pair<Node *, unsigned>> context;
+		context.push(std::make_pair(loadRoot(), 0));
+		while (!context.empty())
+		{
+			Node *node = context.top().first;
+			unsigned depth = context.top().second;
+			std::string indentation(depth * 4, ' ');
+			context.pop();
+			std::cout << indentation << "Node " << (void *) node << std::endl;
+			if (node->isLeaf)
+			{
+				for (const Point &p : node->data)
+				{
+					std::cout << indentation << "    " << p << std::endl;
+				}
+				continue;
+			}
+			for (auto &slot : node->entries)
+			{
+				Entry *entry = slot.load(std::memory_order_acquire);
+				std::cout << indentation << "    " << entry->boundingBox << std::endl;
+				context.push(std::make_pair(entry->child, depth + 1));
+			}
+		}
+	}
+
+	void ConcurrentRTree::visualize()
+	{
+	}
+}
@@ -0,0 +1,126 @@
+#include <server/client.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+query_client::query_client( const std::string &socket_path ) :
+    fd_( -1 ), next_request_id_( 0 ) {
+    struct sockaddr_un addr;
+    if( socket_path.size() >= sizeof(addr.sun_path) ) {
+        throw std::runtime_error( "Socket path too long: " + socket_path );
+    }
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, socket_path.c_str() );
+
+    fd_ = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( fd_ == -1 or connect( fd_, (struct sockaddr *) &addr, sizeof(addr)
+                ) == -1 ) {
+        std::string reason = strerror( errno );
+        if( fd_ != -1 ) {
+            close( fd_ );
+        }
+        throw std::runtime_error( "Could not connect to " + socket_path +
+                ": " + reason );
+    }
+}
+
+query_client::~query_client() {
+    if( fd_ != -1 ) {
+        close( fd_ );
+    }
+}
+
+void query_client::write_fully( const char *data, size_t len ) {
+    while( len > 0 ) {
+        ssize_t written = ::send( fd_, data, len, MSG_NOSIGNAL );
+        if( written == -1 and errno == EINTR ) {
+            continue;
+        }
+        if( written <= 0 ) {
+            throw std::runtime_error( std::string( "Lost connection to "
+                        "server: " ) + strerror( errno ) );
+        }
+        data += written;
+        len -= written;
+    }
+}
+
+void query_client::read_fully( char *data, size_t len ) {
+    while( len > 0 ) {
+        ssize_t got = read( fd_, data, len );
+        if( got == -1 and errno == EINTR ) {
+            continue;
+        }
+        if( got <= 0 ) {
+            throw std::runtime_error( "Lost connection to server" );
+        }
+        data += got;
+        len -= got;
+    }
+}
+
+uint32_t query_client::send( const std::vector<operation> &ops ) {
+    uint32_t request_id = next_request_id_++;
+    buffer_.clear();
+    encode_request( request_id, ops, buffer_ );
+    write_fully( buffer_.data(), buffer_.size() );
+    return request_id;
+}
+
+std::vector<std::vector<Point>> query_client::receive( uint32_t
+        &request_id ) {
+    uint32_t frame_length;
+    read_fully( (char *) &frame_length, sizeof(frame_length) );
+    if( frame_length < sizeof(response_header) or frame_length >
+            MAX_FRAME_SIZE ) {
+        throw std::runtime_error( "Malformed response from server" );
+    }
+
+    buffer_.resize( frame_length );
+    memcpy( buffer_.data(), &frame_length, sizeof(frame_length) );
+    read_fully( buffer_.data() + sizeof(frame_length), frame_length -
+            sizeof(frame_length) );
+
+    response_header header;
+    std::vector<std::vector<Point>> results;
+    if( not decode_response( buffer_.data(), frame_length, header, results
+                ) ) {
+        throw std::runtime_error( "Malformed response from server" );
+    }
+    if( header.status_ != STATUS_OK ) {
+        throw std::runtime_error( "Server rejected request" );
+    }
+    request_id = header.request_id_;
+    return results;
+}
+
+std::vector<std::vector<Point>> query_client::batch( const
+        std::vector<operation> &ops ) {
+    uint32_t sent_id = send( ops );
+    uint32_t received_id;
+    std::vector<std::vector<Point>> results = receive( received_id );
+    if( received_id != sent_id or results.size() != ops.size() ) {
+        throw std::runtime_error( "Out of order response from server" );
+    }
+    return results;
+}
+
+void query_client::insert( const Point &p ) {
+    batch( { operation::insert( p ) } );
+}
+
+std::vector<Point> query_client::search( const Point &p ) {
+    return batch( { operation::point_query( p ) } )[0];
+}
+
+std::vector<Point> query_client::search( const Rectangle &r ) {
+    return batch( { operation::range_query( r ) } )[0];
+}
+
+std::vector<Point> query_client::nearest( const Point &p, uint32_t k ) {
+    return batch( { operation::knn_query( p, k ) } )[0];
+}
@@ -0,0 +1,165 @@
+#include <server/loadgen.h>
+#include <server/client.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+load_generator_config::load_generator_config() :
+    socket_path_( "" ), connections_( 4 ), requests_per_connection_(
+            10000 ), batch_size_( 1 ), pipeline_depth_( 8 ), seed_( 3141 ),
+    insert_fraction_( 0.1 ), range_fraction_( 0.2 ), knn_fraction_( 0.05 ),
+    k_( 10 ), space_( 0.0, 0.0, 1.0, 1.0 ), range_extent_( 0.01 ) {}
+
+namespace {
+
+struct connection_result {
+    size_t operations_;
+    size_t points_returned_;
+    std::vector<double> latencies_;
+};
+
+class operation_mix {
+public:
+    operation_mix( const load_generator_config &config, unsigned seed ) :
+        config_( config ), generator_( seed ), unit_( 0.0, 1.0 ) {}
+
+    operation next() {
+        double choice = unit_( generator_ );
+        if( choice < config_.insert_fraction_ ) {
+            return operation::insert( random_point() );
+        }
+        choice -= config_.insert_fraction_;
+        if( choice < config_.range_fraction_ ) {
+            Point lower = random_point();
+            Point upper = lower;
+            for( unsigned d = 0; d < dimensions; d++ ) {
+                upper[d] += config_.range_extent_ *
+                    (config_.space_.upperRight[d] -
+                     config_.space_.lowerLeft[d]);
+            }
+            return operation::range_query( Rectangle( lower, upper ) );
+        }
+        choice -= config_.range_fraction_;
+        if( choice < config_.knn_fraction_ ) {
+            return operation::knn_query( random_point(), config_.k_ );
+        }
+        return operation::point_query( random_point() );
+    }
+
+private:
+    Point random_point() {
+        Point p;
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            p[d] = config_.space_.lowerLeft[d] + unit_( generator_ ) *
+                (config_.space_.upperRight[d] - config_.space_.lowerLeft[d]);
+        }
+        return p;
+    }
+
+    const load_generator_config &config_;
+    std::default_random_engine generator_;
+    std::uniform_real_distribution<double> unit_;
+};
+
+void drive_connection( const load_generator_config &config, unsigned
+        connection_number, connection_result &result ) {
+    using clock = std::chrono::steady_clock;
+
+    query_client client( config.socket_path_ );
+    operation_mix mix( config, config.seed_ + connection_number );
+    std::unordered_map<uint32_t, clock::time_point> in_flight;
+    std::vector<operation> ops;
+
+    result.operations_ = 0;
+    result.points_returned_ = 0;
+    unsigned sent = 0;
+    unsigned received = 0;
+    while( received < config.requests_per_connection_ ) {
+        while( sent < config.requests_per_connection_ and in_flight.size()
+                < config.pipeline_depth_ ) {
+            ops.clear();
+            for( unsigned i = 0; i < config.batch_size_; i++ ) {
+                ops.push_back( mix.next() );
+            }
+            uint32_t request_id = client.send( ops );
+            in_flight[request_id] = clock::now();
+            result.operations_ += ops.size();
+            sent++;
+        }
+
+        uint32_t request_id;
+        std::vector<std::vector<Point>> results = client.receive(
+                request_id );
+        std::chrono::duration<double> latency = clock::now() -
+            in_flight.at( request_id );
+        in_flight.erase( request_id );
+        result.latencies_.push_back( latency.count() );
+        for( const std::vector<Point> &points : results ) {
+            result.points_returned_ += points.size();
+        }
+        received++;
+    }
+}
+
+}
+
+load_generator_report run_load_generator( const load_generator_config
+        &config ) {
+    std::vector<connection_result> results( config.connections_ );
+    std::vector<std::thread> workers;
+
+    auto begin = std::chrono::steady_clock::now();
+    for( unsigned i = 0; i < config.connections_; i++ ) {
+        workers.emplace_back( drive_connection, std::cref( config ), i,
+                std::ref( results[i] ) );
+    }
+    for( std::thread &worker : workers ) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - begin;
+
+    load_generator_report report;
+    report.requests_ = 0;
+    report.operations_ = 0;
+    report.points_returned_ = 0;
+    report.seconds_ = elapsed.count();
+    std::vector<double> latencies;
+    for( connection_result &result : results ) {
+        report.operations_ += result.operations_;
+        report.points_returned_ += result.points_returned_;
+        latencies.insert( latencies.end(), result.latencies_.begin(),
+                result.latencies_.end() );
+    }
+    report.requests_ = latencies.size();
+
+    std::sort( latencies.begin(), latencies.end() );
+    auto percentile = [&latencies]( double fraction ) {
+        if( latencies.empty() ) {
+            return 0.0;
+        }
+        return latencies[(size_t) (fraction * (latencies.size() - 1))];
+    };
+    report.p50_latency_ = percentile( 0.5 );
+    report.p99_latency_ = percentile( 0.99 );
+    report.max_latency_ = percentile( 1.0 );
+    return report;
+}
+
+void print_load_generator_report( const load_generator_report &report ) {
+    std::cout << "Requests: " << report.requests_ << std::endl;
+    std::cout << "Operations: " << report.operations_ << std::endl;
+    std::cout << "Points returned: " << report.points_returned_ << std::endl;
+    std::cout << "Total time: " << report.seconds_ << "s" << std::endl;
+    std::cout << "Requests per second: " << report.requests_ /
+        report.seconds_ << std::endl;
+    std::cout << "Operations per second: " << report.operations_ /
+        report.seconds_ << std::endl;
+    std::cout << "p50 latency: " << report.p50_latency_ << "s" << std::endl;
+    std::cout << "p99 latency: " << report.p99_latency_ << "s" << std::endl;
+    std::cout << "Max latency: " << report.max_latency_ << "s" << std::endl;
+}
@@ -0,0 +1,168 @@
+#include <server/protocol.h>
+#include <cstring>
+
+operation operation::insert( const Point &p ) {
+    return operation{ OP_INSERT, 0, p, Rectangle() };
+}
+
+operation operation::point_query( const Point &p ) {
+    return operation{ OP_POINT_QUERY, 0, p, Rectangle() };
+}
+
+operation operation::range_query( const Rectangle &r ) {
+    return operation{ OP_RANGE_QUERY, 0, Point(), r };
+}
+
+operation operation::knn_query( const Point &p, uint32_t k ) {
+    return operation{ OP_KNN_QUERY, k, p, Rectangle() };
+}
+
+static void append( std::vector<char> &out, const void *data, size_t len )
+{
+    const char *bytes = (const char *) data;
+    out.insert( out.end(), bytes, bytes + len );
+}
+
+static void append_point( std::vector<char> &out, const Point &p ) {
+    append( out, p.values, sizeof(double) * dimensions );
+}
+
+// Reads len bytes at cursor, refusing to run off the end of the frame.
+static bool take( const char *&cursor, const char *end, void *data, size_t
+        len ) {
+    if( (size_t) (end - cursor) < len ) {
+        return false;
+    }
+    memcpy( data, cursor, len );
+    cursor += len;
+    return true;
+}
+
+static bool take_point( const char *&cursor, const char *end, Point &p ) {
+    return take( cursor, end, p.values, sizeof(double) * dimensions );
+}
+
+void encode_operation( const operation &op, std::vector<char> &out ) {
+    operation_header header;
+    header.opcode_ = op.opcode_;
+    header.padding_ = 0;
+    header.k_ = op.k_;
+    append( out, &header, sizeof(header) );
+    if( op.opcode_ == OP_RANGE_QUERY ) {
+        append_point( out, op.rectangle_.lowerLeft );
+        append_point( out, op.rectangle_.upperRight );
+    } else {
+        append_point( out, op.point_ );
+    }
+}
+
+void encode_request( uint32_t request_id, const std::vector<operation>
+        &ops, std::vector<char> &out ) {
+    size_t start = out.size();
+    request_header header;
+    header.frame_length_ = 0;
+    header.request_id_ = request_id;
+    header.count_ = ops.size();
+    header.padding_ = 0;
+    append( out, &header, sizeof(header) );
+    for( const operation &op : ops ) {
+        encode_operation( op, out );
+    }
+
+    // Now that we know how long it is
+    uint32_t frame_length = out.size() - start;
+    memcpy( out.data() + start, &frame_length, sizeof(frame_length) );
+}
+
+bool decode_request( const char *frame, size_t frame_length,
+        request_header &header, std::vector<operation> &ops ) {
+    const char *cursor = frame;
+    const char *end = frame + frame_length;
+    if( not take( cursor, end, &header, sizeof(header) ) or
+            header.frame_length_ != frame_length ) {
+        return false;
+    }
+
+    ops.clear();
+    for( uint32_t i = 0; i < header.count_; i++ ) {
+        operation_header op_header;
+        if( not take( cursor, end, &op_header, sizeof(op_header) ) ) {
+            return false;
+        }
+
+        operation op;
+        op.opcode_ = (operation_code) op_header.opcode_;
+        op.k_ = op_header.k_;
+        switch( op.opcode_ ) {
+            case OP_INSERT:
+            case OP_POINT_QUERY:
+            case OP_KNN_QUERY:
+                if( not take_point( cursor, end, op.point_ ) ) {
+                    return false;
+                }
+                break;
+            case OP_RANGE_QUERY:
+                if( not take_point( cursor, end, op.rectangle_.lowerLeft ) or
+                        not take_point( cursor, end,
+                            op.rectangle_.upperRight ) ) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+        ops.push_back( op );
+    }
+
+    return cursor == end;
+}
+
+void encode_response( uint32_t request_id, response_status status, const
+        std::vector<std::vector<Point>> &results, std::vector<char> &out ) {
+    size_t start = out.size();
+    response_header header;
+    header.frame_length_ = 0;
+    header.request_id_ = request_id;
+    header.count_ = results.size();
+    header.status_ = status;
+    header.padding_ = 0;
+    append( out, &header, sizeof(header) );
+    for( const std::vector<Point> &result : results ) {
+        uint32_t point_count = result.size();
+        append( out, &point_count, sizeof(point_count) );
+        for( const Point &p : result ) {
+            append_point( out, p );
+        }
+    }
+
+    uint32_t frame_length = out.size() - start;
+    memcpy( out.data() + start, &frame_length, sizeof(frame_length) );
+}
+
+bool decode_response( const char *frame, size_t frame_length,
+        response_header &header, std::vector<std::vector<Point>> &results )
+{
+    const char *cursor = frame;
+    const char *end = frame + frame_length;
+    if( not take( cursor, end, &header, sizeof(header) ) or
+            header.frame_length_ != frame_length ) {
+        return false;
+    }
+
+    results.clear();
+    results.resize( header.count_ );
+    for( uint32_t i = 0; i < header.count_; i++ ) {
+        uint32_t point_count;
+        if( not take( cursor, end, &point_count, sizeof(point_count) ) or
+                point_count > (size_t) (end - cursor) / (sizeof(double) *
+                    dimensions) ) {
+            return false;
+        }
+        results[i].resize( point_count );
+        for( uint32_t j = 0; j < point_count; j++ ) {
+            take_point( cursor, end, results[i][j] );
+        }
+    }
+
+    return cursor == end;
+}
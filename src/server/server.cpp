@@ -0,0 +1,465 @@
+#include <server/server.h>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Past this half-width the data can't be any further away, so just take
+// everything. For indexes that can't say where their points are.
+#define KNN_MAX_RADIUS 1e12
+
+// Half-width of the first box to search around p for k neighbours, and
+// the half-width past which the box holds every point. Taking the
+// points as spread evenly over bounds, a cube of side s holds about
+// point_count * s^dimensions / volume of them.
+static void knn_radius_from_extent( const Rectangle &bounds, uint64_t
+        point_count, const Point &p, unsigned k, double &radius, double
+        &max_radius ) {
+    double volume = 1.0;
+    double widest = 0.0;
+    double gap = 0.0;
+    max_radius = 0.0;
+    for( unsigned d = 0; d < dimensions; d++ ) {
+        double side = bounds.upperRight[d] - bounds.lowerLeft[d];
+        volume *= side;
+        widest = std::max( widest, side );
+        gap = std::max( { gap, bounds.lowerLeft[d] - p[d], p[d] -
+                bounds.upperRight[d] } );
+        max_radius = std::max( { max_radius, p[d] - bounds.lowerLeft[d],
+                bounds.upperRight[d] - p[d] } );
+    }
+
+    double share = std::min( 1.0, (double) k / point_count );
+    double side = volume > 0.0 ? std::pow( share * volume, 1.0 /
+            dimensions ) : share * widest;
+    // A query outside the data has to reach it first
+    radius = gap + side / 2.0;
+    if( not (radius > 0.0) ) {
+        radius = max_radius;
+    }
+}
+
+std::vector<Point> nearest_neighbours( Index *index, const Point &p,
+        unsigned k ) {
+    if( k == 0 ) {
+        return {};
+    }
+
+    auto box_around = [&p]( double radius ) {
+        return Rectangle( p - Point( radius ), Point::closest_larger_point(
+                    p + Point( radius ) ) );
+    };
+
+    double radius = 1.0;
+    double max_radius = KNN_MAX_RADIUS;
+    Rectangle bounds;
+    uint64_t point_count;
+    if( index->extent( bounds, point_count ) ) {
+        if( point_count == 0 ) {
+            return {};
+        }
+        knn_radius_from_extent( bounds, point_count, p, k, radius,
+                max_radius );
+    }
+
+    std::vector<Point> candidates;
+    while( true ) {
+        if( radius >= max_radius ) {
+            candidates = index->search( Rectangle( Point::atNegInfinity,
+                        Point::atInfinity ) );
+            radius = std::numeric_limits<double>::infinity();
+            break;
+        }
+        candidates = index->search( box_around( radius ) );
+        if( candidates.size() >= k ) {
+            break;
+        }
+        radius *= 4.0;
+    }
+
+    auto closer = [&p]( const Point &a, const Point &b ) {
+        return a.distance( p ) < b.distance( p );
+    };
+    if( candidates.size() >= k ) {
+        std::nth_element( candidates.begin(), candidates.begin() + (k-1),
+                candidates.end(), closer );
+        double kth_distance = candidates[k-1].distance( p );
+        if( kth_distance > radius ) {
+            // Something just outside the box could beat a corner point
+            candidates = index->search( box_around( kth_distance ) );
+        }
+    }
+
+    std::sort( candidates.begin(), candidates.end(), closer );
+    if( candidates.size() > k ) {
+        candidates.resize( k );
+    }
+    return candidates;
+}
+
+static void set_nonblocking( int fd ) {
+    int flags = fcntl( fd, F_GETFL, 0 );
+    assert( flags != -1 );
+    int rc = fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+    assert( rc != -1 );
+}
+
+query_server::query_server( Index *index, std::string socket_path ) :
+    index_( index ), socket_path_( socket_path ), listen_fd_( -1 ),
+    epoll_fd_( -1 ), requests_served_( 0 ), batches_executed_( 0 ) {
+    wake_fds_[0] = -1;
+    wake_fds_[1] = -1;
+}
+
+query_server::~query_server() {
+    for( auto &entry : connections_ ) {
+        close( entry.first );
+    }
+    if( listen_fd_ != -1 ) {
+        close( listen_fd_ );
+        unlink( socket_path_.c_str() );
+    }
+    if( epoll_fd_ != -1 ) {
+        close( epoll_fd_ );
+    }
+    if( wake_fds_[0] != -1 ) {
+        close( wake_fds_[0] );
+        close( wake_fds_[1] );
+    }
+}
+
+void query_server::listen() {
+    struct sockaddr_un addr;
+    if( socket_path_.size() >= sizeof(addr.sun_path) ) {
+        throw std::runtime_error( "Socket path too long: " + socket_path_ );
+    }
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, socket_path_.c_str() );
+
+    listen_fd_ = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( listen_fd_ == -1 ) {
+        throw std::runtime_error( std::string( "socket: " ) + strerror(
+                    errno ) );
+    }
+    unlink( socket_path_.c_str() );
+    if( bind( listen_fd_, (struct sockaddr *) &addr, sizeof(addr) ) == -1
+            or ::listen( listen_fd_, SOMAXCONN ) == -1 ) {
+        throw std::runtime_error( "Could not listen on " + socket_path_ +
+                ": " + strerror( errno ) );
+    }
+    set_nonblocking( listen_fd_ );
+
+    int rc = pipe2( wake_fds_, O_NONBLOCK );
+    assert( rc == 0 );
+
+    epoll_fd_ = epoll_create1( 0 );
+    assert( epoll_fd_ != -1 );
+    for( int fd : { listen_fd_, wake_fds_[0] } ) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, fd, &event );
+        assert( rc == 0 );
+    }
+}
+
+void query_server::stop() {
+    char byte = 0;
+    ssize_t rc = write( wake_fds_[1], &byte, 1 );
+    (void) rc;
+}
+
+void query_server::run() {
+    struct epoll_event events[64];
+    std::vector<int> closing;
+    bool running = true;
+
+    while( running ) {
+        int ready = epoll_wait( epoll_fd_, events, 64, -1 );
+        if( ready == -1 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            throw std::runtime_error( std::string( "epoll_wait: " ) +
+                    strerror( errno ) );
+        }
+
+        for( int i = 0; i < ready; i++ ) {
+            int fd = events[i].data.fd;
+            if( fd == wake_fds_[0] ) {
+                running = false;
+                continue;
+            }
+            if( fd == listen_fd_ ) {
+                accept_connections();
+                continue;
+            }
+
+            auto search = connections_.find( fd );
+            if( search == connections_.end() ) {
+                continue;
+            }
+            connection &conn = *search->second;
+            bool open = true;
+            if( events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) ) {
+                open = read_from( conn );
+            }
+            if( open and (events[i].events & EPOLLOUT) ) {
+                open = flush( conn );
+            }
+            if( not open ) {
+                closing.push_back( fd );
+            }
+        }
+
+        // Closing is deferred until the batch has run so that a
+        // recycled fd can't receive someone else's replies.
+        execute_batch();
+        for( int fd : closing ) {
+            close_connection( fd );
+        }
+        closing.clear();
+    }
+}
+
+void query_server::accept_connections() {
+    while( true ) {
+        int fd = accept( listen_fd_, nullptr, nullptr );
+        if( fd == -1 ) {
+            // EAGAIN once the backlog is drained, anything else we
+            // leave for the next wakeup
+            return;
+        }
+        set_nonblocking( fd );
+
+        std::unique_ptr<connection> conn = std::make_unique<connection>();
+        conn->fd_ = fd;
+        conn->out_offset_ = 0;
+        conn->want_write_ = false;
+        connections_[fd] = std::move( conn );
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        int rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, fd, &event );
+        assert( rc == 0 );
+    }
+}
+
+bool query_server::read_from( connection &conn ) {
+    char buffer[65536];
+    bool open = true;
+    while( true ) {
+        ssize_t len = read( conn.fd_, buffer, sizeof(buffer) );
+        if( len > 0 ) {
+            conn.in_.insert( conn.in_.end(), buffer, buffer + len );
+            continue;
+        }
+        if( len == -1 and (errno == EAGAIN or errno == EWOULDBLOCK) ) {
+            break;
+        }
+        if( len == -1 and errno == EINTR ) {
+            continue;
+        }
+        // EOF or a real error. Still run whatever complete requests we
+        // got first.
+        open = false;
+        break;
+    }
+
+    size_t consumed = 0;
+    while( conn.in_.size() - consumed >= sizeof(uint32_t) ) {
+        uint32_t frame_length;
+        memcpy( &frame_length, conn.in_.data() + consumed,
+                sizeof(frame_length) );
+        if( frame_length < sizeof(request_header) or frame_length >
+                MAX_FRAME_SIZE ) {
+            return false;
+        }
+        if( conn.in_.size() - consumed < frame_length ) {
+            break;
+        }
+
+        pending_request request;
+        request.fd_ = conn.fd_;
+        request_header header;
+        if( decode_request( conn.in_.data() + consumed, frame_length,
+                    header, request.ops_ ) ) {
+            request.request_id_ = header.request_id_;
+        } else {
+            // Answered with STATUS_BAD_REQUEST and no results
+            memcpy( &request.request_id_, conn.in_.data() + consumed +
+                    offsetof(request_header, request_id_),
+                    sizeof(request.request_id_) );
+            request.ops_.clear();
+            request.results_.resize( 1 );
+        }
+        pending_.emplace_back( std::move( request ) );
+        consumed += frame_length;
+    }
+    conn.in_.erase( conn.in_.begin(), conn.in_.begin() + consumed );
+
+    return open;
+}
+
+bool query_server::flush( connection &conn ) {
+    while( conn.out_offset_ < conn.out_.size() ) {
+        ssize_t len = send( conn.fd_, conn.out_.data() + conn.out_offset_,
+                conn.out_.size() - conn.out_offset_, MSG_NOSIGNAL );
+        if( len > 0 ) {
+            conn.out_offset_ += len;
+            continue;
+        }
+        if( len == -1 and errno == EINTR ) {
+            continue;
+        }
+        if( len == -1 and (errno == EAGAIN or errno == EWOULDBLOCK) ) {
+            // Finish when the socket drains
+            if( not conn.want_write_ ) {
+                struct epoll_event event;
+                event.events = EPOLLIN | EPOLLOUT;
+                event.data.fd = conn.fd_;
+                int rc = epoll_ctl( epoll_fd_, EPOLL_CTL_MOD, conn.fd_,
+                        &event );
+                assert( rc == 0 );
+                conn.want_write_ = true;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    conn.out_.clear();
+    conn.out_offset_ = 0;
+    if( conn.want_write_ ) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = conn.fd_;
+        int rc = epoll_ctl( epoll_fd_, EPOLL_CTL_MOD, conn.fd_, &event );
+        assert( rc == 0 );
+        conn.want_write_ = false;
+    }
+    return true;
+}
+
+void query_server::close_connection( int fd ) {
+    epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, fd, nullptr );
+    close( fd );
+    connections_.erase( fd );
+}
+
+void query_server::execute_batch() {
+    if( pending_.empty() ) {
+        return;
+    }
+
+    // Operations run in arrival order, except that each run of reads
+    // between two writes is handed to execute_reads as a whole. A
+    // client never sees a read reordered around its own writes.
+    std::vector<std::pair<pending_request *, size_t>> reads;
+    for( pending_request &request : pending_ ) {
+        if( request.ops_.empty() ) {
+            continue;
+        }
+        request.results_.resize( request.ops_.size() );
+        for( size_t i = 0; i < request.ops_.size(); i++ ) {
+            const operation &op = request.ops_[i];
+            if( op.is_read() ) {
+                reads.emplace_back( &request, i );
+                continue;
+            }
+            execute_reads( reads );
+            index_->insert( op.point_ );
+        }
+    }
+    execute_reads( reads );
+
+    for( pending_request &request : pending_ ) {
+        auto search = connections_.find( request.fd_ );
+        if( search == connections_.end() ) {
+            continue;
+        }
+        connection &conn = *search->second;
+        bool malformed = request.ops_.empty() and not
+            request.results_.empty();
+        if( malformed ) {
+            request.results_.clear();
+        }
+        encode_response( request.request_id_, malformed ?
+                STATUS_BAD_REQUEST : STATUS_OK, request.results_,
+                conn.out_ );
+        requests_served_++;
+    }
+
+    for( auto &entry : connections_ ) {
+        if( not entry.second->out_.empty() and not
+                entry.second->want_write_ ) {
+            // Errors show up as EPOLLERR/EPOLLHUP on the next pass
+            flush( *entry.second );
+        }
+    }
+
+    pending_.clear();
+    batches_executed_++;
+}
+
+void query_server::execute_reads( std::vector<std::pair<pending_request *,
+        size_t>> &reads ) {
+    if( reads.empty() ) {
+        return;
+    }
+
+    // Visit the batch in spatial order so consecutive queries walk
+    // mostly the same nodes and hit pages the pool already holds.
+    auto key = []( const std::pair<pending_request *, size_t> &read ) {
+        const operation &op = read.first->ops_[read.second];
+        return op.opcode_ == OP_RANGE_QUERY ? op.rectangle_.lowerLeft :
+            op.point_;
+    };
+    std::sort( reads.begin(), reads.end(), [&key]( const auto &a, const
+                auto &b ) {
+        return key( a ).orderedCompare( key( b ), 0 );
+    } );
+
+    // Point queries go to the index as one batch it can interleave
+    std::vector<Point> points;
+    for( auto &read : reads ) {
+        const operation &op = read.first->ops_[read.second];
+        if( op.opcode_ == OP_POINT_QUERY ) {
+            points.push_back( op.point_ );
+        }
+    }
+    std::vector<std::vector<Point>> point_results;
+    if( not points.empty() ) {
+        point_results = index_->batchSearch( points );
+    }
+
+    size_t next_point_result = 0;
+    for( auto &read : reads ) {
+        const operation &op = read.first->ops_[read.second];
+        std::vector<Point> &result = read.first->results_[read.second];
+        switch( op.opcode_ ) {
+            case OP_POINT_QUERY:
+                result = std::move( point_results[next_point_result++] );
+                break;
+            case OP_RANGE_QUERY:
+                result = index_->search( op.rectangle_ );
+                break;
+            case OP_KNN_QUERY:
+                result = nearest_neighbours( index_, op.point_, op.k_ );
+                break;
+            default:
+                assert( false );
+        }
+    }
+    reads.clear();
+}
@@ -0,0 +1,69 @@
+#include <storage/async.h>
+#include <stdexcept>
+
+executor::executor( unsigned io_workers ) : engine_( io_workers ) {}
+
+void executor::schedule( std::coroutine_handle<> handle ) {
+    ready_.push_back( handle );
+}
+
+void executor::defer( std::function<bool()> retry ) {
+    deferred_.push_back( retry );
+}
+
+void executor::run() {
+    for( ;; ) {
+        // Only what was ready when the round began, so that a task
+        // rescheduling itself can't keep us from reaping
+        std::deque<std::coroutine_handle<>> round;
+        round.swap( ready_ );
+        for( std::coroutine_handle<> handle : round ) {
+            handle.resume();
+        }
+
+        size_t retries = deferred_.size();
+        for( size_t i = 0; i < retries; i++ ) {
+            std::function<bool()> retry = std::move( deferred_.front() );
+            deferred_.pop_front();
+            if( !retry() ) {
+                deferred_.push_back( std::move( retry ) );
+            }
+        }
+
+        if( ready_.empty() ) {
+            if( engine_.get_in_flight() == 0 ) {
+                if( !deferred_.empty() ) {
+                    throw std::runtime_error( "Queries are waiting for "
+                            "frames but every frame is pinned" );
+                }
+                return;
+            }
+            engine_.reap( true );
+        } else {
+            engine_.reap( false );
+        }
+    }
+}
+
+bool page_fetch::await_ready() {
+    page_ = pool_.get_resident_page( page_id_ );
+    if( page_ != nullptr ) {
+        pool_.pin_page( page_ );
+        return true;
+    }
+    return false;
+}
+
+void page_fetch::await_suspend( std::coroutine_handle<> awaiting ) {
+    if( !start( awaiting ) ) {
+        executor_.defer( [this, awaiting]() { return start( awaiting ); } );
+    }
+}
+
+bool page_fetch::start( std::coroutine_handle<> awaiting ) {
+    return pool_.read_page_async( page_id_, executor_.get_io_engine(),
+            [this, awaiting]( page *page_ptr ) {
+                page_ = page_ptr;
+                executor_.schedule( awaiting );
+            } );
+}
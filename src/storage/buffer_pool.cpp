@@ -8,29 +8,122 @@
 #include <iostream>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <storage/buffer_pool.h>
+#include <storage/shared_buffer_pool.h>
+#include <storage/numa.h>
 #include <storage/page.h>
+#include <storage/page_codec.h>
+#include <util/interleave.h>
+
+// Compressed pages are placed on this boundary so a page that grows a
+// little can usually be rewritten in place.
+#define COMPRESSED_PAGE_ALIGNMENT 64
+
+// Reads as "PAGEMAP1" in a hexdump of the backing file
+#define PAGE_MAP_MAGIC 0x3150414d45474150ULL
+
+// Longest run of pages prefetch_pages will ask for in one read
+#define PREFETCH_MAX_RUN_PAGES 64
+
+// Consecutive pages placed in the same partition by default
+#define PARTITION_RUN_PAGES 64
+
+// Resident slots come in chunks of 1 << RESIDENT_CHUNK_BITS pages, and
+// there are enough chunks for every 32 bit page id a tree node handle
+// can hold.
+#define RESIDENT_CHUNK_BITS 16
+#define RESIDENT_CHUNK_COUNT (((size_t) 1) << (32 - RESIDENT_CHUNK_BITS))
+
+// Last bytes of a compressed backing file.
+struct page_map_trailer {
+    uint64_t magic_;
+    uint64_t map_offset_;
+    uint64_t page_count_;
+};
+
+buffer_pool::buffer_pool( buffer_budget budget, std::string
+        backing_file_name, page_encoding encoding ) {
+
+    shared_ = budget.shared_;
+    shared_file_id_ = 0;
+    if( shared_ != nullptr ) {
+        max_mem_pages_ = std::min( budget.max_pages_,
+                shared_->get_capacity() );
+        shared_file_id_ = shared_->attach( this, budget.min_pages_,
+                budget.max_pages_ );
+    } else {
+        max_mem_pages_ = budget.pool_size_bytes_ / PAGE_SIZE;
+        if( budget.pool_size_bytes_ % PAGE_SIZE != 0 ) {
+            max_mem_pages_++;
+        }
 
-
-buffer_pool::buffer_pool( size_t pool_size_bytes, std::string
-        backing_file_name ) {
-
-    max_mem_pages_ = pool_size_bytes / PAGE_SIZE;
-    if( pool_size_bytes % PAGE_SIZE != 0 ) {
-        max_mem_pages_++;
+        size_t partition_count = budget.partitions_ > 0 ?
+            budget.partitions_ : numa_node_count();
+        partition_count = std::max( (size_t) 1, std::min( partition_count,
+                    max_mem_pages_ ) );
+        for( size_t i = 0; i < partition_count; i++ ) {
+            frame_partition partition;
+            partition.node_ = i % numa_node_count();
+            partition.capacity_ = max_mem_pages_ / partition_count +
+                (i < max_mem_pages_ % partition_count ? 1 : 0);
+            partition.frames_ = partition.capacity_ > 0 ?
+                numa_alloc_frames( partition.capacity_, partition.node_ ) :
+                nullptr;
+            partition.frames_in_use_ = 0;
+            partition.clock_hand_pos_ = 0;
+            partition.hits_ = 0;
+            partition.local_hits_ = 0;
+            partition.misses_ = 0;
+            partitions_.push_back( partition );
+        }
     }
+    remote_accesses_ = 0;
 
     backing_file_name_ = backing_file_name;
-    clock_hand_pos_ = 0;
+    existing_page_count_ = 0;
+    backing_file_fd_ = -1;
     highest_allocated_page_id_ = 0;
+    encoding_ = encoding;
+    append_offset_ = 0;
+    pages_read_ = 0;
+    bytes_read_ = 0;
+    bytes_written_ = 0;
+    read_calls_ = 0;
+    writing_ = false;
 }
 
 
 buffer_pool::~buffer_pool() {
+    // Reads in flight would land in freed frames
+    assert( pending_reads_.empty() );
+
     // Teardown, write back everypage
-    for( auto &page_ptr : allocated_pages_ ) {
-        evict( page_ptr );
+    for( frame_partition &partition : partitions_ ) {
+        for( size_t i = 0; i < partition.frames_in_use_; i++ ) {
+            evict_frame( &partition.frames_[i] );
+        }
+        if( partition.frames_ != nullptr ) {
+            numa_free_frames( partition.frames_, partition.capacity_ );
+        }
+    }
+    if( shared_ != nullptr ) {
+        for( auto entry : page_index_ ) {
+            writeback_page( entry.second );
+        }
+        shared_->detach( shared_file_id_ );
+    }
+    if( backing_file_fd_ != -1 ) {
+        if( encoding_ == COMPRESSED_PAGES ) {
+            write_page_map();
+        }
+        close( backing_file_fd_ );
+    }
+    if( resident_chunks_ != nullptr ) {
+        for( size_t i = 0; i < RESIDENT_CHUNK_COUNT; i++ ) {
+            delete[] resident_chunks_[i].load();
+        }
     }
 }
 
@@ -41,71 +134,60 @@ void buffer_pool::initialize() {
 
     assert( backing_file_fd_ != -1 );
 
-    // Step 1: Read every data page we have, load 'em into memory
-    size_t file_offset = 0;
-    for( ;; ) {
-        std::unique_ptr<page> page_ptr = std::make_unique<page>();
-        int rc = read( backing_file_fd_, (char *) page_ptr.get(), PAGE_SIZE );
-        if( rc == PAGE_SIZE ) {
-            page *raw_page_ptr = page_ptr.get();
-
-            // Construct metadata and record it 
-            allocated_pages_.emplace_back( std::move(
-                            page_ptr ) );
-            page_index_.insert( { raw_page_ptr->header_.page_id_,
-                    raw_page_ptr } ); 
-
-            // Increment offsets
-            file_offset += PAGE_SIZE;
-            existing_page_count_++;
-
-            if( existing_page_count_ == max_mem_pages_ ) {
-                // If we are out of memory to use, then the rest will need to be
-                // read later.
-                break;
-            }
-        } else {
-            // Destroys page_ptr
-            break;
-        }
+    // Compressed files are recognized by their trailer, whatever
+    // encoding we were asked for.
+    if( load_page_map() ) {
+        encoding_ = COMPRESSED_PAGES;
+        existing_page_count_ = page_map_.size();
+        highest_allocated_page_id_ = existing_page_count_ - 1;
+        return;
     }
 
     struct stat stat_buffer;
     int fstat_ret = fstat( backing_file_fd_, &stat_buffer );
     assert( fstat_ret == 0 );
-    assert( stat_buffer.st_size % PAGE_SIZE == 0 );
     if( stat_buffer.st_size > 0 ) {
-        existing_page_count_ = (stat_buffer.st_size / PAGE_SIZE ) - 1;
-    } else {
-        existing_page_count_ = 0;
+        // An existing raw file
+        encoding_ = RAW_PAGES;
     }
+    assert( stat_buffer.st_size % PAGE_SIZE == 0 );
+    existing_page_count_ = stat_buffer.st_size / PAGE_SIZE;
 
-    // We have enough pages. Break.
-    if( existing_page_count_ >= max_mem_pages_ ) {
-        highest_allocated_page_id_ = existing_page_count_;
+    // Existing file: don't read anything yet. Pages are faulted in on
+    // demand and frames are created as we need them, so reopening a
+    // large file costs the same as reopening a small one.
+    if( existing_page_count_ > 0 ) {
+        highest_allocated_page_id_ = existing_page_count_ - 1;
         return;
     }
 
-    off_t rc = lseek( backing_file_fd_, file_offset, SEEK_SET );
-    assert( rc == (off_t) file_offset );
-
+    // A shared pool has no frames of its own to size the file by, so a
+    // fresh file starts out with just page 0 and grows through
+    // create_new_page().
+    size_t initial_pages = shared_ != nullptr ? 1 : max_mem_pages_;
+
+    // Fresh compressed file: every page we have a frame for reads back
+    // as zeroes until it is first written, so there is nothing to lay
+    // down on disk.
+    if( encoding_ == COMPRESSED_PAGES ) {
+        page_map_.resize( initial_pages, page_extent{ 0, 0, 0 } );
+        highest_allocated_page_id_ = initial_pages-1;
+        return;
+    }
 
-    // Create any more backing file data that we need
-    for( size_t i = existing_page_count_; i < max_mem_pages_; i++ ) { 
-        std::unique_ptr<page> page_ptr = std::make_unique<page>();
+    // Fresh file: create the backing file data for every frame we have
+    std::unique_ptr<page> page_ptr = std::make_unique<page>();
+    page_ptr->header_.pin_count_ = 0;
+    page_ptr->header_.clock_active_ = false;
+    memset( page_ptr->data_, '\0', sizeof( page_ptr->data_ ) );
+    size_t file_offset = 0;
+    for( size_t i = 0; i < initial_pages; i++ ) { 
         page_ptr->header_.page_id_ = OFFSET_TO_PAGE_ID( file_offset );
-        page_ptr->header_.pin_count_ = 0;
-        page_ptr->header_.clock_active_ = false;
-        memset( page_ptr->data_, '\0', sizeof( page_ptr->data_ ) );
         writeback_page( page_ptr.get() );
-
-        // Push these into the freelist
-        freelist_.push_back( std::move( page_ptr ) );
-
         file_offset += PAGE_SIZE;
     }
 
-    highest_allocated_page_id_ = max_mem_pages_-1;
+    highest_allocated_page_id_ = initial_pages-1;
 }
 
 page *buffer_pool::get_page( size_t page_id ) {
@@ -114,39 +196,418 @@ page *buffer_pool::get_page( size_t page_id ) {
         return nullptr;
     }
 
+    if( !pending_reads_.empty() ) {
+        wait_for_read( page_id );
+    }
+
     // Step 1: Determine if this page is already in memory
     auto search = page_index_.find( page_id );
     if( search != page_index_.end() ) {
         page *page_ptr = search->second;
         page_ptr->header_.clock_active_ = true;
+        count_access( page_ptr, true );
         return page_ptr;
     }
 
 
     // Step 2: It is not, so obtain a page
     // Will evict an old page if necessary
-    page *page_ptr = obtain_clean_page();
+    page *page_ptr = obtain_clean_page( page_id );
 
     // No free pages available.
     if( page_ptr == nullptr ) {
+        std::cout << "No Free pages, its all pinned!" << std::endl;
         return nullptr;
     }
+    count_access( page_ptr, false );
 
     // Step 3: Read in the contents of the page
-    off_t seek_ret = lseek( backing_file_fd_, PAGE_ID_TO_OFFSET(
-                page_id ), SEEK_SET );
-    assert( seek_ret == (off_t) PAGE_ID_TO_OFFSET( page_id ) );
-    int read_ret = read( backing_file_fd_, (char *) page_ptr,
-            PAGE_SIZE );
-    assert( read_ret == PAGE_SIZE );
+    read_page_from_disk( page_id, page_ptr );
     assert( page_ptr->header_.page_id_ == page_id );
 
-    // Step 4: Put the page into the page_index (obtain_clean_page puts it into
-    // allocated_pages_)
-    page_index_.insert( { page_id, page_ptr } );
+    // Step 4: Put the page into the page_index
+    index_page( page_id, page_ptr );
     return page_ptr;
 }
 
+size_t buffer_pool::prefetch_pages( std::vector<size_t> page_ids ) {
+    std::sort( page_ids.begin(), page_ids.end() );
+    page_ids.erase( std::unique( page_ids.begin(), page_ids.end() ),
+            page_ids.end() );
+
+    std::vector<size_t> missing;
+    for( size_t page_id : page_ids ) {
+        if( page_id <= highest_allocated_page_id_ and not
+                is_page_in_memory( page_id ) and
+                pending_reads_.count( page_id ) == 0 ) {
+            missing.push_back( page_id );
+        }
+    }
+
+    size_t pages_fetched = 0;
+    size_t run_start = 0;
+    while( run_start < missing.size() ) {
+        size_t run_end = run_start + 1;
+        while( run_end < missing.size() and
+                run_end - run_start < PREFETCH_MAX_RUN_PAGES and
+                are_adjacent_on_disk( missing[run_end-1], missing[run_end] ) ) {
+            run_end++;
+        }
+
+        size_t fetched = read_page_run( missing.data() + run_start, run_end -
+                run_start );
+        pages_fetched += fetched;
+        if( fetched < run_end - run_start ) {
+            // Everything is pinned
+            break;
+        }
+        run_start = run_end;
+    }
+    return pages_fetched;
+}
+
+bool buffer_pool::are_adjacent_on_disk( size_t first_page_id, size_t
+        second_page_id ) {
+    if( encoding_ == RAW_PAGES ) {
+        return first_page_id + 1 == second_page_id;
+    }
+    const page_extent &first = page_map_.at( first_page_id );
+    const page_extent &second = page_map_.at( second_page_id );
+    return first.length_ != 0 and second.length_ != 0 and
+        first.offset_ + first.capacity_ == second.offset_;
+}
+
+size_t buffer_pool::read_page_run( const size_t *page_ids, size_t count ) {
+    std::vector<page *> frames;
+    for( size_t i = 0; i < count; i++ ) {
+        page *page_ptr = obtain_clean_page( page_ids[i] );
+        if( page_ptr == nullptr ) {
+            break;
+        }
+        // Held until the run is read, so the clock can't hand the same
+        // frame out again for a later page of it
+        page_ptr->header_.pin_count_ = 1;
+        frames.push_back( page_ptr );
+    }
+    count = frames.size();
+    if( count == 0 ) {
+        return 0;
+    }
+
+    if( count == 1 ) {
+        read_page_from_disk( page_ids[0], frames[0] );
+    } else if( encoding_ == RAW_PAGES ) {
+        std::vector<struct iovec> iov( count );
+        for( size_t i = 0; i < count; i++ ) {
+            iov[i].iov_base = frames[i];
+            iov[i].iov_len = PAGE_SIZE;
+        }
+        ssize_t read_ret = preadv( backing_file_fd_, iov.data(), count,
+                PAGE_ID_TO_OFFSET( page_ids[0] ) );
+        assert( read_ret == (ssize_t) (count * PAGE_SIZE) );
+        pages_read_ += count;
+        bytes_read_ += read_ret;
+        read_calls_++;
+    } else {
+        // One read covering every extent, then decode each page out of
+        // it.
+        const page_extent &first = page_map_.at( page_ids[0] );
+        const page_extent &last = page_map_.at( page_ids[count-1] );
+        size_t span = last.offset_ + last.length_ - first.offset_;
+        std::vector<char> buffer( span );
+        ssize_t read_ret = pread( backing_file_fd_, buffer.data(), span,
+                first.offset_ );
+        assert( read_ret == (ssize_t) span );
+        for( size_t i = 0; i < count; i++ ) {
+            const page_extent &extent = page_map_.at( page_ids[i] );
+            const char *data = buffer.data() + (extent.offset_ -
+                    first.offset_);
+            if( extent.length_ == PAGE_SIZE ) {
+                memcpy( (char *) frames[i], data, PAGE_SIZE );
+            } else {
+                decompress_page( data, extent.length_, frames[i] );
+            }
+            bytes_read_ += extent.length_;
+        }
+        pages_read_ += count;
+        read_calls_++;
+    }
+
+    for( size_t i = 0; i < count; i++ ) {
+        assert( frames[i]->header_.page_id_ == page_ids[i] );
+        frames[i]->header_.pin_count_ = 0;
+        // Give prefetched pages a full sweep of the clock before they
+        // can be evicted, they are about to be used.
+        frames[i]->header_.clock_active_ = true;
+        index_page( page_ids[i], frames[i] );
+    }
+    return count;
+}
+
+void buffer_pool::prefetch_resident( size_t page_id, size_t offset, size_t
+        bytes ) {
+    auto search = page_index_.find( page_id );
+    if( search == page_index_.end() ) {
+        return;
+    }
+    page *page_ptr = search->second;
+    __builtin_prefetch( &page_ptr->header_ );
+    prefetchObject( page_ptr->data_ + offset, bytes );
+}
+
+page *buffer_pool::get_resident_page( size_t page_id ) {
+    auto search = page_index_.find( page_id );
+    if( search == page_index_.end() ) {
+        return nullptr;
+    }
+    page *page_ptr = search->second;
+    page_ptr->header_.clock_active_ = true;
+    count_access( page_ptr, true );
+    return page_ptr;
+}
+
+bool buffer_pool::read_page_async( size_t page_id, io_engine &engine,
+        std::function<void( page * )> on_ready ) {
+    assert( page_id <= highest_allocated_page_id_ );
+
+    auto pending = pending_reads_.find( page_id );
+    if( pending != pending_reads_.end() ) {
+        pending->second->waiters_.push_back( on_ready );
+        return true;
+    }
+
+    // It may have come in since the caller looked
+    page *page_ptr = get_resident_page( page_id );
+    if( page_ptr != nullptr ) {
+        pin_page( page_ptr );
+        on_ready( page_ptr );
+        return true;
+    }
+
+    page_ptr = obtain_clean_page( page_id );
+    if( page_ptr == nullptr ) {
+        return false;
+    }
+    count_access( page_ptr, false );
+    page_ptr->header_.pin_count_ = 1;
+    page_ptr->header_.clock_active_ = true;
+
+    size_t length = PAGE_SIZE;
+    off_t offset = PAGE_ID_TO_OFFSET( page_id );
+    if( encoding_ == COMPRESSED_PAGES ) {
+        const page_extent &extent = page_map_.at( page_id );
+        if( extent.length_ == 0 ) {
+            // Never written, nothing to read
+            read_page_from_disk( page_id, page_ptr );
+            page_ptr->header_.pin_count_ = 1;
+            page_ptr->header_.clock_active_ = true;
+            index_page( page_id, page_ptr );
+            on_ready( page_ptr );
+            return true;
+        }
+        length = extent.length_;
+        offset = extent.offset_;
+    }
+
+    std::unique_ptr<pending_read> read = std::make_unique<pending_read>();
+    read->frame_ = page_ptr;
+    read->engine_ = &engine;
+    read->buffer_ = std::make_unique<char[]>( length );
+    read->waiters_.push_back( on_ready );
+    io_request &request = read->request_;
+    request.fd_ = backing_file_fd_;
+    request.buffer_ = read->buffer_.get();
+    request.length_ = length;
+    request.offset_ = offset;
+    request.on_complete_ = [this, page_id]( io_request * ) {
+        complete_read( page_id );
+    };
+
+    pending_reads_.emplace( page_id, std::move( read ) );
+    engine.submit( &request );
+    return true;
+}
+
+void buffer_pool::complete_read( size_t page_id ) {
+    auto pending = pending_reads_.find( page_id );
+    assert( pending != pending_reads_.end() );
+    std::unique_ptr<pending_read> read = std::move( pending->second );
+    pending_reads_.erase( pending );
+
+    const io_request &request = read->request_;
+    assert( request.result_ == (ssize_t) request.length_ );
+    page *page_ptr = read->frame_;
+    if( request.length_ == PAGE_SIZE ) {
+        memcpy( (char *) page_ptr, request.buffer_, PAGE_SIZE );
+    } else {
+        decompress_page( request.buffer_, request.length_, page_ptr );
+    }
+    assert( page_ptr->header_.page_id_ == page_id );
+    pages_read_++;
+    bytes_read_ += request.length_;
+    read_calls_++;
+
+    // The read's pin is handed to the first waiter
+    page_ptr->header_.pin_count_ = read->waiters_.size();
+    page_ptr->header_.clock_active_ = true;
+    index_page( page_id, page_ptr );
+    for( auto &on_ready : read->waiters_ ) {
+        on_ready( page_ptr );
+    }
+}
+
+void buffer_pool::wait_for_read( size_t page_id ) {
+    auto pending = pending_reads_.find( page_id );
+    if( pending == pending_reads_.end() ) {
+        return;
+    }
+    io_engine *engine = pending->second->engine_;
+    while( pending_reads_.count( page_id ) > 0 ) {
+        engine->reap( true );
+    }
+}
+
+void buffer_pool::index_page( size_t page_id, page *page_ptr ) {
+    page_index_.insert( { page_id, page_ptr } );
+    if( resident_chunks_ != nullptr ) {
+        find_slot( page_id, true )->frame_.store( page_ptr,
+                std::memory_order_release );
+    }
+}
+
+void buffer_pool::enable_optimistic_reads() {
+    assert( shared_ == nullptr );
+    assert( pending_reads_.empty() );
+    if( resident_chunks_ != nullptr ) {
+        return;
+    }
+    resident_chunks_ = std::make_unique<std::atomic<resident_slot *>[]>(
+            RESIDENT_CHUNK_COUNT );
+    for( size_t i = 0; i < RESIDENT_CHUNK_COUNT; i++ ) {
+        resident_chunks_[i].store( nullptr, std::memory_order_relaxed );
+    }
+    for( auto entry : page_index_ ) {
+        find_slot( entry.first, true )->frame_.store( entry.second,
+                std::memory_order_release );
+    }
+}
+
+buffer_pool::resident_slot *buffer_pool::find_slot( size_t page_id, bool
+        create ) {
+    assert( page_id >> RESIDENT_CHUNK_BITS < RESIDENT_CHUNK_COUNT );
+    std::atomic<resident_slot *> &chunk_ptr = resident_chunks_[page_id >>
+        RESIDENT_CHUNK_BITS];
+    resident_slot *chunk = chunk_ptr.load( std::memory_order_acquire );
+    if( chunk == nullptr ) {
+        if( not create ) {
+            return nullptr;
+        }
+        // Only ever created under the latch
+        chunk = new resident_slot[((size_t) 1) << RESIDENT_CHUNK_BITS]();
+        chunk_ptr.store( chunk, std::memory_order_release );
+    }
+    return &chunk[page_id & ((((size_t) 1) << RESIDENT_CHUNK_BITS) - 1)];
+}
+
+bool buffer_pool::lock_slot( resident_slot &slot ) {
+    uint32_t version = slot.version_.load( std::memory_order_relaxed );
+    if( version & 1 ) {
+        return false;
+    }
+    slot.version_.store( version + 1, std::memory_order_relaxed );
+    // Nothing we change from here on may be seen before the odd version
+    std::atomic_thread_fence( std::memory_order_release );
+    return true;
+}
+
+void buffer_pool::unlock_slot( resident_slot &slot ) {
+    uint32_t version = slot.version_.load( std::memory_order_relaxed );
+    assert( version & 1 );
+    slot.version_.store( version + 1, std::memory_order_release );
+}
+
+void buffer_pool::hold_page( size_t page_id ) {
+    if( lock_slot( *find_slot( page_id, true ) ) ) {
+        held_pages_.push_back( page_id );
+    }
+}
+
+void buffer_pool::hold_for_write( size_t page_id ) {
+    if( writing_ ) {
+        hold_page( page_id );
+    }
+}
+
+void buffer_pool::begin_writes() {
+    assert( not writing_ );
+    writing_ = true;
+}
+
+void buffer_pool::end_writes() {
+    assert( writing_ );
+    for( size_t page_id : held_pages_ ) {
+        resident_slot *slot = find_slot( page_id, false );
+        if( slot->version_.load( std::memory_order_relaxed ) & 1 ) {
+            unlock_slot( *slot );
+        }
+    }
+    held_pages_.clear();
+    writing_ = false;
+}
+
+buffer_pool::optimistic_status buffer_pool::read_optimistic( size_t
+        page_id, const char *&data, uint32_t &version ) {
+    resident_slot *slot = find_slot( page_id, false );
+    if( slot == nullptr ) {
+        return OPTIMISTIC_MISS;
+    }
+    version = slot->version_.load( std::memory_order_acquire );
+    if( version & 1 ) {
+        return OPTIMISTIC_CONFLICT;
+    }
+    page *page_ptr = slot->frame_.load( std::memory_order_acquire );
+    if( page_ptr == nullptr ) {
+        return OPTIMISTIC_MISS;
+    }
+
+    // Only a hint for the clock, and left alone once set so that every
+    // reader of a hot page isn't writing to its cache line
+    std::atomic_ref<bool> clock_active( page_ptr->header_.clock_active_ );
+    if( not clock_active.load( std::memory_order_relaxed ) ) {
+        clock_active.store( true, std::memory_order_relaxed );
+    }
+
+    data = page_ptr->data_;
+    return OPTIMISTIC_OK;
+}
+
+bool buffer_pool::validate_optimistic( size_t page_id, uint32_t version ) {
+    std::atomic_thread_fence( std::memory_order_acquire );
+    resident_slot *slot = find_slot( page_id, false );
+    return slot != nullptr and slot->version_.load(
+            std::memory_order_relaxed ) == version;
+}
+
+void buffer_pool::fault_in( size_t page_id ) {
+    std::lock_guard<std::mutex> guard( latch_ );
+    get_page( page_id );
+}
+
+write_section::write_section( buffer_pool &pool ) : pool_( pool ),
+    active_( pool.has_optimistic_reads() ) {
+    if( active_ ) {
+        pool_.get_latch().lock();
+        pool_.begin_writes();
+    }
+}
+
+write_section::~write_section() {
+    if( active_ ) {
+        pool_.end_writes();
+        pool_.get_latch().unlock();
+    }
+}
+
 void buffer_pool::pin_page( page *page_ptr ) {
     page_ptr->header_.pin_count_++;
 }
@@ -157,13 +618,17 @@ void buffer_pool::unpin_page( page *page_ptr ) {
 
 
 page *buffer_pool::create_new_page() {
-    page *page_ptr = obtain_clean_page();
+    page *page_ptr = obtain_clean_page( highest_allocated_page_id_ + 1 );
     if( page_ptr == nullptr ) {
+        std::cout << "No Free pages, its all pinned!" << std::endl;
         return nullptr;
     }
 
     memset( page_ptr->data_, '\0', sizeof(page_ptr->data_) );
     highest_allocated_page_id_++;
+    if( encoding_ == COMPRESSED_PAGES ) {
+        page_map_.push_back( page_extent{ 0, 0, 0 } );
+    }
 
     // Set the header
     page_ptr->header_.page_id_ = highest_allocated_page_id_;
@@ -171,7 +636,10 @@ page *buffer_pool::create_new_page() {
     page_ptr->header_.clock_active_ = false;
 
     writeback_page( page_ptr );
-    page_index_.insert( { highest_allocated_page_id_, page_ptr } );
+    index_page( highest_allocated_page_id_, page_ptr );
+    if( writing_ ) {
+        hold_page( highest_allocated_page_id_ );
+    }
     return page_ptr;
 }
 
@@ -183,46 +651,239 @@ void buffer_pool::writeback_page( size_t page_id ) {
 }
 
 void buffer_pool::writeback_page( page *page_ptr ) {
-    // Seek to the right offset in the file and flush it out
-    size_t file_offset = PAGE_ID_TO_OFFSET( page_ptr->header_.page_id_ );
-    off_t seek_ret = lseek( backing_file_fd_, file_offset, SEEK_SET );
-    assert( seek_ret == (off_t) file_offset );
-    int write_ret = write( backing_file_fd_, (char *) page_ptr,
-            PAGE_SIZE );
-    assert( write_ret == PAGE_SIZE );
-}
-
-page *buffer_pool::obtain_clean_page() {
-    // Are there any free pages?
-    if( !freelist_.empty() ) {
-        std::unique_ptr<page> page_ptr = std::move( freelist_.front() );
-        freelist_.pop_front();
-        page *raw_page_ptr = page_ptr.get();
-        allocated_pages_.emplace_back( std::move(page_ptr) );
-        return raw_page_ptr;
-    }
-
-    size_t orig_clock_hand_pos_ = clock_hand_pos_;
+    if( encoding_ == RAW_PAGES ) {
+        // Seek to the right offset in the file and flush it out
+        size_t file_offset = PAGE_ID_TO_OFFSET( page_ptr->header_.page_id_ );
+        off_t seek_ret = lseek( backing_file_fd_, file_offset, SEEK_SET );
+        assert( seek_ret == (off_t) file_offset );
+        int write_ret = write( backing_file_fd_, (char *) page_ptr,
+                PAGE_SIZE );
+        assert( write_ret == PAGE_SIZE );
+        bytes_written_ += PAGE_SIZE;
+        return;
+    }
+
+    // Anything that doesn't shrink is stored raw.
+    char buffer[PAGE_SIZE];
+    const char *data = buffer;
+    size_t length = compress_page( page_ptr, buffer, PAGE_SIZE-1 );
+    if( length == 0 ) {
+        data = (const char *) page_ptr;
+        length = PAGE_SIZE;
+    }
+
+    page_extent &extent = page_map_.at( page_ptr->header_.page_id_ );
+    if( length > extent.capacity_ ) {
+        // Doesn't fit where it was, move it to the end of the file.
+        extent.offset_ = append_offset_;
+        extent.capacity_ = ((length + COMPRESSED_PAGE_ALIGNMENT - 1) /
+                COMPRESSED_PAGE_ALIGNMENT) * COMPRESSED_PAGE_ALIGNMENT;
+        append_offset_ += extent.capacity_;
+    }
+    extent.length_ = length;
+
+    off_t seek_ret = lseek( backing_file_fd_, extent.offset_, SEEK_SET );
+    assert( seek_ret == (off_t) extent.offset_ );
+    int write_ret = write( backing_file_fd_, data, length );
+    assert( write_ret == (int) length );
+    bytes_written_ += length;
+}
+
+void buffer_pool::read_page_from_disk( size_t page_id, page *page_ptr ) {
+    pages_read_++;
+
+    if( encoding_ == RAW_PAGES ) {
+        off_t seek_ret = lseek( backing_file_fd_, PAGE_ID_TO_OFFSET(
+                    page_id ), SEEK_SET );
+        assert( seek_ret == (off_t) PAGE_ID_TO_OFFSET( page_id ) );
+        int read_ret = read( backing_file_fd_, (char *) page_ptr,
+                PAGE_SIZE );
+        assert( read_ret == PAGE_SIZE );
+        bytes_read_ += PAGE_SIZE;
+        read_calls_++;
+        return;
+    }
+
+    page_extent &extent = page_map_.at( page_id );
+    if( extent.length_ == 0 ) {
+        memset( (char *) page_ptr, '\0', PAGE_SIZE );
+        page_ptr->header_.page_id_ = page_id;
+        return;
+    }
+
+    off_t seek_ret = lseek( backing_file_fd_, extent.offset_, SEEK_SET );
+    assert( seek_ret == (off_t) extent.offset_ );
+    if( extent.length_ == PAGE_SIZE ) {
+        int read_ret = read( backing_file_fd_, (char *) page_ptr,
+                PAGE_SIZE );
+        assert( read_ret == PAGE_SIZE );
+    } else {
+        char buffer[PAGE_SIZE];
+        int read_ret = read( backing_file_fd_, buffer, extent.length_ );
+        assert( read_ret == (int) extent.length_ );
+        decompress_page( buffer, extent.length_, page_ptr );
+    }
+    bytes_read_ += extent.length_;
+    read_calls_++;
+}
+
+bool buffer_pool::load_page_map() {
+    struct stat stat_buffer;
+    int fstat_ret = fstat( backing_file_fd_, &stat_buffer );
+    assert( fstat_ret == 0 );
+    if( stat_buffer.st_size < (off_t) sizeof(page_map_trailer) ) {
+        return false;
+    }
+
+    page_map_trailer trailer;
+    off_t trailer_offset = stat_buffer.st_size - sizeof(page_map_trailer);
+    off_t seek_ret = lseek( backing_file_fd_, trailer_offset, SEEK_SET );
+    assert( seek_ret == trailer_offset );
+    int read_ret = read( backing_file_fd_, (char *) &trailer,
+            sizeof(trailer) );
+    assert( read_ret == sizeof(trailer) );
+    if( trailer.magic_ != PAGE_MAP_MAGIC ) {
+        return false;
+    }
+
+    page_map_.resize( trailer.page_count_ );
+    seek_ret = lseek( backing_file_fd_, trailer.map_offset_, SEEK_SET );
+    assert( seek_ret == (off_t) trailer.map_offset_ );
+    size_t map_bytes = page_map_.size() * sizeof(page_extent);
+    read_ret = read( backing_file_fd_, (char *) page_map_.data(), map_bytes );
+    assert( read_ret == (int) map_bytes );
+
+    // The map gets rewritten at the end whenever we close, so new pages
+    // can go on top of it.
+    append_offset_ = trailer.map_offset_;
+    return true;
+}
+
+void buffer_pool::write_page_map() {
+    page_map_trailer trailer;
+    trailer.magic_ = PAGE_MAP_MAGIC;
+    trailer.map_offset_ = append_offset_;
+    trailer.page_count_ = page_map_.size();
+
+    off_t seek_ret = lseek( backing_file_fd_, append_offset_, SEEK_SET );
+    assert( seek_ret == (off_t) append_offset_ );
+    size_t map_bytes = page_map_.size() * sizeof(page_extent);
+    int write_ret = write( backing_file_fd_, (char *) page_map_.data(),
+            map_bytes );
+    assert( write_ret == (int) map_bytes );
+    write_ret = write( backing_file_fd_, (char *) &trailer,
+            sizeof(trailer) );
+    assert( write_ret == sizeof(trailer) );
+
+    // Drop any longer map left over from a previous close
+    int trunc_ret = ftruncate( backing_file_fd_, append_offset_ +
+            map_bytes + sizeof(trailer) );
+    assert( trunc_ret == 0 );
+}
+
+size_t buffer_pool::get_backing_file_size() {
+    struct stat stat_buffer;
+    int fstat_ret = fstat( backing_file_fd_, &stat_buffer );
+    assert( fstat_ret == 0 );
+    return stat_buffer.st_size;
+}
+
+void buffer_pool::set_page_placement( std::function<std::optional<size_t>(
+            size_t)> placement ) {
+    page_placement_ = placement;
+}
+
+size_t buffer_pool::partition_for( size_t page_id ) {
+    if( partitions_.size() <= 1 ) {
+        return 0;
+    }
+    if( page_placement_ ) {
+        std::optional<size_t> placed = page_placement_( page_id );
+        if( placed.has_value() ) {
+            return placed.value() % partitions_.size();
+        }
+    }
+    return (page_id / PARTITION_RUN_PAGES) % partitions_.size();
+}
+
+void buffer_pool::count_access( page *page_ptr, bool hit ) {
+    if( partitions_.empty() ) {
+        return;
+    }
+    // Counted against the partition the frame is in, which is not the
+    // page's own if it had to borrow one
+    frame_partition *partition = &partitions_[0];
+    for( frame_partition &candidate : partitions_ ) {
+        if( page_ptr >= candidate.frames_ and page_ptr < candidate.frames_ +
+                candidate.capacity_ ) {
+            partition = &candidate;
+            break;
+        }
+    }
+    bool local = partitions_.size() == 1 or numa_current_node() ==
+        partition->node_;
+    if( hit ) {
+        partition->hits_++;
+        partition->local_hits_ += local;
+    } else {
+        partition->misses_++;
+    }
+    if( not local ) {
+        remote_accesses_++;
+    }
+}
+
+page *buffer_pool::obtain_clean_page( size_t page_id ) {
+    if( shared_ != nullptr ) {
+        return shared_->obtain_frame( shared_file_id_ );
+    }
+
+    // Only go to another partition if everything in the page's own
+    // is pinned
+    size_t home = partition_for( page_id );
+    for( size_t i = 0; i < partitions_.size(); i++ ) {
+        page *page_ptr = obtain_partition_frame( partitions_[(home + i) %
+                partitions_.size()] );
+        if( page_ptr != nullptr ) {
+            return page_ptr;
+        }
+    }
+
+    // No free pages. Left to the caller to report, since async reads
+    // just try again later.
+    return nullptr;
+}
+
+page *buffer_pool::obtain_partition_frame( frame_partition &partition ) {
+    // Frames are only touched, and so placed, once they are needed
+    if( partition.frames_in_use_ < partition.capacity_ ) {
+        return &partition.frames_[partition.frames_in_use_++];
+    }
+    if( partition.frames_in_use_ == 0 ) {
+        return nullptr;
+    }
+
+    size_t orig_clock_hand_pos_ = partition.clock_hand_pos_;
     bool looped_over_everything_once = false;
 
     // Use clock
     do {
-        std::unique_ptr<page> &page = allocated_pages_[ clock_hand_pos_ ];
+        page *page_ptr = &partition.frames_[partition.clock_hand_pos_];
         // Move hand past
-        clock_hand_pos_ = ( clock_hand_pos_ + 1 ) %
-            allocated_pages_.size();
+        partition.clock_hand_pos_ = ( partition.clock_hand_pos_ + 1 ) %
+            partition.frames_in_use_;
 
-        if( not page->header_.clock_active_ and not
-                (page->header_.pin_count_
+        if( not page_ptr->header_.clock_active_ and not
+                (page_ptr->header_.pin_count_
                     > 0) ) { 
             // Evict the page
-            page->header_.clock_active_ = true;
-            evict( page );
-            return page.get();
+            page_ptr->header_.clock_active_ = true;
+            evict_frame( page_ptr );
+            return page_ptr;
         }
         // Unset
-        page->header_.clock_active_ = false;
-        if( orig_clock_hand_pos_ == clock_hand_pos_ ) {
+        page_ptr->header_.clock_active_ = false;
+        if( orig_clock_hand_pos_ == partition.clock_hand_pos_ ) {
             // We should have unset all the in_use bits and found
             // something, every page is pinned
             if( looped_over_everything_once ) {
@@ -232,14 +893,31 @@ page *buffer_pool::obtain_clean_page() {
         }
     } while( true );
 
-    // No free pages
-    std::cout << "No Free pages, its all pinned!" << std::endl;
     return nullptr;
 }
 
-void buffer_pool::evict( std::unique_ptr<page> &page ) {
-    writeback_page( page.get() );
-    page_index_.erase( page->header_.page_id_ );
+void buffer_pool::evict_frame( page *page_ptr ) {
+    // A frame handed out for a read that never completed, or never
+    // handed out at all, holds nothing of ours and its header is stale
+    auto search = page_index_.find( page_ptr->header_.page_id_ );
+    if( search == page_index_.end() or search->second != page_ptr ) {
+        return;
+    }
+    writeback_page( page_ptr );
+    page_index_.erase( search );
+
+    if( resident_chunks_ != nullptr ) {
+        // Readers partway through a copy of the page see the version
+        // move before the frame is reused. A page the writer holds
+        // stays held.
+        resident_slot *slot = find_slot( page_ptr->header_.page_id_,
+                false );
+        bool locked = lock_slot( *slot );
+        slot->frame_.store( nullptr, std::memory_order_relaxed );
+        if( locked ) {
+            unlock_slot( *slot );
+        }
+    }
 }
 
 void buffer_pool::writeback_all_pages() {
@@ -247,4 +925,7 @@ void buffer_pool::writeback_all_pages() {
         page *page_ptr = entry.second;
         writeback_page( page_ptr );
     }
+    if( encoding_ == COMPRESSED_PAGES ) {
+        write_page_map();
+    }
 }
@@ -0,0 +1,89 @@
+#include <storage/io_engine.h>
+#include <cassert>
+#include <cerrno>
+#include <unistd.h>
+
+io_engine::io_engine( unsigned worker_count ) {
+    assert( worker_count > 0 );
+    stopping_ = false;
+    in_flight_ = 0;
+    for( unsigned i = 0; i < worker_count; i++ ) {
+        workers_.emplace_back( &io_engine::work, this );
+    }
+}
+
+io_engine::~io_engine() {
+    // Whoever submitted a read is waiting on its callback, so there had
+    // better not be any left
+    assert( in_flight_ == 0 );
+    {
+        std::lock_guard<std::mutex> guard( lock_ );
+        stopping_ = true;
+    }
+    submitted_.notify_all();
+    for( std::thread &worker : workers_ ) {
+        worker.join();
+    }
+}
+
+void io_engine::submit( io_request *request ) {
+    in_flight_++;
+    {
+        std::lock_guard<std::mutex> guard( lock_ );
+        submission_queue_.push_back( request );
+    }
+    submitted_.notify_one();
+}
+
+size_t io_engine::reap( bool block ) {
+    std::deque<io_request *> completed;
+    {
+        std::unique_lock<std::mutex> guard( lock_ );
+        if( block and in_flight_ > 0 ) {
+            completed_.wait( guard, [this]() {
+                    return !completion_queue_.empty(); } );
+        }
+        completed.swap( completion_queue_ );
+    }
+
+    // Callbacks may submit more reads
+    in_flight_ -= completed.size();
+    for( io_request *request : completed ) {
+        request->on_complete_( request );
+    }
+    return completed.size();
+}
+
+void io_engine::work() {
+    std::unique_lock<std::mutex> guard( lock_ );
+    for( ;; ) {
+        submitted_.wait( guard, [this]() {
+                return stopping_ or !submission_queue_.empty(); } );
+        if( submission_queue_.empty() ) {
+            return;
+        }
+        io_request *request = submission_queue_.front();
+        submission_queue_.pop_front();
+        guard.unlock();
+
+        size_t done = 0;
+        request->errno_ = 0;
+        while( done < request->length_ ) {
+            ssize_t ret = pread( request->fd_, request->buffer_ + done,
+                    request->length_ - done, request->offset_ + done );
+            if( ret < 0 and errno == EINTR ) {
+                continue;
+            }
+            if( ret <= 0 ) {
+                request->errno_ = ret < 0 ? errno : 0;
+                break;
+            }
+            done += ret;
+        }
+        request->result_ = request->errno_ != 0 ? -1 : (ssize_t) done;
+
+        guard.lock();
+        completion_queue_.push_back( request );
+        completed_.notify_one();
+    }
+}
@@ -0,0 +1,105 @@
+#include <storage/leaf_filter.h>
+#include <storage/point_location_index.h>
+#include <algorithm>
+#include <cassert>
+
+// Bits set per key. With every key confined to one word, a few more
+// bits than the textbook optimum offsets the extra collisions.
+constexpr unsigned BLOOM_BITS_PER_KEY = 4;
+
+// Second, independent hash derived from the first (splitmix64 finaliser)
+static uint64_t remix( uint64_t h ) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// The word a point lands in and the bits it sets there
+static uint64_t bloom_mask( const Point &p, size_t word_count, size_t
+        &word ) {
+    uint64_t h = remix( point_hash()( p ) );
+    word = h % word_count;
+
+    uint64_t bits = remix( h );
+    uint64_t mask = 0;
+    for( unsigned i = 0; i < BLOOM_BITS_PER_KEY; i++ ) {
+        mask |= 1ULL << (bits & 63);
+        bits >>= 6;
+    }
+    return mask;
+}
+
+blocked_bloom_filter::blocked_bloom_filter( size_t word_count ) :
+    words_( word_count, 0 ) {
+    assert( word_count > 0 );
+}
+
+void blocked_bloom_filter::add( const Point &p ) {
+    size_t word;
+    uint64_t mask = bloom_mask( p, words_.size(), word );
+    words_[word] |= mask;
+}
+
+bool blocked_bloom_filter::may_contain( const Point &p ) const {
+    size_t word;
+    uint64_t mask = bloom_mask( p, words_.size(), word );
+    return (words_[word] & mask) == mask;
+}
+
+void blocked_bloom_filter::clear() {
+    std::fill( words_.begin(), words_.end(), 0 );
+}
+
+leaf_filter_set::leaf_filter_set( unsigned bits_per_entry, unsigned
+        entries_per_leaf ) :
+    words_per_filter_( (bits_per_entry * entries_per_leaf + 63) / 64 ) {}
+
+uint64_t leaf_filter_set::key_for( tree_node_handle leaf ) {
+    return ((uint64_t) leaf.get_page_id() << 16) | leaf.get_offset();
+}
+
+void leaf_filter_set::add( tree_node_handle leaf, const Point &p ) {
+    if( not enabled() ) {
+        return;
+    }
+    auto iter = filters_.try_emplace( key_for( leaf ), words_per_filter_
+            ).first;
+    iter->second.add( p );
+}
+
+void leaf_filter_set::rebuild( tree_node_handle leaf, const
+        std::vector<Point> &points ) {
+    if( not enabled() ) {
+        return;
+    }
+    auto iter = filters_.try_emplace( key_for( leaf ), words_per_filter_
+            ).first;
+    iter->second.clear();
+    for( const Point &p : points ) {
+        iter->second.add( p );
+    }
+}
+
+void leaf_filter_set::erase( tree_node_handle leaf ) {
+    filters_.erase( key_for( leaf ) );
+}
+
+void leaf_filter_set::clear() {
+    filters_.clear();
+}
+
+bool leaf_filter_set::may_contain( tree_node_handle leaf, const Point &p )
+    const {
+    auto iter = filters_.find( key_for( leaf ) );
+    if( iter == filters_.end() ) {
+        return true;
+    }
+    return iter->second.may_contain( p );
+}
+
+size_t leaf_filter_set::size_in_bytes() const {
+    return filters_.size() * words_per_filter_ * sizeof(uint64_t);
+}
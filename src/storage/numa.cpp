@@ -0,0 +1,83 @@
+#include <storage/numa.h>
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <string>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+unsigned numa_node_count() {
+    static const unsigned node_count = []() {
+        // Online nodes are listed as ranges, e.g. "0-1" or "0,2-3"
+        std::ifstream online( "/sys/devices/system/node/online" );
+        std::string ranges;
+        if( !online or !std::getline( online, ranges ) or ranges.empty() ) {
+            return 1u;
+        }
+        unsigned highest = 0;
+        size_t pos = 0;
+        while( pos < ranges.size() ) {
+            size_t end = ranges.find( ',', pos );
+            if( end == std::string::npos ) {
+                end = ranges.size();
+            }
+            std::string range = ranges.substr( pos, end - pos );
+            size_t dash = range.find( '-' );
+            try {
+                unsigned last = std::stoul( dash == std::string::npos ? range
+                        : range.substr( dash + 1 ) );
+                highest = std::max( highest, last );
+            } catch( ... ) {
+                return 1u;
+            }
+            pos = end + 1;
+        }
+        return highest + 1;
+    }();
+    return node_count;
+}
+
+unsigned numa_current_node() {
+    if( numa_node_count() == 1 ) {
+        return 0;
+    }
+    // sched_getcpu() is answered from the vDSO without entering the
+    // kernel, so only a thread that has moved CPUs asks for its node
+    thread_local int cached_cpu = -1;
+    thread_local unsigned cached_node = 0;
+    int cpu = sched_getcpu();
+    if( cpu != cached_cpu ) {
+        unsigned syscall_cpu = 0;
+        unsigned node = 0;
+        if( syscall( SYS_getcpu, &syscall_cpu, &node, nullptr ) != 0 ) {
+            return 0;
+        }
+        cached_cpu = syscall_cpu;
+        cached_node = node;
+    }
+    return cached_node;
+}
+
+page *numa_alloc_frames( size_t count, unsigned node ) {
+    assert( count > 0 );
+    size_t length = count * PAGE_SIZE;
+    void *frames = mmap( nullptr, length, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    assert( frames != MAP_FAILED );
+
+    if( numa_node_count() > 1 and node < 8 * sizeof(unsigned long) ) {
+        // Preferred rather than bound, so a full node spills over
+        // instead of failing the allocation
+        unsigned long node_mask = 1UL << node;
+        syscall( SYS_mbind, frames, length, MPOL_PREFERRED, &node_mask,
+                8 * sizeof(node_mask), 0 );
+    }
+    return (page *) frames;
+}
+
+void numa_free_frames( page *frames, size_t count ) {
+    munmap( frames, count * PAGE_SIZE );
+}
@@ -0,0 +1,80 @@
+#include <storage/overflow_chain.h>
+#include <cassert>
+
+tree_node_handle overflow_push( tree_node_allocator *allocator,
+        tree_node_handle head, const Point &p ) {
+    if( head ) {
+        pinned_node_ptr<overflow_page> head_page =
+            allocator->get_tree_node<overflow_page>( head );
+        assert( head_page->count_ > 0 );
+        assert( head_page->points_[0] == p );
+        if( head_page->count_ < OVERFLOW_PAGE_CAPACITY ) {
+            head_page->points_[head_page->count_++] = p;
+            return head;
+        }
+    }
+
+    auto alloc_data = allocator->create_new_tree_node<overflow_page>(
+            PAGE_DATA_SIZE, NodeHandleType(0) );
+    assert( alloc_data.second );
+    pinned_node_ptr<overflow_page> new_page = alloc_data.first;
+    new_page->next_ = head;
+    new_page->count_ = 1;
+    new_page->points_[0] = p;
+    return alloc_data.second;
+}
+
+tree_node_handle overflow_pop( tree_node_allocator *allocator,
+        tree_node_handle head ) {
+    assert( head );
+    pinned_node_ptr<overflow_page> head_page =
+        allocator->get_tree_node<overflow_page>( head );
+    assert( head_page->count_ > 0 );
+    if( --head_page->count_ > 0 ) {
+        return head;
+    }
+
+    tree_node_handle next = head_page->next_;
+    allocator->free( head, PAGE_DATA_SIZE );
+    return next;
+}
+
+Point overflow_front( tree_node_allocator *allocator,
+        tree_node_handle head ) {
+    assert( head );
+    pinned_node_ptr<overflow_page> head_page =
+        allocator->get_tree_node<overflow_page>( head );
+    return head_page->points_[0];
+}
+
+uint64_t overflow_count( tree_node_allocator *allocator,
+        tree_node_handle head ) {
+    uint64_t count = 0;
+    while( head ) {
+        pinned_node_ptr<overflow_page> current_page =
+            allocator->get_tree_node<overflow_page>( head );
+        count += current_page->count_;
+        head = current_page->next_;
+    }
+    return count;
+}
+
+void overflow_scan( tree_node_allocator *allocator, tree_node_handle head,
+        std::vector<Point> &accumulator ) {
+    while( head ) {
+        pinned_node_ptr<overflow_page> current_page =
+            allocator->get_tree_node<overflow_page>( head );
+        accumulator.insert( accumulator.end(), current_page->points_,
+                current_page->points_ + current_page->count_ );
+        head = current_page->next_;
+    }
+}
+
+void overflow_free( tree_node_allocator *allocator, tree_node_handle head ) {
+    while( head ) {
+        tree_node_handle next = allocator->get_tree_node<overflow_page>(
+                head )->next_;
+        allocator->free( head, PAGE_DATA_SIZE );
+        head = next;
+    }
+}
@@ -0,0 +1,142 @@
+#include <storage/page_codec.h>
+#include <cassert>
+#include <cstring>
+
+constexpr size_t WORDS_PER_PAGE = PAGE_SIZE / sizeof(uint64_t);
+static_assert( PAGE_SIZE % sizeof(uint64_t) == 0 );
+
+namespace {
+
+class bit_writer {
+public:
+    bit_writer( char *out, size_t capacity ) :
+        out_( (unsigned char *) out ), capacity_bits_( capacity * 8 ),
+        pos_( 0 ) {
+        memset( out, '\0', capacity );
+    }
+
+    // Returns false once we have run out of room
+    bool write( uint64_t value, unsigned nbits ) {
+        if( pos_ + nbits > capacity_bits_ ) {
+            return false;
+        }
+        for( unsigned i = nbits; i > 0; i-- ) {
+            if( (value >> (i-1)) & 1 ) {
+                out_[pos_ / 8] |= (unsigned char) (0x80 >> (pos_ % 8));
+            }
+            pos_++;
+        }
+        return true;
+    }
+
+    size_t bytes_used() const {
+        return (pos_ + 7) / 8;
+    }
+
+private:
+    unsigned char *out_;
+    size_t capacity_bits_;
+    size_t pos_;
+};
+
+class bit_reader {
+public:
+    bit_reader( const char *in, size_t len ) :
+        in_( (const unsigned char *) in ), len_bits_( len * 8 ),
+        pos_( 0 ) {}
+
+    uint64_t read( unsigned nbits ) {
+        uint64_t value = 0;
+        for( unsigned i = 0; i < nbits; i++ ) {
+            assert( pos_ < len_bits_ );
+            value = (value << 1) | ((in_[pos_ / 8] >> (7 - pos_ % 8)) &
+                    1);
+            pos_++;
+        }
+        return value;
+    }
+
+private:
+    const unsigned char *in_;
+    size_t len_bits_;
+    size_t pos_;
+};
+
+}
+
+size_t compress_page( const page *page_ptr, char *out, size_t
+        out_capacity ) {
+    const uint64_t *words = (const uint64_t *) page_ptr;
+    bit_writer writer( out, out_capacity );
+
+    uint64_t prev = 0;
+    unsigned prev_leading = 64;
+    unsigned prev_trailing = 0;
+    bool ok = true;
+
+    for( size_t i = 0; i < WORDS_PER_PAGE and ok; i++ ) {
+        uint64_t x = words[i] ^ prev;
+        prev = words[i];
+
+        if( x == 0 ) {
+            ok = writer.write( 0, 1 );
+            continue;
+        }
+
+        // x is non-zero, so both of these are at most 63
+        unsigned leading = __builtin_clzll( x );
+        unsigned trailing = __builtin_ctzll( x );
+
+        if( prev_leading != 64 and leading >= prev_leading and trailing >=
+                prev_trailing ) {
+            // Fits in the previous window, reuse it
+            unsigned meaningful = 64 - prev_leading - prev_trailing;
+            ok = writer.write( 0b10, 2 ) and writer.write( x >>
+                    prev_trailing, meaningful );
+        } else {
+            unsigned meaningful = 64 - leading - trailing;
+            ok = writer.write( 0b11, 2 ) and writer.write( leading, 6 ) and
+                writer.write( meaningful - 1, 6 ) and writer.write( x >>
+                        trailing, meaningful );
+            prev_leading = leading;
+            prev_trailing = trailing;
+        }
+    }
+
+    if( not ok ) {
+        return 0;
+    }
+    return writer.bytes_used();
+}
+
+void decompress_page( const char *in, size_t in_len, page *page_ptr ) {
+    uint64_t *words = (uint64_t *) page_ptr;
+    bit_reader reader( in, in_len );
+
+    uint64_t prev = 0;
+    unsigned prev_leading = 64;
+    unsigned prev_trailing = 0;
+
+    for( size_t i = 0; i < WORDS_PER_PAGE; i++ ) {
+        if( reader.read( 1 ) == 0 ) {
+            words[i] = prev;
+            continue;
+        }
+
+        uint64_t x;
+        if( reader.read( 1 ) == 0 ) {
+            assert( prev_leading != 64 );
+            unsigned meaningful = 64 - prev_leading - prev_trailing;
+            x = reader.read( meaningful ) << prev_trailing;
+        } else {
+            unsigned leading = reader.read( 6 );
+            unsigned meaningful = reader.read( 6 ) + 1;
+            unsigned trailing = 64 - leading - meaningful;
+            x = reader.read( meaningful ) << trailing;
+            prev_leading = leading;
+            prev_trailing = trailing;
+        }
+        words[i] = prev ^ x;
+        prev = words[i];
+    }
+}
@@ -0,0 +1,117 @@
+#include <storage/point_location_index.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+// How the table is laid out in its blob, entry after entry.
+struct point_location_entry {
+    Point point_;
+    tree_node_handle leaf_;
+};
+
+size_t point_hash::operator()( const Point &p ) const {
+    size_t h = 0;
+    for( unsigned d = 0; d < dimensions; d++ ) {
+        // 0.0 and -0.0 compare equal, so they must hash the same
+        double v = p[d] == 0.0 ? 0.0 : p[d];
+        uint64_t bits;
+        memcpy( &bits, &v, sizeof(bits) );
+        h ^= std::hash<uint64_t>()( bits ) + 0x9e3779b97f4a7c15ULL + (h << 6)
+            + (h >> 2);
+    }
+    return h;
+}
+
+void point_location_index::add( const Point &p, tree_node_handle leaf ) {
+    locations_.emplace( p, leaf );
+}
+
+void point_location_index::remove( const Point &p, tree_node_handle leaf
+        ) {
+    auto range = locations_.equal_range( p );
+    for( auto iter = range.first; iter != range.second; iter++ ) {
+        if( iter->second == leaf ) {
+            locations_.erase( iter );
+            return;
+        }
+    }
+    assert( false );
+}
+
+void point_location_index::remove_all( const Point &p, tree_node_handle
+        leaf ) {
+    auto range = locations_.equal_range( p );
+    for( auto iter = range.first; iter != range.second; ) {
+        if( iter->second == leaf ) {
+            iter = locations_.erase( iter );
+        } else {
+            iter++;
+        }
+    }
+}
+
+void point_location_index::move( const Point &p, tree_node_handle from,
+        tree_node_handle to ) {
+    auto range = locations_.equal_range( p );
+    for( auto iter = range.first; iter != range.second; iter++ ) {
+        if( iter->second == from ) {
+            iter->second = to;
+            return;
+        }
+    }
+    assert( false );
+}
+
+std::vector<tree_node_handle> point_location_index::leaves_for( const
+        Point &p ) const {
+    std::vector<tree_node_handle> leaves;
+    auto range = locations_.equal_range( p );
+    for( auto iter = range.first; iter != range.second; iter++ ) {
+        if( std::find( leaves.begin(), leaves.end(), iter->second ) ==
+                leaves.end() ) {
+            leaves.push_back( iter->second );
+        }
+    }
+    return leaves;
+}
+
+void point_location_index::clear() {
+    locations_.clear();
+}
+
+void point_location_index::load( tree_node_allocator &allocator,
+        tree_node_handle head, uint64_t entry_count ) {
+    std::vector<char> bytes = allocator.read_blob( head, chunks_ );
+    if( bytes.size() != entry_count * sizeof(point_location_entry) ) {
+        throw std::runtime_error( "Point index holds " +
+                std::to_string( bytes.size() ) + " bytes, expected " +
+                std::to_string( entry_count ) + " entries" );
+    }
+
+    locations_.clear();
+    locations_.reserve( entry_count );
+    for( uint64_t i = 0; i < entry_count; i++ ) {
+        point_location_entry entry;
+        memcpy( &entry, bytes.data() + i * sizeof(entry), sizeof(entry) );
+        locations_.emplace( entry.point_, entry.leaf_ );
+    }
+}
+
+tree_node_handle point_location_index::persist( tree_node_allocator
+        &allocator ) {
+    std::vector<char> bytes( locations_.size() *
+            sizeof(point_location_entry) );
+    size_t offset = 0;
+    for( const auto &location : locations_ ) {
+        point_location_entry entry;
+        entry.point_ = location.first;
+        entry.leaf_ = location.second;
+        memcpy( bytes.data() + offset, &entry, sizeof(entry) );
+        offset += sizeof(entry);
+    }
+
+    return allocator.write_blob( bytes, chunks_ );
+}
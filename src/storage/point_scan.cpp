@@ -0,0 +1,136 @@
+#include <storage/point_scan.h>
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+
+// Points written to an export file at a time
+#define EXPORT_BUFFER_POINTS 65536
+
+point_scan::point_scan( tree_node_allocator *allocator, tree_node_handle
+        root, node_expander expand ) :
+    allocator_( allocator ), expand_( expand ), next_leaf_( 0 ),
+    read_ahead_end_( 0 ) {
+    // Only the NIR-Tree tags its handles with the node type, but every
+    // tree keeps its leaves on one level, so count the levels by
+    // following first children down and stop the walk above the last
+    std::vector<Point> points;
+    unsigned height = 0;
+    tree_node_handle node_handle = root;
+    for( ;; ) {
+        branches_.clear();
+        points.clear();
+        expand_( node_handle, branches_, points );
+        if( branches_.empty() ) {
+            break;
+        }
+        node_handle = branches_[0].second;
+        height++;
+    }
+
+    std::vector<tree_node_handle> frontier = { root };
+    std::vector<tree_node_handle> next_frontier;
+    for( unsigned level = 0; level < height; level++ ) {
+        allocator_->visit_in_page_order( frontier,
+                [&]( tree_node_handle branch_handle ) {
+            branches_.clear();
+            points.clear();
+            expand_( branch_handle, branches_, points );
+            if( branches_.empty() ) {
+                // A leaf above the leaf level, which the trees don't
+                // make, but it still has to be read
+                leaves_.push_back( branch_handle );
+                return;
+            }
+            for( const auto &branch : branches_ ) {
+                next_frontier.push_back( branch.second );
+            }
+        } );
+        frontier.swap( next_frontier );
+        next_frontier.clear();
+    }
+    leaves_.insert( leaves_.end(), frontier.begin(), frontier.end() );
+
+    std::sort( leaves_.begin(), leaves_.end(),
+            []( tree_node_handle a, tree_node_handle b ) {
+                if( a.get_page_id() != b.get_page_id() ) {
+                    return a.get_page_id() < b.get_page_id();
+                }
+                return a.get_offset() < b.get_offset();
+            } );
+}
+
+void point_scan::read_ahead() {
+    // Half the pool, counted in distinct pages, as in
+    // visit_in_page_order
+    size_t window = std::max( (size_t) 1,
+            allocator_->buffer_pool_.get_in_memory_page_count() / 2 );
+    std::vector<size_t> page_ids;
+    size_t end = next_leaf_;
+    while( end < leaves_.size() ) {
+        size_t page_id = leaves_[end].get_page_id();
+        if( page_ids.empty() or page_ids.back() != page_id ) {
+            if( page_ids.size() == window ) {
+                break;
+            }
+            page_ids.push_back( page_id );
+        }
+        end++;
+    }
+
+    allocator_->buffer_pool_.prefetch_pages( page_ids );
+    read_ahead_end_ = end;
+}
+
+bool point_scan::next( std::vector<Point> &points ) {
+    if( next_leaf_ == leaves_.size() ) {
+        return false;
+    }
+    if( next_leaf_ == read_ahead_end_ ) {
+        read_ahead();
+    }
+
+    branches_.clear();
+    expand_( leaves_[next_leaf_++], branches_, points );
+    assert( branches_.empty() );
+    return true;
+}
+
+uint64_t point_scan::export_points( const std::string &path ) {
+    std::ofstream file( path, std::ios::binary | std::ios::trunc );
+    if( not file.good() ) {
+        throw std::runtime_error( "Could not open " + path +
+                " for export" );
+    }
+
+    uint64_t count = 0;
+    std::vector<Point> points;
+    std::vector<double> buffer;
+    buffer.reserve( EXPORT_BUFFER_POINTS * dimensions );
+    for( ;; ) {
+        bool more = next( points );
+        for( const Point &p : points ) {
+            for( unsigned d = 0; d < dimensions; d++ ) {
+                buffer.push_back( p[d] );
+            }
+        }
+        count += points.size();
+        points.clear();
+
+        if( buffer.size() >= EXPORT_BUFFER_POINTS * dimensions or
+                ( not more and not buffer.empty() ) ) {
+            file.write( (const char *) buffer.data(), buffer.size() *
+                    sizeof(double) );
+            buffer.clear();
+        }
+        if( not more ) {
+            break;
+        }
+    }
+
+    file.close();
+    if( file.fail() ) {
+        throw std::runtime_error( "Could not write " + path );
+    }
+    return count;
+}
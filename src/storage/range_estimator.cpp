@@ -0,0 +1,362 @@
+#include <storage/range_estimator.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+range_estimator::range_estimator( size_t max_cells ) :
+    max_cells_( max_cells ), side_( 2 ), gridded_( false ),
+    exponents_( dimensions, 0 ), origins_( dimensions, 0 ),
+    unplaced_( 0 ) {
+    assert( max_cells_ > 0 );
+
+    // As many cells a side as fit in max_cells, at least two
+    for( size_t side = 3; ; side++ ) {
+        size_t cells = 1;
+        for( unsigned d = 0; d < dimensions and cells <= max_cells_; d++ ) {
+            cells *= side;
+        }
+        if( cells > max_cells_ ) {
+            break;
+        }
+        side_ = side;
+    }
+}
+
+static bool is_finite( const Point &p ) {
+    for( unsigned d = 0; d < dimensions; d++ ) {
+        if( not std::isfinite( p[d] ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t range_estimator::column_for( unsigned d, double value ) const {
+    // Far enough out to need widening either way, without overflowing
+    double limit = std::ldexp( 1.0, 62 );
+    return (int64_t) std::clamp( std::floor( std::ldexp( value,
+                    -exponents_[d] ) ), -limit, limit );
+}
+
+double range_estimator::cell_edge( unsigned d, int64_t column ) const {
+    return std::ldexp( (double) column, exponents_[d] );
+}
+
+void range_estimator::build_grid() {
+    Point low = Point::atInfinity;
+    Point high = Point::atNegInfinity;
+    for( const Point &p : points_ ) {
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            low[d] = std::min( low[d], p[d] );
+            high[d] = std::max( high[d], p[d] );
+        }
+    }
+
+    // Smallest power of two wide enough that side_ cells span the
+    // points. Points all in one place can take any width, later ones
+    // widen it as they need.
+    for( unsigned d = 0; d < dimensions; d++ ) {
+        double span = high[d] - low[d];
+        int exponent = 0;
+        if( span > 0.0 ) {
+            exponent = (int) std::ceil( std::log2( span / side_ ) );
+        } else if( low[d] != 0.0 ) {
+            exponent = std::ilogb( low[d] ) - 8;
+        }
+        // Cell edges must be exact, so columns stay within the mantissa
+        double magnitude = std::max( std::fabs( low[d] ), std::fabs(
+                    high[d] ) );
+        if( magnitude > 0.0 ) {
+            exponent = std::max( exponent, std::ilogb( magnitude ) -
+                    std::numeric_limits<double>::digits + 2 );
+        }
+        exponents_[d] = std::max( exponent,
+                std::numeric_limits<double>::min_exponent );
+        origins_[d] = column_for( d, low[d] );
+    }
+
+    size_t cells = 1;
+    for( unsigned d = 0; d < dimensions; d++ ) {
+        cells *= side_;
+    }
+    cell_counts_.assign( cells, 0 );
+    gridded_ = true;
+
+    std::vector<Point> points;
+    points.swap( points_ );
+    for( const Point &p : points ) {
+        cell_counts_[cell_for( p )]++;
+    }
+}
+
+void range_estimator::widen( unsigned d, int64_t column ) {
+    size_t stride = 1;
+    for( unsigned e = d + 1; e < dimensions; e++ ) {
+        stride *= side_;
+    }
+
+    std::vector<uint64_t> counts( cell_counts_.size() );
+    int64_t side = side_;
+    while( column < origins_[d] or column >= origins_[d] + side ) {
+        // Cell a merges into a / 2 at twice the width, rounding down, so
+        // the old cells land on about half the grid. Leave the other
+        // half on the side the column is.
+        auto halve = []( int64_t a ) { return a >= 0 ? a / 2 : -((1 - a) / 2); };
+        int64_t first = halve( origins_[d] );
+        int64_t last = halve( origins_[d] + side - 1 );
+        int64_t origin = column < origins_[d] ? last - side + 1 : first;
+
+        std::fill( counts.begin(), counts.end(), 0 );
+        for( size_t i = 0; i < cell_counts_.size(); i++ ) {
+            int64_t old_local = (i / stride) % side_;
+            int64_t new_local = halve( origins_[d] + old_local ) - origin;
+            counts[i + (new_local - old_local) * stride] += cell_counts_[i];
+        }
+        cell_counts_.swap( counts );
+        origins_[d] = origin;
+        exponents_[d]++;
+        column = halve( column );
+    }
+}
+
+size_t range_estimator::cell_for( const Point &p ) {
+    size_t cell = 0;
+    for( unsigned d = 0; d < dimensions; d++ ) {
+        int64_t column = column_for( d, p[d] );
+        while( column < origins_[d] or column >= origins_[d] + (int64_t)
+                side_ ) {
+            widen( d, column );
+            column = column_for( d, p[d] );
+        }
+        cell = cell * side_ + (column - origins_[d]);
+    }
+    return cell;
+}
+
+void range_estimator::note_insert( const Point &p ) {
+    if( not is_finite( p ) ) {
+        unplaced_++;
+        return;
+    }
+    if( gridded_ ) {
+        cell_counts_[cell_for( p )]++;
+        return;
+    }
+    points_.push_back( p );
+    if( points_.size() > max_cells_ ) {
+        build_grid();
+    }
+}
+
+void range_estimator::note_remove( const Point &p ) {
+    // A point the summary never saw, from nodes filled in by hand rather
+    // than by insert(), leaves it be
+    if( not is_finite( p ) ) {
+        unplaced_ -= unplaced_ > 0;
+        return;
+    }
+    if( gridded_ ) {
+        uint64_t &count = cell_counts_[cell_for( p )];
+        count -= count > 0;
+        return;
+    }
+    auto iter = std::find( points_.begin(), points_.end(), p );
+    if( iter == points_.end() ) {
+        return;
+    }
+    *iter = points_.back();
+    points_.pop_back();
+}
+
+size_t range_estimator::cell_count() const {
+    return gridded_ ? cell_counts_.size() : points_.size();
+}
+
+void range_estimator::clear() {
+    gridded_ = false;
+    points_.clear();
+    cell_counts_.clear();
+    unplaced_ = 0;
+}
+
+range_estimate range_estimator::estimate( const Rectangle
+        &requested_rectangle ) const {
+    if( not gridded_ ) {
+        uint64_t count = 0;
+        for( const Point &p : points_ ) {
+            count += requested_rectangle.containsPoint( p );
+        }
+        return range_estimate{ (double) count, count, count + unplaced_ };
+    }
+
+    // The columns the query reaches along each dimension, with the
+    // share of each column's width inside it
+    std::vector<size_t> low( dimensions );
+    std::vector<size_t> high( dimensions );
+    std::vector<std::vector<double>> fractions( dimensions );
+    std::vector<std::vector<bool>> inside( dimensions );
+    int64_t side = side_;
+    for( unsigned d = 0; d < dimensions; d++ ) {
+        double query_low = requested_rectangle.lowerLeft[d];
+        double query_high = requested_rectangle.upperRight[d];
+        double grid_low = cell_edge( d, origins_[d] );
+        double grid_high = cell_edge( d, origins_[d] + side );
+        if( not (query_low < query_high) or query_low >= grid_high or
+                query_high <= grid_low ) {
+            return range_estimate{ 0.0, 0, unplaced_ };
+        }
+
+        int64_t first = 0;
+        if( query_low > grid_low ) {
+            first = column_for( d, query_low ) - origins_[d];
+        }
+        int64_t last = side - 1;
+        if( query_high < grid_high ) {
+            // The query stops short of its upper edge
+            int64_t column = column_for( d, query_high );
+            if( cell_edge( d, column ) == query_high ) {
+                column--;
+            }
+            last = column - origins_[d];
+        }
+
+        low[d] = first;
+        high[d] = last;
+        double width = cell_edge( d, 1 );
+        for( int64_t c = first; c <= last; c++ ) {
+            double cell_low = cell_edge( d, origins_[d] + c );
+            double cell_high = cell_edge( d, origins_[d] + c + 1 );
+            double cut = std::min( cell_high, query_high ) - std::max(
+                    cell_low, query_low );
+            fractions[d].push_back( std::clamp( cut / width, 0.0, 1.0 ) );
+            inside[d].push_back( query_low <= cell_low and cell_high <=
+                    query_high );
+        }
+    }
+
+    double count = 0.0;
+    uint64_t lower = 0;
+    uint64_t upper = unplaced_;
+    std::vector<size_t> coordinates = low;
+    for( ;; ) {
+        size_t cell = 0;
+        double fraction = 1.0;
+        bool all_inside = true;
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            cell = cell * side_ + coordinates[d];
+            fraction *= fractions[d][coordinates[d] - low[d]];
+            all_inside = all_inside and inside[d][coordinates[d] - low[d]];
+        }
+        uint64_t cell_points = cell_counts_[cell];
+        upper += cell_points;
+        if( all_inside ) {
+            lower += cell_points;
+            count += cell_points;
+        } else {
+            count += fraction * cell_points;
+        }
+
+        // Odometer step through the box of cells
+        unsigned d = dimensions;
+        while( d-- > 0 ) {
+            if( coordinates[d] < high[d] ) {
+                coordinates[d]++;
+                break;
+            }
+            coordinates[d] = low[d];
+        }
+        if( d == std::numeric_limits<unsigned>::max() ) {
+            break;
+        }
+    }
+
+    count = std::clamp( count, (double) lower, (double) upper );
+    return range_estimate{ count, lower, upper };
+}
+
+void range_estimator::load( tree_node_allocator &allocator,
+        tree_node_handle head ) {
+    std::vector<char> bytes = allocator.read_blob( head, chunks_ );
+    size_t offset = 0;
+    auto read = [&]( void *dst, size_t len ) {
+        if( offset + len > bytes.size() ) {
+            throw std::runtime_error( "Range estimator summary is truncated" );
+        }
+        memcpy( dst, bytes.data() + offset, len );
+        offset += len;
+    };
+
+    clear();
+    uint64_t gridded;
+    uint64_t side;
+    read( &gridded, sizeof(gridded) );
+    read( &side, sizeof(side) );
+    read( &unplaced_, sizeof(unplaced_) );
+    if( side != side_ ) {
+        throw std::runtime_error( "Range estimator summary has " +
+                std::to_string( side ) + " cells a side, expected " +
+                std::to_string( side_ ) );
+    }
+
+    uint64_t cells;
+    if( gridded ) {
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            int64_t exponent;
+            read( &exponent, sizeof(exponent) );
+            read( &origins_[d], sizeof(origins_[d]) );
+            exponents_[d] = exponent;
+        }
+        read( &cells, sizeof(cells) );
+        size_t expected = 1;
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            expected *= side_;
+        }
+        if( cells != expected ) {
+            throw std::runtime_error( "Range estimator summary has " +
+                    std::to_string( cells ) + " cells, expected " +
+                    std::to_string( expected ) );
+        }
+        cell_counts_.resize( cells );
+        read( cell_counts_.data(), cells * sizeof(uint64_t) );
+        gridded_ = true;
+    } else {
+        read( &cells, sizeof(cells) );
+        points_.resize( cells );
+        read( points_.data(), cells * sizeof(Point) );
+    }
+}
+
+tree_node_handle range_estimator::persist( tree_node_allocator &allocator
+        ) {
+    std::vector<char> bytes;
+    auto write = [&bytes]( const void *src, size_t len ) {
+        bytes.insert( bytes.end(), (const char *) src, (const char *) src +
+                len );
+    };
+
+    uint64_t gridded = gridded_;
+    uint64_t side = side_;
+    write( &gridded, sizeof(gridded) );
+    write( &side, sizeof(side) );
+    write( &unplaced_, sizeof(unplaced_) );
+    if( gridded_ ) {
+        for( unsigned d = 0; d < dimensions; d++ ) {
+            int64_t exponent = exponents_[d];
+            write( &exponent, sizeof(exponent) );
+            write( &origins_[d], sizeof(origins_[d]) );
+        }
+        uint64_t cells = cell_counts_.size();
+        write( &cells, sizeof(cells) );
+        write( cell_counts_.data(), cells * sizeof(uint64_t) );
+    } else {
+        uint64_t cells = points_.size();
+        write( &cells, sizeof(cells) );
+        write( points_.data(), cells * sizeof(Point) );
+    }
+
+    return allocator.write_blob( bytes, chunks_ );
+}
@@ -0,0 +1,142 @@
+#include <storage/shared_buffer_pool.h>
+#include <storage/buffer_pool.h>
+#include <cassert>
+#include <iostream>
+
+shared_buffer_pool::shared_buffer_pool( size_t pool_size_bytes ) {
+    max_mem_pages_ = pool_size_bytes / PAGE_SIZE;
+    if( pool_size_bytes % PAGE_SIZE != 0 ) {
+        max_mem_pages_++;
+    }
+    assert( max_mem_pages_ > 0 );
+    attached_files_ = 0;
+    reserved_pages_ = 0;
+    clock_hand_pos_ = 0;
+}
+
+shared_buffer_pool::~shared_buffer_pool() {
+    // Every buffer_pool writes back and detaches when it goes away, so
+    // it must not outlive us
+    assert( attached_files_ == 0 );
+}
+
+size_t shared_buffer_pool::get_resident_page_count( unsigned file_id ) {
+    return files_.at( file_id ).resident_pages_;
+}
+
+unsigned shared_buffer_pool::attach( buffer_pool *pool, size_t min_pages,
+        size_t max_pages ) {
+    assert( min_pages <= max_pages );
+    assert( max_pages > 0 );
+    assert( reserved_pages_ + min_pages <= max_mem_pages_ );
+    reserved_pages_ += min_pages;
+    attached_files_++;
+
+    // Ids of detached files are handed out again
+    for( size_t i = 0; i < files_.size(); i++ ) {
+        if( files_[i].pool_ == nullptr ) {
+            files_[i] = file_entry{ pool, min_pages, max_pages, 0 };
+            return i;
+        }
+    }
+    files_.push_back( file_entry{ pool, min_pages, max_pages, 0 } );
+    return files_.size() - 1;
+}
+
+void shared_buffer_pool::detach( unsigned file_id ) {
+    file_entry &file = files_.at( file_id );
+    assert( file.pool_ != nullptr );
+    for( size_t i = 0; i < frames_.size(); i++ ) {
+        if( frames_[i].file_id_ == file_id ) {
+            frames_[i].file_id_ = NO_FILE;
+            free_frames_.push_back( i );
+        }
+    }
+    reserved_pages_ -= file.min_pages_;
+    attached_files_--;
+    file = file_entry{ nullptr, 0, 0, 0 };
+}
+
+page *shared_buffer_pool::obtain_frame( unsigned file_id ) {
+    file_entry &requester = files_.at( file_id );
+
+    // A file at its maximum may only recycle its own frames
+    bool own_frames_only = requester.resident_pages_ >=
+        requester.max_pages_;
+
+    if( not own_frames_only ) {
+        // Don't hand out the last free frames if that leaves another
+        // file unable to reach its minimum
+        size_t owed = 0;
+        for( size_t i = 0; i < files_.size(); i++ ) {
+            if( i != file_id and files_[i].resident_pages_ <
+                    files_[i].min_pages_ ) {
+                owed += files_[i].min_pages_ - files_[i].resident_pages_;
+            }
+        }
+        size_t unused = free_frames_.size() + (max_mem_pages_ -
+                frames_.size());
+        if( unused > owed or requester.resident_pages_ <
+                requester.min_pages_ ) {
+            size_t frame_index;
+            if( !free_frames_.empty() ) {
+                frame_index = free_frames_.back();
+                free_frames_.pop_back();
+            } else if( frames_.size() < max_mem_pages_ ) {
+                frames_.push_back( frame{ std::make_unique<page>(), NO_FILE
+                        } );
+                frame_index = frames_.size() - 1;
+            } else {
+                frame_index = frames_.size();
+            }
+
+            if( frame_index < frames_.size() ) {
+                // Same grace period as a frame taken by the clock
+                frames_[frame_index].page_->header_.pin_count_ = 0;
+                frames_[frame_index].page_->header_.clock_active_ = true;
+                frames_[frame_index].file_id_ = file_id;
+                requester.resident_pages_++;
+                return frames_[frame_index].page_.get();
+            }
+        }
+    }
+
+    // Use clock. The first sweep clears every reference bit, so if the
+    // second turns up nothing everything we may take is pinned.
+    for( size_t steps = 0; steps < 2 * frames_.size(); steps++ ) {
+        frame &candidate = frames_[clock_hand_pos_];
+        clock_hand_pos_ = (clock_hand_pos_ + 1) % frames_.size();
+
+        if( candidate.file_id_ == NO_FILE ) {
+            continue;
+        }
+        if( own_frames_only and candidate.file_id_ != file_id ) {
+            continue;
+        }
+        file_entry &owner = files_[candidate.file_id_];
+        if( candidate.file_id_ != file_id and owner.resident_pages_ <=
+                owner.min_pages_ ) {
+            continue;
+        }
+
+        page_header &header = candidate.page_->header_;
+        if( header.pin_count_ > 0 ) {
+            continue;
+        }
+        if( header.clock_active_ ) {
+            header.clock_active_ = false;
+            continue;
+        }
+
+        // Evict the page
+        owner.pool_->evict_frame( candidate.page_.get() );
+        owner.resident_pages_--;
+        candidate.file_id_ = file_id;
+        requester.resident_pages_++;
+        header.clock_active_ = true;
+        return candidate.page_.get();
+    }
+
+    // No free pages, the file's pool reports it
+    return nullptr;
+}
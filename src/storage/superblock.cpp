@@ -0,0 +1,56 @@
+#include <storage/superblock.h>
+#include <sstream>
+#include <stdexcept>
+
+superblock superblock::describe( disk_tree_type tree_type, unsigned
+        min_branch_factor, unsigned max_branch_factor ) {
+    superblock sb;
+    sb.magic_ = SUPERBLOCK_MAGIC;
+    sb.version_ = SUPERBLOCK_VERSION;
+    sb.tree_type_ = tree_type;
+    sb.min_branch_factor_ = min_branch_factor;
+    sb.max_branch_factor_ = max_branch_factor;
+    sb.page_size_ = PAGE_SIZE;
+    sb.dimensions_ = dimensions;
+    sb.point_count_ = 0;
+    sb.tree_height_ = 0;
+    sb.root_ = tree_node_handle( nullptr );
+    sb.cur_page_ = 0;
+    sb.space_left_in_cur_page_ = 0;
+    sb.free_list_head_ = tree_node_handle( nullptr );
+    sb.free_list_entry_count_ = 0;
+    sb.has_point_index_ = 0;
+    sb.point_index_head_ = tree_node_handle( nullptr );
+    sb.point_index_entry_count_ = 0;
+    sb.tombstone_count_ = 0;
+    sb.range_estimator_head_ = tree_node_handle( nullptr );
+    sb.page_subtrees_head_ = tree_node_handle( nullptr );
+    return sb;
+}
+
+static void check_field( const char *field, uint64_t found, uint64_t
+        expected, const std::string &backing_file ) {
+    if( found == expected ) {
+        return;
+    }
+    std::ostringstream msg;
+    msg << "Backing file " << backing_file << " has " << field << " "
+        << found << " but this tree expects " << expected;
+    throw std::runtime_error( msg.str() );
+}
+
+void superblock::validate_against( const superblock &expected, const
+        std::string &backing_file ) const {
+    check_field( "magic", magic_, expected.magic_, backing_file );
+    check_field( "version", version_, expected.version_, backing_file );
+    check_field( "tree type", tree_type_, expected.tree_type_,
+            backing_file );
+    check_field( "page size", page_size_, expected.page_size_,
+            backing_file );
+    check_field( "dimensions", dimensions_, expected.dimensions_,
+            backing_file );
+    check_field( "min branch factor", min_branch_factor_,
+            expected.min_branch_factor_, backing_file );
+    check_field( "max branch factor", max_branch_factor_,
+            expected.max_branch_factor_, backing_file );
+}
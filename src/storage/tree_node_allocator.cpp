@@ -1,15 +1,154 @@
 #include <storage/tree_node_allocator.h>
 #include <storage/buffer_pool.h>
 #include <storage/page.h>
+#include <storage/superblock.h>
 #include <limits>
 #include <cassert>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
 
-tree_node_allocator::tree_node_allocator( size_t memory_budget,
-        std::string backing_file ) :
-    buffer_pool_( memory_budget, backing_file ),
+// One page worth of the persisted free list. Chunks are chained through
+// next_, the head of the chain is recorded in the superblock.
+struct free_list_entry {
+    tree_node_handle handle_;
+    uint16_t alloc_size_;
+};
+
+constexpr size_t FREE_LIST_CHUNK_CAPACITY = (PAGE_DATA_SIZE -
+        sizeof(tree_node_handle) - sizeof(uint64_t)) /
+    sizeof(free_list_entry);
+
+struct free_list_chunk {
+    tree_node_handle next_;
+    uint32_t entry_count_;
+    free_list_entry entries_[FREE_LIST_CHUNK_CAPACITY];
+};
+
+static_assert( sizeof(free_list_chunk) <= PAGE_DATA_SIZE );
+
+// One page worth of a blob, chained the same way.
+constexpr size_t BLOB_CHUNK_CAPACITY = PAGE_DATA_SIZE -
+    sizeof(tree_node_handle) - sizeof(uint64_t);
+
+struct blob_chunk {
+    tree_node_handle next_;
+    uint32_t length_;
+    char data_[BLOB_CHUNK_CAPACITY];
+};
+
+static_assert( sizeof(blob_chunk) <= PAGE_DATA_SIZE );
+
+tree_node_allocator::tree_node_allocator( buffer_budget memory_budget,
+        std::string backing_file, page_encoding encoding ) :
+    buffer_pool_( memory_budget, backing_file, encoding ),
     space_left_in_cur_page_( PAGE_DATA_SIZE ),
-    cur_page_( std::numeric_limits<uint32_t>::max() ) {
+    cur_page_( std::numeric_limits<uint32_t>::max() ),
+    cur_subtree_( 0 ) {
+    buffer_pool_.set_page_placement( [this]( size_t page_id ) ->
+            std::optional<size_t> {
+        return subtree_partition( get_page_subtree( page_id ) );
+    } );
+}
+
+uint64_t tree_node_allocator::resolve_subtree( uint64_t node ) {
+    // Stale parents of reused handles could in principle loop, and no
+    // tree is this tall
+    for( unsigned depth = 0; depth < 64; depth++ ) {
+        auto parent = subtree_parents_.find( node );
+        if( parent == subtree_parents_.end() or subtree_parents_.count(
+                    parent->second ) == 0 ) {
+            return node;
+        }
+        node = parent->second;
+    }
+    return 0;
+}
+
+std::optional<size_t> tree_node_allocator::subtree_partition( uint64_t
+        node ) {
+    if( node == 0 ) {
+        return std::nullopt;
+    }
+    auto partition = subtree_partitions_.find( resolve_subtree( node ) );
+    if( partition == subtree_partitions_.end() ) {
+        return std::nullopt;
+    }
+    return partition->second;
+}
+
+void tree_node_allocator::enter_subtree( tree_node_handle node,
+        tree_node_handle parent ) {
+    size_t partition_count = buffer_pool_.get_partition_count();
+    if( partition_count <= 1 ) {
+        return;
+    }
+    cur_subtree_ = subtree_key( node );
+    if( not parent ) {
+        subtree_parents_.erase( cur_subtree_ );
+        return;
+    }
+    uint64_t parent_key = subtree_key( parent );
+    subtree_parents_[cur_subtree_] = parent_key;
+    if( subtree_parents_.count( parent_key ) > 0 or
+            subtree_partitions_.count( cur_subtree_ ) > 0 ) {
+        return;
+    }
+
+    // A new child of the root takes the partition with the fewest
+    // pages. Rare enough, once per split near the root, to count them
+    // all.
+    std::vector<size_t> pages( partition_count, 0 );
+    for( uint64_t subtree : page_subtrees_ ) {
+        std::optional<size_t> partition = subtree_partition( subtree );
+        if( partition.has_value() ) {
+            pages[partition.value() % partition_count]++;
+        }
+    }
+    subtree_partitions_[cur_subtree_] = std::min_element( pages.begin(),
+            pages.end() ) - pages.begin();
+}
+
+bool tree_node_allocator::on_cur_subtree_page( size_t page_id ) {
+    return cur_subtree_ == 0 or resolve_subtree( get_page_subtree( page_id
+                ) ) == resolve_subtree( cur_subtree_ );
+}
+
+void tree_node_allocator::note_allocation( tree_node_handle node ) {
+    if( cur_subtree_ == 0 ) {
+        return;
+    }
+    // Until a descent says otherwise
+    uint64_t key = subtree_key( node );
+    subtree_parents_[key] = cur_subtree_;
+
+    size_t page_id = node.get_page_id();
+    if( page_id >= page_subtrees_.size() ) {
+        page_subtrees_.resize( page_id + 1, 0 );
+    }
+    if( page_subtrees_[page_id] == 0 or node.get_offset() == 0 ) {
+        page_subtrees_[page_id] = key;
+    }
+}
+
+void tree_node_allocator::forget_subtree_node( tree_node_handle node ) {
+    uint64_t key = subtree_key( node );
+    if( subtree_parents_.count( key ) == 0 and subtree_partitions_.count(
+                key ) == 0 ) {
+        return;
+    }
+
+    size_t page_id = node.get_page_id();
+    if( page_id < page_subtrees_.size() and page_subtrees_[page_id] == key
+            ) {
+        uint64_t subtree = resolve_subtree( key );
+        page_subtrees_[page_id] = subtree == key ? 0 : subtree;
+    }
+    subtree_parents_.erase( key );
+    subtree_partitions_.erase( key );
+    if( cur_subtree_ == key ) {
+        cur_subtree_ = 0;
+    }
 }
 
 page *tree_node_allocator::get_page_to_alloc_on( uint16_t object_size ) {
@@ -20,7 +159,9 @@ page *tree_node_allocator::get_page_to_alloc_on( uint16_t object_size ) {
         return page_ptr;
     }
 
-    if( object_size <= space_left_in_cur_page_ ) {
+    // A subtree starts a page of its own rather than share one
+    if( object_size <= space_left_in_cur_page_ and on_cur_subtree_page(
+                cur_page_ ) ) {
         return buffer_pool_.get_page( cur_page_ );
     } else {
         size_t remainder = space_left_in_cur_page_;
@@ -29,12 +170,16 @@ page *tree_node_allocator::get_page_to_alloc_on( uint16_t object_size ) {
             uint16_t offset_into_page = (PAGE_DATA_SIZE - space_left_in_cur_page_);
             tree_node_handle split_handle(
                     cur_page_, offset_into_page, NodeHandleType(0) );
-            insert_to_free_list( std::make_pair( split_handle, remainder ) );
+            free_list_.push_back( std::make_pair( split_handle, remainder ) );
         }
     }
 
     cur_page_++;
     space_left_in_cur_page_ = PAGE_DATA_SIZE;
+    if( cur_page_ < page_subtrees_.size() ) {
+        // Tagged by the node that starts it
+        page_subtrees_[cur_page_] = 0;
+    }
 
     // We may have pre-allocated a whole bunch of pages.
     page *page_ptr = buffer_pool_.get_page( cur_page_ );
@@ -44,3 +189,195 @@ page *tree_node_allocator::get_page_to_alloc_on( uint16_t object_size ) {
 
     return buffer_pool_.create_new_page();
 }
+
+void tree_node_allocator::reserve_superblock() {
+    auto alloc_data = create_new_tree_node<superblock>();
+    assert( alloc_data.second.get_page_id() == 0 );
+    assert( alloc_data.second.get_offset() == 0 );
+    memset( (char *) &(*alloc_data.first), '\0', sizeof(superblock) );
+}
+
+bool tree_node_allocator::load_superblock( const superblock &expected,
+        superblock &sb ) {
+    page *page_ptr = buffer_pool_.get_page( 0 );
+    if( page_ptr == nullptr ) {
+        return false;
+    }
+
+    memcpy( (char *) &sb, page_ptr->data_, sizeof(superblock) );
+    if( sb.magic_ != SUPERBLOCK_MAGIC ) {
+        if( buffer_pool_.get_preexisting_page_count() > 0 ) {
+            throw std::runtime_error( "Backing file " +
+                    get_backing_file_name() +
+                    " has data but no superblock" );
+        }
+        return false;
+    }
+
+    // Don't trust anything else in here until we know the layout
+    // matches.
+    sb.validate_against( expected, get_backing_file_name() );
+
+    cur_page_ = sb.cur_page_;
+    space_left_in_cur_page_ = sb.space_left_in_cur_page_;
+
+    std::vector<char> subtree_bytes = read_blob( sb.page_subtrees_head_,
+            page_subtree_chunks_ );
+    std::vector<uint64_t> words( subtree_bytes.size() / sizeof(uint64_t) );
+    memcpy( words.data(), subtree_bytes.data(), words.size() *
+            sizeof(uint64_t) );
+    page_subtrees_.clear();
+    subtree_parents_.clear();
+    subtree_partitions_.clear();
+    if( not words.empty() ) {
+        // Page tags, then parents and partitions, each led by its length
+        size_t pos = 0;
+        page_subtrees_.assign( words.begin() + pos + 1, words.begin() + pos
+                + 1 + words[pos] );
+        pos += 1 + words[pos];
+        for( auto *map : { &subtree_parents_, &subtree_partitions_ } ) {
+            for( size_t i = 0; i < words[pos]; i++ ) {
+                (*map)[words[pos + 1 + 2 * i]] = words[pos + 2 + 2 * i];
+            }
+            pos += 1 + 2 * words[pos];
+        }
+    }
+
+    free_list_.clear();
+    free_list_chunks_.clear();
+    tree_node_handle chunk_handle = sb.free_list_head_;
+    while( chunk_handle ) {
+        pinned_node_ptr<free_list_chunk> chunk =
+            get_tree_node<free_list_chunk>( chunk_handle );
+        for( uint32_t i = 0; i < chunk->entry_count_; i++ ) {
+            free_list_.push_back( std::make_pair(
+                        chunk->entries_[i].handle_,
+                        chunk->entries_[i].alloc_size_ ) );
+        }
+        free_list_chunks_.push_back( chunk_handle );
+        chunk_handle = chunk->next_;
+    }
+    assert( free_list_.size() == sb.free_list_entry_count_ );
+
+    return true;
+}
+
+void tree_node_allocator::write_superblock( superblock &sb ) {
+    // Written first since its pages come off the free list. Nothing
+    // allocated from here on is tagged, so the tags written stay true.
+    cur_subtree_ = 0;
+    std::vector<uint64_t> words;
+    if( not page_subtrees_.empty() ) {
+        words.push_back( page_subtrees_.size() );
+        words.insert( words.end(), page_subtrees_.begin(),
+                page_subtrees_.end() );
+        for( const auto *map : { &subtree_parents_, &subtree_partitions_
+                } ) {
+            words.push_back( map->size() );
+            for( const auto &entry : *map ) {
+                words.push_back( entry.first );
+                words.push_back( entry.second );
+            }
+        }
+    }
+    std::vector<char> subtree_bytes( (const char *) words.data(), (const
+                char *) (words.data() + words.size()) );
+    sb.page_subtrees_head_ = write_blob( subtree_bytes,
+            page_subtree_chunks_ );
+
+    // Give back the pages holding the last free list we wrote, they
+    // are likely to be reused immediately below.
+    for( tree_node_handle &chunk_handle : free_list_chunks_ ) {
+        free( chunk_handle, PAGE_DATA_SIZE );
+    }
+    free_list_chunks_.clear();
+
+    // Allocating chunks can itself change the free list, so keep going
+    // until there is room for all of it.
+    while( free_list_chunks_.size() * FREE_LIST_CHUNK_CAPACITY <
+            free_list_.size() ) {
+        auto alloc_data = create_new_tree_node<free_list_chunk>(
+                PAGE_DATA_SIZE, NodeHandleType(0) );
+        assert( alloc_data.second );
+        free_list_chunks_.push_back( alloc_data.second );
+    }
+
+    auto iter = free_list_.begin();
+    for( size_t i = 0; i < free_list_chunks_.size(); i++ ) {
+        pinned_node_ptr<free_list_chunk> chunk =
+            get_tree_node<free_list_chunk>( free_list_chunks_[i] );
+        chunk->next_ = (i+1 < free_list_chunks_.size()) ?
+            free_list_chunks_[i+1] : tree_node_handle( nullptr );
+        chunk->entry_count_ = 0;
+        while( iter != free_list_.end() and chunk->entry_count_ <
+                FREE_LIST_CHUNK_CAPACITY ) {
+            chunk->entries_[chunk->entry_count_].handle_ = iter->first;
+            chunk->entries_[chunk->entry_count_].alloc_size_ =
+                iter->second;
+            chunk->entry_count_++;
+            iter++;
+        }
+    }
+    assert( iter == free_list_.end() );
+
+    sb.free_list_head_ = free_list_chunks_.empty() ?
+        tree_node_handle( nullptr ) : free_list_chunks_.front();
+    sb.free_list_entry_count_ = free_list_.size();
+    sb.cur_page_ = cur_page_;
+    sb.space_left_in_cur_page_ = space_left_in_cur_page_;
+
+    page *page_ptr = buffer_pool_.get_page( 0 );
+    assert( page_ptr != nullptr );
+    memcpy( page_ptr->data_, (char *) &sb, sizeof(superblock) );
+
+    buffer_pool_.writeback_all_pages();
+}
+
+tree_node_handle tree_node_allocator::write_blob( const std::vector<char>
+        &bytes, std::vector<tree_node_handle> &chunks ) {
+    // Blobs belong to no subtree, until the next descent
+    cur_subtree_ = 0;
+    for( tree_node_handle &chunk_handle : chunks ) {
+        free( chunk_handle, PAGE_DATA_SIZE );
+    }
+    chunks.clear();
+
+    size_t chunks_needed = (bytes.size() + BLOB_CHUNK_CAPACITY - 1) /
+        BLOB_CHUNK_CAPACITY;
+    for( size_t i = 0; i < chunks_needed; i++ ) {
+        auto alloc_data = create_new_tree_node<blob_chunk>( PAGE_DATA_SIZE,
+                NodeHandleType(0) );
+        assert( alloc_data.second );
+        chunks.push_back( alloc_data.second );
+    }
+
+    size_t offset = 0;
+    for( size_t i = 0; i < chunks.size(); i++ ) {
+        pinned_node_ptr<blob_chunk> chunk = get_tree_node<blob_chunk>(
+                chunks[i] );
+        chunk->next_ = (i+1 < chunks.size()) ? chunks[i+1] :
+            tree_node_handle( nullptr );
+        chunk->length_ = std::min( BLOB_CHUNK_CAPACITY, bytes.size() -
+                offset );
+        memcpy( chunk->data_, bytes.data() + offset, chunk->length_ );
+        offset += chunk->length_;
+    }
+    assert( offset == bytes.size() );
+
+    return chunks.empty() ? tree_node_handle( nullptr ) : chunks.front();
+}
+
+std::vector<char> tree_node_allocator::read_blob( tree_node_handle head,
+        std::vector<tree_node_handle> &chunks ) {
+    std::vector<char> bytes;
+    chunks.clear();
+    while( head ) {
+        pinned_node_ptr<blob_chunk> chunk = get_tree_node<blob_chunk>(
+                head );
+        bytes.insert( bytes.end(), chunk->data_, chunk->data_ +
+                chunk->length_ );
+        chunks.push_back( head );
+        head = chunk->next_;
+    }
+    return bytes;
+}
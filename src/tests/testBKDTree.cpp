@@ -0,0 +1,146 @@
+#include <catch2/catch.hpp>
+#include <bkdtree/bkdtree.h>
+#include <util/geometry.h>
+#include <algorithm>
+#include <unistd.h>
+
+static void sortPoints( std::vector<Point> &points )
+{
+    std::sort( points.begin(), points.end(), []( const Point &a, const Point &b ) {
+        return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1]);
+    } );
+}
+
+static Point scatteredPoint( unsigned i )
+{
+    return Point( (i * 7919) % 1000 + 0.25, (i * 104729) % 997 + 0.5 );
+}
+
+TEST_CASE("BKDTree: Full buffers merge into logarithmic segments")
+{
+    unlink( "bkdtreediskbacked.txt" );
+    bkdtree::BKDTree tree( 4096*20, "bkdtreediskbacked.txt", RAW_PAGES,
+            300, false );
+
+    for( unsigned i = 0; i < 2150; i++ ) {
+        tree.insert( scatteredPoint( i ) );
+    }
+
+    // Seven full buffers are 111 in binary, the rest is still buffered
+    std::vector<uint64_t> expectedSizes = { 300, 600, 1200 };
+    REQUIRE( tree.segmentSizes() == expectedSizes );
+    REQUIRE( tree.point_count_ == 2150 );
+    REQUIRE( tree.validate() );
+
+    tree.insert( scatteredPoint( 2150 ) );
+    for( unsigned i = 2151; i < 2400; i++ ) {
+        tree.insert( scatteredPoint( i ) );
+    }
+    expectedSizes = { 2400 };
+    REQUIRE( tree.segmentSizes() == expectedSizes );
+    REQUIRE( tree.validate() );
+
+    for( unsigned i = 0; i < 2400; i++ ) {
+        std::vector<Point> found = tree.search( scatteredPoint( i ) );
+        REQUIRE( found.size() == 1 );
+        REQUIRE( found[0] == scatteredPoint( i ) );
+    }
+    REQUIRE( tree.search( Point( 0.0, 0.0 ) ).empty() );
+    unlink( "bkdtreediskbacked.txt" );
+}
+
+TEST_CASE("BKDTree: Range search matches a scan across merges and removes")
+{
+    unlink( "bkdtreediskbacked.txt" );
+    bkdtree::BKDTree tree( 4096*20, "bkdtreediskbacked.txt", RAW_PAGES,
+            256 );
+    std::vector<Point> points;
+    for( unsigned i = 0; i < 5000; i++ ) {
+        points.push_back( scatteredPoint( i ) );
+        tree.insert( points.back() );
+        if( i % 3 == 0 ) {
+            points.push_back( scatteredPoint( i ) );
+            tree.insert( points.back() );
+        }
+        // Removes hit the buffer, frozen buffers and segments alike
+        if( i % 7 == 0 and i > 500 ) {
+            Point gone = scatteredPoint( i - 500 );
+            points.erase( std::find( points.begin(), points.end(), gone ) );
+            tree.remove( gone );
+        }
+    }
+    tree.remove( Point( -1.0, -1.0 ) );
+    REQUIRE( tree.point_count_ == points.size() );
+
+    std::vector<Rectangle> queries = {
+        Rectangle( 0.0, 0.0, 1000.0, 1000.0 ),
+        Rectangle( 100.0, 200.0, 300.0, 250.0 ),
+        Rectangle( 500.25, 0.0, 500.25, 1000.0 ),
+        Rectangle( -50.0, -50.0, 10.0, 10.0 ),
+        Rectangle( 2000.0, 2000.0, 3000.0, 3000.0 )
+    };
+    auto check = [&]() {
+        for( Rectangle &query : queries ) {
+            std::vector<Point> expected;
+            for( Point &p : points ) {
+                if( query.containsPoint( p ) ) {
+                    expected.push_back( p );
+                }
+            }
+            std::vector<Point> found = tree.search( query );
+            sortPoints( expected );
+            sortPoints( found );
+            REQUIRE( found == expected );
+        }
+    };
+    check();
+
+    tree.waitForMerges();
+    REQUIRE( tree.validate() );
+    check();
+    unlink( "bkdtreediskbacked.txt" );
+}
+
+TEST_CASE("BKDTree: Reopen restores segments, buffer and tombstones")
+{
+    unlink( "bkdtreediskbacked.txt" );
+    std::vector<uint64_t> sizes;
+    {
+        bkdtree::BKDTree tree( 4096*20, "bkdtreediskbacked.txt", RAW_PAGES,
+                200 );
+        for( unsigned i = 0; i < 1050; i++ ) {
+            tree.insert( scatteredPoint( i ) );
+        }
+        tree.waitForMerges();
+        tree.remove( scatteredPoint( 3 ) );
+        tree.remove( scatteredPoint( 1049 ) );
+        REQUIRE( tree.tombstoneCount() == 1 );
+        tree.write_metadata();
+        sizes = tree.segmentSizes();
+    }
+
+    bkdtree::BKDTree tree( 4096*20, "bkdtreediskbacked.txt", RAW_PAGES,
+            200 );
+    REQUIRE( tree.point_count_ == 1048 );
+    REQUIRE( tree.segmentSizes() == sizes );
+    REQUIRE( tree.tombstoneCount() == 1 );
+    REQUIRE( tree.validate() );
+    REQUIRE( tree.search( scatteredPoint( 3 ) ).empty() );
+    REQUIRE( tree.search( scatteredPoint( 1049 ) ).empty() );
+    REQUIRE( tree.search( scatteredPoint( 1048 ) ).size() == 1 );
+    REQUIRE( tree.search( scatteredPoint( 500 ) ).size() == 1 );
+
+    // Keeps merging where it left off; three more buffers carry every
+    // level into one segment, dropping the tombstoned copy on the way
+    for( unsigned i = 1050; i < 1601; i++ ) {
+        tree.insert( scatteredPoint( i ) );
+    }
+    tree.waitForMerges();
+    std::vector<uint64_t> expectedSizes = { 1599 };
+    REQUIRE( tree.segmentSizes() == expectedSizes );
+    REQUIRE( tree.tombstoneCount() == 0 );
+    REQUIRE( tree.validate() );
+    REQUIRE( tree.search( Rectangle( 0.0, 0.0, 1000.0, 1000.0 ) ).size() ==
+            1599 );
+    unlink( "bkdtreediskbacked.txt" );
+}
@@ -1,6 +1,10 @@
 #include <catch2/catch.hpp>
 #include <storage/buffer_pool.h>
+#include <storage/shared_buffer_pool.h>
 #include <storage/page.h>
+#include <storage/page_codec.h>
+#include <storage/async.h>
+#include <cstring>
 #include <iostream>
 
 #include <unistd.h>
@@ -266,3 +270,478 @@ TEST_CASE( "Storage: Buffer Pool All Pages Pinned" ) {
     REQUIRE( bp.is_page_in_memory( 1 ) );
     REQUIRE( bp.is_page_in_memory( 2 ) );
 }
+
+TEST_CASE( "Storage: Page codec round trip" ) {
+    page original;
+    memset( (char *) &original, '\0', PAGE_SIZE );
+    original.header_.page_id_ = 7;
+
+    // Clustered coordinates, like a leaf full of nearby points
+    double *coords = (double *) original.data_;
+    for( size_t i = 0; i < 200; i++ ) {
+        coords[i] = -118.25 + 0.0001 * (i % 17) + 0.00003 * i;
+    }
+
+    char buffer[PAGE_SIZE];
+    size_t length = compress_page( &original, buffer, PAGE_SIZE );
+    REQUIRE( length > 0 );
+    REQUIRE( length < PAGE_SIZE / 2 );
+
+    page decoded;
+    decompress_page( buffer, length, &decoded );
+    REQUIRE( memcmp( &original, &decoded, PAGE_SIZE ) == 0 );
+
+    // Too little room reports failure rather than truncating
+    REQUIRE( compress_page( &original, buffer, 16 ) == 0 );
+}
+
+TEST_CASE( "Storage: Compressed pages persist" ) {
+    size_t num_pages = 10;
+
+    {
+        buffer_pool bp( PAGE_SIZE * num_pages, "file_backing.db",
+                COMPRESSED_PAGES );
+        unlink( bp.get_backing_file_name().c_str() );
+        bp.initialize();
+        REQUIRE( bp.get_highest_allocated_page_id() == num_pages-1 );
+
+        for( size_t i = 0; i < num_pages; i++ ) {
+            page *page_ptr = bp.get_page( i );
+            REQUIRE( page_ptr->header_.page_id_ == i );
+            double *coords = (double *) page_ptr->data_;
+            for( size_t j = 0; j < 100; j++ ) {
+                coords[j] = 43.65 + 0.001 * i + 0.00001 * j;
+            }
+        }
+        // Page 10 lives past the initial frames
+        page *page_ptr = bp.create_new_page();
+        REQUIRE( page_ptr->header_.page_id_ == num_pages );
+        bp.writeback_all_pages();
+
+        // Far smaller than the raw pages would have been
+        REQUIRE( bp.get_backing_file_size() < (num_pages+1) * PAGE_SIZE /
+                4 );
+    }
+
+    // The encoding is recorded in the file, asking for raw pages
+    // doesn't matter.
+    {
+        buffer_pool bp( PAGE_SIZE * num_pages, "file_backing.db" );
+        bp.initialize();
+        REQUIRE( bp.get_page_encoding() == COMPRESSED_PAGES );
+        REQUIRE( bp.get_highest_allocated_page_id() == num_pages );
+
+        for( size_t i = 0; i < num_pages; i++ ) {
+            page *page_ptr = bp.get_page( i );
+            double *coords = (double *) page_ptr->data_;
+            for( size_t j = 0; j < 100; j++ ) {
+                REQUIRE( coords[j] == 43.65 + 0.001 * i + 0.00001 * j );
+            }
+            REQUIRE( coords[100] == 0.0 );
+        }
+        REQUIRE( bp.get_page( num_pages )->header_.page_id_ == num_pages );
+        REQUIRE( bp.get_pages_read() == num_pages + 1 );
+        REQUIRE( bp.get_bytes_read() < (num_pages+1) * PAGE_SIZE / 4 );
+
+        // Overwrite a page with data that doesn't compress as well and
+        // make sure it moves rather than clobbering its neighbours.
+        page *page_ptr = bp.get_page( 3 );
+        uint64_t *words = (uint64_t *) page_ptr->data_;
+        for( size_t j = 0; j < 300; j++ ) {
+            words[j] = j * 0x9E3779B97F4A7C15ULL;
+        }
+        bp.writeback_all_pages();
+    }
+
+    {
+        buffer_pool bp( PAGE_SIZE * 2, "file_backing.db" );
+        bp.initialize();
+        uint64_t *words = (uint64_t *) bp.get_page( 3 )->data_;
+        for( size_t j = 0; j < 300; j++ ) {
+            REQUIRE( words[j] == j * 0x9E3779B97F4A7C15ULL );
+        }
+        for( size_t i : { 2, 4 } ) {
+            double *coords = (double *) bp.get_page( i )->data_;
+            for( size_t j = 0; j < 100; j++ ) {
+                REQUIRE( coords[j] == 43.65 + 0.001 * i + 0.00001 * j );
+            }
+        }
+    }
+    unlink( "file_backing.db" );
+}
+
+TEST_CASE( "Storage: Prefetch coalesces adjacent pages" ) {
+    size_t num_pages = 10;
+    {
+        buffer_pool bp( PAGE_SIZE * num_pages, "file_backing.db" );
+        unlink( bp.get_backing_file_name().c_str() );
+        bp.initialize();
+        for( size_t i = 0; i < num_pages; i++ ) {
+            page *page_ptr = bp.get_page( i );
+            *(size_t *) page_ptr->data_ = i * 3;
+            bp.writeback_page( i );
+        }
+    }
+
+    buffer_pool bp( PAGE_SIZE * num_pages, "file_backing.db" );
+    bp.initialize();
+    bp.get_page( 2 );
+    REQUIRE( bp.get_read_calls() == 1 );
+
+    // 2 is already in memory and 12 doesn't exist, so this should be
+    // three reads: {1,3} can't merge around 2, giving {1}, {3,4,5} and
+    // {7,8}.
+    REQUIRE( bp.prefetch_pages( { 8, 4, 1, 12, 3, 7, 2, 5, 4 } ) == 6 );
+    REQUIRE( bp.get_read_calls() == 4 );
+    REQUIRE( bp.get_pages_read() == 7 );
+
+    size_t read_calls = bp.get_read_calls();
+    for( size_t i : { 1, 2, 3, 4, 5, 7, 8 } ) {
+        REQUIRE( bp.is_page_in_memory( i ) );
+        page *page_ptr = bp.get_page( i );
+        REQUIRE( page_ptr->header_.page_id_ == i );
+        REQUIRE( page_ptr->header_.pin_count_ == 0 );
+        REQUIRE( *(size_t *) page_ptr->data_ == i * 3 );
+    }
+    REQUIRE( bp.get_read_calls() == read_calls );
+    unlink( "file_backing.db" );
+}
+
+TEST_CASE( "Storage: Prefetch longer than the pool" ) {
+    size_t num_pages = 10;
+    {
+        buffer_pool bp( PAGE_SIZE * num_pages, "file_backing.db" );
+        unlink( bp.get_backing_file_name().c_str() );
+        bp.initialize();
+        for( size_t i = 0; i < num_pages; i++ ) {
+            page *page_ptr = bp.get_page( i );
+            *(size_t *) page_ptr->data_ = i * 3;
+            bp.writeback_page( i );
+        }
+    }
+
+    // Every frame gets a page of the run before the clock has to look
+    // for one, and it must not take back one the run already holds
+    auto check = []( buffer_pool &bp ) {
+        std::vector<size_t> run;
+        for( size_t i = 0; i < 10; i++ ) {
+            run.push_back( i );
+        }
+        REQUIRE( bp.prefetch_pages( run ) == 4 );
+        for( size_t i = 0; i < 4; i++ ) {
+            REQUIRE( bp.is_page_in_memory( i ) );
+            page *page_ptr = bp.get_page( i );
+            REQUIRE( page_ptr->header_.page_id_ == i );
+            REQUIRE( page_ptr->header_.pin_count_ == 0 );
+            REQUIRE( *(size_t *) page_ptr->data_ == i * 3 );
+        }
+    };
+
+    {
+        buffer_pool bp( PAGE_SIZE * 4, "file_backing.db" );
+        bp.initialize();
+        check( bp );
+    }
+    {
+        shared_buffer_pool shared( PAGE_SIZE * 4 );
+        buffer_pool bp( shared, "file_backing.db" );
+        bp.initialize();
+        check( bp );
+    }
+    unlink( "file_backing.db" );
+}
+
+TEST_CASE( "Storage: Shared pool follows the busy file" ) {
+    unlink( "file_backing.db" );
+    unlink( "file_backing2.db" );
+    shared_buffer_pool shared( PAGE_SIZE * 8 );
+    {
+        buffer_pool first( shared, "file_backing.db" );
+        buffer_pool second( shared, "file_backing2.db" );
+        first.initialize();
+        second.initialize();
+        REQUIRE( first.is_shared() );
+        REQUIRE( shared.get_attached_file_count() == 2 );
+
+        // Pages of the two files carry different stamps, so a frame
+        // handed back with the wrong contents shows up
+        auto fill = []( buffer_pool &bp, size_t count, size_t stamp ) {
+            for( size_t i = 0; i < count; i++ ) {
+                page *page_ptr = i == 0 ? bp.get_page( 0 ) :
+                    bp.create_new_page();
+                REQUIRE( page_ptr != nullptr );
+                REQUIRE( page_ptr->header_.page_id_ == i );
+                *(size_t *) page_ptr->data_ = stamp + i;
+            }
+        };
+        auto check = []( buffer_pool &bp, size_t count, size_t stamp ) {
+            for( size_t i = 0; i < count; i++ ) {
+                page *page_ptr = bp.get_page( i );
+                REQUIRE( page_ptr != nullptr );
+                REQUIRE( *(size_t *) page_ptr->data_ == stamp + i );
+            }
+        };
+
+        fill( first, 6, 1000 );
+        REQUIRE( shared.get_resident_page_count( first.get_shared_file_id() ) == 6 );
+        fill( second, 12, 2000 );
+        REQUIRE( shared.get_frame_count() == 8 );
+        REQUIRE( shared.get_resident_page_count( first.get_shared_file_id() ) +
+                shared.get_resident_page_count( second.get_shared_file_id() ) == 8 );
+        REQUIRE( shared.get_resident_page_count( second.get_shared_file_id() ) > 6 );
+
+        check( first, 6, 1000 );
+        check( second, 12, 2000 );
+        check( first, 6, 1000 );
+    }
+    REQUIRE( shared.get_attached_file_count() == 0 );
+
+    // Everything made it to disk when the pools went away
+    {
+        buffer_pool bp( PAGE_SIZE * 4, "file_backing2.db" );
+        bp.initialize();
+        for( size_t i = 0; i < 12; i++ ) {
+            REQUIRE( *(size_t *) bp.get_page( i )->data_ == 2000 + i );
+        }
+    }
+    unlink( "file_backing.db" );
+    unlink( "file_backing2.db" );
+}
+
+TEST_CASE( "Storage: Shared pool quotas" ) {
+    unlink( "file_backing.db" );
+    unlink( "file_backing2.db" );
+    shared_buffer_pool shared( PAGE_SIZE * 10 );
+    {
+        // The first file keeps at least 4 frames, the second never gets
+        // more than 3
+        buffer_pool first( buffer_budget( shared, 4 ), "file_backing.db" );
+        buffer_pool second( buffer_budget( shared, 0, 3 ), "file_backing2.db" );
+        first.initialize();
+        second.initialize();
+        REQUIRE( second.get_in_memory_page_count() == 3 );
+
+        for( size_t i = 0; i < 8; i++ ) {
+            REQUIRE( (i == 0 ? first.get_page( 0 ) : first.create_new_page()) != nullptr );
+        }
+        REQUIRE( shared.get_resident_page_count( first.get_shared_file_id() ) == 8 );
+
+        for( size_t i = 0; i < 20; i++ ) {
+            REQUIRE( (i == 0 ? second.get_page( 0 ) : second.create_new_page()) != nullptr );
+            REQUIRE( shared.get_resident_page_count( second.get_shared_file_id() ) <= 3 );
+        }
+        REQUIRE( shared.get_resident_page_count( second.get_shared_file_id() ) == 3 );
+
+        // Spare frames are fair game for the uncapped file
+        for( size_t i = 0; i < 8; i++ ) {
+            REQUIRE( first.get_page( i ) != nullptr );
+        }
+        REQUIRE( shared.get_resident_page_count( first.get_shared_file_id() ) >= 7 );
+    }
+    {
+        buffer_pool first( buffer_budget( shared, 4 ), "file_backing.db" );
+        buffer_pool second( shared, "file_backing2.db" );
+        first.initialize();
+        second.initialize();
+        REQUIRE( first.get_page( 0 ) != nullptr );
+
+        // The second file can take all but the first file's minimum
+        for( size_t i = 0; i < 20; i++ ) {
+            REQUIRE( second.get_page( i ) != nullptr );
+        }
+        REQUIRE( shared.get_resident_page_count( second.get_shared_file_id() ) == 6 );
+        for( size_t i = 0; i < 8; i++ ) {
+            REQUIRE( first.get_page( i ) != nullptr );
+        }
+        REQUIRE( shared.get_resident_page_count( first.get_shared_file_id() ) >= 4 );
+        for( size_t i = 0; i < 20; i++ ) {
+            REQUIRE( second.get_page( i ) != nullptr );
+            REQUIRE( shared.get_resident_page_count( first.get_shared_file_id() ) >= 4 );
+        }
+    }
+    unlink( "file_backing.db" );
+    unlink( "file_backing2.db" );
+}
+
+TEST_CASE( "Storage: Partitioned pool" ) {
+    unlink( "file_backing.db" );
+    {
+        // On a machine without NUMA the default is a single partition
+        buffer_pool bp( PAGE_SIZE * 10, "file_backing.db" );
+        REQUIRE( bp.get_partition_count() >= 1 );
+        REQUIRE( bp.partition_for( 1000 ) < bp.get_partition_count() );
+    }
+    unlink( "file_backing.db" );
+    {
+        buffer_pool bp( buffer_budget( PAGE_SIZE * 10, 2 ), "file_backing.db" );
+        REQUIRE( bp.get_partition_count() == 2 );
+        bp.set_page_placement( []( size_t page_id ) { return page_id % 2; } );
+        bp.initialize();
+
+        for( size_t i = 0; i < 40; i++ ) {
+            page *page_ptr = i < 10 ? bp.get_page( i ) : bp.create_new_page();
+            REQUIRE( page_ptr != nullptr );
+            REQUIRE( page_ptr->header_.page_id_ == i );
+            memset( page_ptr->data_, (int) i, sizeof( page_ptr->data_ ) );
+            bp.writeback_page( i );
+        }
+        REQUIRE( bp.get_partition_misses( 0 ) == 5 );
+        REQUIRE( bp.get_partition_misses( 1 ) == 5 );
+
+        // Odd pages can only push out other odd pages, so the five most
+        // recent even pages are all still there
+        for( size_t i = 1; i < 40; i += 2 ) {
+            REQUIRE( bp.get_page( i ) != nullptr );
+        }
+        size_t hits_before = bp.get_partition_hits( 0 );
+        for( size_t i = 30; i < 40; i += 2 ) {
+            REQUIRE( bp.get_page( i ) != nullptr );
+        }
+        REQUIRE( bp.get_partition_hits( 0 ) == hits_before + 5 );
+
+        for( size_t i = 0; i < 40; i++ ) {
+            page *page_ptr = bp.get_page( i );
+            REQUIRE( page_ptr->header_.page_id_ == i );
+            REQUIRE( page_ptr->data_[0] == (char) i );
+            REQUIRE( page_ptr->data_[sizeof( page_ptr->data_ ) - 1] == (char) i );
+        }
+
+        // With its own partition all pinned a page borrows a frame from
+        // the other one
+        std::vector<page *> pinned;
+        for( size_t i = 0; i < 10; i += 2 ) {
+            page *page_ptr = bp.get_page( i );
+            page_ptr->header_.pin_count_++;
+            pinned.push_back( page_ptr );
+        }
+        size_t even_misses = bp.get_partition_misses( 0 );
+        size_t odd_misses = bp.get_partition_misses( 1 );
+        page *page_ptr = bp.get_page( 20 );
+        REQUIRE( page_ptr != nullptr );
+        REQUIRE( page_ptr->data_[0] == (char) 20 );
+        // and is counted where its frame is
+        REQUIRE( bp.get_partition_misses( 0 ) == even_misses );
+        REQUIRE( bp.get_partition_misses( 1 ) == odd_misses + 1 );
+        size_t odd_hits = bp.get_partition_hits( 1 );
+        REQUIRE( bp.get_page( 20 ) == page_ptr );
+        REQUIRE( bp.get_partition_hits( 1 ) == odd_hits + 1 );
+        for( page *pinned_ptr : pinned ) {
+            pinned_ptr->header_.pin_count_--;
+        }
+    }
+    unlink( "file_backing.db" );
+}
+
+static task<size_t> readMarker( executor &ex, buffer_pool &bp, size_t page_id ) {
+    page *page_ptr = co_await page_fetch( ex, bp, page_id );
+    size_t marker = *(size_t *) page_ptr->data_;
+    bp.unpin_page( page_ptr );
+    co_return marker;
+}
+
+TEST_CASE( "Storage: Async page reads" ) {
+    for( page_encoding encoding : { RAW_PAGES, COMPRESSED_PAGES } ) {
+        unlink( "file_backing.db" );
+        {
+            buffer_pool bp( PAGE_SIZE * 8, "file_backing.db", encoding );
+            bp.initialize();
+            for( size_t i = 0; i < 40; i++ ) {
+                page *page_ptr = i < 8 ? bp.get_page( i ) : bp.create_new_page();
+                *(size_t *) page_ptr->data_ = i * 3;
+                bp.writeback_page( i );
+            }
+        }
+
+        buffer_pool bp( PAGE_SIZE * 8, "file_backing.db" );
+        bp.initialize();
+        executor ex;
+
+        // Many more reads than frames, and some of the same page at once
+        std::vector<task<size_t>> reads;
+        for( size_t i = 0; i < 40; i++ ) {
+            reads.push_back( readMarker( ex, bp, i ) );
+            reads.push_back( readMarker( ex, bp, 39 - i ) );
+        }
+        std::vector<size_t> markers = ex.run_all( reads );
+        for( size_t i = 0; i < 40; i++ ) {
+            REQUIRE( markers[2*i] == i * 3 );
+            REQUIRE( markers[2*i+1] == (39 - i) * 3 );
+        }
+        REQUIRE( bp.get_pages_read() >= 40 );
+        REQUIRE( bp.get_pages_read() < 80 );
+
+        // Resident pages come back without a read
+        REQUIRE( ex.run_sync( readMarker( ex, bp, 17 ) ) == 17 * 3 );
+        size_t pages_read = bp.get_pages_read();
+        REQUIRE( ex.run_sync( readMarker( ex, bp, 17 ) ) == 17 * 3 );
+        REQUIRE( bp.get_pages_read() == pages_read );
+
+        // Nothing was left pinned
+        for( size_t i = 0; i < 40; i++ ) {
+            REQUIRE( bp.get_page( i ) != nullptr );
+        }
+    }
+    unlink( "file_backing.db" );
+}
+
+TEST_CASE( "Storage: Optimistic reads" ) {
+    unlink( "file_backing.db" );
+    buffer_pool bp( PAGE_SIZE * 4, "file_backing.db" );
+    bp.initialize();
+    for( size_t i = 0; i < 8; i++ ) {
+        page *page_ptr = i < 4 ? bp.get_page( i ) : bp.create_new_page();
+        *(size_t *) page_ptr->data_ = i;
+    }
+    bp.enable_optimistic_reads();
+
+    const char *data;
+    uint32_t version;
+    REQUIRE( bp.read_optimistic( 7, data, version ) ==
+            buffer_pool::OPTIMISTIC_OK );
+    REQUIRE( *(size_t *) data == 7 );
+    REQUIRE( bp.validate_optimistic( 7, version ) );
+
+    // Pages that aren't in memory have to be faulted in
+    REQUIRE( bp.read_optimistic( 0, data, version ) ==
+            buffer_pool::OPTIMISTIC_MISS );
+    bp.fault_in( 0 );
+    REQUIRE( bp.read_optimistic( 0, data, version ) ==
+            buffer_pool::OPTIMISTIC_OK );
+    REQUIRE( *(size_t *) data == 0 );
+
+    // Readers are kept out of pages a writer holds, and what they read
+    // before is stale once it lets go. Pages it only reads stay open.
+    uint32_t old_version = version;
+    uint32_t read_version;
+    REQUIRE( bp.read_optimistic( 7, data, read_version ) ==
+            buffer_pool::OPTIMISTIC_OK );
+    {
+        write_section section( bp );
+        REQUIRE( *(size_t *) bp.get_page( 7 )->data_ == 7 );
+        bp.hold_for_write( 0 );
+        *(size_t *) bp.get_page( 0 )->data_ = 100;
+        REQUIRE( bp.read_optimistic( 0, data, version ) == buffer_pool::OPTIMISTIC_CONFLICT );
+        REQUIRE( !bp.validate_optimistic( 0, old_version ) );
+        REQUIRE( bp.validate_optimistic( 7, read_version ) );
+    }
+    REQUIRE( bp.validate_optimistic( 7, read_version ) );
+    REQUIRE( !bp.validate_optimistic( 0, old_version ) );
+    REQUIRE( bp.read_optimistic( 0, data, version ) ==
+            buffer_pool::OPTIMISTIC_OK );
+    REQUIRE( *(size_t *) data == 100 );
+
+    // So is anything read before the page left memory
+    old_version = version;
+    for( size_t i = 1; i < 8; i++ ) {
+        bp.fault_in( i );
+    }
+    REQUIRE( !bp.validate_optimistic( 0, old_version ) );
+    REQUIRE( bp.read_optimistic( 0, data, version ) ==
+            buffer_pool::OPTIMISTIC_MISS );
+    bp.fault_in( 0 );
+    REQUIRE( bp.read_optimistic( 0, data, version ) ==
+            buffer_pool::OPTIMISTIC_OK );
+    REQUIRE( *(size_t *) data == 100 );
+
+    unlink( "file_backing.db" );
+}
@@ -0,0 +1,175 @@
+#include <catch2/catch.hpp>
+#include <rtree/concurrentrtree.h>
+#include <util/geometry.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Distinct for n up to 2000
+static std::vector<Point> scatteredPoints(unsigned n)
+{
+	std::vector<Point> points;
+	for (unsigned i = 0; i < n; ++i)
+	{
+		points.push_back(Point((i * 7919) % 1000 + i / 1000 * 0.5, (i * 104729) % 1000));
+	}
+
+	return points;
+}
+
+TEST_CASE("ConcurrentRTree: inserts, searches and removes")
+{
+	rtree::ConcurrentRTree tree(3, 7);
+	std::vector<Point> points = scatteredPoints(2000);
+	for (const Point &p : points)
+	{
+		tree.insert(p);
+	}
+	REQUIRE(tree.validate());
+
+	for (const Point &p : points)
+	{
+		std::vector<Point> v = tree.search(p);
+		REQUIRE(v.size() == 1);
+		REQUIRE(v[0] == p);
+	}
+	REQUIRE(tree.search(Rectangle(Point::atNegInfinity, Point::atInfinity)).size() == 2000);
+	Rectangle quarter(0.0, 0.0, 500.0, 500.0);
+	unsigned inQuarter = 0;
+	for (const Point &p : points)
+	{
+		inQuarter += quarter.containsPoint(p);
+	}
+	REQUIRE(tree.search(quarter).size() == inQuarter);
+
+	// Remove every other point
+	for (unsigned i = 0; i < points.size(); i += 2)
+	{
+		tree.remove(points[i]);
+	}
+	REQUIRE(tree.validate());
+	for (unsigned i = 0; i < points.size(); ++i)
+	{
+		REQUIRE(tree.search(points[i]).size() == i % 2);
+	}
+
+	// Removing what isn't there changes nothing
+	tree.remove(Point(5000.0, 5000.0));
+	REQUIRE(tree.search(Rectangle(Point::atNegInfinity, Point::atInfinity)).size() == 1000);
+
+	for (unsigned i = 1; i < points.size(); i += 2)
+	{
+		tree.remove(points[i]);
+	}
+	REQUIRE(tree.validate());
+	REQUIRE(tree.search(Rectangle(Point::atNegInfinity, Point::atInfinity)).empty());
+
+	// The empty tree takes points again
+	tree.insert(points[0]);
+	REQUIRE(tree.search(points[0]).size() == 1);
+	REQUIRE(tree.validate());
+}
+
+TEST_CASE("ConcurrentRTree: duplicates split")
+{
+	rtree::ConcurrentRTree tree(3, 7);
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		tree.insert(Point(1.0, 1.0));
+	}
+	REQUIRE(tree.validate());
+	REQUIRE(tree.search(Point(1.0, 1.0)).size() == 100);
+
+	tree.remove(Point(1.0, 1.0));
+	REQUIRE(tree.search(Point(1.0, 1.0)).size() == 99);
+	REQUIRE(tree.validate());
+}
+
+TEST_CASE("ConcurrentRTree: searches never miss alongside writers")
+{
+	rtree::ConcurrentRTree tree(3, 7);
+
+	// Readers look for these while writers add and take away others
+	std::vector<Point> stable = scatteredPoints(1000);
+	for (const Point &p : stable)
+	{
+		tree.insert(p);
+	}
+
+	const unsigned writerCount = 4;
+	const unsigned readerCount = 4;
+	const unsigned writesPerThread = 3000;
+	std::atomic<bool> writing(true);
+	std::atomic<unsigned> missed(0);
+	std::atomic<unsigned> badRanges(0);
+	std::atomic<unsigned> searches(0);
+
+	std::vector<std::thread> readers;
+	for (unsigned t = 0; t < readerCount; ++t)
+	{
+		readers.emplace_back([&, t]()
+		{
+			unsigned i = t;
+			while (writing or i < 2000)
+			{
+				if (tree.search(stable[i % stable.size()]).size() != 1)
+				{
+					missed++;
+				}
+				if (i % 50 == 0 and tree.search(Rectangle(0.0, 0.0, 1000.0, 1000.0)).size() != stable.size())
+				{
+					badRanges++;
+				}
+				i += 7;
+				searches++;
+			}
+		});
+	}
+
+	// Each writer inserts points of its own well away from the stable
+	// ones, removing every other one again as it goes
+	std::vector<std::thread> writers;
+	for (unsigned t = 0; t < writerCount; ++t)
+	{
+		writers.emplace_back([&, t]()
+		{
+			for (unsigned i = 0; i < writesPerThread; ++i)
+			{
+				Point p(2000.0 + (i * 7919) % 1000, 2000.0 + t * 1000.0 + i % 1000 + i / 1000 * 0.25);
+				tree.insert(p);
+				if (i % 2 == 1)
+				{
+					Point previous(2000.0 + ((i - 1) * 7919) % 1000, 2000.0 + t * 1000.0 + (i - 1) % 1000 + (i - 1) / 1000 * 0.25);
+					tree.remove(previous);
+				}
+			}
+		});
+	}
+
+	for (std::thread &writer : writers)
+	{
+		writer.join();
+	}
+	writing = false;
+	for (std::thread &reader : readers)
+	{
+		reader.join();
+	}
+
+	REQUIRE(searches > 0);
+	REQUIRE(missed == 0);
+	REQUIRE(badRanges == 0);
+	REQUIRE(tree.validate());
+	REQUIRE(tree.search(Rectangle(Point::atNegInfinity, Point::atInfinity)).size() == stable.size() + writerCount * writesPerThread / 2);
+	for (unsigned t = 0; t < writerCount; ++t)
+	{
+		for (unsigned i = 1; i < writesPerThread; i += 2)
+		{
+			Point p(2000.0 + (i * 7919) % 1000, 2000.0 + t * 1000.0 + i % 1000 + i / 1000 * 0.25);
+			REQUIRE(tree.search(p).size() == 1);
+		}
+	}
+
+	// Nothing is reading, so everything retired can go
+	tree.reclaim();
+}
@@ -0,0 +1,132 @@
+#include <catch2/catch.hpp>
+#include <gridfile/gridfile.h>
+#include <util/geometry.h>
+#include <algorithm>
+#include <unistd.h>
+
+static void sortPoints( std::vector<Point> &points )
+{
+    std::sort( points.begin(), points.end(), []( const Point &a, const Point &b ) {
+        return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1]);
+    } );
+}
+
+static Point scatteredPoint( unsigned i )
+{
+    return Point( (i * 7919) % 1000 + 0.25, (i * 104729) % 997 + 0.5 );
+}
+
+TEST_CASE("GridFile: Splits cells and buckets on overflow")
+{
+    unlink( "gridfilediskbacked.txt" );
+    gridfile::GridFile grid( 4096*20, "gridfilediskbacked.txt", RAW_PAGES, 8 );
+    REQUIRE( grid.cellCount() == 1 );
+
+    for( unsigned i = 0; i < 1000; i++ ) {
+        grid.insert( scatteredPoint( i ) );
+    }
+    REQUIRE( grid.validate() );
+    REQUIRE( grid.cellCount() > 1 );
+    REQUIRE( grid.bucketCount() >= 1000 / 8 );
+
+    for( unsigned i = 0; i < 1000; i++ ) {
+        std::vector<Point> found = grid.search( scatteredPoint( i ) );
+        REQUIRE( found.size() == 1 );
+        REQUIRE( found[0] == scatteredPoint( i ) );
+    }
+    REQUIRE( grid.search( Point( 0.0, 0.0 ) ).empty() );
+    unlink( "gridfilediskbacked.txt" );
+}
+
+TEST_CASE("GridFile: Range search matches a scan")
+{
+    unlink( "gridfilediskbacked.txt" );
+    gridfile::GridFile grid( 4096*20, "gridfilediskbacked.txt", RAW_PAGES, 16 );
+    std::vector<Point> points;
+    for( unsigned i = 0; i < 2000; i++ ) {
+        points.push_back( scatteredPoint( i ) );
+        grid.insert( points.back() );
+    }
+
+    std::vector<Rectangle> queries = {
+        Rectangle( 0.0, 0.0, 1000.0, 1000.0 ),
+        Rectangle( 100.0, 200.0, 300.0, 250.0 ),
+        Rectangle( 500.25, 0.0, 500.25, 1000.0 ),
+        Rectangle( -50.0, -50.0, 10.0, 10.0 ),
+        Rectangle( 2000.0, 2000.0, 3000.0, 3000.0 )
+    };
+    for( Rectangle &query : queries ) {
+        std::vector<Point> expected;
+        for( Point &p : points ) {
+            if( query.containsPoint( p ) ) {
+                expected.push_back( p );
+            }
+        }
+        std::vector<Point> found = grid.search( query );
+        sortPoints( expected );
+        sortPoints( found );
+        REQUIRE( found == expected );
+    }
+    unlink( "gridfilediskbacked.txt" );
+}
+
+TEST_CASE("GridFile: Duplicates chain and removes")
+{
+    unlink( "gridfilediskbacked.txt" );
+    gridfile::GridFile grid( 4096*20, "gridfilediskbacked.txt", RAW_PAGES, 4 );
+    for( unsigned i = 0; i < 20; i++ ) {
+        grid.insert( Point( 5.0, 5.0 ) );
+        grid.insert( Point( i, 2.0 * i ) );
+    }
+    REQUIRE( grid.validate() );
+    REQUIRE( grid.search( Point( 5.0, 5.0 ) ).size() == 20 );
+    REQUIRE( grid.exhaustiveSearch( Point( 5.0, 5.0 ) ).size() == 20 );
+
+    for( unsigned i = 0; i < 15; i++ ) {
+        grid.remove( Point( 5.0, 5.0 ) );
+    }
+    grid.remove( Point( 3.0, 6.0 ) );
+    // Removing a point that isn't there changes nothing
+    grid.remove( Point( 3.0, 6.0 ) );
+    REQUIRE( grid.point_count_ == 24 );
+    REQUIRE( grid.validate() );
+    REQUIRE( grid.search( Point( 5.0, 5.0 ) ).size() == 5 );
+    REQUIRE( grid.search( Point( 3.0, 6.0 ) ).empty() );
+    REQUIRE( grid.search( Point( 4.0, 8.0 ) ).size() == 1 );
+    unlink( "gridfilediskbacked.txt" );
+}
+
+TEST_CASE("GridFile: Reopens from the backing file")
+{
+    unlink( "gridfilediskbacked.txt" );
+    size_t cells;
+    {
+        gridfile::GridFile grid( 4096*20, "gridfilediskbacked.txt", RAW_PAGES, 8 );
+        for( unsigned i = 0; i < 3000; i++ ) {
+            grid.insert( scatteredPoint( i ) );
+        }
+        cells = grid.cellCount();
+        grid.write_metadata();
+    }
+    {
+        gridfile::GridFile grid( 4096*20, "gridfilediskbacked.txt", RAW_PAGES, 8 );
+        REQUIRE( grid.point_count_ == 3000 );
+        REQUIRE( grid.cellCount() == cells );
+        REQUIRE( grid.validate() );
+        for( unsigned i = 0; i < 3000; i += 7 ) {
+            REQUIRE( grid.search( scatteredPoint( i ) ).size() == 1 );
+        }
+        grid.insert( Point( 1.0, 1.0 ) );
+        grid.write_metadata();
+    }
+    {
+        gridfile::GridFile grid( 4096*20, "gridfilediskbacked.txt", RAW_PAGES, 8 );
+        REQUIRE( grid.point_count_ == 3001 );
+        REQUIRE( grid.validate() );
+    }
+    {
+        // A different bucket size is a different layout
+        REQUIRE_THROWS( gridfile::GridFile( 4096*20, "gridfilediskbacked.txt", RAW_PAGES, 16 ) );
+    }
+    unlink( "gridfilediskbacked.txt" );
+}
@@ -1,5 +1,6 @@
 #include <catch2/catch.hpp>
 #include <nirtree/nirtree.h>
+#include <random>
 
 TEST_CASE("NIRTree: testPrefixConsistency")
 {
@@ -38,3 +39,67 @@ TEST_CASE("NIRTree: testPrefixConsistency")
 	tree.insert(Point(-12.0, -3.4));
 	REQUIRE(Point(-12.0, -3.4) == tree.search(Point(-12.0, -3.4)).front());
 }
+
+TEST_CASE("NIRTree: packed layout matches search")
+{
+	nirtree::NIRTree tree(3, 7);
+	std::default_random_engine generator(1);
+	std::uniform_real_distribution<double> pointDist(0.0, 1000.0);
+	std::vector<Point> points;
+	for (unsigned i = 0; i < 3000; ++i)
+	{
+		points.push_back(Point(pointDist(generator), pointDist(generator)));
+		tree.insert(points.back());
+	}
+
+	// Some children must have polygons of several rectangles for the
+	// packed copy to map boxes back to them
+	unsigned polygonCount = 0;
+	std::vector<nirtree::Node *> context = {tree.root};
+	while (!context.empty())
+	{
+		nirtree::Node *node = context.back();
+		context.pop_back();
+		for (nirtree::Node::Branch &branch : node->branches)
+		{
+			polygonCount += branch.boundingPoly.basicRectangles.size() > 1;
+			context.push_back(branch.child);
+		}
+	}
+	REQUIRE(polygonCount > 0);
+
+	PackedTree packed = tree.pack();
+	REQUIRE(packed.validate());
+	REQUIRE(packed.size() % 64 == 0);
+
+	for (const Point &p : points)
+	{
+		std::vector<Point> v = packed.search(p);
+		REQUIRE(v.size() == 1);
+		REQUIRE(v[0] == p);
+	}
+	REQUIRE(packed.search(Point(-1.0, -1.0)).empty());
+
+	for (unsigned i = 0; i < 50; ++i)
+	{
+		Rectangle r(i * 19.0, i * 13.0, i * 19.0 + 80.0, i * 13.0 + 120.0);
+		REQUIRE(packed.search(r).size() == tree.search(r).size());
+	}
+	REQUIRE(packed.search(Rectangle(Point::atNegInfinity, Point::atInfinity)).size() == 3000);
+
+	// Routing has to map polygons of several boxes back to their child
+	nirtree::NIRTree wide(8, 16);
+	for (const Point &p : points)
+	{
+		wide.insert(p);
+	}
+	PackedTree routed = wide.pack();
+	routed.learnRouting(routed.height() - 1);
+	REQUIRE(routed.routedNodeCount() > 0);
+	for (const Point &p : points)
+	{
+		std::vector<Point> v = routed.search(p);
+		REQUIRE(v.size() == 1);
+		REQUIRE(v[0] == p);
+	}
+}
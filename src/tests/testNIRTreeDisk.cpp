@@ -1,4 +1,6 @@
 #include <catch2/catch.hpp>
+#include <algorithm>
+#include <fstream>
 #include <nirtreedisk/nirtreedisk.h>
 #include <storage/page.h>
 #include <util/geometry.h>
@@ -855,3 +857,247 @@ TEST_CASE( "NIRTreeDisk: grow well-beyond memory provisions" )
     unlink( "nirdiskbacked.txt" );
 
 }
+
+TEST_CASE( "NIRTreeDisk: pageOrderSearch matches search" )
+{
+    unlink( "nirdiskbacked.txt" );
+    std::vector<Rectangle> queries = {
+        Rectangle( 0.0, 0.0, 1000.0, 1000.0 ),
+        Rectangle( 100.0, 200.0, 300.0, 250.0 ),
+        Rectangle( 500.0, 500.0, 500.0, 500.0 ),
+        Rectangle( 2000.0, 2000.0, 3000.0, 3000.0 )
+    };
+    {
+        DefaulTreeType tree( 4096*20, "nirdiskbacked.txt" );
+        for( unsigned i = 0; i < 3000; i++ ) {
+            tree.insert( Point( (i * 7919) % 1000, (i * 104729) % 1000 ) );
+        }
+        tree.write_metadata();
+    }
+    {
+        DefaulTreeType tree( 4096*20, "nirdiskbacked.txt" );
+        for( Rectangle &query : queries ) {
+            std::vector<Point> expected = tree.search( query );
+            std::vector<Point> found = tree.pageOrderSearch( query );
+            auto lexicographic = []( const Point &a, const Point &b ) {
+                return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1]);
+            };
+            std::sort( expected.begin(), expected.end(), lexicographic );
+            std::sort( found.begin(), found.end(), lexicographic );
+            REQUIRE( found == expected );
+        }
+        REQUIRE( tree.pageOrderSearch( queries[0] ).size() == 3000 );
+    }
+    unlink( "nirdiskbacked.txt" );
+}
+
+TEST_CASE( "NIRTreeDisk: lazy deletes tombstone then compact" )
+{
+    unlink( "nirdiskbacked.txt" );
+    auto scattered = []( unsigned i ) {
+        return Point( (i * 7919) % 1000, (i * 104729) % 1000 );
+    };
+    Rectangle everything( 0.0, 0.0, 1000.0, 1000.0 );
+    {
+        DefaulTreeType tree( 4096*20, "nirdiskbacked.txt" );
+        // Never compacts on its own
+        tree.enableLazyDeletes( 100 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            tree.insert( scattered(i) );
+        }
+        for( unsigned i = 0; i < 1000; i += 2 ) {
+            tree.remove( scattered(i) );
+        }
+        REQUIRE( tree.tombstone_count_ == 500 );
+        REQUIRE( tree.point_count_ == 500 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            REQUIRE( tree.search( scattered(i) ).size() == i % 2 );
+        }
+        REQUIRE( tree.search( everything ).size() == 500 );
+        REQUIRE( tree.pageOrderSearch( everything ).size() == 500 );
+
+        // Already gone
+        tree.remove( scattered(0) );
+        REQUIRE( tree.tombstone_count_ == 500 );
+        REQUIRE( tree.point_count_ == 500 );
+
+        // Lands in the leaf holding its own tombstone and takes that slot
+        tree.insert( scattered(0) );
+        REQUIRE( tree.tombstone_count_ == 499 );
+        REQUIRE( tree.search( scattered(0) ).size() == 1 );
+        tree.write_metadata();
+    }
+    {
+        DefaulTreeType tree( 4096*20, "nirdiskbacked.txt" );
+        REQUIRE( tree.tombstone_count_ == 499 );
+        REQUIRE( tree.point_count_ == 501 );
+        REQUIRE( tree.search( everything ).size() == 501 );
+
+        tree.compactTombstones();
+        REQUIRE( tree.tombstone_count_ == 0 );
+        REQUIRE( tree.point_count_ == 501 );
+        REQUIRE( tree.validate() );
+        REQUIRE( tree.search( everything ).size() == 501 );
+        for( unsigned i = 1; i < 1000; i++ ) {
+            REQUIRE( tree.search( scattered(i) ).size() == i % 2 );
+        }
+
+        // Past a quarter of the entries the tree compacts itself
+        tree.enableLazyDeletes( 25 );
+        for( unsigned i = 1; i < 800; i += 2 ) {
+            tree.remove( scattered(i) );
+            REQUIRE( tree.tombstone_count_ * 4 <=
+                    tree.point_count_ + tree.tombstone_count_ );
+        }
+        REQUIRE( tree.point_count_ == 101 );
+        REQUIRE( tree.validate() );
+        REQUIRE( tree.search( everything ).size() == 101 );
+        for( unsigned i = 801; i < 1000; i += 2 ) {
+            REQUIRE( tree.search( scattered(i) ).size() == 1 );
+        }
+    }
+    unlink( "nirdiskbacked.txt" );
+}
+
+TEST_CASE( "NIRTreeDisk: range estimates bound the true count" )
+{
+    unlink( "nirdiskbacked.txt" );
+    {
+        DefaulTreeType tree( 4096*100, "nirdiskbacked.txt" );
+        for( unsigned i = 0; i < 10000; i++ ) {
+            tree.insert( Point( (i * 7919) % 10000 * 0.1, (i * 104729) % 10000 * 0.1 ) );
+        }
+        // Tombstoned points don't count
+        tree.enableLazyDeletes( 50 );
+        for( unsigned i = 0; i < 10000; i += 5 ) {
+            tree.remove( Point( (i * 7919) % 10000 * 0.1, (i * 104729) % 10000 * 0.1 ) );
+        }
+        tree.buildRangeEstimator();
+
+        for( unsigned i = 0; i < 200; i++ ) {
+            double x = (i * 131) % 900;
+            double y = (i * 337) % 900;
+            double w = 5.0 + (i * 17) % 100;
+            Rectangle query( x, y, x + w, y + w );
+            range_estimate e = tree.estimate( query );
+            uint64_t actual = tree.search( query ).size();
+            REQUIRE( e.lower_ <= actual );
+            REQUIRE( actual <= e.upper_ );
+        }
+        range_estimate everything = tree.estimate( Rectangle( 0.0, 0.0, 1000.0, 1000.0 ) );
+        REQUIRE( everything.upper_ == 8000 );
+        REQUIRE( everything.count_ <= 8000 );
+    }
+    unlink( "nirdiskbacked.txt" );
+}
+
+TEST_CASE( "NIRTreeDisk: duplicates go to overflow chains" )
+{
+    unlink( "nirdiskbacked.txt" );
+    Rectangle everything( 0.0, 0.0, 1000.0, 1000.0 );
+    Point hot[3] = { Point(250,250), Point(500,500), Point(750,100) };
+    auto scattered = []( unsigned i ) {
+        return Point( i + 0.5, (i * 37) % 300 + 0.5 );
+    };
+    {
+        DefaulTreeType tree( 4096*20, "nirdiskbacked.txt" );
+        // Far more copies of a few points than a leaf holds, mixed in
+        // with distinct points
+        for( unsigned i = 0; i < 3000; i++ ) {
+            tree.insert( hot[i % 3] );
+            if( i % 10 == 0 ) {
+                tree.insert( scattered(i / 10) );
+            }
+        }
+        REQUIRE( tree.validate() );
+        REQUIRE( tree.point_count_ == 3300 );
+        REQUIRE( tree.search( everything ).size() == 3300 );
+        REQUIRE( tree.pageOrderSearch( everything ).size() == 3300 );
+        for( unsigned k = 0; k < 3; k++ ) {
+            REQUIRE( tree.search( hot[k] ).size() == 1000 );
+        }
+
+        // One copy in a leaf, the rest chained off it
+        auto leaf_node = tree.get_leaf_node(
+                tree.get_branch_node( tree.root )->findLeaf( hot[0] ) );
+        REQUIRE( overflow_count( &tree.node_allocator_, leaf_node->overflow_ ) == 999 );
+
+        for( unsigned i = 0; i < 999; i++ ) {
+            tree.remove( hot[0] );
+        }
+        REQUIRE( tree.search( hot[0] ).size() == 1 );
+        leaf_node = tree.get_leaf_node(
+                tree.get_branch_node( tree.root )->findLeaf( hot[0] ) );
+        REQUIRE( leaf_node->overflow_ == nullptr );
+        tree.remove( hot[0] );
+        REQUIRE( tree.search( hot[0] ).size() == 0 );
+        REQUIRE( tree.validate() );
+        tree.write_metadata();
+    }
+    {
+        DefaulTreeType tree( 4096*20, "nirdiskbacked.txt" );
+        REQUIRE( tree.search( hot[1] ).size() == 1000 );
+        REQUIRE( tree.search( everything ).size() == 2300 );
+
+        // Lazy deletes take copies straight out of the chain, and
+        // compaction carries the chains of leaves it dissolves
+        tree.enableLazyDeletes( 100 );
+        for( unsigned i = 0; i < 500; i++ ) {
+            tree.remove( hot[2] );
+        }
+        REQUIRE( tree.tombstone_count_ == 0 );
+        for( unsigned i = 0; i < 300; i++ ) {
+            tree.remove( scattered(i) );
+        }
+        REQUIRE( tree.tombstone_count_ > 0 );
+        tree.compactTombstones();
+        REQUIRE( tree.tombstone_count_ == 0 );
+        REQUIRE( tree.validate() );
+        REQUIRE( tree.search( hot[1] ).size() == 1000 );
+        REQUIRE( tree.search( hot[2] ).size() == 500 );
+        REQUIRE( tree.search( everything ).size() == 1500 );
+    }
+    unlink( "nirdiskbacked.txt" );
+}
+
+TEST_CASE( "NIRTreeDisk: scans skip tombstones and read overflow chains" )
+{
+    unlink( "nirdiskbacked.txt" );
+    auto scattered = []( unsigned i ) {
+        return Point( (i * 7919) % 1000, (i * 104729) % 1000 );
+    };
+    {
+        DefaulTreeType tree( 4096*20, "nirdiskbacked.txt" );
+        tree.enableLazyDeletes( 100 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            tree.insert( scattered(i) );
+        }
+        for( unsigned i = 0; i < 500; i++ ) {
+            tree.insert( Point( 500.5, 500.5 ) );
+        }
+        for( unsigned i = 0; i < 1000; i += 2 ) {
+            tree.remove( scattered(i) );
+        }
+        REQUIRE( tree.tombstone_count_ == 500 );
+
+        point_scan cursor = tree.scan();
+        std::vector<Point> points;
+        while( cursor.next( points ) ) {
+        }
+        REQUIRE( points.size() == 1000 );
+        REQUIRE( std::count( points.begin(), points.end(),
+                    Point( 500.5, 500.5 ) ) == 500 );
+        for( unsigned i = 1; i < 1000; i += 2 ) {
+            REQUIRE( std::count( points.begin(), points.end(),
+                        scattered(i) ) == 1 );
+        }
+
+        REQUIRE( tree.exportPoints( "nirexport.bin" ) == 1000 );
+        std::ifstream file( "nirexport.bin", std::ios::binary |
+                std::ios::ate );
+        REQUIRE( (size_t) file.tellg() == 1000 * dimensions *
+                sizeof(double) );
+        unlink( "nirexport.bin" );
+    }
+    unlink( "nirdiskbacked.txt" );
+}
@@ -0,0 +1,192 @@
+#include <catch2/catch.hpp>
+#include <partitionedindex/partitionedindex.h>
+#include <rstartree/rstartree.h>
+#include <rstartreedisk/rstartreedisk.h>
+#include <util/geometry.h>
+#include <algorithm>
+#include <string>
+#include <unistd.h>
+
+static Index *createRStarTree(unsigned partitionId)
+{
+	return new rstartree::RStarTree(3, 7);
+}
+
+static std::vector<Point> scatteredPoints(unsigned n, unsigned offset = 0)
+{
+	std::vector<Point> points;
+	for (unsigned i = offset; i < offset + n; ++i)
+	{
+		points.push_back(Point((i * 7919) % 1000, (i * 104729) % 1000));
+	}
+
+	return points;
+}
+
+static void sortPoints(std::vector<Point> &points)
+{
+	std::sort(points.begin(), points.end(), [](const Point &a, const Point &b)
+	{
+		return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1]);
+	});
+}
+
+TEST_CASE("PartitionedIndex: kd splits balance the sample")
+{
+	std::vector<Point> sample = scatteredPoints(1000);
+	partitionedindex::PartitionedIndex index(4, sample, createRStarTree);
+
+	REQUIRE(index.partitions.size() == 4);
+	REQUIRE(index.partitionsFor(Rectangle(Point::atNegInfinity, Point::atInfinity)).size() == 4);
+
+	std::vector<unsigned> counts(4, 0);
+	for (const Point &p : sample)
+	{
+		unsigned partition = index.partitionFor(p);
+		REQUIRE(index.partitions[partition]->region.containsPoint(p));
+		counts[partition]++;
+	}
+	for (unsigned count : counts)
+	{
+		REQUIRE(count >= 240);
+		REQUIRE(count <= 260);
+	}
+
+	// Uneven partition counts still cover everything
+	partitionedindex::PartitionedIndex odd(3, sample, createRStarTree);
+	REQUIRE(odd.partitions.size() == 3);
+	REQUIRE(odd.partitionsFor(Rectangle(0.0, 0.0, 1000.0, 1000.0)).size() == 3);
+
+	// A rectangle inside one region only touches that partition
+	unsigned home = index.partitionFor(Point(1.0, 1.0));
+	std::vector<unsigned> touched = index.partitionsFor(Rectangle(1.0, 1.0, 1.5, 1.5));
+	REQUIRE(touched.size() == 1);
+	REQUIRE(touched[0] == home);
+}
+
+TEST_CASE("PartitionedIndex: queries match a single tree")
+{
+	std::vector<Point> points = scatteredPoints(2000);
+	std::vector<Point> sample(points.begin(), points.begin() + 200);
+	partitionedindex::PartitionedIndex index(8, sample, createRStarTree);
+	rstartree::RStarTree reference(3, 7);
+
+	std::vector<Point> firstHalf(points.begin(), points.begin() + 1000);
+	index.bulkInsert(firstHalf);
+	for (unsigned i = 1000; i < points.size(); ++i)
+	{
+		index.insert(points[i]);
+	}
+	for (const Point &p : points)
+	{
+		reference.insert(p);
+	}
+
+	REQUIRE(index.validate());
+	REQUIRE(index.checksum() == reference.checksum());
+
+	std::vector<Rectangle> queries = {
+		Rectangle(0.0, 0.0, 1000.0, 1000.0),
+		Rectangle(100.0, 200.0, 300.0, 250.0),
+		Rectangle(499.0, 0.0, 501.0, 1000.0),
+		Rectangle(2000.0, 2000.0, 3000.0, 3000.0)
+	};
+	for (const Rectangle &query : queries)
+	{
+		std::vector<Point> expected = reference.search(query);
+		std::vector<Point> found = index.search(query);
+		sortPoints(expected);
+		sortPoints(found);
+		REQUIRE(found == expected);
+	}
+
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		REQUIRE(index.search(points[i]).size() == reference.search(points[i]).size());
+	}
+
+	index.remove(points[0]);
+	index.remove(Point(-5.0, -5.0));
+	uint64_t total = 0;
+	for (auto &partition : index.partitions)
+	{
+		total += partition->pointCount;
+	}
+	REQUIRE(total == points.size() - 1);
+}
+
+TEST_CASE("PartitionedIndex: rebalance splits hot partitions")
+{
+	// Learn the partitioning from a sample that misses the hot spot
+	std::vector<Point> sample = scatteredPoints(200);
+	std::vector<unsigned> retired;
+	partitionedindex::PartitionedIndex index(2, sample, createRStarTree,
+		[&retired](unsigned partitionId) { retired.push_back(partitionId); });
+
+	std::vector<Point> points = scatteredPoints(500);
+	for (unsigned i = 0; i < 1500; ++i)
+	{
+		points.push_back(Point(10.0 + (i % 40) * 0.1, 10.0 + (i / 40) * 0.1));
+	}
+	index.bulkInsert(points);
+
+	unsigned splits = index.rebalance(300);
+	REQUIRE(splits > 0);
+	REQUIRE(retired.size() == splits);
+	REQUIRE(index.partitions.size() == 2 + splits);
+	for (auto &partition : index.partitions)
+	{
+		REQUIRE(partition->pointCount <= 300);
+	}
+	REQUIRE(index.validate());
+	REQUIRE(index.search(Rectangle(0.0, 0.0, 1000.0, 1000.0)).size() == points.size());
+	REQUIRE(index.search(Rectangle(10.0, 10.0, 11.0, 11.0)).size() == 100);
+
+	// Nothing left to do
+	REQUIRE(index.rebalance(300) == 0);
+
+	// Duplicates can't be split apart, so rebalance has to give up
+	partitionedindex::PartitionedIndex duplicates(1, {}, createRStarTree);
+	for (unsigned i = 0; i < 50; ++i)
+	{
+		duplicates.insert(Point(3.0, 3.0));
+	}
+	REQUIRE(duplicates.rebalance(10) == 0);
+}
+
+TEST_CASE("PartitionedIndex: disk-backed partitions")
+{
+	auto fileName = [](unsigned partitionId)
+	{
+		return "partitiondiskbacked" + std::to_string(partitionId) + ".txt";
+	};
+	auto factory = [&fileName](unsigned partitionId) -> Index *
+	{
+		unlink(fileName(partitionId).c_str());
+		return new rstartreedisk::RStarTreeDisk<3,7>(4096 * 20, fileName(partitionId));
+	};
+	auto retirer = [&fileName](unsigned partitionId)
+	{
+		unlink(fileName(partitionId).c_str());
+	};
+
+	std::vector<Point> points = scatteredPoints(3000);
+	std::vector<Point> sample(points.begin(), points.begin() + 300);
+	unsigned partitionCount;
+	{
+		partitionedindex::PartitionedIndex index(4, sample, factory, retirer);
+		index.bulkInsert(points);
+		index.rebalance(1000);
+		partitionCount = index.partitions.size();
+		REQUIRE(index.search(Rectangle(0.0, 0.0, 1000.0, 1000.0)).size() == points.size());
+		REQUIRE(index.pageOrderSearch(Rectangle(0.0, 0.0, 500.0, 500.0)).size() ==
+			index.search(Rectangle(0.0, 0.0, 500.0, 500.0)).size());
+		index.write_metadata();
+	}
+
+	// Ids are handed out sequentially, so one past the last id is free
+	for (unsigned i = 0; i <= partitionCount * 2; ++i)
+	{
+		unlink(fileName(i).c_str());
+	}
+}
@@ -369,3 +369,154 @@ TEST_CASE( "R+TreeDisk: Inserts and Read from Disk" ) {
 
     unlink( "rplustreedisk.txt" );
 }
+
+TEST_CASE( "R+TreeDisk: Reopen checks superblock" ) {
+    unlink( "rplustreedisk.txt" );
+    {
+        TWO_THREE_TREE tree( 4096*100, "rplustreedisk.txt" );
+
+        for( unsigned i = 0; i < 200; i++ ) {
+            tree.insert( Point(i,i) );
+        }
+
+        tree.write_metadata();
+    }
+
+    {
+        TWO_THREE_TREE tree( 4096*100, "rplustreedisk.txt" );
+        REQUIRE( tree.point_count_ == 200 );
+
+        // Keep growing the reopened tree, nothing may land on top of
+        // existing nodes.
+        for( unsigned i = 200; i < 400; i++ ) {
+            tree.insert( Point(i,i) );
+        }
+        for( unsigned i = 0; i < 400; i++ ) {
+            REQUIRE( tree.search( Point(i,i) ).size() == 1 );
+        }
+        tree.write_metadata();
+    }
+
+    // Different fanout, same file
+    REQUIRE_THROWS( rplustreedisk::RPlusTreeDisk<3,7>( 4096*100,
+                "rplustreedisk.txt" ) );
+
+    unlink( "rplustreedisk.txt" );
+}
+
+TEST_CASE( "R+TreeDisk: lazy deletes tombstone then compact" ) {
+    unlink( "rplustreedisk.txt" );
+    Rectangle everything( 0.0, 0.0, 1000.0, 1000.0 );
+    {
+        TWO_THREE_TREE tree( 4096*100, "rplustreedisk.txt" );
+        // Never compacts on its own
+        tree.enableLazyDeletes( 100 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            tree.insert( Point(i,i) );
+        }
+        for( unsigned i = 0; i < 1000; i += 2 ) {
+            tree.remove( Point(i,i) );
+        }
+        REQUIRE( tree.tombstone_count_ == 500 );
+        REQUIRE( tree.point_count_ == 500 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            REQUIRE( tree.search( Point(i,i) ).size() == i % 2 );
+        }
+        REQUIRE( tree.search( everything ).size() == 500 );
+        REQUIRE( tree.pageOrderSearch( everything ).size() == 500 );
+
+        // Takes the slot of its own tombstone
+        tree.insert( Point(0,0) );
+        REQUIRE( tree.tombstone_count_ == 499 );
+        REQUIRE( tree.search( Point(0,0) ).size() == 1 );
+        tree.write_metadata();
+    }
+    {
+        TWO_THREE_TREE tree( 4096*100, "rplustreedisk.txt" );
+        REQUIRE( tree.tombstone_count_ == 499 );
+        REQUIRE( tree.point_count_ == 501 );
+
+        tree.compactTombstones();
+        REQUIRE( tree.tombstone_count_ == 0 );
+        REQUIRE( tree.search( everything ).size() == 501 );
+        for( unsigned i = 1; i < 1000; i++ ) {
+            REQUIRE( tree.search( Point(i,i) ).size() == i % 2 );
+        }
+
+        // Past a quarter of the entries the tree compacts itself
+        tree.enableLazyDeletes( 25 );
+        for( unsigned i = 1; i < 800; i += 2 ) {
+            tree.remove( Point(i,i) );
+            REQUIRE( tree.tombstone_count_ * 4 <=
+                    tree.point_count_ + tree.tombstone_count_ );
+        }
+        REQUIRE( tree.point_count_ == 101 );
+        REQUIRE( tree.search( everything ).size() == 101 );
+        for( unsigned i = 801; i < 1000; i += 2 ) {
+            REQUIRE( tree.search( Point(i,i) ).size() == 1 );
+        }
+    }
+    unlink( "rplustreedisk.txt" );
+}
+
+TEST_CASE( "R+TreeDisk: duplicates go to overflow chains" ) {
+    unlink( "rplustreedisk.txt" );
+    Rectangle everything( 0.0, 0.0, 1000.0, 1000.0 );
+    Point hot[3] = { Point(250,250), Point(500,500), Point(750,100) };
+    {
+        TWO_THREE_TREE tree( 4096*100, "rplustreedisk.txt" );
+        // Far more copies of a few points than a leaf holds, mixed in
+        // with distinct points
+        for( unsigned i = 0; i < 3000; i++ ) {
+            tree.insert( hot[i % 3] );
+            if( i % 10 == 0 ) {
+                tree.insert( Point( i / 10 + 0.5, (i / 10 * 37) % 300 + 0.5 ) );
+            }
+        }
+        REQUIRE( tree.validate() );
+        REQUIRE( tree.point_count_ == 3300 );
+        REQUIRE( tree.search( everything ).size() == 3300 );
+        REQUIRE( tree.pageOrderSearch( everything ).size() == 3300 );
+        for( unsigned k = 0; k < 3; k++ ) {
+            REQUIRE( tree.search( hot[k] ).size() == 1000 );
+        }
+
+        // One copy in a leaf, the rest chained off it
+        auto leaf_node = tree.get_node( tree.get_node( tree.root_ )->findLeaf( hot[0] ) );
+        REQUIRE( overflow_count( &tree.node_allocator_, leaf_node->overflow_ ) == 999 );
+
+        for( unsigned i = 0; i < 999; i++ ) {
+            tree.remove( hot[0] );
+        }
+        REQUIRE( tree.search( hot[0] ).size() == 1 );
+        leaf_node = tree.get_node( tree.get_node( tree.root_ )->findLeaf( hot[0] ) );
+        REQUIRE( leaf_node->overflow_ == nullptr );
+        tree.remove( hot[0] );
+        REQUIRE( tree.search( hot[0] ).size() == 0 );
+        REQUIRE( tree.validate() );
+        tree.write_metadata();
+    }
+    {
+        TWO_THREE_TREE tree( 4096*100, "rplustreedisk.txt" );
+        REQUIRE( tree.search( hot[1] ).size() == 1000 );
+        REQUIRE( tree.search( everything ).size() == 2300 );
+
+        // Lazy deletes take copies straight out of the chain
+        tree.enableLazyDeletes( 100 );
+        for( unsigned i = 0; i < 500; i++ ) {
+            tree.remove( hot[2] );
+        }
+        REQUIRE( tree.tombstone_count_ == 0 );
+        for( unsigned i = 0; i < 300; i++ ) {
+            tree.remove( Point( i + 0.5, (i * 37) % 300 + 0.5 ) );
+        }
+        REQUIRE( tree.tombstone_count_ > 0 );
+        tree.compactTombstones();
+        REQUIRE( tree.tombstone_count_ == 0 );
+        REQUIRE( tree.validate() );
+        REQUIRE( tree.search( hot[1] ).size() == 1000 );
+        REQUIRE( tree.search( hot[2] ).size() == 500 );
+        REQUIRE( tree.search( everything ).size() == 1500 );
+    }
+    unlink( "rplustreedisk.txt" );
+}
@@ -2,6 +2,7 @@
 #include <rstartree/rstartree.h>
 #include <util/geometry.h>
 #include <iostream>
+#include <random>
 
 static rstartree::Node::NodeEntry createBranchEntry(const Rectangle &boundingBox, rstartree::Node *child)
 {
@@ -935,3 +936,121 @@ TEST_CASE("R*Tree: reInsertAccountsForNewTreeDepth")
 	REQUIRE(root->parent->level == 3);
 }
 
+
+TEST_CASE("R*Tree: batchSearch matches search")
+{
+	rstartree::RStarTree tree(3, 7);
+	for (unsigned i = 0; i < 2000; ++i)
+	{
+		tree.insert(Point((i * 7919) % 500, (i * 104729) % 500));
+	}
+	// Every point goes in four times, the origin once more
+	tree.insert(Point(0.0, 0.0));
+
+	std::vector<Point> requestedPoints;
+	for (unsigned i = 0; i < 300; ++i)
+	{
+		requestedPoints.push_back(Point((i * 7919) % 500, (i * 104729) % 500));
+	}
+	requestedPoints.push_back(Point(-1.0, -1.0));
+	requestedPoints.push_back(Point(0.5, 0.5));
+
+	std::vector<std::vector<Point>> results = tree.batchSearch(requestedPoints);
+	REQUIRE(results.size() == requestedPoints.size());
+	for (unsigned i = 0; i < requestedPoints.size(); ++i)
+	{
+		REQUIRE(results[i].size() == tree.search(requestedPoints[i]).size());
+		for (Point &p : results[i])
+		{
+			REQUIRE(p == requestedPoints[i]);
+		}
+	}
+	REQUIRE(results[0].size() == 5);
+	REQUIRE(results[1].size() == 4);
+	REQUIRE(results[300].empty());
+	REQUIRE(results[301].empty());
+	REQUIRE(tree.batchSearch(std::vector<Point>()).empty());
+}
+
+TEST_CASE("R*Tree: packed layout matches search")
+{
+	rstartree::RStarTree tree(3, 7);
+
+	// An empty tree packs to an empty leaf
+	PackedTree empty = tree.pack();
+	REQUIRE(empty.nodeCount() == 1);
+	REQUIRE(empty.validate());
+	REQUIRE(empty.search(Point(0.0, 0.0)).empty());
+
+	for (unsigned i = 0; i < 2000; ++i)
+	{
+		tree.insert(Point((i * 7919) % 500, (i * 104729) % 500));
+	}
+
+	PackedTree packed = tree.pack();
+	REQUIRE(packed.validate());
+	REQUIRE(packed.size() % 64 == 0);
+	REQUIRE(packed.nodeCount() > 2000 / 7);
+
+	for (unsigned i = 0; i < 300; ++i)
+	{
+		Point p((i * 7919) % 500, (i * 104729) % 500);
+		std::vector<Point> v = packed.search(p);
+		REQUIRE(v.size() == tree.search(p).size());
+		REQUIRE(v.size() == 4);
+		for (Point &found : v)
+		{
+			REQUIRE(found == p);
+		}
+	}
+	REQUIRE(packed.search(Point(-1.0, -1.0)).empty());
+
+	for (unsigned i = 0; i < 50; ++i)
+	{
+		Rectangle r(i * 9.0, i * 7.0, i * 9.0 + 40.0, i * 7.0 + 60.0);
+		REQUIRE(packed.search(r).size() == tree.search(r).size());
+	}
+	REQUIRE(packed.search(Rectangle(Point::atNegInfinity, Point::atInfinity)).size() == 2000);
+}
+
+TEST_CASE("R*Tree: learned routing finds every point")
+{
+	rstartree::RStarTree tree(8, 16);
+	std::default_random_engine generator(3);
+	std::uniform_real_distribution<double> pointDist(0.0, 1000.0);
+	std::vector<Point> points;
+	for (unsigned i = 0; i < 5000; ++i)
+	{
+		points.push_back(Point(pointDist(generator), pointDist(generator)));
+		tree.insert(points.back());
+	}
+	// Duplicates may sit under different children
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		tree.insert(points[i]);
+	}
+
+	PackedTree packed = tree.pack();
+	REQUIRE(packed.height() >= 3);
+	packed.learnRouting(packed.height() - 1);
+	REQUIRE(packed.routedNodeCount() > 0);
+	REQUIRE(packed.validate());
+
+	for (unsigned i = 0; i < points.size(); ++i)
+	{
+		std::vector<Point> v = packed.search(points[i]);
+		REQUIRE(v.size() == (i < 100 ? 2 : 1));
+		REQUIRE(v[0] == points[i]);
+	}
+
+	// Points the models never saw, inside the data and out, aren't found
+	REQUIRE(packed.search(Point(500.5, 500.5)).empty());
+	REQUIRE(packed.search(Point(-1.0, 2000.0)).empty());
+
+	// Range searches don't route
+	REQUIRE(packed.search(Rectangle(Point::atNegInfinity, Point::atInfinity)).size() == 5100);
+
+	packed.learnRouting(0);
+	REQUIRE(packed.routedNodeCount() == 0);
+	REQUIRE(packed.search(points[0]).size() == 2);
+}
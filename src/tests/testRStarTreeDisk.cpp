@@ -1,5 +1,11 @@
 #include <catch2/catch.hpp>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 #include <rstartreedisk/rstartreedisk.h>
+#include <storage/shared_buffer_pool.h>
 #include <util/geometry.h>
 #include <iostream>
 #include <unistd.h>
@@ -645,8 +651,7 @@ TEST_CASE("R*TreeDisk: testFindLeaf ON DISK")
 
     TreeType tree( 4096 * 5, "rstardiskbacked.txt" );
     REQUIRE( root == tree.root );
-    auto rootNode = tree.node_allocator_.get_tree_node<NodeType>( root
-            );
+    auto rootNode = tree.get_node( root );
 
 	// Test finding leaves
 	REQUIRE(rootNode->findLeaf(Point(-11.0, -3.0)) == cluster4a);
@@ -1325,12 +1330,13 @@ TEST_CASE("R*TreeDisk: testSearch")
                 nextafter(3.0, DBL_MAX));
         std::vector<Point> v5 = rootNode->search(sr5);
         REQUIRE(v5.size() == 0);
+
+        tree.write_metadata();
     }
     {
         // Re-read the tree from disk, doall the searches again
         TreeType tree( 4096*5, "rstardiskbacked.txt");
-        auto rootNode = tree.node_allocator_.get_tree_node<NodeType>(
-                tree.root );
+        auto rootNode = tree.get_node( tree.root );
         // Test set one
         Rectangle sr1 = Rectangle(-9.0, 9.5, nextafter(-5.0, DBL_MAX),
                 nextafter(12.5, DBL_MAX));
@@ -1478,3 +1484,726 @@ TEST_CASE("R*TreeDisk: reInsertAccountsForNewTreeDepth")
 }
 
 
+
+TEST_CASE("R*TreeDisk: pageOrderSearch matches search")
+{
+    unlink( "rstardiskbacked.txt" );
+    std::vector<Rectangle> queries = {
+        Rectangle( 0.0, 0.0, 1000.0, 1000.0 ),
+        Rectangle( 100.0, 200.0, 300.0, 250.0 ),
+        Rectangle( 500.0, 500.0, 500.0, 500.0 ),
+        Rectangle( 2000.0, 2000.0, 3000.0, 3000.0 )
+    };
+    {
+        TreeType tree( 4096*20, "rstardiskbacked.txt" );
+        for( unsigned i = 0; i < 3000; i++ ) {
+            tree.insert( Point( (i * 7919) % 1000, (i * 104729) % 1000 ) );
+        }
+        tree.write_metadata();
+    }
+    {
+        // Reopened so that every node starts out on disk
+        TreeType tree( 4096*20, "rstardiskbacked.txt" );
+        for( Rectangle &query : queries ) {
+            std::vector<Point> expected = tree.search( query );
+            std::vector<Point> found = tree.pageOrderSearch( query );
+            auto lexicographic = []( const Point &a, const Point &b ) {
+                return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1]);
+            };
+            std::sort( expected.begin(), expected.end(), lexicographic );
+            std::sort( found.begin(), found.end(), lexicographic );
+            REQUIRE( found == expected );
+        }
+        REQUIRE( tree.pageOrderSearch( queries[0] ).size() == 3000 );
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE("R*TreeDisk: point index tracks leaves across splits and removes")
+{
+    unlink( "rstardiskbacked.txt" );
+    auto pointFor = []( unsigned i ) {
+        return Point( (i * 7919) % 1000, (i * 104729) % 1000 );
+    };
+    {
+        TreeType tree( 4096*20, "rstardiskbacked.txt", RAW_PAGES, true );
+        // Every point goes in three times
+        for( unsigned i = 0; i < 3000; i++ ) {
+            tree.insert( pointFor( i ) );
+        }
+        REQUIRE( tree.point_index_.size() == 3000 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            std::vector<Point> found = tree.search( pointFor( i ) );
+            REQUIRE( found.size() == 3 );
+            REQUIRE( found[0] == pointFor( i ) );
+        }
+        REQUIRE( tree.search( Point( 0.5, 0.5 ) ).empty() );
+
+        for( unsigned i = 0; i < 200; i++ ) {
+            while( !tree.search( pointFor( i ) ).empty() ) {
+                tree.remove( pointFor( i ) );
+            }
+        }
+        REQUIRE( tree.point_index_.size() == 2400 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            REQUIRE( tree.search( pointFor( i ) ).size() == (i < 200 ? 0 : 3) );
+            REQUIRE( tree.exhaustiveSearch( pointFor( i ) ).size() == (i < 200 ? 0 : 3) );
+        }
+        tree.write_metadata();
+    }
+    {
+        // The index comes back with the file, asked for or not
+        TreeType tree( 4096*20, "rstardiskbacked.txt" );
+        REQUIRE( tree.has_point_index_ );
+        REQUIRE( tree.point_index_.size() == 2400 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            REQUIRE( tree.search( pointFor( i ) ).size() == (i < 200 ? 0 : 3) );
+        }
+        tree.insert( Point( 0.5, 0.5 ) );
+        REQUIRE( tree.search( Point( 0.5, 0.5 ) ).size() == 1 );
+        tree.write_metadata();
+    }
+    {
+        TreeType tree( 4096*20, "rstardiskbacked.txt" );
+        REQUIRE( tree.point_index_.size() == 2401 );
+        REQUIRE( tree.search( Point( 0.5, 0.5 ) ).size() == 1 );
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE("R*TreeDisk: point index built for an existing tree")
+{
+    unlink( "rstardiskbacked.txt" );
+    {
+        TreeType tree( 4096*20, "rstardiskbacked.txt" );
+        for( unsigned i = 0; i < 500; i++ ) {
+            tree.insert( Point( i, i * 2.0 ) );
+        }
+        REQUIRE_FALSE( tree.has_point_index_ );
+        tree.write_metadata();
+    }
+    {
+        TreeType tree( 4096*20, "rstardiskbacked.txt", RAW_PAGES, true );
+        REQUIRE( tree.point_index_.size() == 500 );
+        for( unsigned i = 0; i < 500; i++ ) {
+            REQUIRE( tree.search( Point( i, i * 2.0 ) ).size() == 1 );
+        }
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE("R*TreeDisk: leaf filters have no false negatives")
+{
+    blocked_bloom_filter filter( 4 );
+    for( unsigned i = 0; i < 25; i++ ) {
+        filter.add( Point( i, i * 3.0 ) );
+    }
+    for( unsigned i = 0; i < 25; i++ ) {
+        REQUIRE( filter.may_contain( Point( i, i * 3.0 ) ) );
+    }
+
+    // 10 bits per entry should rule out the vast majority of misses
+    unsigned falsePositives = 0;
+    for( unsigned i = 0; i < 10000; i++ ) {
+        if( filter.may_contain( Point( i + 0.5, i * 7.0 ) ) ) {
+            falsePositives++;
+        }
+    }
+    REQUIRE( falsePositives < 1000 );
+
+    leaf_filter_set disabled( 0, 15 );
+    REQUIRE_FALSE( disabled.enabled() );
+    REQUIRE( disabled.may_contain( tree_node_handle( 1, 0, NodeHandleType( 0 ) ), Point( 1.0, 1.0 ) ) );
+}
+
+TEST_CASE("R*TreeDisk: searches with leaf filters match searches without")
+{
+    unlink( "rstardiskbacked.txt" );
+    auto pointFor = []( unsigned i ) {
+        return Point( (i * 7919) % 1000, (i * 104729) % 1000 );
+    };
+    {
+        TreeType tree( 4096*20, "rstardiskbacked.txt", RAW_PAGES, false, 10 );
+        REQUIRE( tree.leaf_filters_.enabled() );
+        for( unsigned i = 0; i < 3000; i++ ) {
+            tree.insert( pointFor( i ) );
+        }
+        for( unsigned i = 0; i < 200; i++ ) {
+            while( !tree.search( pointFor( i ) ).empty() ) {
+                tree.remove( pointFor( i ) );
+            }
+        }
+        for( unsigned i = 0; i < 1000; i++ ) {
+            REQUIRE( tree.search( pointFor( i ) ).size() == (i < 200 ? 0 : 3) );
+            REQUIRE( tree.search( Point( i + 0.5, i + 0.5 ) ).empty() );
+        }
+        tree.write_metadata();
+    }
+    {
+        // Rebuilt for every leaf on reopen
+        TreeType tree( 4096*20, "rstardiskbacked.txt", RAW_PAGES, false, 10 );
+        REQUIRE( tree.leaf_filters_.filter_count() > 1 );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            REQUIRE( tree.search( pointFor( i ) ).size() == (i < 200 ? 0 : 3) );
+        }
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE("R*TreeDisk: trees sharing a buffer pool")
+{
+    unlink( "rstardiskbacked.txt" );
+    unlink( "rstardiskbacked2.txt" );
+    auto pointFor = []( unsigned i ) {
+        return Point( (i * 7919) % 1000, (i * 104729) % 1000 );
+    };
+    shared_buffer_pool shared( 4096 * 40 );
+    {
+        TreeType hot( shared, "rstardiskbacked.txt" );
+        TreeType cold( buffer_budget( shared, 8 ), "rstardiskbacked2.txt" );
+        for( unsigned i = 0; i < 200; i++ ) {
+            cold.insert( pointFor( i ) );
+        }
+        for( unsigned i = 0; i < 3000; i++ ) {
+            hot.insert( pointFor( i ) );
+        }
+        // The hot tree gets everything but the cold tree's minimum
+        size_t hotPages = shared.get_resident_page_count(
+                hot.node_allocator_.buffer_pool_.get_shared_file_id() );
+        size_t coldPages = shared.get_resident_page_count(
+                cold.node_allocator_.buffer_pool_.get_shared_file_id() );
+        REQUIRE( hotPages >= 40 - 8 );
+        REQUIRE( hotPages + coldPages <= 40 );
+        REQUIRE( hot.validate() );
+        REQUIRE( cold.validate() );
+        for( unsigned i = 0; i < 1000; i++ ) {
+            REQUIRE( hot.search( pointFor( i ) ).size() == 3 );
+            REQUIRE( cold.search( pointFor( i ) ).size() == (i < 200 ? 1 : 0) );
+        }
+        hot.write_metadata();
+        cold.write_metadata();
+    }
+    {
+        TreeType hot( shared, "rstardiskbacked.txt" );
+        REQUIRE( hot.point_count_ == 3000 );
+        REQUIRE( hot.search( Rectangle( 0.0, 0.0, 1000.0, 1000.0 ) ).size() == 3000 );
+    }
+    unlink( "rstardiskbacked.txt" );
+    unlink( "rstardiskbacked2.txt" );
+}
+
+TEST_CASE("R*TreeDisk: batchSearch matches search")
+{
+    unlink( "rstardiskbacked.txt" );
+    TreeType tree( 4096*20, "rstardiskbacked.txt", RAW_PAGES, false, 8 );
+    for( unsigned i = 0; i < 3000; i++ ) {
+        tree.insert( Point( (i * 7919) % 1000, (i * 104729) % 1000 ) );
+    }
+    // Every point goes in three times, the origin once more
+    tree.insert( Point( 0.0, 0.0 ) );
+
+    std::vector<Point> requestedPoints;
+    for( unsigned i = 0; i < 500; i++ ) {
+        requestedPoints.push_back( Point( (i * 7919) % 1000, (i * 104729) % 1000 ) );
+        requestedPoints.push_back( Point( i + 0.5, i + 0.5 ) );
+    }
+
+    std::vector<std::vector<Point>> results = tree.batchSearch( requestedPoints );
+    REQUIRE( results.size() == requestedPoints.size() );
+    for( unsigned i = 0; i < requestedPoints.size(); i++ ) {
+        REQUIRE( results[i].size() == tree.search( requestedPoints[i] ).size() );
+        for( Point &p : results[i] ) {
+            REQUIRE( p == requestedPoints[i] );
+        }
+        REQUIRE( results[i].empty() == (i % 2 == 1) );
+    }
+    REQUIRE( results[0].size() == 4 );
+    REQUIRE( results[2].size() == 3 );
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: async searches match search" )
+{
+    unlink( "rstardiskbacked.txt" );
+    {
+        TreeType tree( 4096*20, "rstardiskbacked.txt" );
+        for( unsigned i = 0; i < 3000; i++ ) {
+            tree.insert( Point( (i * 7919) % 1000, (i * 104729) % 1000 ) );
+        }
+        tree.write_metadata();
+    }
+    {
+        // Reopened with a small pool, so searches wait on reads
+        TreeType tree( 4096*20, "rstardiskbacked.txt" );
+        executor ex;
+
+        std::vector<task<std::vector<Point>>> queries;
+        std::vector<Point> requestedPoints;
+        std::vector<Rectangle> requestedRectangles;
+        for( unsigned i = 0; i < 100; i++ ) {
+            requestedPoints.push_back( Point( (i * 7919) % 1000, (i * 104729) % 1000 ) );
+            requestedRectangles.push_back( Rectangle( i * 9.0, i * 7.0, i * 9.0 + 40.0, i * 7.0 + 60.0 ) );
+            queries.push_back( tree.searchAsync( ex, requestedPoints.back() ) );
+            queries.push_back( tree.searchAsync( ex, requestedRectangles.back() ) );
+        }
+        std::vector<std::vector<Point>> results = ex.run_all( queries );
+
+        auto lexicographic = []( const Point &a, const Point &b ) {
+            return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1]);
+        };
+        for( unsigned i = 0; i < 100; i++ ) {
+            REQUIRE( results[2*i].size() == 3 );
+            REQUIRE( results[2*i] == tree.search( requestedPoints[i] ) );
+
+            std::vector<Point> expected = tree.search( requestedRectangles[i] );
+            std::sort( expected.begin(), expected.end(), lexicographic );
+            std::sort( results[2*i+1].begin(), results[2*i+1].end(), lexicographic );
+            REQUIRE( results[2*i+1] == expected );
+        }
+
+        // Through the synchronous adapter and the Index interface
+        Index *index = &tree;
+        REQUIRE( ex.run_sync( index->searchAsync( ex, Point( -1.0, -1.0 ) ) ).empty() );
+        REQUIRE( ex.run_sync( index->searchAsync( ex, Rectangle( 0.0, 0.0, 1000.0, 1000.0 ) ) ).size() == 3000 );
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: optimistic searches alongside a writer" )
+{
+    unlink( "rstardiskbacked.txt" );
+    {
+        // Small enough that readers fault pages in and evict each other
+        TreeType tree( 4096*30, "rstardiskbacked.txt" );
+        std::vector<Point> stable;
+        for( unsigned i = 0; i < 2000; i++ ) {
+            stable.push_back( Point( i * 0.5, (i * 7919) % 2000 * 0.5 ) );
+            tree.insert( stable.back() );
+        }
+        tree.enableOptimisticReads();
+
+        std::atomic<bool> stop( false );
+        std::atomic<unsigned> failures( 0 );
+        std::vector<std::thread> readers;
+        for( unsigned t = 0; t < 4; t++ ) {
+            readers.emplace_back( [&, t]() {
+                for( unsigned i = t; !stop or i < 4000; i += 7 ) {
+                    const Point &p = stable[i % stable.size()];
+                    if( tree.search( p ).size() != 1 ) {
+                        failures++;
+                    }
+                    // Every stable point in a strip, whatever the writer
+                    // is doing elsewhere
+                    double x = (i % 1900) * 0.5;
+                    if( tree.search( Rectangle( x, 0.0, x + 20.0, 1000.0 ) ).size() != 40 ) {
+                        failures++;
+                    }
+                }
+            } );
+        }
+
+        // Points well away from the stable ones, some removed again
+        for( unsigned i = 0; i < 3000; i++ ) {
+            tree.insert( Point( 2000.0 + i, 2000.0 + (i * 31) % 3000 ) );
+            if( i % 3 == 0 ) {
+                tree.remove( Point( 2000.0 + i, 2000.0 + (i * 31) % 3000 ) );
+            }
+        }
+        stop = true;
+        for( std::thread &reader : readers ) {
+            reader.join();
+        }
+
+        REQUIRE( failures == 0 );
+        REQUIRE( tree.search( Rectangle( 2000.0, 2000.0, 5000.0, 5000.0 ) ).size() == 2000 );
+        for( const Point &p : stable ) {
+            REQUIRE( tree.search( p ).size() == 1 );
+        }
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: an insert leaves searches elsewhere undisturbed" )
+{
+    unlink( "rstardiskbacked.txt" );
+    {
+        TreeType tree( 4096*100, "rstardiskbacked.txt" );
+        for( unsigned i = 0; i < 500; i++ ) {
+            tree.insert( Point( (i * 7919) % 500 * 0.2, (i * 104729) % 500 * 0.2 ) );
+        }
+        std::vector<Point> far;
+        for( unsigned i = 0; i < 500; i++ ) {
+            far.push_back( Point( 1000.0 + (i * 7919) % 500 * 0.2, 1000.0 + (i * 104729) % 500 * 0.2 ) );
+            tree.insert( far.back() );
+        }
+        tree.enableOptimisticReads();
+        buffer_pool &pool = tree.node_allocator_.buffer_pool_;
+
+        // The pages a search of the first cluster reads
+        Rectangle near( 0.0, 0.0, 100.0, 100.0 );
+        std::vector<size_t> searched;
+        std::vector<tree_node_handle> context = { tree.root };
+        while( !context.empty() ) {
+            tree_node_handle handle = context.back();
+            context.pop_back();
+            searched.push_back( handle.get_page_id() );
+            auto node = tree.get_node( handle );
+            if( node->isLeafNode() ) {
+                continue;
+            }
+            for( unsigned i = 0; i < node->cur_offset_; i++ ) {
+                const NodeType::Branch &b = std::get<NodeType::Branch>( node->entries.at(i) );
+                if( b.boundingBox.intersectsRectangle( near ) ) {
+                    context.push_back( b.child );
+                }
+            }
+        }
+        auto isSearched = [&]( size_t page_id ) {
+            return std::find( searched.begin(), searched.end(), page_id ) != searched.end();
+        };
+
+        // Another copy of a far point whose leaf has room and shares no
+        // page with the search, so nothing above the leaf changes
+        Point added = Point::atOrigin;
+        for( const Point &p : far ) {
+            tree_node_handle leaf = tree.get_node( tree.root )->findLeaf( p );
+            if( tree.get_node( leaf )->cur_offset_ < 7 and not isSearched( leaf.get_page_id() ) ) {
+                added = p;
+                break;
+            }
+        }
+        REQUIRE( added != Point::atOrigin );
+
+        std::vector<uint32_t> versions;
+        for( size_t page_id : searched ) {
+            const char *data;
+            uint32_t version;
+            REQUIRE( pool.read_optimistic( page_id, data, version ) == buffer_pool::OPTIMISTIC_OK );
+            versions.push_back( version );
+        }
+        tree_node_handle root = tree.root;
+        tree.insert( added );
+        REQUIRE( tree.root == root );
+
+        // A search that read these pages before the insert still holds
+        // when it checks them after
+        for( unsigned i = 0; i < searched.size(); i++ ) {
+            REQUIRE( pool.validate_optimistic( searched[i], versions[i] ) );
+        }
+        uint64_t restarts = tree.optimistic_restarts_;
+        REQUIRE( tree.search( near ).size() == 500 );
+        REQUIRE( tree.search( added ).size() == 2 );
+        REQUIRE( tree.optimistic_restarts_ == restarts );
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: range estimates bound the true count" )
+{
+    unlink( "rstardiskbacked.txt" );
+    {
+        TreeType tree( 4096*100, "rstardiskbacked.txt" );
+
+        // Small trees get a cell per point and exact answers
+        for( unsigned i = 0; i < 100; i++ ) {
+            tree.insert( Point( i, (i * 37) % 100 ) );
+        }
+        range_estimate small = tree.estimate( Rectangle( 10.0, 10.0, 50.0, 50.0 ) );
+        uint64_t expected = tree.search( Rectangle( 10.0, 10.0, 50.0, 50.0 ) ).size();
+        REQUIRE( small.lower_ == expected );
+        REQUIRE( small.upper_ == expected );
+        REQUIRE( tree.range_estimator_.cell_count() == 100 );
+
+        for( unsigned i = 100; i < 20000; i++ ) {
+            tree.insert( Point( (i * 7919) % 20000 * 0.05, (i * 104729) % 20000 * 0.05 ) );
+        }
+        auto checkBounds = [&]() {
+            for( unsigned i = 0; i < 200; i++ ) {
+                double x = (i * 131) % 900;
+                double y = (i * 337) % 900;
+                double w = 5.0 + (i * 17) % 100;
+                Rectangle query( x, y, x + w, y + w );
+                range_estimate e = tree.estimate( query );
+                uint64_t actual = tree.search( query ).size();
+                REQUIRE( e.lower_ <= actual );
+                REQUIRE( actual <= e.upper_ );
+                REQUIRE( e.lower_ <= e.count_ );
+                REQUIRE( e.count_ <= e.upper_ );
+            }
+        };
+        checkBounds();
+        REQUIRE( tree.range_estimator_.cell_count() <= 4096 );
+
+        // Uniform data, so large ranges come out close
+        Rectangle half( 0.0, 0.0, 1000.0, 500.0 );
+        range_estimate e = tree.estimate( half );
+        double actual = tree.search( half ).size();
+        REQUIRE( e.count_ > actual * 0.95 );
+        REQUIRE( e.count_ < actual * 1.05 );
+
+        // Inserts and removes keep the counts exact, including ones
+        // beyond the grid so far
+        for( unsigned i = 0; i < 1000; i++ ) {
+            tree.insert( Point( 300.0 + i * 0.1, 300.0 ) );
+        }
+        for( unsigned i = 0; i < 50; i++ ) {
+            tree.insert( Point( -5000.0 + i, 7000.0 ) );
+        }
+        for( unsigned i = 100; i < 2000; i++ ) {
+            tree.remove( Point( (i * 7919) % 20000 * 0.05, (i * 104729) % 20000 * 0.05 ) );
+        }
+        checkBounds();
+        range_estimate everything = tree.estimate( Rectangle( Point::atNegInfinity, Point::atInfinity ) );
+        REQUIRE( everything.upper_ == tree.point_count_ );
+        REQUIRE( tree.estimate( Rectangle( -5000.0, 7000.0, -4950.0, 7001.0 ) ).upper_ >= 50 );
+        tree.write_metadata();
+    }
+    {
+        // The summary comes back with the file
+        TreeType tree( 4096*100, "rstardiskbacked.txt" );
+        REQUIRE( tree.range_estimator_.is_gridded() );
+        range_estimate everything = tree.estimate( Rectangle( Point::atNegInfinity, Point::atInfinity ) );
+        REQUIRE( everything.lower_ == tree.point_count_ );
+        REQUIRE( everything.upper_ == tree.point_count_ );
+        Rectangle half( 0.0, 0.0, 1000.0, 500.0 );
+        range_estimate e = tree.estimate( half );
+        uint64_t actual = tree.search( half ).size();
+        REQUIRE( e.lower_ <= actual );
+        REQUIRE( actual <= e.upper_ );
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: density tiles account for every point" )
+{
+    unlink( "rstardiskbacked.txt" );
+    {
+        TreeType tree( 4096*100, "rstardiskbacked.txt" );
+        for( unsigned i = 0; i < 20000; i++ ) {
+            tree.insert( Point( (i * 7919) % 20000 * 0.05, (i * 104729) % 20000 * 0.05 ) );
+        }
+
+        DensityRenderer renderer( tree.root, 20000, [&]( tree_node_handle nodeHandle,
+                    range_estimator::branch_list &branches,
+                    std::vector<Point> &points ) {
+            tree.expandNode( nodeHandle, branches, points );
+        } );
+
+        // Leaves are bigger than a pixel here, so every point is drawn
+        std::vector<double> counts = renderer.tileCounts( 0, 0, 0, 64 );
+        double total = 0.0;
+        for( double c : counts ) {
+            total += c;
+        }
+        REQUIRE( total == 20000.0 );
+
+        // Whereas here whole subtrees are, and their counts are estimates
+        counts = renderer.tileCounts( 0, 0, 0, 4 );
+        total = 0.0;
+        for( double c : counts ) {
+            total += c;
+        }
+        REQUIRE( total > 20000.0 * 0.5 );
+        REQUIRE( total < 20000.0 * 2.0 );
+
+        // The quadrants of a tile hold its points between them
+        double quadrants = 0.0;
+        for( unsigned x = 0; x < 2; x++ ) {
+            for( unsigned y = 0; y < 2; y++ ) {
+                counts = renderer.tileCounts( 1, x, y, 64 );
+                for( double c : counts ) {
+                    quadrants += c;
+                }
+            }
+        }
+        REQUIRE( quadrants == 20000.0 );
+
+        std::string directory = std::filesystem::temp_directory_path() / "rstardensity";
+        std::filesystem::remove_all( directory );
+        REQUIRE( tree.renderDensity( directory, 2, 2 ) == 21 );
+        REQUIRE( std::filesystem::file_size( directory + "/0/0/0.bmp" ) == 54 + 256 * 256 * 3 );
+        REQUIRE( std::filesystem::exists( directory + "/2/3/3.bmp" ) );
+        std::filesystem::remove_all( directory );
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: scans read every point in storage order" )
+{
+    unlink( "rstardiskbacked.txt" );
+    auto scattered = []( unsigned i ) {
+        return Point( (i * 7919) % 20000 * 0.05, (i * 104729) % 20000 * 0.05 );
+    };
+    {
+        TreeType tree( 4096*100, "rstardiskbacked.txt" );
+        for( unsigned i = 0; i < 20000; i++ ) {
+            tree.insert( scattered(i) );
+        }
+        tree.write_metadata();
+    }
+    {
+        // Cold, with a pool far smaller than the tree
+        TreeType tree( 4096*20, "rstardiskbacked.txt" );
+        buffer_pool &pool = tree.node_allocator_.buffer_pool_;
+        size_t read_calls_before = pool.get_read_calls();
+        size_t pages_read_before = pool.get_pages_read();
+
+        point_scan cursor = tree.scan();
+        std::vector<Point> points;
+        size_t leaves = 0;
+        while( cursor.next( points ) ) {
+            leaves++;
+        }
+        REQUIRE( leaves == cursor.get_leaf_count() );
+        REQUIRE( points.size() == 20000 );
+        REQUIRE( !cursor.next( points ) );
+
+        // Pages were read ahead many at a time
+        REQUIRE( pool.get_pages_read() - pages_read_before >
+                2 * (pool.get_read_calls() - read_calls_before) );
+
+        std::vector<Point> expected;
+        for( unsigned i = 0; i < 20000; i++ ) {
+            expected.push_back( scattered(i) );
+        }
+        auto byCoordinates = []( const Point &a, const Point &b ) {
+            return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1]);
+        };
+        std::sort( points.begin(), points.end(), byCoordinates );
+        std::sort( expected.begin(), expected.end(), byCoordinates );
+        REQUIRE( points == expected );
+
+        // Exported in the benchmarks' binary format
+        std::string path = std::filesystem::temp_directory_path() / "rstarexport.bin";
+        REQUIRE( tree.exportPoints( path ) == 20000 );
+        REQUIRE( std::filesystem::file_size( path ) == 20000 * dimensions * sizeof(double) );
+        std::ifstream file( path, std::ios::binary );
+        std::vector<Point> exported;
+        for( unsigned i = 0; i < 20000; i++ ) {
+            Point p;
+            for( unsigned d = 0; d < dimensions; d++ ) {
+                file.read( (char *) &p[d], sizeof(double) );
+            }
+            exported.push_back( p );
+        }
+        std::sort( exported.begin(), exported.end(), byCoordinates );
+        REQUIRE( exported == expected );
+        std::filesystem::remove( path );
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: removing absent points keeps the count" )
+{
+    for( bool pointIndex : { false, true } ) {
+        unlink( "rstardiskbacked.txt" );
+        {
+            TreeType tree( 4096 * 20, "rstardiskbacked.txt", RAW_PAGES, pointIndex );
+            tree.remove( Point( 1.0, 1.0 ) );
+            REQUIRE( tree.point_count_ == 0 );
+
+            for( unsigned i = 0; i < 200; i++ ) {
+                tree.insert( Point( (i * 7919) % 500, (i * 104729) % 500 ) );
+            }
+            tree.remove( Point( -1.0, -1.0 ) );
+            REQUIRE( tree.point_count_ == 200 );
+            REQUIRE( tree.search( Rectangle( 0.0, 0.0, 500.0, 500.0 ) ).size() == 200 );
+
+            tree.remove( Point( 0.0, 0.0 ) );
+            REQUIRE( tree.point_count_ == 199 );
+        }
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: removing a duplicated point removes one copy" )
+{
+    for( bool pointIndex : { false, true } ) {
+        unlink( "rstardiskbacked.txt" );
+        {
+            TreeType tree( 4096 * 20, "rstardiskbacked.txt", RAW_PAGES, pointIndex );
+            for( unsigned i = 0; i < 5; i++ ) {
+                tree.insert( Point( 3.0, 3.0 ) );
+            }
+            tree.remove( Point( 3.0, 3.0 ) );
+            REQUIRE( tree.point_count_ == 4 );
+            REQUIRE( tree.search( Point( 3.0, 3.0 ) ).size() == 4 );
+            REQUIRE( tree.estimate( Rectangle( 0.0, 0.0, 5.0, 5.0 ) ).upper_ == 4 );
+            tree.write_metadata();
+        }
+        {
+            TreeType tree( 4096 * 20, "rstardiskbacked.txt", RAW_PAGES, pointIndex );
+            REQUIRE( tree.point_count_ == 4 );
+            for( unsigned i = 0; i < 4; i++ ) {
+                tree.remove( Point( 3.0, 3.0 ) );
+            }
+            REQUIRE( tree.point_count_ == 0 );
+            REQUIRE( tree.search( Point( 3.0, 3.0 ) ).empty() );
+            REQUIRE( tree.estimate( Rectangle( 0.0, 0.0, 5.0, 5.0 ) ).upper_ == 0 );
+        }
+    }
+    unlink( "rstardiskbacked.txt" );
+}
+
+TEST_CASE( "R*TreeDisk: pages are placed by the subtree under the root" )
+{
+    unlink( "rstardiskbacked.txt" );
+    std::vector<uint64_t> subtrees;
+    {
+        TreeType tree( buffer_budget( 4096 * 100, 2 ), "rstardiskbacked.txt" );
+        for( unsigned i = 0; i < 5000; i++ ) {
+            tree.insert( Point( (i * 7919) % 5000, (i * 104729) % 5000 ) );
+        }
+        buffer_pool &pool = tree.node_allocator_.buffer_pool_;
+        auto root = tree.get_node( tree.root );
+        REQUIRE( not root->isLeafNode() );
+
+        // Nearly all the nodes under each of the root's children share a
+        // partition, where runs of page ids would split them about evenly
+        size_t nodes = 0;
+        size_t together = 0;
+        for( unsigned i = 0; i < root->cur_offset_; i++ ) {
+            std::vector<size_t> counts( pool.get_partition_count(), 0 );
+            std::vector<tree_node_handle> stack = { std::get<NodeType::Branch>( root->entries[i] ).child };
+            while( not stack.empty() ) {
+                tree_node_handle handle = stack.back();
+                stack.pop_back();
+                counts[pool.partition_for( handle.get_page_id() )]++;
+                nodes++;
+                auto node = tree.get_node( handle );
+                if( not node->isLeafNode() ) {
+                    for( unsigned j = 0; j < node->cur_offset_; j++ ) {
+                        stack.push_back( std::get<NodeType::Branch>( node->entries[j] ).child );
+                    }
+                }
+            }
+            together += *std::max_element( counts.begin(), counts.end() );
+        }
+        REQUIRE( together * 10 >= nodes * 9 );
+
+        tree.write_metadata();
+        for( size_t i = 0; i <= pool.get_highest_allocated_page_id(); i++ ) {
+            subtrees.push_back( tree.node_allocator_.get_page_subtree( i ) );
+        }
+    }
+    {
+        // The placement comes back with the file
+        TreeType tree( buffer_budget( 4096 * 100, 2 ), "rstardiskbacked.txt" );
+        for( size_t i = 0; i < subtrees.size(); i++ ) {
+            REQUIRE( tree.node_allocator_.get_page_subtree( i ) == subtrees[i] );
+        }
+        REQUIRE( tree.search( Rectangle( 0.0, 0.0, 5000.0, 5000.0 ) ).size() == 5000 );
+    }
+    unlink( "rstardiskbacked.txt" );
+    {
+        // A single partition keeps the layout as it was
+        TreeType tree( buffer_budget( 4096 * 100, 1 ), "rstardiskbacked.txt" );
+        for( unsigned i = 0; i < 5000; i++ ) {
+            tree.insert( Point( (i * 7919) % 5000, (i * 104729) % 5000 ) );
+        }
+        for( size_t i = 0; i <= tree.node_allocator_.buffer_pool_.get_highest_allocated_page_id(); i++ ) {
+            REQUIRE( tree.node_allocator_.get_page_subtree( i ) == 0 );
+        }
+    }
+    unlink( "rstardiskbacked.txt" );
+}
@@ -3,6 +3,8 @@
 #include <storage/page.h>
 #include <util/geometry.h>
 #include <iostream>
+#include <atomic>
+#include <thread>
 #include <unistd.h>
 
 using NodeType = rtreedisk::Node<3, 6>;
@@ -299,8 +301,7 @@ TEST_CASE("RTreeDisk: testSearch")
     {
         // Re-read the tree from disk, doall the searches again
         TreeType tree(4096 * 5, "rdiskbacked.txt");
-        auto rootNode = tree.node_allocator_.get_tree_node<NodeType>(
-            tree.root);
+        auto rootNode = tree.get_node( tree.root );
         // Test set one
         Rectangle sr1 = Rectangle(-9.0, 9.5, nextafter(-5.0, DBL_MAX),
                 nextafter(12.5, DBL_MAX));
@@ -808,11 +809,13 @@ TEST_CASE("RTreeDisk: testFindLeaf ON DISK")
         // Root
         rootNode->addEntryToNode(rtreedisk::createBranchEntry<NodeType::NodeEntry, BranchType>(cluster4Node->boundingBox(), cluster4));
         rootNode->addEntryToNode(rtreedisk::createBranchEntry<NodeType::NodeEntry, BranchType>(cluster5Node->boundingBox(), cluster5));
+
+        tree.write_metadata();
     }
 
     TreeType tree(4096 * 5, "rdiskbacked.txt");
     REQUIRE(root == tree.root);
-    auto rootNode = tree.node_allocator_.get_tree_node<NodeType>(root);
+    auto rootNode = tree.get_node(root);
 
     // Test finding leaves
     REQUIRE(rootNode->findLeaf(Point(-11.0, -3.0)) == cluster4a);
@@ -824,3 +827,212 @@ TEST_CASE("RTreeDisk: testFindLeaf ON DISK")
 
     unlink("rdiskbacked.txt");
 }
+
+TEST_CASE("RTreeDisk: batchSearch matches search")
+{
+    unlink("rdiskbacked.txt");
+    std::vector<Point> requestedPoints;
+    for (unsigned i = 0; i < 300; i++)
+    {
+        requestedPoints.push_back(Point((i * 7919) % 500, (i * 104729) % 500));
+    }
+    requestedPoints.push_back(Point(-1.0, -1.0));
+    {
+        TreeType tree(4096 * 20, "rdiskbacked.txt");
+        for (unsigned i = 0; i < 2000; i++)
+        {
+            tree.insert(Point((i * 7919) % 500, (i * 104729) % 500));
+        }
+        tree.write_metadata();
+    }
+    {
+        // Reopened with a small pool, so lookups also fetch from disk
+        TreeType tree(4096 * 20, "rdiskbacked.txt");
+        std::vector<std::vector<Point>> results = tree.batchSearch(requestedPoints);
+        REQUIRE(results.size() == requestedPoints.size());
+        for (unsigned i = 0; i < requestedPoints.size(); i++)
+        {
+            REQUIRE(results[i] == tree.search(requestedPoints[i]));
+        }
+        REQUIRE(results[0].size() == 4);
+        REQUIRE(results[300].empty());
+    }
+    unlink("rdiskbacked.txt");
+}
+
+TEST_CASE("RTreeDisk: optimistic searches alongside a writer")
+{
+    unlink("rdiskbacked.txt");
+    {
+        TreeType tree(4096 * 30, "rdiskbacked.txt");
+        std::vector<Point> stable;
+        for (unsigned i = 0; i < 1000; ++i)
+        {
+            stable.push_back(Point(i, (i * 7919) % 1000));
+            tree.insert(stable.back());
+        }
+        tree.enableOptimisticReads();
+
+        std::atomic<bool> stop(false);
+        std::atomic<unsigned> failures(0);
+        std::vector<std::thread> readers;
+        for (unsigned t = 0; t < 4; ++t)
+        {
+            readers.emplace_back([&, t]() {
+                for (unsigned i = t; !stop || i < 2000; i += 5)
+                {
+                    if (tree.search(stable[i % stable.size()]).size() != 1)
+                    {
+                        failures++;
+                    }
+                    double x = i % 950;
+                    if (tree.search(Rectangle(x, 0.0, x + 9.0, 1000.0)).size() != 9)
+                    {
+                        failures++;
+                    }
+                }
+            });
+        }
+
+        for (unsigned i = 0; i < 1500; ++i)
+        {
+            tree.insert(Point(2000.0 + i, 2000.0 + (i * 31) % 1500));
+        }
+        stop = true;
+        for (std::thread &reader : readers)
+        {
+            reader.join();
+        }
+
+        REQUIRE(failures == 0);
+        REQUIRE(tree.search(Rectangle(2000.0, 2000.0, 4000.0, 4000.0)).size() == 1500);
+    }
+    unlink("rdiskbacked.txt");
+}
+
+TEST_CASE("RTreeDisk: splits separate two clusters")
+{
+    std::vector<Rectangle> boxes;
+    for (unsigned i = 0; i < 4; i++)
+    {
+        boxes.push_back(Rectangle(i, i, i + 1.0, i + 1.0));
+        boxes.push_back(Rectangle(100.0 + i, 50.0 - i, 101.0 + i, 51.0 - i));
+    }
+
+    for (const std::vector<bool> &toSibling : {rtreedisk::linearSplit(boxes, 3),
+            rtreedisk::angTanSplit(boxes, 3), rtreedisk::sweepSplit(boxes, 3)})
+    {
+        REQUIRE(toSibling.size() == boxes.size());
+        for (unsigned i = 0; i < boxes.size(); i += 2)
+        {
+            REQUIRE(toSibling[i] == toSibling[0]);
+            REQUIRE(toSibling[i + 1] != toSibling[0]);
+        }
+    }
+
+    // Lopsided input still leaves both sides at least minFill
+    std::vector<Rectangle> lopsided(7, Rectangle(0.0, 0.0, 1.0, 1.0));
+    lopsided.push_back(Rectangle(500.0, 500.0, 501.0, 501.0));
+    for (const std::vector<bool> &toSibling : {rtreedisk::linearSplit(lopsided, 3),
+            rtreedisk::angTanSplit(lopsided, 3), rtreedisk::sweepSplit(lopsided, 3)})
+    {
+        unsigned moved = std::count(toSibling.begin(), toSibling.end(), true);
+        REQUIRE(moved >= 3);
+        REQUIRE(moved <= 5);
+    }
+}
+
+TEMPLATE_TEST_CASE("RTreeDisk: split strategies build valid trees", "",
+        rtreedisk::QuadraticSplit, rtreedisk::LinearSplit,
+        rtreedisk::AngTanSplit, rtreedisk::SweepSplit)
+{
+    unlink("rdiskbacked.txt");
+    {
+        rtreedisk::RTreeDisk<3, 7, TestType> tree(4096 * 20, "rdiskbacked.txt");
+        std::vector<Point> points;
+        for (unsigned i = 0; i < 1000; i++)
+        {
+            points.push_back(Point((i * 7919) % 1000, (i * 104729) % 1000));
+            tree.insert(points.back());
+        }
+        REQUIRE(tree.validate());
+        for (Point &p : points)
+        {
+            REQUIRE(tree.search(p).size() == 1);
+        }
+
+        Rectangle query(100.0, 200.0, 400.0, 350.0);
+        size_t expected = std::count_if(points.begin(), points.end(),
+                [&](const Point &p) { return query.containsPoint(p); });
+        REQUIRE(tree.search(query).size() == expected);
+    }
+    unlink("rdiskbacked.txt");
+}
+
+TEST_CASE("RTreeDisk: removing absent points keeps the count")
+{
+    unlink("rdiskbacked.txt");
+    {
+        TreeType tree(4096 * 20, "rdiskbacked.txt");
+        tree.remove(Point(1.0, 1.0));
+        REQUIRE(tree.point_count_ == 0);
+
+        for (unsigned i = 0; i < 200; i++)
+        {
+            tree.insert(Point((i * 7919) % 500, (i * 104729) % 500));
+        }
+        tree.remove(Point(-1.0, -1.0));
+        REQUIRE(tree.point_count_ == 200);
+        REQUIRE(tree.validate());
+
+        tree.remove(Point(0.0, 0.0));
+        REQUIRE(tree.point_count_ == 199);
+        tree.write_metadata();
+    }
+    {
+        TreeType tree(4096 * 20, "rdiskbacked.txt");
+        REQUIRE(tree.point_count_ == 199);
+    }
+    unlink("rdiskbacked.txt");
+}
+
+TEST_CASE("RTreeDisk: searches with leaf filters match searches without")
+{
+    unlink("rdiskbacked.txt");
+    auto pointFor = [](unsigned i) {
+        return Point((i * 7919) % 1000, (i * 104729) % 1000);
+    };
+    {
+        TreeType tree(4096 * 20, "rdiskbacked.txt", RAW_PAGES, 10);
+        REQUIRE(tree.leaf_filters_.enabled());
+        for (unsigned i = 0; i < 3000; i++)
+        {
+            tree.insert(pointFor(i));
+        }
+        for (unsigned i = 0; i < 200; i++)
+        {
+            while (!tree.search(pointFor(i)).empty())
+            {
+                tree.remove(pointFor(i));
+            }
+        }
+        REQUIRE(tree.validate());
+        for (unsigned i = 0; i < 1000; i++)
+        {
+            REQUIRE(tree.search(pointFor(i)).size() == (i < 200 ? 0 : 3));
+            REQUIRE(tree.search(Point(i + 0.5, i + 0.5)).empty());
+        }
+        REQUIRE(tree.point_count_ == 2400);
+        tree.write_metadata();
+    }
+    {
+        // Rebuilt for every leaf on reopen
+        TreeType tree(4096 * 20, "rdiskbacked.txt", RAW_PAGES, 10);
+        REQUIRE(tree.leaf_filters_.filter_count() > 1);
+        for (unsigned i = 0; i < 1000; i++)
+        {
+            REQUIRE(tree.search(pointFor(i)).size() == (i < 200 ? 0 : 3));
+        }
+    }
+    unlink("rdiskbacked.txt");
+}
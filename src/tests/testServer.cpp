@@ -0,0 +1,201 @@
+#include <catch2/catch.hpp>
+#include <server/client.h>
+#include <server/protocol.h>
+#include <server/server.h>
+#include <rstartree/rstartree.h>
+#include <rstartreedisk/rstartreedisk.h>
+#include <util/geometry.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+static void sort_points( std::vector<Point> &points ) {
+    std::sort( points.begin(), points.end(), []( const Point &a, const Point
+                &b ) {
+        return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1]);
+    } );
+}
+
+TEST_CASE( "Server: Protocol round trip" ) {
+    std::vector<operation> ops;
+    ops.push_back( operation::insert( Point( 1.0, 2.0 ) ) );
+    ops.push_back( operation::point_query( Point( 3.0, 4.0 ) ) );
+    ops.push_back( operation::range_query( Rectangle( 0.0, 0.0, 5.0, 6.0 ) ) );
+    ops.push_back( operation::knn_query( Point( 7.0, 8.0 ), 3 ) );
+
+    std::vector<char> frame;
+    encode_request( 17, ops, frame );
+
+    request_header header;
+    std::vector<operation> decoded;
+    REQUIRE( decode_request( frame.data(), frame.size(), header, decoded ) );
+    REQUIRE( header.request_id_ == 17 );
+    REQUIRE( decoded.size() == ops.size() );
+    REQUIRE( decoded[0].opcode_ == OP_INSERT );
+    REQUIRE( decoded[0].point_ == Point( 1.0, 2.0 ) );
+    REQUIRE( decoded[1].opcode_ == OP_POINT_QUERY );
+    REQUIRE( decoded[1].point_ == Point( 3.0, 4.0 ) );
+    REQUIRE( decoded[2].opcode_ == OP_RANGE_QUERY );
+    REQUIRE( decoded[2].rectangle_ == Rectangle( 0.0, 0.0, 5.0, 6.0 ) );
+    REQUIRE( decoded[3].opcode_ == OP_KNN_QUERY );
+    REQUIRE( decoded[3].k_ == 3 );
+
+    // Truncated frames are rejected rather than read past
+    REQUIRE_FALSE( decode_request( frame.data(), frame.size() - 1, header,
+                decoded ) );
+
+    std::vector<std::vector<Point>> results = { {}, { Point( 3.0, 4.0 ) },
+        { Point( 1.0, 2.0 ), Point( 3.0, 4.0 ) }, {} };
+    std::vector<char> reply;
+    encode_response( 17, STATUS_OK, results, reply );
+
+    response_header reply_header;
+    std::vector<std::vector<Point>> decoded_results;
+    REQUIRE( decode_response( reply.data(), reply.size(), reply_header,
+                decoded_results ) );
+    REQUIRE( reply_header.request_id_ == 17 );
+    REQUIRE( reply_header.status_ == STATUS_OK );
+    REQUIRE( decoded_results == results );
+}
+
+TEST_CASE( "Server: Serves queries over a socket" ) {
+    std::string socket_path = "/tmp/nirtree_test_server_" + std::to_string(
+            getpid() ) + ".sock";
+    rstartree::RStarTree tree( 3, 7 );
+    query_server server( &tree, socket_path );
+    server.listen();
+    std::thread serving( [&server]() { server.run(); } );
+
+    // Stop the server even if a check fails so the thread can be joined
+    struct stop_on_exit {
+        query_server &server_;
+        std::thread &serving_;
+        ~stop_on_exit() {
+            server_.stop();
+            serving_.join();
+        }
+    } stopper{ server, serving };
+
+    std::vector<Point> points;
+    for( unsigned i = 0; i < 300; i++ ) {
+        points.push_back( Point( (i % 17) * 6.0, (i / 17) * 5.5 ) );
+    }
+
+    {
+        query_client client( socket_path );
+        for( const Point &p : points ) {
+            client.insert( p );
+        }
+
+        std::vector<Point> found = client.search( points[42] );
+        REQUIRE( found.size() == 1 );
+        REQUIRE( found[0] == points[42] );
+        REQUIRE( client.search( Point( 0.5, 0.5 ) ).empty() );
+
+        Rectangle range( 10.0, 10.0, 40.0, 30.0 );
+        std::vector<Point> expected;
+        for( const Point &p : points ) {
+            if( range.containsPoint( p ) ) {
+                expected.push_back( p );
+            }
+        }
+        found = client.search( range );
+        sort_points( expected );
+        sort_points( found );
+        REQUIRE( found == expected );
+
+        // kNN against brute force. Compare distances since ties can be
+        // broken either way.
+        Point centre( 50.5, 50.5 );
+        std::vector<Point> nearest = client.nearest( centre, 5 );
+        REQUIRE( nearest.size() == 5 );
+        std::vector<double> distances;
+        for( const Point &p : points ) {
+            distances.push_back( p.distance( centre ) );
+        }
+        std::sort( distances.begin(), distances.end() );
+        for( unsigned i = 0; i < nearest.size(); i++ ) {
+            REQUIRE( nearest[i].distance( centre ) == Approx( distances[i] ) );
+        }
+
+        // More neighbours than points returns them all
+        REQUIRE( client.nearest( centre, 1000 ).size() == points.size() );
+
+        std::vector<operation> ops;
+        ops.push_back( operation::insert( Point( 0.25, 0.25 ) ) );
+        ops.push_back( operation::point_query( Point( 0.25, 0.25 ) ) );
+        ops.push_back( operation::point_query( points[7] ) );
+        ops.push_back( operation::range_query( range ) );
+        std::vector<std::vector<Point>> results = client.batch( ops );
+        REQUIRE( results.size() == ops.size() );
+        REQUIRE( results[0].empty() );
+        REQUIRE( results[1].size() == 1 );
+        REQUIRE( results[2].size() == 1 );
+        REQUIRE( results[3].size() == expected.size() );
+
+        // Pipelined requests come back in order
+        uint32_t first = client.send( { operation::point_query( points[1] )
+                } );
+        uint32_t second = client.send( { operation::point_query( points[2] )
+                } );
+        uint32_t received;
+        REQUIRE( client.receive( received )[0][0] == points[1] );
+        REQUIRE( received == first );
+        REQUIRE( client.receive( received )[0][0] == points[2] );
+        REQUIRE( received == second );
+    }
+
+    REQUIRE( server.get_requests_served() > 0 );
+
+    unlink( socket_path.c_str() );
+}
+
+TEST_CASE( "Server: Nearest neighbours sized from the tree's extent" ) {
+    unlink( "rstardiskbacked.txt" );
+    {
+        rstartreedisk::RStarTreeDisk<3,7> tree( 4096*100,
+                "rstardiskbacked.txt" );
+        Rectangle bounds;
+        uint64_t point_count;
+        REQUIRE( tree.extent( bounds, point_count ) );
+        REQUIRE( point_count == 0 );
+        REQUIRE( nearest_neighbours( &tree, Point( 1.0, 1.0 ), 3 ).empty() );
+
+        // Far from the origin and spread wide, where growing a box from
+        // a fixed radius takes many searches
+        std::vector<Point> points;
+        for( unsigned i = 0; i < 2000; i++ ) {
+            points.push_back( Point( 1e6 + (i * 7919) % 2000 * 50.0, 2e6 +
+                        (i * 104729) % 2000 * 30.0 ) );
+            tree.insert( points.back() );
+        }
+        REQUIRE( tree.extent( bounds, point_count ) );
+        REQUIRE( point_count == points.size() );
+        for( const Point &p : points ) {
+            REQUIRE( bounds.containsPoint( p ) );
+        }
+
+        // Inside the data and well outside it
+        for( const Point &centre : { Point( 1.05e6, 2.03e6 ), Point( 0.0,
+                    0.0 ), Point( 1.2e6, 2.1e6 ) } ) {
+            std::vector<double> distances;
+            for( const Point &p : points ) {
+                distances.push_back( p.distance( centre ) );
+            }
+            std::sort( distances.begin(), distances.end() );
+            for( unsigned k : { 1u, 10u, 100u } ) {
+                std::vector<Point> nearest = nearest_neighbours( &tree,
+                        centre, k );
+                REQUIRE( nearest.size() == k );
+                for( unsigned i = 0; i < k; i++ ) {
+                    REQUIRE( nearest[i].distance( centre ) == Approx(
+                                distances[i] ) );
+                }
+            }
+        }
+        REQUIRE( nearest_neighbours( &tree, Point( 0.0, 0.0 ), 5000 ).size()
+                == points.size() );
+    }
+    unlink( "rstardiskbacked.txt" );
+}
@@ -2,6 +2,7 @@
 #include <rstartree/rstartree.h>
 #include <rstartree/node.h>
 #include <storage/tree_node_allocator.h>
+#include <storage/superblock.h>
 #include <storage/page.h>
 #include <unistd.h>
 #include <util/geometry.h>
@@ -97,7 +98,7 @@ TEST_CASE( "Tree Node Allocator: Can Handle Paged Out data" ) {
 class allocator_tester : public tree_node_allocator {
 public:
 
-    allocator_tester( size_t memory_budget, std::string
+    allocator_tester( buffer_budget memory_budget, std::string
             backing_file_name ) :
         tree_node_allocator( memory_budget, backing_file_name ) {}
 
@@ -111,6 +112,10 @@ public:
     size_t get_space_left_in_cur_page() {
         return space_left_in_cur_page_;
     }
+
+    size_t get_subtree_link_count() {
+        return subtree_parents_.size();
+    }
 };
 
 TEST_CASE( "Tree Node Allocator: Test pinned_node_ptr scope" ) {
@@ -232,3 +237,84 @@ TEST_CASE( "Tree Node Allocator: Test freelist split allocs" ) {
     REQUIRE( allocator.get_cur_page() == 1 );
 
 }
+
+TEST_CASE( "Tree Node Allocator: Superblock persists free list" ) {
+    superblock expected = superblock::describe( RTREE_DISK, 3, 6 );
+    std::vector<tree_node_handle> freed;
+    {
+        allocator_tester allocator( PAGE_SIZE*4, "file_backing.db" );
+        unlink( allocator.get_backing_file_name().c_str() );
+        allocator.initialize();
+
+        superblock sb;
+        REQUIRE( not allocator.load_superblock( expected, sb ) );
+        allocator.reserve_superblock();
+
+        // Enough frees to need more than one free list page
+        for( unsigned i = 0; i < 2000; i++ ) {
+            auto alloc_data = allocator.create_new_tree_node<size_t>();
+            if( i % 4 == 0 ) {
+                freed.push_back( alloc_data.second );
+            }
+        }
+        for( auto &handle : freed ) {
+            allocator.free( handle, sizeof(size_t) );
+        }
+
+        sb = expected;
+        allocator.write_superblock( sb );
+        REQUIRE( sb.free_list_entry_count_ == freed.size() );
+        REQUIRE( sb.free_list_head_ );
+    }
+
+    allocator_tester allocator( PAGE_SIZE*4, "file_backing.db" );
+    allocator.initialize();
+    superblock sb;
+    REQUIRE( allocator.load_superblock( expected, sb ) );
+    REQUIRE( sb.free_list_entry_count_ == freed.size() );
+
+    // Everything we freed comes back before any new space is used
+    size_t cur_page = allocator.get_cur_page();
+    for( unsigned i = 0; i < freed.size(); i++ ) {
+        auto alloc_data = allocator.create_new_tree_node<size_t>();
+        REQUIRE( std::find( freed.begin(), freed.end(), alloc_data.second
+                    ) != freed.end() );
+    }
+    REQUIRE( allocator.get_cur_page() == cur_page );
+
+    superblock wrong_fanout = superblock::describe( RTREE_DISK, 3, 7 );
+    allocator_tester allocator2( PAGE_SIZE*4, "file_backing.db" );
+    allocator2.initialize();
+    REQUIRE_THROWS( allocator2.load_superblock( wrong_fanout, sb ) );
+}
+
+TEST_CASE( "Tree Node Allocator: Freed nodes leave the subtree links" ) {
+    allocator_tester allocator( buffer_budget( PAGE_SIZE * 10, 2 ),
+            "file_backing.db" );
+    unlink( allocator.get_backing_file_name().c_str() );
+    allocator.initialize();
+
+    tree_node_handle root = allocator.create_new_tree_node<size_t>().second;
+    allocator.enter_subtree( root, tree_node_handle( nullptr ) );
+    tree_node_handle child = allocator.create_new_tree_node<size_t>().second;
+    allocator.enter_subtree( child, root );
+    tree_node_handle grandchild =
+        allocator.create_new_tree_node<size_t>().second;
+
+    // The child starts a page of its own, which the grandchild shares
+    REQUIRE( child.get_page_id() != root.get_page_id() );
+    REQUIRE( grandchild.get_page_id() == child.get_page_id() );
+    REQUIRE( allocator.get_page_subtree( child.get_page_id() ) != 0 );
+    REQUIRE( allocator.get_subtree_link_count() == 2 );
+
+    allocator.free( grandchild, sizeof(size_t) );
+    REQUIRE( allocator.get_subtree_link_count() == 1 );
+    REQUIRE( allocator.get_page_subtree( child.get_page_id() ) != 0 );
+
+    // Nothing is left of the subtree to file its page under
+    allocator.free( child, sizeof(size_t) );
+    REQUIRE( allocator.get_subtree_link_count() == 0 );
+    REQUIRE( allocator.get_page_subtree( child.get_page_id() ) == 0 );
+
+    unlink( allocator.get_backing_file_name().c_str() );
+}
@@ -0,0 +1,245 @@
+#include <util/densityRenderer.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+// Colours saturate at this many times the average density
+#define DENSITY_SATURATION 100.0
+
+DensityRenderer::DensityRenderer(tree_node_handle root, uint64_t pointCount, NodeExpander expand) :
+	root(root), pointCount(pointCount), expand(expand), height(0), fanout(1.0)
+{
+	assert(dimensions >= 2);
+
+	// The world is whatever the root's entries cover
+	range_estimator::branch_list branches;
+	std::vector<Point> points;
+	expandNode(root, branches, points);
+	Point lower = Point::atInfinity;
+	Point upper = Point::atNegInfinity;
+	for (const auto &branch : branches)
+	{
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			lower[d] = std::min(lower[d], branch.first.lowerLeft[d]);
+			upper[d] = std::max(upper[d], branch.first.upperRight[d]);
+		}
+	}
+	for (const Point &p : points)
+	{
+		Point above = Point::closest_larger_point(p);
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			lower[d] = std::min(lower[d], p[d]);
+			upper[d] = std::max(upper[d], above[d]);
+		}
+	}
+	world = Rectangle(lower, upper);
+
+	// Follow the first child of each node down to the leaves
+	while (!branches.empty())
+	{
+		tree_node_handle child = branches[0].second;
+		branches.clear();
+		points.clear();
+		expandNode(child, branches, points);
+		height++;
+	}
+	fanout = std::pow((double) std::max<uint64_t>(pointCount, 1), 1.0 / (height + 1));
+}
+
+void DensityRenderer::expandNode(tree_node_handle node, range_estimator::branch_list &branches, std::vector<Point> &points)
+{
+	std::lock_guard<std::mutex> guard(expandLatch);
+	expand(node, branches, points);
+}
+
+std::vector<double> DensityRenderer::tileCounts(unsigned zoom, unsigned x, unsigned y, unsigned tileSize)
+{
+	std::vector<double> counts(tileSize * tileSize, 0.0);
+	if (pointCount == 0)
+	{
+		return counts;
+	}
+
+	double tiles = (double) (1ULL << zoom);
+	double tileWidth = (world.upperRight[0] - world.lowerLeft[0]) / tiles;
+	double tileHeight = (world.upperRight[1] - world.lowerLeft[1]) / tiles;
+	double pixelWidth = tileWidth / tileSize;
+	double pixelHeight = tileHeight / tileSize;
+	double left = world.lowerLeft[0] + x * tileWidth;
+	double top = world.upperRight[1] - y * tileHeight;
+
+	// Unbounded in every other dimension
+	Rectangle tile = Rectangle::atInfinity;
+	tile.lowerLeft = Point::atNegInfinity;
+	tile.upperRight = Point::atInfinity;
+	tile.lowerLeft[0] = left;
+	tile.upperRight[0] = left + tileWidth;
+	tile.lowerLeft[1] = top - tileHeight;
+	tile.upperRight[1] = top;
+
+	auto pixel = [&](const Point &p) -> double & {
+		unsigned column = std::min<double>(tileSize - 1, std::max(0.0, std::floor((p[0] - left) / pixelWidth)));
+		unsigned row = std::min<double>(tileSize - 1, std::max(0.0, std::floor((top - p[1]) / pixelHeight)));
+		return counts[row * tileSize + column];
+	};
+
+	std::vector<std::pair<tree_node_handle, unsigned>> stack = {std::make_pair(root, height)};
+	range_estimator::branch_list branches;
+	std::vector<Point> points;
+	range_estimator::branch_list childBranches;
+	std::vector<Point> childPoints;
+	while (!stack.empty())
+	{
+		tree_node_handle node = stack.back().first;
+		unsigned nodeHeight = stack.back().second;
+		stack.pop_back();
+
+		branches.clear();
+		points.clear();
+		expandNode(node, branches, points);
+		for (const Point &p : points)
+		{
+			if (tile.containsPoint(p))
+			{
+				pixel(p) += 1.0;
+			}
+		}
+
+		unsigned childHeight = nodeHeight > 0 ? nodeHeight - 1 : 0;
+		for (const auto &branch : branches)
+		{
+			const Rectangle &box = branch.first;
+			if (!box.intersectsRectangle(tile))
+			{
+				continue;
+			}
+			if (box.upperRight[0] - box.lowerLeft[0] > pixelWidth || box.upperRight[1] - box.lowerLeft[1] > pixelHeight)
+			{
+				stack.push_back(std::make_pair(branch.second, childHeight));
+				continue;
+			}
+
+			// Sub-pixel, so the child's fill stands in for its subtree.
+			// Only the tile holding the centre counts it.
+			Point centre = box.centrePoint();
+			if (!tile.containsPoint(centre))
+			{
+				continue;
+			}
+			childBranches.clear();
+			childPoints.clear();
+			expandNode(branch.second, childBranches, childPoints);
+			double fill = childBranches.size() + childPoints.size();
+			pixel(centre) += fill * std::pow(fanout, childHeight);
+		}
+	}
+
+	return counts;
+}
+
+void DensityRenderer::writeTile(const std::string &path, const std::vector<double> &counts, unsigned tileSize, double saturation)
+{
+	// Black, blue, red, yellow, white
+	static const double stops[5][3] = {{0, 0, 0}, {0, 0, 255}, {255, 0, 0}, {255, 255, 0}, {255, 255, 255}};
+
+	unsigned rowBytes = (tileSize * 3 + 3) & ~3u;
+	unsigned dataSize = rowBytes * tileSize;
+	char header[54];
+	memset(header, 0, 54);
+	header[0] = 'B', header[1] = 'M'; // Signature
+	unsigned fileSize = 54 + dataSize;
+	memcpy(&header[2], &fileSize, 4);
+	header[10] = 54; // Offset to data
+	header[14] = 40; // Info header size
+	memcpy(&header[18], &tileSize, 4); // Width
+	memcpy(&header[22], &tileSize, 4); // Height
+	header[26] = 1; // Number of planes
+	header[28] = 24; // Bits per pixel
+	memcpy(&header[34], &dataSize, 4);
+
+	std::vector<char> data(dataSize, 0);
+	double logSaturation = std::log1p(saturation);
+	for (unsigned row = 0; row < tileSize; ++row)
+	{
+		// BMP rows run bottom up
+		char *out = &data[(tileSize - 1 - row) * rowBytes];
+		for (unsigned column = 0; column < tileSize; ++column)
+		{
+			double t = std::min(1.0, std::log1p(counts[row * tileSize + column]) / logSaturation) * 4.0;
+			unsigned stop = std::min(3u, (unsigned) t);
+			double blend = t - stop;
+			for (unsigned c = 0; c < 3; ++c)
+			{
+				// Blue, green, red
+				double value = stops[stop][2 - c] + blend * (stops[stop + 1][2 - c] - stops[stop][2 - c]);
+				out[column * 3 + c] = (char) (unsigned char) value;
+			}
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(header, 54);
+	file.write(data.data(), dataSize);
+}
+
+unsigned DensityRenderer::render(const std::string &directory, unsigned maxZoom, unsigned tileSize, unsigned threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	uint64_t tileTotal = 0;
+	for (unsigned zoom = 0; zoom <= maxZoom; ++zoom)
+	{
+		tileTotal += 1ULL << (2 * zoom);
+	}
+
+	std::atomic<uint64_t> nextTile(0);
+	std::atomic<unsigned> written(0);
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threadCount; ++t)
+	{
+		workers.emplace_back([&]() {
+			for (uint64_t i = nextTile++; i < tileTotal; i = nextTile++)
+			{
+				unsigned zoom = 0;
+				uint64_t index = i;
+				while (index >= (1ULL << (2 * zoom)))
+				{
+					index -= 1ULL << (2 * zoom);
+					zoom++;
+				}
+				unsigned x = index % (1ULL << zoom);
+				unsigned y = index >> zoom;
+
+				std::vector<double> counts = tileCounts(zoom, x, y, tileSize);
+				if (std::all_of(counts.begin(), counts.end(), [](double c) { return c == 0.0; }))
+				{
+					continue;
+				}
+
+				double pixels = (double) (1ULL << zoom) * tileSize;
+				double saturation = std::max(1.0, DENSITY_SATURATION * pointCount / (pixels * pixels));
+				std::string tileDirectory = directory + "/" + std::to_string(zoom) + "/" + std::to_string(x);
+				std::error_code error;
+				std::filesystem::create_directories(tileDirectory, error);
+				writeTile(tileDirectory + "/" + std::to_string(y) + ".bmp", counts, tileSize, saturation);
+				written++;
+			}
+		});
+	}
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+
+	return written;
+}
@@ -0,0 +1,113 @@
+#include <util/epochs.h>
+#include <functional>
+#include <limits>
+#include <thread>
+
+// Retired objects gathered before trying to free any
+#define EPOCH_RECLAIM_THRESHOLD 64
+
+EpochManager::EpochManager() : globalEpoch(1)
+{
+	for (unsigned i = 0; i < slotCount; ++i)
+	{
+		slots[i].epoch.store(0, std::memory_order_relaxed);
+	}
+}
+
+EpochManager::~EpochManager()
+{
+	for (auto &entry : retired)
+	{
+		entry.second();
+	}
+}
+
+EpochManager::Guard::Guard(EpochManager &manager) : manager(manager)
+{
+	// Start from a slot of our own so threads don't fight over one
+	unsigned start = std::hash<std::thread::id>()(std::this_thread::get_id()) % slotCount;
+	for (unsigned i = 0; ; ++i)
+	{
+		slot = (start + i) % slotCount;
+		uint64_t expected = 0;
+		uint64_t epoch = manager.globalEpoch.load(std::memory_order_seq_cst);
+		if (manager.slots[slot].epoch.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst))
+		{
+			break;
+		}
+		if (i % slotCount == slotCount - 1)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Either a writer reclaiming sees our slot, or we see whatever it
+	// unlinked before it looked
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+EpochManager::Guard::~Guard()
+{
+	manager.slots[slot].epoch.store(0, std::memory_order_release);
+}
+
+void EpochManager::retire(std::function<void()> deleter)
+{
+	std::lock_guard<std::mutex> guard(retireLatch);
+	// Readers entering from here on can't reach what was unlinked
+	uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+	retired.emplace_back(epoch, std::move(deleter));
+	if (retired.size() >= EPOCH_RECLAIM_THRESHOLD)
+	{
+		reclaimLocked();
+	}
+}
+
+size_t EpochManager::reclaim()
+{
+	std::lock_guard<std::mutex> guard(retireLatch);
+	return reclaimLocked();
+}
+
+size_t EpochManager::pending()
+{
+	std::lock_guard<std::mutex> guard(retireLatch);
+	return retired.size();
+}
+
+size_t EpochManager::reclaimLocked()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	uint64_t oldestReader = std::numeric_limits<uint64_t>::max();
+	for (unsigned i = 0; i < slotCount; ++i)
+	{
+		uint64_t epoch = slots[i].epoch.load(std::memory_order_seq_cst);
+		if (epoch != 0 && epoch < oldestReader)
+		{
+			oldestReader = epoch;
+		}
+	}
+
+	// Readers that entered in the epoch something was retired in may
+	// have seen it, later ones can't have
+	size_t kept = 0;
+	size_t freed = 0;
+	for (size_t i = 0; i < retired.size(); ++i)
+	{
+		if (retired[i].first < oldestReader)
+		{
+			retired[i].second();
+			freed++;
+		}
+		else
+		{
+			if (kept != i)
+			{
+				retired[kept] = std::move(retired[i]);
+			}
+			kept++;
+		}
+	}
+	retired.resize(kept);
+	return freed;
+}
@@ -0,0 +1,507 @@
+#include <util/packedtree.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+// Branches with fewer children are scanned, a model buys nothing there
+#define LEARNED_ROUTING_MIN_CHILDREN 8
+
+// Segments a routing model gets for each child of its node
+#define LEARNED_ROUTING_SEGMENTS_PER_CHILD 4
+
+// Owners are only stored for nodes where some child has several boxes
+static bool hasOwners(uint16_t boxCount, uint16_t childCount)
+{
+	return childCount != 0 and boxCount != childCount;
+}
+
+static size_t footerOffset(uint16_t boxCount, uint16_t childCount)
+{
+	size_t bytes;
+	if (childCount == 0)
+	{
+		bytes = boxCount * sizeof(Point);
+	}
+	else
+	{
+		bytes = boxCount * sizeof(Rectangle) + childCount * sizeof(PackedTree::Ref);
+		if (hasOwners(boxCount, childCount))
+		{
+			bytes += boxCount * sizeof(uint16_t);
+		}
+	}
+
+	return (bytes + alignof(PackedTree::Footer) - 1) / alignof(PackedTree::Footer) * alignof(PackedTree::Footer);
+}
+
+size_t PackedTree::nodeBytes(const Pending &node)
+{
+	return footerOffset(node.ref.boxCount, node.ref.childCount) + sizeof(Footer);
+}
+
+void PackedTree::write(std::deque<Pending> &pending)
+{
+	static_assert(sizeof(Rectangle) % alignof(Ref) == 0, "children must follow the boxes aligned");
+	root = pending[0].ref;
+	nodes = pending.size();
+	std::memset(arena.data(), 0, arena.size() * sizeof(Line));
+
+	for (const Pending &node : pending)
+	{
+		unsigned char *block = arena[node.ref.line].bytes;
+		if (node.ref.childCount == 0)
+		{
+			std::memcpy(block, node.points.data(), node.points.size() * sizeof(Point));
+		}
+		else
+		{
+			unsigned char *cursor = block;
+			std::memcpy(cursor, node.boxes.data(), node.boxes.size() * sizeof(Rectangle));
+			cursor += node.boxes.size() * sizeof(Rectangle);
+			for (uint32_t child : node.children)
+			{
+				std::memcpy(cursor, &pending[child].ref, sizeof(Ref));
+				cursor += sizeof(Ref);
+			}
+			if (hasOwners(node.ref.boxCount, node.ref.childCount))
+			{
+				std::memcpy(cursor, node.owners.data(), node.owners.size() * sizeof(uint16_t));
+			}
+		}
+		std::memcpy(block + footerOffset(node.ref.boxCount, node.ref.childCount), &node.footer, sizeof(Footer));
+	}
+}
+
+std::vector<Point> PackedTree::search(const Point &requestedPoint) const
+{
+	std::vector<Point> accumulator;
+	std::vector<Ref> context = {root};
+	uint64_t key = models.empty() ? 0 : curveKey(requestedPoint);
+	while (not context.empty())
+	{
+		Ref ref = context.back();
+		context.pop_back();
+		const unsigned char *block = at(ref.line);
+
+		if (ref.childCount == 0)
+		{
+			const Point *points = (const Point *) block;
+			for (uint16_t i = 0; i < ref.boxCount; ++i)
+			{
+				if (points[i] == requestedPoint)
+				{
+					accumulator.push_back(points[i]);
+				}
+			}
+			continue;
+		}
+
+		const Rectangle *boxes = (const Rectangle *) block;
+		const Ref *children = (const Ref *) (boxes + ref.boxCount);
+		if (ref.line < modelAtLine.size() and modelAtLine[ref.line] >= 0)
+		{
+			route(models[modelAtLine[ref.line]], key, requestedPoint, boxes, children, context);
+			continue;
+		}
+
+		const uint16_t *owners = hasOwners(ref.boxCount, ref.childCount) ? (const uint16_t *) (children + ref.childCount) : nullptr;
+		// A child's boxes are together, so skipping repeats of the last
+		// one taken is enough to take each child once
+		int lastTaken = -1;
+		for (uint16_t i = 0; i < ref.boxCount; ++i)
+		{
+			int owner = owners == nullptr ? i : owners[i];
+			if (owner != lastTaken and boxes[i].containsPoint(requestedPoint))
+			{
+				context.push_back(children[owner]);
+				lastTaken = owner;
+			}
+		}
+	}
+
+	return accumulator;
+}
+
+std::vector<Point> PackedTree::search(const Rectangle &requestedRectangle) const
+{
+	std::vector<Point> accumulator;
+	std::vector<Ref> context = {root};
+	while (not context.empty())
+	{
+		Ref ref = context.back();
+		context.pop_back();
+		const unsigned char *block = at(ref.line);
+
+		if (ref.childCount == 0)
+		{
+			const Point *points = (const Point *) block;
+			for (uint16_t i = 0; i < ref.boxCount; ++i)
+			{
+				if (requestedRectangle.containsPoint(points[i]))
+				{
+					accumulator.push_back(points[i]);
+				}
+			}
+			continue;
+		}
+
+		const Rectangle *boxes = (const Rectangle *) block;
+		const Ref *children = (const Ref *) (boxes + ref.boxCount);
+		const uint16_t *owners = hasOwners(ref.boxCount, ref.childCount) ? (const uint16_t *) (children + ref.childCount) : nullptr;
+		int lastTaken = -1;
+		for (uint16_t i = 0; i < ref.boxCount; ++i)
+		{
+			int owner = owners == nullptr ? i : owners[i];
+			if (owner != lastTaken and boxes[i].intersectsRectangle(requestedRectangle))
+			{
+				context.push_back(children[owner]);
+				lastTaken = owner;
+			}
+		}
+	}
+
+	return accumulator;
+}
+
+uint64_t PackedTree::curveKey(const Point &p) const
+{
+	// Cells must fit in a double's mantissa to be computed exactly
+	const unsigned bits = std::min(64u / dimensions, 52u);
+	const double maxCell = (double) ((1ull << bits) - 1);
+	uint64_t cells[dimensions];
+	for (unsigned d = 0; d < dimensions; ++d)
+	{
+		double extent = curveBounds.upperRight[d] - curveBounds.lowerLeft[d];
+		double t = extent > 0.0 ? (p[d] - curveBounds.lowerLeft[d]) / extent : 0.0;
+		t = std::min(std::max(t, 0.0), 1.0);
+		cells[d] = (uint64_t) (t * maxCell);
+	}
+
+	uint64_t key = 0;
+	for (int b = bits - 1; b >= 0; --b)
+	{
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			key = (key << 1) | ((cells[d] >> b) & 1);
+		}
+	}
+
+	return key;
+}
+
+void PackedTree::collectPoints(Ref ref, std::vector<Point> &points) const
+{
+	std::vector<Ref> context = {ref};
+	while (not context.empty())
+	{
+		Ref current = context.back();
+		context.pop_back();
+		const unsigned char *block = at(current.line);
+		if (current.childCount == 0)
+		{
+			const Point *leafPoints = (const Point *) block;
+			points.insert(points.end(), leafPoints, leafPoints + current.boxCount);
+			continue;
+		}
+
+		const Ref *children = (const Ref *) ((const Rectangle *) block + current.boxCount);
+		context.insert(context.end(), children, children + current.childCount);
+	}
+}
+
+int64_t PackedTree::predictRank(const Segment &segment, uint64_t offset, unsigned childCount)
+{
+	// Clamped before converting, so wild predictions for keys the model
+	// never saw stay representable
+	double prediction = std::floor(segment.slope * (double) offset + segment.intercept);
+	prediction = std::min(std::max(prediction, -(double) childCount), 2.0 * childCount);
+	return (int64_t) prediction;
+}
+
+PackedTree::RoutingModel PackedTree::learnModel(Ref ref) const
+{
+	const unsigned char *block = at(ref.line);
+	const Rectangle *boxes = (const Rectangle *) block;
+	const Ref *children = (const Ref *) (boxes + ref.boxCount);
+	const uint16_t *owners = hasOwners(ref.boxCount, ref.childCount) ? (const uint16_t *) (children + ref.childCount) : nullptr;
+	unsigned childCount = ref.childCount;
+
+	std::vector<uint16_t> firstBoxes(childCount, 0);
+	std::vector<uint16_t> boxCounts(childCount, 0);
+	for (uint16_t i = 0; i < ref.boxCount; ++i)
+	{
+		uint16_t owner = owners == nullptr ? i : owners[i];
+		if (boxCounts[owner] == 0)
+		{
+			firstBoxes[owner] = i;
+		}
+		boxCounts[owner]++;
+	}
+
+	std::vector<std::vector<uint64_t>> keys(childCount);
+	std::vector<Point> points;
+	for (unsigned c = 0; c < childCount; ++c)
+	{
+		points.clear();
+		collectPoints(children[c], points);
+		for (const Point &p : points)
+		{
+			keys[c].push_back(curveKey(p));
+		}
+		std::sort(keys[c].begin(), keys[c].end());
+	}
+
+	// Ranked along the curve the mapping from key to rank is close to a
+	// staircase, which a few segments per child follow well
+	std::vector<uint16_t> order(childCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&keys](uint16_t a, uint16_t b)
+	{
+		if (keys[a].empty() or keys[b].empty())
+		{
+			return not keys[a].empty() and keys[b].empty();
+		}
+		return keys[a][keys[a].size() / 2] < keys[b][keys[b].size() / 2];
+	});
+
+	RoutingModel model;
+	std::vector<std::pair<uint64_t, uint16_t>> samples;
+	for (unsigned rank = 0; rank < childCount; ++rank)
+	{
+		uint16_t child = order[rank];
+		model.children.push_back(child);
+		model.firstBoxes.push_back(firstBoxes[child]);
+		model.boxCounts.push_back(boxCounts[child]);
+		for (uint64_t key : keys[child])
+		{
+			samples.emplace_back(key, rank);
+		}
+	}
+	std::sort(samples.begin(), samples.end());
+
+	if (samples.empty())
+	{
+		// Nothing to learn from, so every child stays a candidate
+		model.segmentKeys.push_back(0);
+		model.segments.push_back({0.0, 0.0, 0, (uint16_t) (childCount - 1)});
+		return model;
+	}
+
+	size_t perSegment = std::max((size_t) 1, samples.size() / (childCount * LEARNED_ROUTING_SEGMENTS_PER_CHILD));
+	for (size_t begin = 0; begin < samples.size(); )
+	{
+		// Equal keys stay in one segment, which is what a search for
+		// them will look in
+		size_t end = std::min(samples.size(), begin + perSegment);
+		while (end < samples.size() and samples[end].first == samples[end - 1].first)
+		{
+			end++;
+		}
+
+		// Least squares over the offsets from the segment's first key
+		uint64_t firstKey = samples[begin].first;
+		double count = end - begin;
+		double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			double x = (double) (samples[i].first - firstKey);
+			double y = samples[i].second;
+			sumX += x;
+			sumY += y;
+			sumXX += x * x;
+			sumXY += x * y;
+		}
+		Segment segment;
+		double denominator = count * sumXX - sumX * sumX;
+		if (denominator > 0.0)
+		{
+			segment.slope = (count * sumXY - sumX * sumY) / denominator;
+			segment.intercept = (sumY - segment.slope * sumX) / count;
+		}
+		else
+		{
+			segment.slope = 0.0;
+			segment.intercept = sumY / count;
+		}
+
+		int64_t below = 0;
+		int64_t above = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			int64_t predicted = predictRank(segment, samples[i].first - firstKey, childCount);
+			below = std::max(below, predicted - (int64_t) samples[i].second);
+			above = std::max(above, (int64_t) samples[i].second - predicted);
+		}
+		segment.below = below;
+		segment.above = above;
+
+		model.segmentKeys.push_back(firstKey);
+		model.segments.push_back(segment);
+		begin = end;
+	}
+
+	return model;
+}
+
+void PackedTree::route(const RoutingModel &model, uint64_t key, const Point &requestedPoint, const Rectangle *boxes, const Ref *children, std::vector<Ref> &context)
+{
+	auto next = std::upper_bound(model.segmentKeys.begin(), model.segmentKeys.end(), key);
+	size_t s = next == model.segmentKeys.begin() ? 0 : next - model.segmentKeys.begin() - 1;
+	const Segment &segment = model.segments[s];
+	uint64_t offset = key < model.segmentKeys[s] ? 0 : key - model.segmentKeys[s];
+	int64_t childCount = model.children.size();
+	int64_t predicted = predictRank(segment, offset, childCount);
+
+	// The error bounds cover every point the model learned from, so the
+	// children outside them can't hold the point. Inside them the boxes
+	// still decide.
+	int64_t lowest = std::max((int64_t) 0, predicted - segment.below);
+	int64_t highest = std::min(childCount - 1, predicted + segment.above);
+	for (int64_t rank = lowest; rank <= highest; ++rank)
+	{
+		const Rectangle *childBoxes = boxes + model.firstBoxes[rank];
+		for (uint16_t i = 0; i < model.boxCounts[rank]; ++i)
+		{
+			if (childBoxes[i].containsPoint(requestedPoint))
+			{
+				context.push_back(children[model.children[rank]]);
+				break;
+			}
+		}
+	}
+}
+
+void PackedTree::learnRouting(unsigned depth)
+{
+	models.clear();
+	modelAtLine.clear();
+	if (depth == 0)
+	{
+		return;
+	}
+
+	std::vector<Point> points;
+	collectPoints(root, points);
+	if (points.empty())
+	{
+		return;
+	}
+	curveBounds = Rectangle(points[0], points[0]);
+	for (const Point &p : points)
+	{
+		for (unsigned d = 0; d < dimensions; ++d)
+		{
+			curveBounds.lowerLeft[d] = std::min(curveBounds.lowerLeft[d], p[d]);
+			curveBounds.upperRight[d] = std::max(curveBounds.upperRight[d], p[d]);
+		}
+	}
+
+	std::vector<Ref> level = {root};
+	std::vector<Ref> nextLevel;
+	for (unsigned d = 0; d < depth and not level.empty(); ++d)
+	{
+		for (Ref ref : level)
+		{
+			if (ref.childCount == 0)
+			{
+				continue;
+			}
+			if (ref.childCount >= LEARNED_ROUTING_MIN_CHILDREN)
+			{
+				if (modelAtLine.size() <= ref.line)
+				{
+					modelAtLine.resize(ref.line + 1, -1);
+				}
+				modelAtLine[ref.line] = models.size();
+				models.push_back(learnModel(ref));
+			}
+			const Ref *children = (const Ref *) ((const Rectangle *) at(ref.line) + ref.boxCount);
+			nextLevel.insert(nextLevel.end(), children, children + ref.childCount);
+		}
+		level.swap(nextLevel);
+		nextLevel.clear();
+	}
+}
+
+size_t PackedTree::nodeCount() const
+{
+	return nodes;
+}
+
+size_t PackedTree::routedNodeCount() const
+{
+	return models.size();
+}
+
+unsigned PackedTree::height() const
+{
+	unsigned height = 1;
+	Ref ref = root;
+	while (ref.childCount != 0)
+	{
+		ref = *(const Ref *) ((const Rectangle *) at(ref.line) + ref.boxCount);
+		height++;
+	}
+
+	return height;
+}
+
+size_t PackedTree::size() const
+{
+	return arena.size() * sizeof(Line);
+}
+
+bool PackedTree::validate() const
+{
+	// Every node starts a cache line, lies inside the arena and names
+	// the parent that reaches it
+	std::vector<std::pair<Ref, Footer>> context = {{root, {0, 0}}};
+	size_t seen = 0;
+	while (not context.empty())
+	{
+		Ref ref = context.back().first;
+		Footer expected = context.back().second;
+		context.pop_back();
+		seen++;
+
+		size_t end = ref.line * sizeof(Line) + footerOffset(ref.boxCount, ref.childCount) + sizeof(Footer);
+		if (end > size() or (uintptr_t) at(ref.line) % CACHE_LINE_SIZE != 0)
+		{
+			return false;
+		}
+
+		Footer footer;
+		std::memcpy(&footer, at(ref.line) + footerOffset(ref.boxCount, ref.childCount), sizeof(Footer));
+		if (footer.depth != expected.depth or footer.parentLine != expected.parentLine)
+		{
+			std::cout << "Packed node at line " << ref.line << " has depth " << footer.depth << " and parent " << footer.parentLine << ", expected " << expected.depth << " and " << expected.parentLine << std::endl;
+			return false;
+		}
+
+		const Rectangle *boxes = (const Rectangle *) at(ref.line);
+		const Ref *children = (const Ref *) (boxes + ref.boxCount);
+		for (uint16_t i = 0; i < ref.childCount; ++i)
+		{
+			context.push_back({children[i], {footer.depth + 1, ref.line}});
+		}
+	}
+
+	return seen == nodes;
+}
+
+void PackedTree::stat() const
+{
+	std::cout << "Packed nodes: " << nodes << std::endl;
+	std::cout << "Packed size: " << size() << " bytes in " << arena.size() << " cache lines" << std::endl;
+	std::cout << "Average cache lines per node: " << (double) arena.size() / nodes << std::endl;
+	if (not models.empty())
+	{
+		size_t segments = 0;
+		for (const RoutingModel &model : models)
+		{
+			segments += model.segments.size();
+		}
+		std::cout << "Routed nodes: " << models.size() << " with " << (double) segments / models.size() << " segments each" << std::endl;
+	}
+}